@@ -0,0 +1,7 @@
+option(BUILD_AGGREGATE "Build aggregator building the cross-backend comparison matrix" OFF)
+
+if (BUILD_AGGREGATE)
+    add_executable(aggregate_results ${CMAKE_SOURCE_DIR}/source/aggregate/main.cc)
+    target_compile_options(aggregate_results PRIVATE -O2)
+    target_link_libraries(aggregate_results PUBLIC gflags::gflags glog::glog)
+endif()
@@ -9,15 +9,20 @@ if (BUILD_ARCHTEST)
         ${SOURCE_DIR}/lmbench
     )
 
+    find_package(Threads REQUIRED)
+
     add_executable(arch_test 
         ${SOURCE_DIR}/main.cc
     )
     set_target_properties(arch_test PROPERTIES LINKER_LANGUAGE CXX)
+    # 微基准的kernel依赖寄存器分配与循环展开，不论构建类型都需要开启优化
+    target_compile_options(arch_test PRIVATE -O2)
 
     target_link_libraries(arch_test 
                         PUBLIC
                         gflags::gflags 
-                        glog::glog)
+                        glog::glog
+                        Threads::Threads)
 
     add_executable(
         cache
@@ -33,6 +38,7 @@ if (BUILD_ARCHTEST)
     add_executable(
         bw_mem
         ${SOURCE_DIR}/lmbench/bw_mem.c
+        ${SOURCE_DIR}/lmbench/lib_bw_mem.c
         ${SOURCE_DIR}/lmbench/getopt.c
         ${SOURCE_DIR}/lmbench/lib_debug.c
         ${SOURCE_DIR}/lmbench/lib_mem.c
@@ -41,10 +47,37 @@ if (BUILD_ARCHTEST)
     )
     set_target_properties(bw_mem PROPERTIES LINKER_LANGUAGE C)
 
+    add_executable(
+        tlb
+        ${SOURCE_DIR}/lmbench/tlb.c
+        ${SOURCE_DIR}/lmbench/getopt.c
+        ${SOURCE_DIR}/lmbench/lib_debug.c
+        ${SOURCE_DIR}/lmbench/lib_mem.c
+        ${SOURCE_DIR}/lmbench/lib_timing.c
+        ${SOURCE_DIR}/lmbench/lib_sched.c
+    )
+    set_target_properties(tlb PROPERTIES LINKER_LANGUAGE C)
+
+    # 内存争用测试：aggressor复用bw_mem的kernel，victim为lib_mem的指针追逐或模拟后端
+    add_executable(
+        mem_contention
+        ${SOURCE_DIR}/contention.cc
+        ${SOURCE_DIR}/lmbench/lib_bw_mem.c
+        ${SOURCE_DIR}/lmbench/getopt.c
+        ${SOURCE_DIR}/lmbench/lib_debug.c
+        ${SOURCE_DIR}/lmbench/lib_mem.c
+        ${SOURCE_DIR}/lmbench/lib_timing.c
+        ${SOURCE_DIR}/lmbench/lib_sched.c
+    )
+    set_target_properties(mem_contention PROPERTIES LINKER_LANGUAGE CXX)
+    target_compile_options(mem_contention PRIVATE -O2)
+
 
     set_source_files_properties(
         ${SOURCE_DIR}/lmbench/cache.c
         ${SOURCE_DIR}/lmbench/bw_mem.c
+        ${SOURCE_DIR}/lmbench/tlb.c
+        ${SOURCE_DIR}/lmbench/lib_bw_mem.c
         ${SOURCE_DIR}/lmbench/getopt.c
         ${SOURCE_DIR}/lmbench/lib_debug.c
         ${SOURCE_DIR}/lmbench/lib_mem.c
@@ -58,5 +91,14 @@ if (BUILD_ARCHTEST)
     target_link_libraries(bw_mem 
                         PUBLIC 
                         m)
+    target_link_libraries(tlb 
+                        PUBLIC 
+                        m)
+    target_link_libraries(mem_contention 
+                        PUBLIC
+                        gflags::gflags 
+                        glog::glog
+                        Threads::Threads
+                        m)
     
 endif(BUILD_ARCHTEST)
@@ -0,0 +1,8 @@
+option(BUILD_BATCHER "Build dynamic batching benchmark on the simulated backend" OFF)
+
+if (BUILD_BATCHER)
+    find_package(Threads REQUIRED)
+    add_executable(batcher_benchmark ${CMAKE_SOURCE_DIR}/source/batcher/main.cc)
+    target_compile_options(batcher_benchmark PRIVATE -O2)
+    target_link_libraries(batcher_benchmark PUBLIC gflags::gflags glog::glog Threads::Threads)
+endif()
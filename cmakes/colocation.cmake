@@ -0,0 +1,8 @@
+option(BUILD_COLOCATION "Build multi-model co-location benchmark on the simulated backend" OFF)
+
+if (BUILD_COLOCATION)
+    find_package(Threads REQUIRED)
+    add_executable(colocation_benchmark ${CMAKE_SOURCE_DIR}/source/colocation/main.cc)
+    target_compile_options(colocation_benchmark PRIVATE -O2)
+    target_link_libraries(colocation_benchmark PUBLIC gflags::gflags glog::glog Threads::Threads)
+endif()
@@ -0,0 +1,7 @@
+option(BUILD_COMPARE "Build regression detector comparing benchmark result files" OFF)
+
+if (BUILD_COMPARE)
+    add_executable(compare_results ${CMAKE_SOURCE_DIR}/source/compare/main.cc)
+    target_compile_options(compare_results PRIVATE -O2)
+    target_link_libraries(compare_results PUBLIC gflags::gflags glog::glog)
+endif()
@@ -0,0 +1,31 @@
+option(BUILD_NPUBENCH "Build npubench with runtime-loaded backend plugins" OFF)
+
+# npubench本身不链接任何SDK，内置simulated后端；打开BUILD_RKNN2/BUILD_HBBPU/BUILD_HIAI/BUILD_OPENVINO时
+# 同时编译对应的插件libnpubench_<backend>.so，与npubench输出在同一个目录
+if (BUILD_NPUBENCH)
+    find_package(Threads REQUIRED)
+    add_executable(npubench ${CMAKE_SOURCE_DIR}/source/npubench/main.cc)
+    target_compile_options(npubench PRIVATE -O2)
+    target_link_libraries(npubench PUBLIC gflags::gflags glog::glog Threads::Threads ${CMAKE_DL_LIBS})
+
+    set(NPUBENCH_PLUGIN_DIR ${CMAKE_SOURCE_DIR}/source/npubench/plugins)
+    function(add_npubench_plugin name sdk)
+        add_library(npubench_${name} MODULE ${NPUBENCH_PLUGIN_DIR}/${name}.cc)
+        target_compile_options(npubench_${name} PRIVATE -O2)
+        target_link_libraries(npubench_${name} PRIVATE ${sdk})
+        add_dependencies(npubench npubench_${name})
+    endfunction()
+
+    if (BUILD_RKNN2)
+        add_npubench_plugin(rknn RKNN2)
+    endif()
+    if (BUILD_HBBPU)
+        add_npubench_plugin(bpu HBBPU)
+    endif()
+    if (BUILD_HIAI)
+        add_npubench_plugin(hiai HIAI)
+    endif()
+    if (BUILD_OPENVINO)
+        add_npubench_plugin(openvino openvino::runtime)
+    endif()
+endif()
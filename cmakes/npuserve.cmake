@@ -0,0 +1,13 @@
+option(BUILD_NPUSERVE "Build the npuserve inference daemon and its client" OFF)
+
+# npuserve与npubench共用后端插件，同时打开BUILD_NPUBENCH和各后端选项时插件输出在同一个目录
+if (BUILD_NPUSERVE)
+    find_package(Threads REQUIRED)
+    add_executable(npuserve ${CMAKE_SOURCE_DIR}/source/npuserve/main.cc)
+    target_compile_options(npuserve PRIVATE -O2)
+    target_link_libraries(npuserve PUBLIC gflags::gflags glog::glog Threads::Threads ${CMAKE_DL_LIBS})
+
+    add_executable(npuserve_client ${CMAKE_SOURCE_DIR}/source/npuserve/client.cc)
+    target_compile_options(npuserve_client PRIVATE -O2)
+    target_link_libraries(npuserve_client PUBLIC gflags::gflags glog::glog Threads::Threads)
+endif()
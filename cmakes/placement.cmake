@@ -0,0 +1,8 @@
+option(BUILD_PLACEMENT "Build multi-core placement sweep on the simulated backend" OFF)
+
+if (BUILD_PLACEMENT)
+    find_package(Threads REQUIRED)
+    add_executable(placement_benchmark ${CMAKE_SOURCE_DIR}/source/placement/main.cc)
+    target_compile_options(placement_benchmark PRIVATE -O2)
+    target_link_libraries(placement_benchmark PUBLIC gflags::gflags glog::glog Threads::Threads)
+endif()
@@ -0,0 +1,8 @@
+option(BUILD_POSTPROCESS "Build post-processing kernel benchmark" OFF)
+
+if (BUILD_POSTPROCESS)
+    add_executable(postprocess_benchmark ${CMAKE_SOURCE_DIR}/source/postprocess/main.cc)
+    # 标量参考实现也需要开启优化，否则加速比没有意义
+    target_compile_options(postprocess_benchmark PRIVATE -O2)
+    target_link_libraries(postprocess_benchmark PUBLIC gflags::gflags glog::glog)
+endif()
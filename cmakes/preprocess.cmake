@@ -0,0 +1,8 @@
+option(BUILD_PREPROCESS "Build pre-processing kernel benchmark" OFF)
+
+if (BUILD_PREPROCESS)
+    add_executable(preprocess_benchmark ${CMAKE_SOURCE_DIR}/source/preprocess/main.cc)
+    # 标量参考实现也需要开启优化，否则加速比没有意义
+    target_compile_options(preprocess_benchmark PRIVATE -O2)
+    target_link_libraries(preprocess_benchmark PUBLIC gflags::gflags glog::glog)
+endif()
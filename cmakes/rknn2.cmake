@@ -13,4 +13,15 @@ if (BUILD_RKNN2)
     target_link_libraries(RKNN2 INTERFACE ${RKNN2_LIBRARY_DIR}/librknnrt.so)
     add_executable(rknn2_test ${CMAKE_SOURCE_DIR}/source/rknn2/main.cpp)
     target_link_libraries(rknn2_test PUBLIC RKNN2 gflags::gflags glog::glog)
-endif()
\ No newline at end of file
+endif()
+
+# perf_detail解析的检查，不依赖RKNN SDK，在开发机上用保存下来的文本运行: ctest -R rknn_perf_detail
+option(BUILD_RKNN2_PERF_DETAIL_CHECK "Build the rknn perf_detail parser check" OFF)
+
+if (BUILD_RKNN2_PERF_DETAIL_CHECK)
+    enable_testing()
+    add_executable(rknn_perf_detail_check ${CMAKE_SOURCE_DIR}/source/rknn2/perf_detail_check.cc)
+    target_link_libraries(rknn_perf_detail_check PUBLIC gflags::gflags glog::glog)
+    add_test(NAME rknn_perf_detail
+             COMMAND rknn_perf_detail_check --perf_detail ${CMAKE_SOURCE_DIR}/source/rknn2/testdata/perf_detail.txt)
+endif()
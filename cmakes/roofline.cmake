@@ -0,0 +1,6 @@
+option(BUILD_ROOFLINE "Build roofline report" OFF)
+
+if (BUILD_ROOFLINE)
+    add_executable(roofline_report ${CMAKE_SOURCE_DIR}/source/roofline/main.cc)
+    target_link_libraries(roofline_report PUBLIC gflags::gflags glog::glog)
+endif()
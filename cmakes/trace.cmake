@@ -0,0 +1,5 @@
+option(ENABLE_TRACE "Record Chrome trace timelines of the benchmark runs (--trace_file)" OFF)
+
+if (ENABLE_TRACE)
+    add_compile_definitions(ENABLE_TRACE)
+endif()
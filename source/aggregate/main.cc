@@ -0,0 +1,91 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "nlohmann/json.hpp"
+#include "BenchmarkSummary.hpp"
+
+// 逗号分隔的结果文件，可以来自不同后端和不同设备(rknn、bpu、openvino、hiai的输出)
+DEFINE_string(results, "", "Comma separated result json files of any backends.");
+
+// 逻辑模型名的别名，逗号分隔的name=logical，把各后端上不同的模型名归到同一个逻辑模型
+DEFINE_string(aliases, "", "Comma separated name=logical pairs mapping backend model names to one logical model.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/benchmark_matrix.json", "The file path to the output json file.");
+DEFINE_string(csv_file, "output/benchmark_matrix.csv", "The file path to the output csv file, empty to disable.");
+
+void write_output(const std::string &path, const std::string &content)
+{
+    std::filesystem::path output_path(path);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream file(path);
+    file << content;
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+    FLAGS_alsologtostderr = true;
+    FLAGS_colorlogtostderr = true;
+    FLAGS_log_prefix = true;
+    FLAGS_logbufsecs = 0;
+
+    std::vector<BenchmarkSummary> summaries;
+    std::stringstream stream(FLAGS_results);
+    std::string path;
+    while (std::getline(stream, path, ','))
+    {
+        if (path.empty())
+            continue;
+        size_t count = summaries.size();
+        if (!load_benchmark_summaries(path, summaries))
+        {
+            return -1;
+        }
+        LOG(INFO) << "Loaded " << summaries.size() - count << " models from " << path;
+    }
+    if (summaries.empty())
+    {
+        LOG(ERROR) << "No benchmark results: --results rknn_profile_result.json,hbpu_profile_result.json";
+        return -1;
+    }
+
+    std::map<std::string, std::string> aliases;
+    std::stringstream alias_stream(FLAGS_aliases);
+    std::string alias;
+    while (std::getline(alias_stream, alias, ','))
+    {
+        size_t pos = alias.find('=');
+        if (pos == std::string::npos || pos == 0 || pos + 1 == alias.size())
+        {
+            LOG(ERROR) << "Invalid alias, expected name=logical: " << alias;
+            return -1;
+        }
+        aliases[alias.substr(0, pos)] = alias.substr(pos + 1);
+    }
+
+    std::map<std::string, std::vector<BenchmarkSummary>> groups = group_summaries(summaries, aliases);
+    log_summary_matrix(groups);
+
+    std::ostringstream json;
+    json << std::setw(4) << summary_matrix_json(groups) << std::endl;
+    write_output(FLAGS_output_file, json.str());
+    if (!FLAGS_csv_file.empty())
+    {
+        write_output(FLAGS_csv_file, summary_matrix_csv(groups));
+    }
+
+    google::ShutdownGoogleLogging();
+    return 0;
+}
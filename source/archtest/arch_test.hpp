@@ -8,6 +8,7 @@
 #include <vector>
 #include <regex>
 #include <filesystem>
+#include <sched.h>
 
 struct CacheInfo {
     std::string level;
@@ -17,6 +18,7 @@ struct CacheInfo {
 
 struct CpuCoreInformation {
     int coreId;
+    int clusterId;
     std::vector<float> availableFrequencies;
     std::vector<CacheInfo> cacheInfoList;
 };
@@ -212,6 +214,57 @@ std::vector<CacheInfo> getCpuCacheInfo(int coreId) {
 
 
 
+// 以cpufreq policy划分cluster（同一个policy的核心共享时钟，在big.LITTLE上即为同一簇），
+// cluster id取该policy中编号最小的核心；没有cpufreq时回退到topology/cluster_id
+int getCoreClusterId(int coreId) {
+#if defined(__linux__)
+    std::string cpuPath = "/sys/devices/system/cpu/cpu" + std::to_string(coreId);
+    std::ifstream relatedFile(cpuPath + "/cpufreq/related_cpus");
+    if (relatedFile.is_open()) {
+        int firstCore = -1;
+        if (relatedFile >> firstCore) {
+            return firstCore;
+        }
+    }
+
+    std::ifstream clusterFile(cpuPath + "/topology/cluster_id");
+    if (clusterFile.is_open()) {
+        int clusterId = -1;
+        if (clusterFile >> clusterId && clusterId >= 0) {
+            return clusterId;
+        }
+    }
+
+    std::ifstream packageFile(cpuPath + "/topology/physical_package_id");
+    if (packageFile.is_open()) {
+        int packageId = -1;
+        if (packageFile >> packageId && packageId >= 0) {
+            return packageId;
+        }
+    }
+    return 0;
+#else
+    std::cerr << "ERROR: Unsupported architecture" << std::endl;
+    return 0;
+#endif
+}
+
+// 将调用线程绑定到指定核心，sched_setaffinity(0, ...)在Linux/Android上只作用于当前线程
+bool pinCurrentThreadToCore(int coreId) {
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(coreId, &cpuSet);
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+        std::cerr << "WARNING: Could not pin thread to core " << coreId << std::endl;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 long getTotalMemorySize() {
     std::ifstream meminfo("/proc/meminfo");
     if (!meminfo.is_open()) {
@@ -242,7 +295,7 @@ void printCpuInformation(const CpuInformation& cpuInfo) {
     std::cout << "Core Count: " << cpuInfo.coreCount << std::endl;
 
     for (const auto& coreInfo : cpuInfo.coresInformationList) {
-        std::cout << "Core ID: " << coreInfo.coreId << std::endl;
+        std::cout << "Core ID: " << coreInfo.coreId << ", Cluster ID: " << coreInfo.clusterId << std::endl;
         std::cout << "Available Frequencies (MHz): ";
         for (const auto& freq : coreInfo.availableFrequencies) {
             std::cout << freq << " ";
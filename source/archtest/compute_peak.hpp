@@ -0,0 +1,472 @@
+#ifndef COMPUTE_PEAK_HPP
+#define COMPUTE_PEAK_HPP
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "arch_test.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COMPUTE_PEAK_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 11)
+#define COMPUTE_PEAK_HAVE_AVXVNNI 1
+#define COMPUTE_PEAK_TARGET_AVXVNNI __attribute__((target("avx2,avxvnni")))
+#endif
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 12)
+#define COMPUTE_PEAK_HAVE_AVX512FP16 1
+#define COMPUTE_PEAK_TARGET_AVX512FP16 __attribute__((target("avx512fp16,avx512vl")))
+#endif
+// 强制累加器留在各自的向量寄存器中，阻止编译器合并或向量化独立的链
+#define COMPUTE_PEAK_KEEP(x) asm volatile("" : "+x"(x))
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMDHP
+#define HWCAP_ASIMDHP (1 << 10)
+#endif
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#if defined(__clang__)
+#define COMPUTE_PEAK_TARGET_FP16 __attribute__((target("fullfp16")))
+#define COMPUTE_PEAK_TARGET_DOTPROD __attribute__((target("dotprod")))
+#else
+#define COMPUTE_PEAK_TARGET_FP16 __attribute__((target("arch=armv8.2-a+fp16")))
+#define COMPUTE_PEAK_TARGET_DOTPROD __attribute__((target("arch=armv8.2-a+dotprod")))
+#endif
+#define COMPUTE_PEAK_KEEP(x) asm volatile("" : "+w"(x))
+#else
+#define COMPUTE_PEAK_KEEP(x)
+#endif
+
+// 每次循环迭代中每条链展开的指令数
+#define COMPUTE_PEAK_UNROLL 4
+// 吞吐测试中独立的累加链数，需覆盖 FMA流水线数 x FMA延迟
+#define COMPUTE_PEAK_CHAINS 8
+
+// 执行iterations次迭代，每次迭代对Chains条链各发射COMPUTE_PEAK_UNROLL条指令，返回值用于防止被优化
+typedef double (*ComputeKernelFunc)(uint64_t iterations);
+
+struct ComputeKernel {
+    std::string name;         // 数据类型与操作，如fp32_fma
+    std::string isa;          // 实际使用的指令集
+    std::string unit;         // GFLOPS或GOPS
+    double opsPerInstruction; // 每条指令完成的浮点/整数运算数（乘加计2）
+    ComputeKernelFunc latencyKernel;
+    ComputeKernelFunc throughputKernel;
+};
+
+struct ComputePeakSample {
+    std::vector<int> coreIds;
+    double gops;
+    double nsPerInstruction;
+};
+
+struct ComputeKernelResult {
+    ComputeKernel kernel;
+    // 单核心: 单链(延迟受限)与多链(吞吐受限)
+    std::vector<std::pair<ComputePeakSample, ComputePeakSample>> perCore;
+    // 每个cluster全部核心同时运行多链
+    std::map<int, ComputePeakSample> perCluster;
+    ComputePeakSample allCores;
+};
+
+template <int Chains>
+double scalarFp32Kernel(uint64_t iterations) {
+    float acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = 0.1f * k;
+    }
+    float b = 0.999f;
+    float c = 0.001f;
+    COMPUTE_PEAK_KEEP(b);
+    COMPUTE_PEAK_KEEP(c);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = acc[k] * b + c;
+                COMPUTE_PEAK_KEEP(acc[k]);
+            }
+        }
+    }
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        sum += acc[k];
+    }
+    return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+template <int Chains>
+COMPUTE_PEAK_TARGET_AVX2 double fp32Avx2Kernel(uint64_t iterations) {
+    __m256 acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = _mm256_set1_ps(0.1f * k);
+    }
+    const __m256 b = _mm256_set1_ps(0.999f);
+    const __m256 c = _mm256_set1_ps(0.001f);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = _mm256_fmadd_ps(acc[k], b, c);
+            }
+        }
+    }
+    float lanes[8];
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        _mm256_storeu_ps(lanes, acc[k]);
+        sum += lanes[0];
+    }
+    return sum;
+}
+
+// AVX2没有int8点积指令，使用maddubs+madd两条指令完成32个乘加；
+// 累加器本身作为无符号int8操作数参与下一次乘加，构成真实的依赖链，避免循环不变量外提
+template <int Chains>
+COMPUTE_PEAK_TARGET_AVX2 double int8Avx2Kernel(uint64_t iterations) {
+    __m256i acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = _mm256_set1_epi32(k);
+    }
+    const __m256i b = _mm256_set1_epi8(-2);
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = _mm256_madd_epi16(_mm256_maddubs_epi16(acc[k], b), ones);
+            }
+        }
+    }
+    int32_t lanes[8];
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        _mm256_storeu_si256((__m256i *)lanes, acc[k]);
+        sum += lanes[0];
+    }
+    return sum;
+}
+
+#if defined(COMPUTE_PEAK_HAVE_AVXVNNI)
+template <int Chains>
+COMPUTE_PEAK_TARGET_AVXVNNI double int8AvxVnniKernel(uint64_t iterations) {
+    __m256i acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = _mm256_set1_epi32(k);
+    }
+    const __m256i a = _mm256_set1_epi8(3);
+    const __m256i b = _mm256_set1_epi8(-2);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = _mm256_dpbusd_avx_epi32(acc[k], a, b);
+            }
+        }
+    }
+    int32_t lanes[8];
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        _mm256_storeu_si256((__m256i *)lanes, acc[k]);
+        sum += lanes[0];
+    }
+    return sum;
+}
+#endif
+
+#if defined(COMPUTE_PEAK_HAVE_AVX512FP16)
+template <int Chains>
+COMPUTE_PEAK_TARGET_AVX512FP16 double fp16Avx512Kernel(uint64_t iterations) {
+    __m256h acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = _mm256_set1_ph((_Float16)(0.1f * k));
+    }
+    const __m256h b = _mm256_set1_ph((_Float16)0.99f);
+    const __m256h c = _mm256_set1_ph((_Float16)0.01f);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = _mm256_fmadd_ph(acc[k], b, c);
+            }
+        }
+    }
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        sum += (float)_mm256_cvtsh_h(acc[k]);
+    }
+    return sum;
+}
+#endif
+#endif
+
+#if defined(__aarch64__)
+template <int Chains>
+double fp32NeonKernel(uint64_t iterations) {
+    float32x4_t acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = vdupq_n_f32(0.1f * k);
+    }
+    const float32x4_t b = vdupq_n_f32(0.999f);
+    const float32x4_t c = vdupq_n_f32(0.001f);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = vfmaq_f32(c, acc[k], b);
+            }
+        }
+    }
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        sum += vgetq_lane_f32(acc[k], 0);
+    }
+    return sum;
+}
+
+template <int Chains>
+COMPUTE_PEAK_TARGET_FP16 double fp16NeonKernel(uint64_t iterations) {
+    float16x8_t acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = vdupq_n_f16((float16_t)(0.1f * k));
+    }
+    const float16x8_t b = vdupq_n_f16((float16_t)0.99f);
+    const float16x8_t c = vdupq_n_f16((float16_t)0.01f);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = vfmaq_f16(c, acc[k], b);
+            }
+        }
+    }
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        sum += (float)vgetq_lane_f16(acc[k], 0);
+    }
+    return sum;
+}
+
+template <int Chains>
+COMPUTE_PEAK_TARGET_DOTPROD double int8DotNeonKernel(uint64_t iterations) {
+    int32x4_t acc[Chains];
+    for (int k = 0; k < Chains; k++) {
+        acc[k] = vdupq_n_s32(k);
+    }
+    const int8x16_t a = vdupq_n_s8(3);
+    const int8x16_t b = vdupq_n_s8(-2);
+    for (uint64_t n = 0; n < iterations; n++) {
+        for (int u = 0; u < COMPUTE_PEAK_UNROLL; u++) {
+            for (int k = 0; k < Chains; k++) {
+                acc[k] = vdotq_s32(acc[k], a, b);
+            }
+        }
+    }
+    double sum = 0;
+    for (int k = 0; k < Chains; k++) {
+        sum += vgetq_lane_s32(acc[k], 0);
+    }
+    return sum;
+}
+#endif
+
+// 运行时检测当前CPU支持的指令集，只返回可以执行的kernel
+std::vector<ComputeKernel> getSupportedComputeKernels() {
+    std::vector<ComputeKernel> kernels;
+    kernels.push_back({"fp32_scalar", "scalar", "GFLOPS", 2.0,
+                       scalarFp32Kernel<1>, scalarFp32Kernel<COMPUTE_PEAK_CHAINS>});
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (hasAvx2) {
+        kernels.push_back({"fp32_fma", "avx2+fma", "GFLOPS", 16.0,
+                           fp32Avx2Kernel<1>, fp32Avx2Kernel<COMPUTE_PEAK_CHAINS>});
+    }
+#if defined(COMPUTE_PEAK_HAVE_AVX512FP16)
+    if (__builtin_cpu_supports("avx512fp16") && __builtin_cpu_supports("avx512vl")) {
+        kernels.push_back({"fp16_fma", "avx512fp16", "GFLOPS", 32.0,
+                           fp16Avx512Kernel<1>, fp16Avx512Kernel<COMPUTE_PEAK_CHAINS>});
+    }
+#endif
+#if defined(COMPUTE_PEAK_HAVE_AVXVNNI)
+    if (__builtin_cpu_supports("avxvnni")) {
+        kernels.push_back({"int8_dot", "avxvnni", "GOPS", 64.0,
+                           int8AvxVnniKernel<1>, int8AvxVnniKernel<COMPUTE_PEAK_CHAINS>});
+    } else
+#endif
+    if (hasAvx2) {
+        kernels.push_back({"int8_dot", "avx2 (maddubs)", "GOPS", 64.0,
+                           int8Avx2Kernel<1>, int8Avx2Kernel<COMPUTE_PEAK_CHAINS>});
+    }
+#elif defined(__aarch64__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    kernels.push_back({"fp32_fma", "neon", "GFLOPS", 8.0,
+                       fp32NeonKernel<1>, fp32NeonKernel<COMPUTE_PEAK_CHAINS>});
+    if (hwcap & HWCAP_ASIMDHP) {
+        kernels.push_back({"fp16_fma", "neon fp16", "GFLOPS", 16.0,
+                           fp16NeonKernel<1>, fp16NeonKernel<COMPUTE_PEAK_CHAINS>});
+    }
+    if (hwcap & HWCAP_ASIMDDP) {
+        kernels.push_back({"int8_dot", "neon sdot", "GOPS", 32.0,
+                           int8DotNeonKernel<1>, int8DotNeonKernel<COMPUTE_PEAK_CHAINS>});
+    }
+#endif
+    return kernels;
+}
+
+// 以倍增方式找到单线程运行时间不少于minTimeMs的迭代次数
+uint64_t calibrateComputeIterations(ComputeKernelFunc func, double minTimeMs) {
+    uint64_t iterations = 1024;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        volatile double sink = func(iterations);
+        (void)sink;
+        auto end = std::chrono::steady_clock::now();
+        double elapsedMs = std::chrono::duration<double, std::milli>(end - start).count();
+        if (elapsedMs >= minTimeMs || iterations >= (1ull << 40)) {
+            return iterations;
+        }
+        iterations = elapsedMs > 1.0 ? (uint64_t)(iterations * minTimeMs / elapsedMs * 1.1) : iterations * 8;
+    }
+}
+
+/*
+ * 在cores中每个核心上各启动一个绑核线程同时运行func，返回所有线程的总吞吐(G ops/s)。
+ * chains为每次迭代的独立链数，用于换算指令数。
+ */
+ComputePeakSample runComputeKernel(ComputeKernelFunc func, int chains, double opsPerInstruction,
+                                   const std::vector<int> &cores, uint64_t iterations, int repeats) {
+    ComputePeakSample sample{cores, 0.0, 0.0};
+    double instructions = (double)iterations * chains * COMPUTE_PEAK_UNROLL;
+    double bestSeconds = 0;
+    for (int r = 0; r < repeats; r++) {
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+        for (int coreId : cores) {
+            workers.emplace_back([&, coreId]() {
+                pinCurrentThreadToCore(coreId);
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) {
+                }
+                volatile double sink = func(iterations);
+                (void)sink;
+            });
+        }
+        while (ready.load(std::memory_order_acquire) < (int)cores.size()) {
+        }
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        if (r == 0 || seconds < bestSeconds) {
+            bestSeconds = seconds;
+        }
+    }
+    sample.gops = instructions * opsPerInstruction * cores.size() / bestSeconds / 1e9;
+    sample.nsPerInstruction = bestSeconds * 1e9 / instructions;
+    return sample;
+}
+
+std::vector<ComputeKernelResult> measureComputePeak(const CpuInformation &cpuInfo, double minTimeMs, int repeats) {
+    std::vector<ComputeKernelResult> results;
+    std::map<int, std::vector<int>> clusters;
+    std::vector<int> allCores;
+    for (const auto &coreInfo : cpuInfo.coresInformationList) {
+        clusters[coreInfo.clusterId].push_back(coreInfo.coreId);
+        allCores.push_back(coreInfo.coreId);
+    }
+
+    for (const auto &kernel : getSupportedComputeKernels()) {
+        ComputeKernelResult result;
+        result.kernel = kernel;
+        // 迭代次数按吞吐kernel在当前核心上标定，延迟kernel每次迭代指令更少，用同样的迭代次数会更快结束
+        uint64_t throughputIterations = calibrateComputeIterations(kernel.throughputKernel, minTimeMs);
+        uint64_t latencyIterations = calibrateComputeIterations(kernel.latencyKernel, minTimeMs);
+        for (int coreId : allCores) {
+            ComputePeakSample latency = runComputeKernel(kernel.latencyKernel, 1, kernel.opsPerInstruction,
+                                                         {coreId}, latencyIterations, repeats);
+            ComputePeakSample throughput = runComputeKernel(kernel.throughputKernel, COMPUTE_PEAK_CHAINS, kernel.opsPerInstruction,
+                                                            {coreId}, throughputIterations, repeats);
+            result.perCore.push_back({latency, throughput});
+        }
+        for (const auto &cluster : clusters) {
+            result.perCluster[cluster.first] = runComputeKernel(kernel.throughputKernel, COMPUTE_PEAK_CHAINS, kernel.opsPerInstruction,
+                                                                cluster.second, throughputIterations, repeats);
+        }
+        result.allCores = runComputeKernel(kernel.throughputKernel, COMPUTE_PEAK_CHAINS, kernel.opsPerInstruction,
+                                           allCores, throughputIterations, repeats);
+        results.push_back(result);
+    }
+    return results;
+}
+
+void printComputePeak(const std::vector<ComputeKernelResult> &results) {
+    tabulate::Table peakTable;
+    peakTable.add_row({"kernel", "isa", "scope", "latency(ns/inst)", "latency-bound", "throughput-bound", "unit"});
+    for (const auto &result : results) {
+        for (const auto &core : result.perCore) {
+            peakTable.add_row({result.kernel.name, result.kernel.isa,
+                               "cpu" + std::to_string(core.first.coreIds[0]),
+                               std::to_string(core.first.nsPerInstruction),
+                               std::to_string(core.first.gops),
+                               std::to_string(core.second.gops),
+                               result.kernel.unit});
+        }
+        for (const auto &cluster : result.perCluster) {
+            peakTable.add_row({result.kernel.name, result.kernel.isa,
+                               "cluster" + std::to_string(cluster.first) + " x" + std::to_string(cluster.second.coreIds.size()),
+                               "-", "-", std::to_string(cluster.second.gops), result.kernel.unit});
+        }
+        peakTable.add_row({result.kernel.name, result.kernel.isa,
+                           "all x" + std::to_string(result.allCores.coreIds.size()),
+                           "-", "-", std::to_string(result.allCores.gops), result.kernel.unit});
+    }
+    for (size_t i = 0; i < 7; ++i) {
+        peakTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    std::cout << "CPU compute peak:" << std::endl
+              << peakTable << std::endl;
+}
+
+nlohmann::json computePeakToJson(const std::vector<ComputeKernelResult> &results) {
+    nlohmann::json result;
+    result["UnrollPerChain"] = COMPUTE_PEAK_UNROLL;
+    result["ThroughputChains"] = COMPUTE_PEAK_CHAINS;
+    for (const auto &kernelResult : results) {
+        nlohmann::json kernel;
+        kernel["Name"] = kernelResult.kernel.name;
+        kernel["Isa"] = kernelResult.kernel.isa;
+        kernel["Unit"] = kernelResult.kernel.unit;
+        kernel["OpsPerInstruction"] = kernelResult.kernel.opsPerInstruction;
+        for (const auto &core : kernelResult.perCore) {
+            nlohmann::json item;
+            item["CoreId"] = core.first.coreIds[0];
+            item["LatencyNsPerInstruction"] = core.first.nsPerInstruction;
+            item["LatencyBound"] = core.first.gops;
+            item["ThroughputNsPerInstruction"] = core.second.nsPerInstruction;
+            item["ThroughputBound"] = core.second.gops;
+            kernel["PerCore"].push_back(item);
+        }
+        for (const auto &cluster : kernelResult.perCluster) {
+            nlohmann::json item;
+            item["ClusterId"] = cluster.first;
+            item["CoreIds"] = cluster.second.coreIds;
+            item["ThroughputBound"] = cluster.second.gops;
+            kernel["PerCluster"].push_back(item);
+        }
+        kernel["AllCores"]["CoreIds"] = kernelResult.allCores.coreIds;
+        kernel["AllCores"]["ThroughputBound"] = kernelResult.allCores.gops;
+        result["Kernels"].push_back(kernel);
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,442 @@
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "tabulate.hpp"
+#include "nlohmann/json.hpp"
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Timer.hpp"
+#include "SimulatedBackend.hpp"
+extern "C"
+{
+#include "bench.h"
+#include "lib_mem.h"
+#include "lib_bw_mem.h"
+}
+
+// 内存争用测试：aggressor进程在指定核心上运行bw_mem的带宽kernel，同时测量victim的延迟退化
+
+// aggressor使用的核心，逗号分隔，为空时使用victim以外的全部核心
+DEFINE_string(aggressor_cores, "", "Comma separated core ids of the aggressor processes, empty means all cores except the victim core.");
+
+// aggressor运行的bw_mem kernel
+DEFINE_string(aggressor_kernel, "rd", "The bw_mem kernel run by the aggressors: rd wr rdwr cp fwr frd fcp bzero bcopy.");
+
+// 每个aggressor的缓冲区大小(MB)，应远大于最后一级cache
+DEFINE_int32(aggressor_mb, 32, "The buffer size of each aggressor in MB.");
+
+// aggressor的占空比(%)，逗号分隔，与aggressor数量组合成曲线上的各个点
+DEFINE_string(aggressor_duty, "25,50,100", "Comma separated duty cycles of the aggressors in percent.");
+
+// victim类型: chase(lib_mem指针追逐), simulated(模拟后端推理), none(只运行aggressor，用于和其他后端程序同时运行)
+DEFINE_string(victim, "chase", "The victim: chase (lmbench pointer chase), simulated (simulated backend inference) or none (aggressors only).");
+
+// victim运行的核心
+DEFINE_int32(victim_core, 0, "The core id of the victim.");
+
+// 指针追逐的工作集大小(MB)和每轮的访存次数
+DEFINE_int32(victim_mb, 64, "The working set of the pointer chase victim in MB.");
+DEFINE_int32(chase_hops, 1000000, "The number of dependent loads per pointer chase round.");
+
+// victim每个测量点的预热和测试轮数
+DEFINE_int32(victim_warmup, 3, "The number of warmup rounds of the victim per point.");
+DEFINE_int32(victim_rounds, 20, "The number of measured rounds of the victim per point.");
+
+// 模拟后端的模型参数
+DEFINE_int64(sim_input_bytes, 1 * 3 * 224 * 224, "The input size of the simulated model in bytes.");
+DEFINE_int64(sim_output_bytes, 1000 * 4, "The output size of the simulated model in bytes.");
+DEFINE_int32(sim_weight_mb, 32, "The weights read from DDR per simulated inference in MB.");
+DEFINE_double(sim_compute_us, 2000, "The compute time of a simulated inference in us.");
+
+// victim=none时aggressor的运行时间(s)
+DEFINE_int32(duration_s, 60, "The run time of the aggressors when victim is none.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/contention_result.json", "The file path to the output json file.");
+
+#define MAX_AGGRESSORS 64
+#define AGGRESSOR_PERIOD_US 10000
+
+// 父子进程共享的控制块，放在MAP_SHARED的匿名映射里
+struct AggressorControl
+{
+    std::atomic<int> stop;
+    std::atomic<int> ready;
+    std::atomic<int> activeCount;
+    std::atomic<int> dutyPercent;
+    std::atomic<uint64_t> bytes[MAX_AGGRESSORS];
+};
+
+struct ContentionPoint
+{
+    int activeAggressors;
+    int dutyPercent;
+    double aggressorMBps;
+    LatencyPerfData victim;
+    double slowdown;
+};
+
+bool parse_int_list(const std::string &text, std::vector<int> &items)
+{
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+        char *end = nullptr;
+        errno = 0;
+        long value = strtol(item.c_str(), &end, 10);
+        if (end == item.c_str() || *end != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX)
+        {
+            LOG(ERROR) << "Expected a comma separated list of integers, got " << text;
+            return false;
+        }
+        items.push_back((int)value);
+    }
+    return true;
+}
+
+bool pin_to_core(int coreId)
+{
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(coreId, &mask);
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+}
+
+void aggressor_main(int index, int coreId, AggressorControl *control)
+{
+    if (!pin_to_core(coreId))
+    {
+        LOG(WARNING) << "Aggressor " << index << " cannot be pinned to core " << coreId;
+    }
+    benchmp_f kernel = bw_mem_kernel(FLAGS_aggressor_kernel.c_str());
+    state_t state;
+    memset(&state, 0, sizeof(state));
+    state.nbytes = (size_t)FLAGS_aggressor_mb * 1024 * 1024;
+    state.need_buf2 = bw_mem_need_buf2(FLAGS_aggressor_kernel.c_str());
+    init_loop(0, &state);
+    control->ready++;
+
+    while (!control->stop.load())
+    {
+        if (index >= control->activeCount.load())
+        {
+            usleep(1000);
+            continue;
+        }
+        // 每个周期内运行duty%的时间，剩下的时间休眠
+        auto start = std::chrono::steady_clock::now();
+        auto busy = std::chrono::microseconds(AGGRESSOR_PERIOD_US * control->dutyPercent.load() / 100);
+        do
+        {
+            kernel(1, &state);
+            control->bytes[index] += state.nbytes;
+        } while (std::chrono::steady_clock::now() - start < busy);
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        if (elapsed.count() < AGGRESSOR_PERIOD_US && control->dutyPercent.load() < 100)
+        {
+            usleep(AGGRESSOR_PERIOD_US - elapsed.count());
+        }
+    }
+    cleanup(0, &state);
+}
+
+// 通知aggressor退出并等待全部子进程结束，之后释放控制块
+void stop_aggressors(AggressorControl *control, const std::vector<pid_t> &aggressors)
+{
+    control->stop = 1;
+    for (pid_t pid : aggressors)
+    {
+        waitpid(pid, NULL, 0);
+    }
+    munmap(control, sizeof(AggressorControl));
+}
+
+uint64_t total_aggressor_bytes(AggressorControl *control, int count)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        total += control->bytes[i].load();
+    }
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;      // 设置日志消息是否转到标准输出而不是日志文件
+    FLAGS_alsologtostderr = true;  // 设置日志消息除了日志文件之外是否去标准输出
+    FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
+    FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
+    FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+
+    if (bw_mem_kernel(FLAGS_aggressor_kernel.c_str()) == NULL)
+    {
+        LOG(ERROR) << "Unknown aggressor kernel: " << FLAGS_aggressor_kernel;
+        return -1;
+    }
+    if (FLAGS_victim_rounds < 1)
+    {
+        LOG(ERROR) << "Expected victim_rounds >= 1, got " << FLAGS_victim_rounds;
+        return -1;
+    }
+    std::vector<int> aggressorCores;
+    if (!parse_int_list(FLAGS_aggressor_cores, aggressorCores))
+    {
+        return -1;
+    }
+    if (aggressorCores.empty())
+    {
+        int coreCount = sysconf(_SC_NPROCESSORS_CONF);
+        for (int coreId = 0; coreId < coreCount; coreId++)
+        {
+            if (coreId != FLAGS_victim_core)
+            {
+                aggressorCores.push_back(coreId);
+            }
+        }
+    }
+    if (aggressorCores.empty())
+    {
+        // 单核机器上aggressor与victim分时复用，测到的是调度干扰而不是带宽争用
+        LOG(WARNING) << "No core left for the aggressors, they share core " << FLAGS_victim_core << " with the victim.";
+        aggressorCores.push_back(FLAGS_victim_core);
+    }
+    if (aggressorCores.size() > MAX_AGGRESSORS)
+    {
+        aggressorCores.resize(MAX_AGGRESSORS);
+    }
+    std::vector<int> duties;
+    if (!parse_int_list(FLAGS_aggressor_duty, duties))
+    {
+        return -1;
+    }
+    if (duties.empty())
+    {
+        duties.push_back(100);
+    }
+
+    AggressorControl *control = (AggressorControl *)mmap(NULL, sizeof(AggressorControl), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (control == MAP_FAILED)
+    {
+        LOG(ERROR) << "Cannot map the aggressor control block";
+        return -1;
+    }
+    new (control) AggressorControl();
+
+    // 先fork aggressor，victim的缓冲区在父进程中分配，不会被子进程继承
+    std::vector<pid_t> aggressors;
+    for (size_t i = 0; i < aggressorCores.size(); i++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            aggressor_main(i, aggressorCores[i], control);
+            _exit(0);
+        }
+        else if (pid < 0)
+        {
+            LOG(ERROR) << "fork failed: " << strerror(errno);
+            break;
+        }
+        aggressors.push_back(pid);
+    }
+    while (control->ready.load() < (int)aggressors.size())
+    {
+        usleep(1000);
+    }
+    LOG(INFO) << "Started " << aggressors.size() << " aggressors, kernel: " << FLAGS_aggressor_kernel << ", buffer: " << FLAGS_aggressor_mb << " MB";
+
+    if (!pin_to_core(FLAGS_victim_core))
+    {
+        LOG(WARNING) << "Victim cannot be pinned to core " << FLAGS_victim_core;
+    }
+
+    nlohmann::json result;
+    result["Aggressor"]["Kernel"] = FLAGS_aggressor_kernel;
+    result["Aggressor"]["BufferBytes"] = (uint64_t)FLAGS_aggressor_mb * 1024 * 1024;
+    result["Aggressor"]["Cores"] = std::vector<int>(aggressorCores.begin(), aggressorCores.begin() + aggressors.size());
+    result["Victim"]["Type"] = FLAGS_victim;
+    result["Victim"]["Core"] = FLAGS_victim_core;
+
+    if (FLAGS_victim == "none")
+    {
+        // 只运行aggressor，在另一个终端里运行各后端的benchmark作为victim
+        control->dutyPercent = duties.back();
+        control->activeCount = aggressors.size();
+        for (int s = 0; s < FLAGS_duration_s; s++)
+        {
+            uint64_t before = total_aggressor_bytes(control, aggressors.size());
+            sleep(1);
+            uint64_t after = total_aggressor_bytes(control, aggressors.size());
+            LOG(INFO) << "Aggressor bandwidth: " << (after - before) / 1e6 << " MB/s";
+        }
+    }
+    else
+    {
+        std::function<void()> victim_function;
+        std::string latencyUnit;
+        double latencyScale = 1.0;
+        struct mem_state chaseState;
+        iter_t chaseIterations = (FLAGS_chase_hops + 99) / 100;
+        std::unique_ptr<SimulatedBackend> backend;
+        if (FLAGS_victim == "chase")
+        {
+            memset(&chaseState, 0, sizeof(chaseState));
+            chaseState.width = 1;
+            chaseState.len = chaseState.maxlen = (size_t)FLAGS_victim_mb * 1024 * 1024;
+            chaseState.line = 64;
+            chaseState.pagesize = getpagesize();
+            mem_initialize(0, &chaseState);
+            if (!chaseState.initialized)
+            {
+                LOG(ERROR) << "Cannot initialize the pointer chase";
+                stop_aggressors(control, aggressors);
+                return -1;
+            }
+            victim_function = [&]()
+            { mem_benchmark_0(chaseIterations, &chaseState); };
+            // Timer的单位是us，换算成每次访存的ns
+            latencyUnit = "ns/load";
+            latencyScale = 1000.0 / (chaseIterations * 100);
+            result["Victim"]["WorkingSetBytes"] = chaseState.len;
+            result["Victim"]["LoadsPerRound"] = (uint64_t)chaseIterations * 100;
+        }
+        else if (FLAGS_victim == "simulated")
+        {
+            SimulatedModelConfig config;
+            config.inputBytes = FLAGS_sim_input_bytes;
+            config.outputBytes = FLAGS_sim_output_bytes;
+            config.weightBytes = (size_t)FLAGS_sim_weight_mb * 1024 * 1024;
+            config.computeUs = FLAGS_sim_compute_us;
+            backend.reset(new SimulatedBackend(config));
+            victim_function = [&]()
+            {
+                backend->inputs_set();
+                backend->run();
+                backend->outputs_get();
+            };
+            latencyUnit = "us/inference";
+            result["Victim"]["MetaInfo"] = backend->meta_info();
+        }
+        else
+        {
+            LOG(ERROR) << "Unknown victim: " << FLAGS_victim;
+            stop_aggressors(control, aggressors);
+            return -1;
+        }
+        result["Victim"]["LatencyUnit"] = latencyUnit;
+
+        // 第一个点不运行aggressor，作为基线
+        std::vector<std::pair<int, int>> levels = {{0, 0}};
+        for (size_t count = 1; count <= aggressors.size(); count++)
+        {
+            for (int duty : duties)
+            {
+                levels.push_back({(int)count, duty});
+            }
+        }
+
+        std::vector<ContentionPoint> curve;
+        for (const auto &level : levels)
+        {
+            control->dutyPercent = level.second;
+            control->activeCount = level.first;
+            // 等待aggressor进入稳定状态
+            usleep(50000);
+
+            uint64_t bytesBefore = total_aggressor_bytes(control, aggressors.size());
+            auto start = std::chrono::steady_clock::now();
+            Timer timer(FLAGS_victim_warmup, FLAGS_victim_rounds, victim_function);
+            timer.run();
+            auto end = std::chrono::steady_clock::now();
+            uint64_t bytesAfter = total_aggressor_bytes(control, aggressors.size());
+
+            ContentionPoint point;
+            point.activeAggressors = level.first;
+            point.dutyPercent = level.second;
+            // bytes / us == MB/s
+            point.aggressorMBps = (bytesAfter - bytesBefore) / (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+            point.victim = timer.report_statistics(timer.durations_normal_);
+            point.victim.mean *= latencyScale;
+            point.victim.stdev *= latencyScale;
+            point.victim.min *= latencyScale;
+            point.victim.max *= latencyScale;
+            point.slowdown = curve.empty() ? 1.0 : point.victim.mean / curve.front().victim.mean;
+            curve.push_back(point);
+        }
+        control->activeCount = 0;
+
+        // 按aggressor带宽排序，得到victim延迟随带宽变化的曲线
+        std::sort(curve.begin() + 1, curve.end(), [](const ContentionPoint &a, const ContentionPoint &b)
+                  { return a.aggressorMBps < b.aggressorMBps; });
+
+        tabulate::Table curveTable;
+        curveTable.add_row({"aggressors", "duty(%)", "aggressor(MB/s)", "avg(" + latencyUnit + ")", "std", "min", "max", "slowdown"});
+        for (const auto &point : curve)
+        {
+            nlohmann::json item;
+            item["ActiveAggressors"] = point.activeAggressors;
+            item["DutyPercent"] = point.dutyPercent;
+            item["AggressorMBps"] = point.aggressorMBps;
+            item["AvgVictimLatency"] = point.victim.mean;
+            item["StdVictimLatency"] = point.victim.stdev;
+            item["MinVictimLatency"] = point.victim.min;
+            item["MaxVictimLatency"] = point.victim.max;
+            item["Slowdown"] = point.slowdown;
+            result["Curve"].push_back(item);
+
+            curveTable.add_row({std::to_string(point.activeAggressors),
+                                std::to_string(point.dutyPercent),
+                                std::to_string(point.aggressorMBps),
+                                std::to_string(point.victim.mean),
+                                std::to_string(point.victim.stdev),
+                                std::to_string(point.victim.min),
+                                std::to_string(point.victim.max),
+                                std::to_string(point.slowdown)});
+        }
+        for (size_t i = 0; i < 8; ++i)
+        {
+            curveTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+        }
+        LOG(INFO) << "\n"
+                  << curveTable << "\n";
+        if (FLAGS_victim == "chase")
+        {
+            mem_cleanup(0, &chaseState);
+        }
+    }
+
+    stop_aggressors(control, aggressors);
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << result << std::endl;
+    LOG(INFO) << "Contention result saved to " << FLAGS_output_file;
+
+    google::ShutdownGoogleLogging();
+    return 0;
+}
@@ -0,0 +1,210 @@
+#ifndef CORE_TO_CORE_HPP
+#define CORE_TO_CORE_HPP
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <limits>
+#include <algorithm>
+#include <iomanip>
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "arch_test.hpp"
+
+struct CoreToCoreLatency {
+    int iterations;
+    std::vector<int> coreIds;
+    std::vector<int> clusterIds;
+    // latencyNs[i][j]: 核心i把cache line交给核心j的单程延迟(ns)，对角线为0
+    std::vector<std::vector<double>> latencyNs;
+};
+
+struct ClusterPairLatency {
+    int clusterA;
+    int clusterB;
+    double avgNs;
+    double minNs;
+    double maxNs;
+    int pairCount;
+};
+
+// 独占一个cache line，避免和其他变量发生false sharing
+struct alignas(64) PingPongLine {
+    std::atomic<uint64_t> sequence{0};
+};
+
+/*
+ * 两个线程分别绑定到coreA和coreB，通过同一个原子变量来回传递序号：
+ * coreA写入奇数后等待coreB写回偶数，每一轮cache line在两个核心之间迁移两次。
+ * 返回单程延迟(ns)，即往返时间的一半。
+ */
+double measureCorePairLatency(int coreA, int coreB, int iterations) {
+    PingPongLine line;
+    std::atomic<int> ready{0};
+
+    std::thread pong([&]() {
+        pinCurrentThreadToCore(coreB);
+        ready.fetch_add(1);
+        while (ready.load(std::memory_order_acquire) < 2) {
+        }
+        for (uint64_t i = 0; i < (uint64_t)iterations; i++) {
+            uint64_t expected = 2 * i + 1;
+            while (line.sequence.load(std::memory_order_acquire) != expected) {
+            }
+            line.sequence.store(expected + 1, std::memory_order_release);
+        }
+    });
+
+    pinCurrentThreadToCore(coreA);
+    ready.fetch_add(1);
+    while (ready.load(std::memory_order_acquire) < 2) {
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < (uint64_t)iterations; i++) {
+        line.sequence.store(2 * i + 1, std::memory_order_release);
+        while (line.sequence.load(std::memory_order_acquire) != 2 * i + 2) {
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    pong.join();
+
+    double totalNs = std::chrono::duration<double, std::nano>(end - start).count();
+    return totalNs / iterations / 2.0;
+}
+
+// 对每一对核心重复测量repeats次取最小值，排除调度和中断带来的干扰
+CoreToCoreLatency measureCoreToCoreLatency(const CpuInformation &cpuInfo, int iterations, int repeats) {
+    CoreToCoreLatency result;
+    result.iterations = iterations;
+    for (const auto &coreInfo : cpuInfo.coresInformationList) {
+        result.coreIds.push_back(coreInfo.coreId);
+        result.clusterIds.push_back(coreInfo.clusterId);
+    }
+
+#if defined(__linux__)
+    cpu_set_t originalMask;
+    sched_getaffinity(0, sizeof(originalMask), &originalMask);
+#endif
+
+    size_t coreCount = result.coreIds.size();
+    result.latencyNs.assign(coreCount, std::vector<double>(coreCount, 0.0));
+    for (size_t i = 0; i < coreCount; i++) {
+        for (size_t j = 0; j < coreCount; j++) {
+            if (i == j) {
+                continue;
+            }
+            double best = std::numeric_limits<double>::max();
+            for (int r = 0; r < repeats; r++) {
+                best = std::min(best, measureCorePairLatency(result.coreIds[i], result.coreIds[j], iterations));
+            }
+            result.latencyNs[i][j] = best;
+        }
+    }
+    // 恢复主线程的亲和性，避免影响后续测试
+#if defined(__linux__)
+    sched_setaffinity(0, sizeof(originalMask), &originalMask);
+#endif
+    return result;
+}
+
+// 按(clusterA, clusterB)聚合，clusterA == clusterB即簇内延迟
+std::vector<ClusterPairLatency> summarizeClusterLatency(const CoreToCoreLatency &latency) {
+    std::map<std::pair<int, int>, ClusterPairLatency> summary;
+    size_t coreCount = latency.coreIds.size();
+    for (size_t i = 0; i < coreCount; i++) {
+        for (size_t j = 0; j < coreCount; j++) {
+            if (i == j) {
+                continue;
+            }
+            int a = std::min(latency.clusterIds[i], latency.clusterIds[j]);
+            int b = std::max(latency.clusterIds[i], latency.clusterIds[j]);
+            double value = latency.latencyNs[i][j];
+            auto it = summary.find({a, b});
+            if (it == summary.end()) {
+                summary[{a, b}] = {a, b, value, value, value, 1};
+            } else {
+                it->second.avgNs += value;
+                it->second.minNs = std::min(it->second.minNs, value);
+                it->second.maxNs = std::max(it->second.maxNs, value);
+                it->second.pairCount++;
+            }
+        }
+    }
+
+    std::vector<ClusterPairLatency> clusterPairs;
+    for (auto &item : summary) {
+        item.second.avgNs /= item.second.pairCount;
+        clusterPairs.push_back(item.second);
+    }
+    return clusterPairs;
+}
+
+void printCoreToCoreLatency(const CoreToCoreLatency &latency, const std::vector<ClusterPairLatency> &clusterPairs) {
+    tabulate::Table matrixTable;
+    tabulate::Table::Row_t header{"from\\to"};
+    for (size_t j = 0; j < latency.coreIds.size(); j++) {
+        header.push_back("cpu" + std::to_string(latency.coreIds[j]) + "(c" + std::to_string(latency.clusterIds[j]) + ")");
+    }
+    matrixTable.add_row(header);
+    for (size_t i = 0; i < latency.coreIds.size(); i++) {
+        tabulate::Table::Row_t row{"cpu" + std::to_string(latency.coreIds[i]) + "(c" + std::to_string(latency.clusterIds[i]) + ")"};
+        for (size_t j = 0; j < latency.coreIds.size(); j++) {
+            std::ostringstream cell;
+            if (i == j) {
+                cell << "-";
+            } else {
+                cell << std::fixed << std::setprecision(1) << latency.latencyNs[i][j];
+            }
+            row.push_back(cell.str());
+        }
+        matrixTable.add_row(row);
+    }
+    for (size_t i = 0; i < header.size(); ++i) {
+        matrixTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+
+    tabulate::Table clusterTable;
+    clusterTable.add_row({"cluster", "pairs", "avg(ns)", "min(ns)", "max(ns)"});
+    for (const auto &pair : clusterPairs) {
+        std::string name = pair.clusterA == pair.clusterB
+                               ? "c" + std::to_string(pair.clusterA) + " intra"
+                               : "c" + std::to_string(pair.clusterA) + " <-> c" + std::to_string(pair.clusterB);
+        clusterTable.add_row({name,
+                              std::to_string(pair.pairCount),
+                              std::to_string(pair.avgNs),
+                              std::to_string(pair.minNs),
+                              std::to_string(pair.maxNs)});
+    }
+    for (size_t i = 0; i < 5; ++i) {
+        clusterTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+
+    std::cout << "Core-to-core one-way latency (ns):" << std::endl
+              << matrixTable << std::endl
+              << "Cluster summary:" << std::endl
+              << clusterTable << std::endl;
+}
+
+nlohmann::json coreToCoreLatencyToJson(const CoreToCoreLatency &latency, const std::vector<ClusterPairLatency> &clusterPairs) {
+    nlohmann::json result;
+    result["Iterations"] = latency.iterations;
+    result["CoreIds"] = latency.coreIds;
+    result["ClusterIds"] = latency.clusterIds;
+    result["LatencyMatrixNs"] = latency.latencyNs;
+    for (const auto &pair : clusterPairs) {
+        nlohmann::json item;
+        item["ClusterA"] = pair.clusterA;
+        item["ClusterB"] = pair.clusterB;
+        item["PairCount"] = pair.pairCount;
+        item["AvgLatencyNs"] = pair.avgNs;
+        item["MinLatencyNs"] = pair.minNs;
+        item["MaxLatencyNs"] = pair.maxNs;
+        result["ClusterSummary"].push_back(item);
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LMBENCH_BW_MEM_H
+#define LMBENCH_BW_MEM_H
+#include <stddef.h>  // for size_t
+
+/*
+ * lib_bw_mem.h - memory bandwidth kernels of bw_mem, shared with the
+ * contention benchmark which runs them as aggressor load.
+ */
+#define TYPE int
+
+/*
+ * rd - 4 byte read, 32 byte stride
+ * wr - 4 byte write, 32 byte stride
+ * rdwr - 4 byte read followed by 4 byte write to same place, 32 byte stride
+ * cp - 4 byte read then 4 byte write to different place, 32 byte stride
+ * fwr - write every 4 byte word
+ * frd - read every 4 byte word
+ * fcp - copy every 4 byte word
+ *
+ * All tests do 512 byte chunks in a loop.
+ *
+ * XXX - do a 64bit version of this.
+ */
+void rd(iter_t iterations, void *cookie);
+void wr(iter_t iterations, void *cookie);
+void rdwr(iter_t iterations, void *cookie);
+void mcp(iter_t iterations, void *cookie);
+void fwr(iter_t iterations, void *cookie);
+void frd(iter_t iterations, void *cookie);
+void fcp(iter_t iterations, void *cookie);
+void loop_bzero(iter_t iterations, void *cookie);
+void loop_bcopy(iter_t iterations, void *cookie);
+void init_overhead(iter_t iterations, void *cookie);
+void init_loop(iter_t iterations, void *cookie);
+void cleanup(iter_t iterations, void *cookie);
+
+typedef struct _state
+{
+	double overhead;
+	size_t nbytes;
+	int need_buf2;
+	int aligned;
+	TYPE *buf;
+	TYPE *buf2;
+	TYPE *buf2_orig;
+	TYPE *lastone;
+	size_t N;
+} state_t;
+
+/* look up a kernel by its bw_mem name, NULL if unknown */
+benchmp_f bw_mem_kernel(const char *what);
+int bw_mem_need_buf2(const char *what);
+
+#endif /* LMBENCH_BW_MEM_H */
@@ -0,0 +1,416 @@
+/*
+ * tlb.c - TLB reach and hugepage sensitivity benchmark
+ *
+ * usage: tlb [-M len[K|M]] [-W <warmup>] [-N <repetitions>] [-o <json file>]
+ *
+ * Builds a pointer chain which touches one word in each 4K-strided block
+ * of a working set, with the blocks visited in random order, and measures
+ * the latency of a dependent load as the working set grows.  The same
+ * walk is repeated on three kinds of backing memory:
+ *
+ *	4k	ordinary anonymous memory, THP explicitly disabled
+ *	thp	transparent hugepages, madvise(MADV_HUGEPAGE)
+ *	hugetlb	explicit hugetlbfs pages, mmap(MAP_HUGETLB)
+ *
+ * With 4K pages every access lands on a new page, so the latency steps up
+ * each time the number of pages exceeds the reach of a TLB level.  With
+ * hugepages the same walk only touches a handful of pages and should stay
+ * flat, the difference is the cost of 4K-page TLB misses for buffers of
+ * that size.
+ *
+ * The word used in block i is cache line (i + i/32) % 64 of the block, so
+ * the low page-number bits and the line offset together cover every set
+ * of a cache indexed by address bits 6-16.  The data itself then stays
+ * cached far beyond the TLB reach, and the steps that remain are TLB
+ * misses rather than cache set conflicts.
+ */
+#include "bench.h"
+#include <string.h>
+#include <sys/mman.h>
+
+#define FIVE(m) m m m m m
+#define TEN(m) FIVE(m) FIVE(m)
+#define FIFTY(m) TEN(m) TEN(m) TEN(m) TEN(m) TEN(m)
+#define HUNDRED(m) FIFTY(m) FIFTY(m)
+
+#define TLB_STRIDE 4096
+#define TLB_LINE 64
+#define TLB_MAX_SAMPLES 64
+#define TLB_MAX_LEVELS 4
+/* a new TLB level starts when latency grows by this factor over the plateau */
+#define TLB_THRESHOLD 1.15
+
+enum tlb_mode
+{
+	TLB_MODE_4K,
+	TLB_MODE_THP,
+	TLB_MODE_HUGETLB,
+	TLB_MODE_COUNT
+};
+
+static const char *tlb_mode_names[TLB_MODE_COUNT] = {"4k", "thp", "hugetlb"};
+
+struct tlb_sample
+{
+	size_t pages;
+	double latency;
+};
+
+struct tlb_level
+{
+	size_t entries;
+	double latency;
+	double penalty;
+};
+
+struct tlb_result
+{
+	int available;
+	char reason[128];
+	size_t pagesize;
+	size_t hugepage_bytes;
+	int nsamples;
+	struct tlb_sample samples[TLB_MAX_SAMPLES];
+	int nlevels;
+	struct tlb_level levels[TLB_MAX_LEVELS];
+};
+
+size_t hugepage_size();
+size_t anon_hugepage_bytes();
+char *tlb_alloc(int mode, size_t len, size_t *mapped, char *reason);
+double tlb_chase(char *base, size_t npages, int warmup, int repetitions);
+void tlb_find_levels(struct tlb_result *r);
+void tlb_print_json(FILE *out, size_t maxlen, struct tlb_result *results);
+
+int main(int ac, char **av)
+{
+	int c, mode;
+	int warmup = 0;
+	int repetitions = TRIES;
+	size_t maxlen = 64 * 1024 * 1024;
+	size_t npages, mapped;
+	char *output = NULL;
+	char *base;
+	FILE *out = stdout;
+	struct tlb_result results[TLB_MODE_COUNT];
+	char *usage = "[-M len[K|M]] [-W <warmup>] [-N <repetitions>] [-o <json file>]\n";
+
+	while ((c = getopt(ac, av, "M:W:N:o:")) != EOF)
+	{
+		switch (c)
+		{
+		case 'M':
+			maxlen = bytes(optarg);
+			break;
+		case 'W':
+			warmup = atoi(optarg);
+			break;
+		case 'N':
+			repetitions = atoi(optarg);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s %s", av[0], usage);
+			exit(1);
+		}
+	}
+
+	bzero(results, sizeof(results));
+	for (mode = 0; mode < TLB_MODE_COUNT; ++mode)
+	{
+		struct tlb_result *r = &results[mode];
+		size_t n, half;
+
+		base = tlb_alloc(mode, maxlen, &mapped, r->reason);
+		r->pagesize = (mode == TLB_MODE_4K) ? getpagesize() : hugepage_size();
+		if (base == NULL)
+		{
+			fprintf(stderr, "%s: unavailable, %s\n", tlb_mode_names[mode], r->reason);
+			continue;
+		}
+		r->available = 1;
+
+		/* sample 2^N and 1.5*2^N pages, like cache.c */
+		npages = maxlen / TLB_STRIDE;
+		for (n = 4; n <= npages && r->nsamples < TLB_MAX_SAMPLES; n <<= 1)
+		{
+			r->samples[r->nsamples].pages = n;
+			r->samples[r->nsamples].latency = tlb_chase(base, n, warmup, repetitions);
+			fprintf(stderr, "%s: %zu pages (%zu KB), %.2f nanoseconds\n", tlb_mode_names[mode],
+					n, n * TLB_STRIDE / 1024, r->samples[r->nsamples].latency);
+			r->nsamples++;
+
+			half = n + (n >> 1);
+			if (half <= npages && r->nsamples < TLB_MAX_SAMPLES)
+			{
+				r->samples[r->nsamples].pages = half;
+				r->samples[r->nsamples].latency = tlb_chase(base, half, warmup, repetitions);
+				r->nsamples++;
+			}
+		}
+		/* THP is only a hint, record how much of the process is really backed by hugepages */
+		r->hugepage_bytes = anon_hugepage_bytes();
+		if (mode == TLB_MODE_THP && r->hugepage_bytes == 0)
+			fprintf(stderr, "thp: no transparent hugepages were allocated, results match 4k pages\n");
+		munmap(base, mapped);
+
+		tlb_find_levels(r);
+		for (c = 0; c < r->nlevels; ++c)
+		{
+			fprintf(stderr, "%s: TLB level %d: %zu entries (%zu KB reach), miss penalty %.2f nanoseconds\n",
+					tlb_mode_names[mode], c + 1, r->levels[c].entries,
+					r->levels[c].entries * TLB_STRIDE / 1024, r->levels[c].penalty);
+		}
+	}
+
+	if (output && (out = fopen(output, "w")) == NULL)
+	{
+		perror(output);
+		exit(1);
+	}
+	tlb_print_json(out, maxlen, results);
+	if (out != stdout)
+		fclose(out);
+	return (0);
+}
+
+size_t
+hugepage_size()
+{
+	char line[256];
+	size_t kb = 2048;
+	FILE *f = fopen("/proc/meminfo", "r");
+
+	if (!f)
+		return kb * 1024;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1)
+			break;
+	}
+	fclose(f);
+	return kb * 1024;
+}
+
+size_t
+anon_hugepage_bytes()
+{
+	char line[256];
+	size_t kb, total = 0;
+	FILE *f = fopen("/proc/self/smaps_rollup", "r");
+
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1)
+			total += kb * 1024;
+	}
+	fclose(f);
+	return total;
+}
+
+/*
+ * Map len bytes of the requested kind of memory, rounded up to (and for
+ * THP aligned on) the hugepage size.  Memory is touched so that every
+ * page is faulted in before the chain is built.
+ */
+char *
+tlb_alloc(int mode, size_t len, size_t *mapped, char *reason)
+{
+	size_t huge = hugepage_size();
+	size_t size = (len + huge - 1) / huge * huge;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	char *p, *aligned;
+
+	*mapped = 0;
+	if (mode == TLB_MODE_HUGETLB)
+	{
+#ifdef MAP_HUGETLB
+		p = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+		if (p == MAP_FAILED)
+		{
+			sprintf(reason, "mmap(MAP_HUGETLB) failed: %s, check /proc/sys/vm/nr_hugepages", strerror(errno));
+			return NULL;
+		}
+		*mapped = size;
+		memset(p, 1, size);
+		return p;
+#else
+		sprintf(reason, "MAP_HUGETLB not supported");
+		return NULL;
+#endif
+	}
+
+	/* over-allocate one hugepage so the region can start on a hugepage boundary */
+	p = (char *)mmap(NULL, size + huge, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (p == MAP_FAILED)
+	{
+		sprintf(reason, "mmap failed: %s", strerror(errno));
+		return NULL;
+	}
+	aligned = (char *)(((unsigned long)p + huge - 1) / huge * huge);
+	if (aligned != p)
+		munmap(p, aligned - p);
+	if (aligned + size != p + size + huge)
+		munmap(aligned + size, (p + size + huge) - (aligned + size));
+
+	if (mode == TLB_MODE_THP)
+	{
+#ifdef MADV_HUGEPAGE
+		if (madvise(aligned, size, MADV_HUGEPAGE) != 0)
+		{
+			sprintf(reason, "madvise(MADV_HUGEPAGE) failed: %s", strerror(errno));
+			munmap(aligned, size);
+			return NULL;
+		}
+#else
+		sprintf(reason, "MADV_HUGEPAGE not supported");
+		munmap(aligned, size);
+		return NULL;
+#endif
+	}
+	else
+	{
+#ifdef MADV_NOHUGEPAGE
+		madvise(aligned, size, MADV_NOHUGEPAGE);
+#endif
+	}
+	*mapped = size;
+	memset(aligned, 1, size);
+	return aligned;
+}
+
+/*
+ * Link one word in each of the first npages 4K blocks into a random
+ * circular chain, walk it warmup times and return the average latency of a dereference in
+ * nanoseconds.
+ */
+double
+tlb_chase(char *base, size_t npages, int warmup, int repetitions)
+{
+	size_t i;
+	size_t nlines = TLB_STRIDE / TLB_LINE;
+	size_t *order = permutation(npages, TLB_STRIDE);
+	char **p;
+	double t;
+	result_t *r, *r_save;
+
+	if (order == NULL)
+		return -1.;
+
+#define TLB_WORD(i) (base + order[i] + ((order[i] / TLB_STRIDE + order[i] / TLB_STRIDE / 32) % nlines) * TLB_LINE)
+	for (i = 0; i < npages - 1; ++i)
+	{
+		*(char **)TLB_WORD(i) = TLB_WORD(i + 1);
+	}
+	*(char **)TLB_WORD(npages - 1) = TLB_WORD(0);
+	p = (char **)TLB_WORD(0);
+#undef TLB_WORD
+	free(order);
+
+	/* untimed walks over the whole chain to fill the TLB and caches */
+	for (i = 0; i < (size_t)warmup * npages; ++i)
+		p = (char **)*p;
+
+	r_save = get_results();
+	r = (result_t *)malloc(sizeof_result(repetitions));
+	insertinit(r);
+	for (i = 0; i < repetitions; ++i)
+	{
+		BENCH1(HUNDRED(p = (char **)*p;), 0);
+		insertsort(gettime(), get_n(), r);
+	}
+	use_pointer(p);
+	set_results(r);
+	t = 10. * (double)gettime() / (double)get_n();
+	set_results(r_save);
+	free(r);
+	return t;
+}
+
+/*
+ * Walk the samples from small to large working sets.  Whenever the
+ * latency rises above the current plateau by TLB_THRESHOLD, the previous
+ * sample is the largest working set that still fit in this TLB level.
+ */
+void
+tlb_find_levels(struct tlb_result *r)
+{
+	int i;
+	double plateau;
+
+	if (r->nsamples < 2)
+		return;
+	plateau = r->samples[0].latency;
+	for (i = 1; i < r->nsamples && r->nlevels < TLB_MAX_LEVELS; ++i)
+	{
+		if (r->samples[i].latency > TLB_THRESHOLD * plateau)
+		{
+			struct tlb_level *level = &r->levels[r->nlevels++];
+			int j = i;
+
+			level->entries = r->samples[i - 1].pages;
+			level->latency = plateau;
+			/* the new plateau is where the latency stops climbing */
+			while (j + 1 < r->nsamples && r->samples[j + 1].latency > TLB_THRESHOLD * r->samples[j].latency)
+				j++;
+			level->penalty = r->samples[j].latency - plateau;
+			plateau = r->samples[j].latency;
+			i = j;
+		}
+	}
+}
+
+void tlb_print_json(FILE *out, size_t maxlen, struct tlb_result *results)
+{
+	int mode, i;
+	char thp[128] = "unknown";
+	FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+
+	if (f)
+	{
+		if (fgets(thp, sizeof(thp), f))
+			thp[strcspn(thp, "\n")] = 0;
+		fclose(f);
+	}
+
+	fprintf(out, "{\n");
+	fprintf(out, "    \"MaxWorkingSetBytes\": %zu,\n", maxlen);
+	fprintf(out, "    \"StrideBytes\": %d,\n", TLB_STRIDE);
+	fprintf(out, "    \"TransparentHugepage\": \"%s\",\n", thp);
+	fprintf(out, "    \"Modes\": [\n");
+	for (mode = 0; mode < TLB_MODE_COUNT; ++mode)
+	{
+		struct tlb_result *r = &results[mode];
+
+		fprintf(out, "        {\n");
+		fprintf(out, "            \"Mode\": \"%s\",\n", tlb_mode_names[mode]);
+		fprintf(out, "            \"Available\": %s,\n", r->available ? "true" : "false");
+		if (!r->available)
+			fprintf(out, "            \"Reason\": \"%s\",\n", r->reason);
+		fprintf(out, "            \"PageSize\": %zu,\n", r->pagesize);
+		if (mode == TLB_MODE_THP)
+			fprintf(out, "            \"AnonHugePagesBytes\": %zu,\n", r->hugepage_bytes);
+		fprintf(out, "            \"Samples\": [");
+		for (i = 0; i < r->nsamples; ++i)
+		{
+			fprintf(out, "%s\n                {\"Pages\": %zu, \"WorkingSetBytes\": %zu, \"LatencyNs\": %.3f}",
+					i ? "," : "", r->samples[i].pages, r->samples[i].pages * TLB_STRIDE, r->samples[i].latency);
+		}
+		fprintf(out, "%s],\n", r->nsamples ? "\n            " : "");
+		fprintf(out, "            \"TlbLevels\": [");
+		for (i = 0; i < r->nlevels; ++i)
+		{
+			fprintf(out, "%s\n                {\"Level\": %d, \"Entries\": %zu, \"ReachBytes\": %zu, \"HitLatencyNs\": %.3f, \"MissPenaltyNs\": %.3f}",
+					i ? "," : "", i + 1, r->levels[i].entries, r->levels[i].entries * TLB_STRIDE,
+					r->levels[i].latency, r->levels[i].penalty);
+		}
+		fprintf(out, "%s]\n", r->nlevels ? "\n            " : "");
+		fprintf(out, "        }%s\n", mode < TLB_MODE_COUNT - 1 ? "," : "");
+	}
+	fprintf(out, "    ]\n");
+	fprintf(out, "}\n");
+}
@@ -1,13 +1,43 @@
 #include "glog/logging.h"
 #include "gflags/gflags.h"
 #include "tabulate.hpp"
+#include "nlohmann/json.hpp"
 #include <unistd.h>
 #include <iostream>
 #include "arch_test.hpp"
+#include "core_to_core.hpp"
+#include "compute_peak.hpp"
+#include "memory_bandwidth.hpp"
 
-void lscpu();
+// 定义硬件画像输出文件路径
+DEFINE_string(output_file, "output/arch_profile.json", "The file path to the output hardware profile json file.");
 
+// 是否测试核间cache line传递延迟
+DEFINE_bool(enable_core_to_core, true, "Flag to enable the core-to-core cache line latency benchmark.");
 
+// 每对核心之间往返的次数
+DEFINE_int32(c2c_iterations, 10000, "The number of ping-pong round trips per core pair.");
+
+// 每对核心重复测量的次数，取最小值
+DEFINE_int32(c2c_repeats, 3, "The number of repeats per core pair, the minimum is reported.");
+
+// 是否测试CPU峰值算力
+DEFINE_bool(enable_compute_peak, true, "Flag to enable the fp32/fp16/int8 compute peak benchmark.");
+
+// 每次算力测试的最短运行时间(ms)
+DEFINE_double(compute_min_time_ms, 50.0, "The minimum duration of a single compute peak run in milliseconds.");
+
+// 算力测试重复次数，取最快的一次
+DEFINE_int32(compute_repeats, 3, "The number of repeats per compute peak run, the fastest is reported.");
+
+// 是否测试单线程host内存带宽（roofline报告中的host拷贝上限）
+DEFINE_bool(enable_memory_bandwidth, true, "Flag to enable the single thread host memory bandwidth benchmark.");
+
+// 带宽测试使用的缓冲区大小，应远大于最后一级cache
+DEFINE_int32(membw_mb, 64, "The buffer size of the memory bandwidth benchmark in MB.");
+
+CpuInformation lscpu();
+nlohmann::json cpuInformationToJson(const CpuInformation &cpuInfo);
 
 int main(int argc, char **argv)
 {
@@ -19,11 +49,68 @@ int main(int argc, char **argv)
     FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
     FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
 
-    
+    if (FLAGS_enable_compute_peak && FLAGS_compute_repeats < 1)
+    {
+        LOG(ERROR) << "Invalid compute_repeats: " << FLAGS_compute_repeats << ", must be at least 1.";
+        return -1;
+    }
+
+    nlohmann::json profile;
+    CpuInformation cpuInfo = lscpu();
+    profile["CpuInfo"] = cpuInformationToJson(cpuInfo);
+
+    if (FLAGS_enable_core_to_core)
+    {
+        if (FLAGS_c2c_iterations < 1 || FLAGS_c2c_repeats < 1)
+        {
+            LOG(ERROR) << "Invalid c2c_iterations or c2c_repeats: " << FLAGS_c2c_iterations << ", " << FLAGS_c2c_repeats << ", both must be at least 1.";
+            return -1;
+        }
+        if (cpuInfo.coresInformationList.size() < 2)
+        {
+            LOG(WARNING) << "Core-to-core latency needs at least 2 cores, skipped.";
+        }
+        else
+        {
+            LOG(INFO) << "Measuring core-to-core latency, iterations: " << FLAGS_c2c_iterations << ", repeats: " << FLAGS_c2c_repeats;
+            CoreToCoreLatency latency = measureCoreToCoreLatency(cpuInfo, FLAGS_c2c_iterations, FLAGS_c2c_repeats);
+            std::vector<ClusterPairLatency> clusterPairs = summarizeClusterLatency(latency);
+            printCoreToCoreLatency(latency, clusterPairs);
+            profile["CoreToCoreLatency"] = coreToCoreLatencyToJson(latency, clusterPairs);
+        }
+    }
+
+    if (FLAGS_enable_memory_bandwidth)
+    {
+        MemoryBandwidth bandwidth = measureMemoryBandwidth((size_t)FLAGS_membw_mb * 1024 * 1024, 5);
+        LOG(INFO) << "Memory bandwidth (" << FLAGS_membw_mb << " MB): read " << bandwidth.readMBps << " MB/s, write "
+                  << bandwidth.writeMBps << " MB/s, copy " << bandwidth.copyMBps << " MB/s";
+        profile["MemoryBandwidth"] = memoryBandwidthToJson(bandwidth);
+    }
+
+    if (FLAGS_enable_compute_peak)
+    {
+        LOG(INFO) << "Measuring compute peak, min time: " << FLAGS_compute_min_time_ms << " ms, repeats: " << FLAGS_compute_repeats;
+        std::vector<ComputeKernelResult> computePeak = measureComputePeak(cpuInfo, FLAGS_compute_min_time_ms, FLAGS_compute_repeats);
+        printComputePeak(computePeak);
+        profile["ComputePeak"] = computePeakToJson(computePeak);
+    }
+
+    // 创建输出目录（如果不存在）
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << profile << std::endl;
+    LOG(INFO) << "Hardware profile saved to " << FLAGS_output_file;
+
+    google::ShutdownGoogleLogging();
     return 0;
 }
 
-void lscpu()
+CpuInformation lscpu()
 {
 
     struct CpuInformation cpuInfo;
@@ -35,6 +122,11 @@ void lscpu()
     cpuInfo.vendor = getVendor();
     cpuInfo.architecture = getArchitecture();
     cpuInfo.coreCount = getCoreCount();
+    if (cpuInfo.coreCount <= 0)
+    {
+        // /proc/cpuinfo解析只支持x86，其他架构直接向系统查询核心数
+        cpuInfo.coreCount = sysconf(_SC_NPROCESSORS_CONF);
+    }
 
     if (cpuInfo.coreCount > 0)
     {
@@ -42,6 +134,7 @@ void lscpu()
         {
             struct CpuCoreInformation coreInfo;
             coreInfo.coreId = coreId;
+            coreInfo.clusterId = getCoreClusterId(coreId);
             coreInfo.availableFrequencies = getCoreAvailableFrequencies(coreId);
             coreInfo.cacheInfoList = getCpuCacheInfo(coreId);
 
@@ -50,4 +143,27 @@ void lscpu()
     }
 
     printCpuInformation(cpuInfo);
-}
\ No newline at end of file
+    return cpuInfo;
+}
+
+nlohmann::json cpuInformationToJson(const CpuInformation &cpuInfo)
+{
+    nlohmann::json result;
+    result["Model"] = cpuInfo.model;
+    result["Vendor"] = cpuInfo.vendor;
+    result["Architecture"] = cpuInfo.architecture;
+    result["CoreCount"] = cpuInfo.coreCount;
+    for (const auto &coreInfo : cpuInfo.coresInformationList)
+    {
+        nlohmann::json core;
+        core["CoreId"] = coreInfo.coreId;
+        core["ClusterId"] = coreInfo.clusterId;
+        core["AvailableFrequencies"] = coreInfo.availableFrequencies;
+        for (const auto &cacheInfo : coreInfo.cacheInfoList)
+        {
+            core["Caches"].push_back({{"Level", cacheInfo.level}, {"Type", cacheInfo.type}, {"SizeKB", cacheInfo.sizeKB}});
+        }
+        result["Cores"].push_back(core);
+    }
+    return result;
+}
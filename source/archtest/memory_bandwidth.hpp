@@ -0,0 +1,74 @@
+#ifndef MEMORY_BANDWIDTH_HPP
+#define MEMORY_BANDWIDTH_HPP
+
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include "nlohmann/json.hpp"
+
+// 单线程host内存带宽，作为模型输入/输出拷贝的上限（驱动里的拷贝基本都是单线程完成的）
+struct MemoryBandwidth {
+    size_t bufferBytes;
+    double readMBps;
+    double writeMBps;
+    double copyMBps;
+};
+
+uint64_t memoryReadKernel(const uint64_t *buffer, size_t words) {
+    uint64_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    for (size_t i = 0; i + 3 < words; i += 4) {
+        sum0 += buffer[i];
+        sum1 += buffer[i + 1];
+        sum2 += buffer[i + 2];
+        sum3 += buffer[i + 3];
+    }
+    return sum0 + sum1 + sum2 + sum3;
+}
+
+// 对fn重复repeats次，返回最快一次的带宽(MB/s, 1MB = 1e6 bytes，与bw_mem保持一致)
+template <typename Func>
+double measureBandwidthMBps(size_t bytes, int repeats, Func &&fn) {
+    double bestSeconds = 0;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        if (r == 0 || seconds < bestSeconds) {
+            bestSeconds = seconds;
+        }
+    }
+    return bytes / bestSeconds / 1e6;
+}
+
+MemoryBandwidth measureMemoryBandwidth(size_t bufferBytes, int repeats) {
+    MemoryBandwidth result{bufferBytes, 0, 0, 0};
+    size_t words = bufferBytes / sizeof(uint64_t);
+    std::vector<uint64_t> src(words, 1);
+    std::vector<uint64_t> dst(words, 0);
+
+    volatile uint64_t sink = 0;
+    result.readMBps = measureBandwidthMBps(bufferBytes, repeats, [&]() {
+        sink = sink + memoryReadKernel(src.data(), words);
+    });
+    result.writeMBps = measureBandwidthMBps(bufferBytes, repeats, [&]() {
+        memset(dst.data(), (int)sink & 0xff, bufferBytes);
+    });
+    result.copyMBps = measureBandwidthMBps(bufferBytes, repeats, [&]() {
+        memcpy(dst.data(), src.data(), bufferBytes);
+    });
+    return result;
+}
+
+nlohmann::json memoryBandwidthToJson(const MemoryBandwidth &bandwidth) {
+    nlohmann::json result;
+    result["BufferBytes"] = bandwidth.bufferBytes;
+    result["ReadMBps"] = bandwidth.readMBps;
+    result["WriteMBps"] = bandwidth.writeMBps;
+    result["CopyMBps"] = bandwidth.copyMBps;
+    return result;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "tabulate.hpp"
+#include "nlohmann/json.hpp"
+#include "DynamicBatcher.hpp"
+#include "SimulatedBackend.hpp"
+#include "Trace.hpp"
+
+// 动态批处理的最大batch，对应模型编译时的batch维
+DEFINE_int32(max_batch, 8, "The maximum batch size, i.e. the batch dimension the model is compiled with.");
+
+// 逗号分隔的最大排队延迟(us)，每个值测一个延迟/吞吐点
+DEFINE_string(max_delays, "0,250,500,1000,2000,4000", "Comma separated max queue delays in us, one curve point each.");
+
+// 同时在运行或等待运行的批次数
+DEFINE_int32(inflight_batches, 2, "The number of batches running or waiting to run.");
+
+// 开环负载: 泊松到达的请求速率(请求/s)和请求个数
+DEFINE_double(request_rate, 2000, "The Poisson arrival rate of the requests per second.");
+DEFINE_int32(num_requests, 2000, "The number of requests per curve point.");
+DEFINE_int32(seed, 0, "The seed of the arrival process.");
+
+// 模拟后端的模型参数，一次推理的计算时间为sim_compute_us + sim_sample_compute_us * batch
+DEFINE_int64(sim_input_bytes, 1 * 3 * 224 * 224, "The input size of one sample of the simulated model in bytes.");
+DEFINE_int64(sim_output_bytes, 1000 * 4, "The output size of one sample of the simulated model in bytes.");
+DEFINE_int32(sim_weight_mb, 8, "The weights read from DDR per simulated inference in MB.");
+DEFINE_double(sim_compute_us, 500, "The fixed compute time of a simulated inference in us.");
+DEFINE_double(sim_sample_compute_us, 100, "The compute time per sample of the compiled batch in us.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/batcher_benchmark.json", "The file path to the output json file.");
+
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+
+// 按batch维编译的模拟模型，不满的批次同样按编译的batch计算
+std::unique_ptr<SimulatedBackend> make_simulated_backend(int batch)
+{
+    SimulatedModelConfig config;
+    config.name = "simulated_batch" + std::to_string(batch);
+    config.inputBytes = FLAGS_sim_input_bytes * batch;
+    config.outputBytes = FLAGS_sim_output_bytes * batch;
+    config.weightBytes = (size_t)FLAGS_sim_weight_mb * 1024 * 1024;
+    config.computeUs = FLAGS_sim_compute_us + FLAGS_sim_sample_compute_us * batch;
+    return std::unique_ptr<SimulatedBackend>(new SimulatedBackend(config));
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+    FLAGS_alsologtostderr = true;
+    FLAGS_colorlogtostderr = true;
+    FLAGS_log_prefix = true;
+    FLAGS_logbufsecs = 0;
+    TRACE_THREAD_NAME("main");
+
+    if (FLAGS_inflight_batches < 1)
+    {
+        LOG(ERROR) << "Invalid inflight_batches: " << FLAGS_inflight_batches << ", must be at least 1.";
+        return -1;
+    }
+    std::vector<double> delays;
+    if (FLAGS_max_batch < 1 || !parse_delay_list(FLAGS_max_delays, delays))
+    {
+        LOG(ERROR) << "Invalid max_batch or max_delays: " << FLAGS_max_batch << ", " << FLAGS_max_delays;
+        return -1;
+    }
+
+    LoadConfig load;
+    load.requestRate = FLAGS_request_rate;
+    load.numRequests = FLAGS_num_requests;
+    load.seed = FLAGS_seed;
+    std::vector<uint8_t> sample(FLAGS_sim_input_bytes, 1);
+
+    auto run_point = [&](int maxBatch, double maxDelayUs)
+    {
+        auto backend = make_simulated_backend(maxBatch);
+        BatcherConfig config;
+        config.maxBatch = maxBatch;
+        config.maxDelayUs = maxDelayUs;
+        config.inflightBatches = FLAGS_inflight_batches;
+        config.inputSampleBytes = {(size_t)FLAGS_sim_input_bytes};
+        config.outputSampleBytes = {(size_t)FLAGS_sim_output_bytes};
+        // 模拟模型按编译的批大小整批运行，与实际请求数无关
+        BatchRunner runner = [&](const std::vector<uint8_t *> &inputs, int, const std::vector<uint8_t *> &outputs)
+        {
+            backend->inputs_set(inputs[0]);
+            backend->run();
+            backend->outputs_get(outputs[0]);
+        };
+        LOG(INFO) << "max_batch " << maxBatch << ", max_delay " << maxDelayUs << " us";
+        return run_batching_load(config, runner, load, {sample.data()});
+    };
+
+    // 第一个点不攒批(max_batch=1)，作为对照
+    std::vector<BatchingPoint> curve;
+    curve.push_back(run_point(1, 0));
+    for (double delay : delays)
+    {
+        curve.push_back(run_point(FLAGS_max_batch, delay));
+    }
+    log_batching_curve(curve);
+
+    nlohmann::json report;
+    report["MetaInfo"] = make_simulated_backend(FLAGS_max_batch)->meta_info();
+    report["RequestRate"] = FLAGS_request_rate;
+    report["Requests"] = FLAGS_num_requests;
+    report["InflightBatches"] = FLAGS_inflight_batches;
+    for (const auto &point : curve)
+    {
+        report["Curve"].push_back(batching_point_json(point));
+    }
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << report << std::endl;
+
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
+    }
+
+    google::ShutdownGoogleLogging();
+    return 0;
+}
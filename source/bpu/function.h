@@ -10,6 +10,12 @@
 #include <cstdio>
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <vector>
+#include "ImageProcess.hpp"
+#include "Postprocess.hpp"
+#include "InputProvider.hpp"
+#include "TensorPool.hpp"
 std::string dump_tensor_shape(hbDNNTensorShape shape)
 {
     std::stringstream stream;
@@ -125,4 +131,330 @@ void dump_tensor_properties(int index, std::string name, hbDNNTensorProperties p
     LOG(INFO) << tensor_type << ", index = " << index << ", name = " << name << ", valid shape = " << dump_tensor_shape(prop.validShape) << ", aligned shape = " << dump_tensor_shape(prop.alignedShape) << ", tensor layout = " << string_tensorlayout(prop.tensorLayout) << ", tensor type = " << string_tensortype(prop.tensorType);
 }
 
-#endif
\ No newline at end of file
+// BPU内存(hbSysMem)的缓冲池，批量测试多个模型时相同大小的输入输出缓冲区会被复用
+BufferPool<hbSysMem> &bpu_memory_pool()
+{
+    static BufferPool<hbSysMem> pool(
+        "bpu",
+        [](const PoolKey &key, hbSysMem &mem)
+        { return hbSysAllocMem(&mem, key.size) == HB_SYS_SUCCESS; },
+        [](const PoolKey &key, hbSysMem &mem)
+        { hbSysFreeMem(&mem); });
+    return pool;
+}
+
+// 输入张量的元素类型，图像类型按uint8处理，4bit类型按打包后的字节填充
+InputDataType to_input_dtype(int32_t type)
+{
+    switch (type)
+    {
+    case HB_DNN_TENSOR_TYPE_S8:
+        return InputDataType::Int8;
+    case HB_DNN_TENSOR_TYPE_F16:
+        return InputDataType::Float16;
+    case HB_DNN_TENSOR_TYPE_S16:
+        return InputDataType::Int16;
+    case HB_DNN_TENSOR_TYPE_U16:
+        return InputDataType::Uint16;
+    case HB_DNN_TENSOR_TYPE_F32:
+        return InputDataType::Float32;
+    case HB_DNN_TENSOR_TYPE_S32:
+    case HB_DNN_TENSOR_TYPE_U32:
+        return InputDataType::Int32;
+    case HB_DNN_TENSOR_TYPE_S64:
+    case HB_DNN_TENSOR_TYPE_U64:
+        return InputDataType::Int64;
+    default:
+        return InputDataType::Uint8;
+    }
+}
+
+// 相机输出的一帧图像，format为nv12、rgb或bgr，crop为送入模型前的裁剪区域
+struct CameraFrame
+{
+    std::string format = "nv12";
+    int width = 0;
+    int height = 0;
+    ImageRect crop;
+    std::vector<uint8_t> data;
+};
+
+// 读取原始的NV12/RGB/BGR帧，path为空时生成一帧渐变图像
+bool load_camera_frame(const std::string &path, CameraFrame &frame)
+{
+    if (frame.width <= 0 || frame.height <= 0 || frame.width % 2 != 0 || frame.height % 2 != 0)
+    {
+        LOG(ERROR) << "Camera frame size must be positive and even: " << frame.width << "x" << frame.height;
+        return false;
+    }
+    size_t pixels = (size_t)frame.width * frame.height;
+    size_t size = frame.format == "nv12" ? pixels * 3 / 2 : pixels * 3;
+    if (frame.format != "nv12" && frame.format != "rgb" && frame.format != "bgr")
+    {
+        LOG(ERROR) << "Unsupported camera frame format: " << frame.format;
+        return false;
+    }
+    frame.data.resize(size);
+    if (path.empty())
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            size_t pixel = i % pixels;
+            frame.data[i] = (uint8_t)((pixel % frame.width) * 255 / frame.width + (pixel / frame.width) * 64 / frame.height + i / pixels * 32);
+        }
+        return true;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read((char *)frame.data.data(), size))
+    {
+        LOG(ERROR) << "Failed to read " << size << " bytes of " << frame.format << " frame from " << path;
+        return false;
+    }
+    return true;
+}
+
+// 图像输入在BPU内存中的布局。alignedShape的宽高包含对齐填充，每行的字节跨度按对齐后的宽度计算
+struct ImageInputLayout
+{
+    int32_t type;
+    int width;
+    int height;
+    int alignedWidth;
+    int alignedHeight;
+    // NCHW布局的RGB/BGR按通道平面存放
+    bool planar;
+};
+
+bool get_image_input_layout(const hbDNNTensorProperties &prop, ImageInputLayout &layout)
+{
+    switch (prop.tensorType)
+    {
+    case hbDNNDataType::HB_DNN_IMG_TYPE_Y:
+    case hbDNNDataType::HB_DNN_IMG_TYPE_NV12:
+    case hbDNNDataType::HB_DNN_IMG_TYPE_NV12_SEPARATE:
+    case hbDNNDataType::HB_DNN_IMG_TYPE_RGB:
+    case hbDNNDataType::HB_DNN_IMG_TYPE_BGR:
+        break;
+    default:
+        return false;
+    }
+    if (prop.validShape.numDimensions != 4 || prop.alignedShape.numDimensions != 4)
+    {
+        return false;
+    }
+    bool nhwc = prop.tensorLayout == hbDNNTensorLayout::HB_DNN_LAYOUT_NHWC;
+    int h = nhwc ? 1 : 2;
+    int w = nhwc ? 2 : 3;
+    layout.type = prop.tensorType;
+    layout.width = prop.validShape.dimensionSize[w];
+    layout.height = prop.validShape.dimensionSize[h];
+    layout.alignedWidth = prop.alignedShape.dimensionSize[w];
+    layout.alignedHeight = prop.alignedShape.dimensionSize[h];
+    layout.planar = !nhwc && (prop.tensorType == hbDNNDataType::HB_DNN_IMG_TYPE_RGB || prop.tensorType == hbDNNDataType::HB_DNN_IMG_TYPE_BGR);
+    return true;
+}
+
+// 把相机帧裁剪、缩放并转换颜色空间后直接写入模型输入的对齐缓冲区，scratch用于缩放后、转换前的中间结果
+void preprocess_image_input(const CameraFrame &frame, const ImageInputLayout &layout, hbDNNTensor &tensor, std::vector<uint8_t> &scratch)
+{
+    const uint8_t *srcY = frame.data.data();
+    const uint8_t *srcUV = srcY + (size_t)frame.width * frame.height;
+    bool srcNV12 = frame.format == "nv12";
+    int w = layout.width;
+    int h = layout.height;
+    int aw = layout.alignedWidth;
+    uint8_t *dst = (uint8_t *)tensor.sysMem[0].virAddr;
+
+    if (layout.type == hbDNNDataType::HB_DNN_IMG_TYPE_Y || layout.type == hbDNNDataType::HB_DNN_IMG_TYPE_NV12 ||
+        layout.type == hbDNNDataType::HB_DNN_IMG_TYPE_NV12_SEPARATE)
+    {
+        bool lumaOnly = layout.type == hbDNNDataType::HB_DNN_IMG_TYPE_Y;
+        uint8_t *dstUV = layout.type == hbDNNDataType::HB_DNN_IMG_TYPE_NV12_SEPARATE
+                             ? (uint8_t *)tensor.sysMem[1].virAddr
+                             : dst + (size_t)aw * layout.alignedHeight;
+        if (srcNV12 && lumaOnly)
+        {
+            resize_bilinear(srcY, frame.width, frame.height, frame.width, 1, frame.crop, dst, w, h, aw);
+        }
+        else if (srcNV12)
+        {
+            resize_nv12(srcY, frame.width, srcUV, frame.width, frame.width, frame.height, frame.crop, dst, aw, dstUV, aw, w, h);
+        }
+        else
+        {
+            // 先在RGB上缩放，再只对模型分辨率的像素做颜色转换；只要Y时UV写到scratch的尾部
+            scratch.resize((size_t)w * h * 3 + (lumaOnly ? (size_t)w * h / 2 : 0));
+            resize_bilinear(srcY, frame.width, frame.height, frame.width * 3, 3, frame.crop, scratch.data(), w, h, w * 3);
+            rgb_to_nv12(scratch.data(), w * 3, w, h, dst, aw, lumaOnly ? scratch.data() + (size_t)w * h * 3 : dstUV,
+                        lumaOnly ? w : aw, frame.format == "bgr");
+        }
+        hbSysFlushMem(&tensor.sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
+        if (layout.type == hbDNNDataType::HB_DNN_IMG_TYPE_NV12_SEPARATE)
+        {
+            hbSysFlushMem(&tensor.sysMem[1], HB_SYS_MEM_CACHE_CLEAN);
+        }
+        return;
+    }
+
+    // RGB/BGR输入: NHWC直接写入对齐缓冲区，NCHW先得到打包的结果再拆成通道平面
+    bool dstBGR = layout.type == hbDNNDataType::HB_DNN_IMG_TYPE_BGR;
+    size_t packedBytes = (size_t)w * h * 3;
+    size_t nv12Bytes = srcNV12 ? (size_t)w * h * 3 / 2 : 0;
+    scratch.resize(nv12Bytes + (layout.planar ? packedBytes : 0));
+    uint8_t *packed = layout.planar ? scratch.data() + nv12Bytes : dst;
+    int packedStride = layout.planar ? w * 3 : aw * 3;
+    if (srcNV12)
+    {
+        uint8_t *resized = scratch.data();
+        resize_nv12(srcY, frame.width, srcUV, frame.width, frame.width, frame.height, frame.crop, resized, w, resized + (size_t)w * h, w, w, h);
+        nv12_to_rgb(resized, w, resized + (size_t)w * h, w, w, h, packed, packedStride, dstBGR);
+    }
+    else
+    {
+        resize_bilinear(srcY, frame.width, frame.height, frame.width * 3, 3, frame.crop, packed, w, h, packedStride);
+        if ((frame.format == "bgr") != dstBGR)
+        {
+            for (int row = 0; row < h; row++)
+            {
+                uint8_t *pixel = packed + (size_t)row * packedStride;
+                for (int x = 0; x < w; x++, pixel += 3)
+                {
+                    std::swap(pixel[0], pixel[2]);
+                }
+            }
+        }
+    }
+    if (layout.planar)
+    {
+        size_t plane = (size_t)aw * layout.alignedHeight;
+        if (aw == w && layout.alignedHeight == h)
+        {
+            nhwc_to_nchw(packed, dst, TensorShape4D{1, 3, (size_t)h, (size_t)w});
+        }
+        else
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                for (int row = 0; row < h; row++)
+                {
+                    const uint8_t *src = packed + (size_t)row * w * 3 + c;
+                    uint8_t *out = dst + c * plane + (size_t)row * aw;
+                    for (int x = 0; x < w; x++)
+                    {
+                        out[x] = src[3 * x];
+                    }
+                }
+            }
+        }
+    }
+    hbSysFlushMem(&tensor.sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
+}
+
+// 第row行(除最后一维外按validShape展开)在对齐缓冲区中的元素偏移，axisIndex返回该行在quantizeAxis上的下标
+size_t aligned_row_offset(const hbDNNTensorProperties &prop, size_t row, int &axisIndex)
+{
+    int n = prop.validShape.numDimensions;
+    size_t offset = 0;
+    size_t alignedStride = prop.alignedShape.dimensionSize[n - 1];
+    axisIndex = 0;
+    for (int d = n - 2; d >= 0; d--)
+    {
+        size_t index = row % prop.validShape.dimensionSize[d];
+        row /= prop.validShape.dimensionSize[d];
+        offset += index * alignedStride;
+        alignedStride *= prop.alignedShape.dimensionSize[d];
+        if (d == prop.quantizeAxis)
+        {
+            axisIndex = (int)index;
+        }
+    }
+    return offset;
+}
+
+// 第channel个通道的量化参数: SCALE对应scaleData/zeroPointData，SHIFT对应 x = q / 2^shift
+QuantParams channel_quant_params(const hbDNNTensorProperties &prop, int channel)
+{
+    if (prop.quantiType == hbDNNQuantiType::SCALE)
+    {
+        float scale = prop.scale.scaleData[prop.scale.scaleLen > 1 ? channel : 0];
+        int32_t zeroPoint = prop.scale.zeroPointLen > 0 ? prop.scale.zeroPointData[prop.scale.zeroPointLen > 1 ? channel : 0] : 0;
+        return QuantParams{scale, zeroPoint};
+    }
+    if (prop.quantiType == hbDNNQuantiType::SHIFT)
+    {
+        return QuantParams{std::ldexp(1.0f, -prop.shift.shiftData[prop.shift.shiftLen > 1 ? channel : 0]), 0};
+    }
+    return QuantParams{};
+}
+
+template <typename T>
+void dequantize_rows(const T *src, const hbDNNTensorProperties &prop, size_t rows, size_t rowLength, float *dst)
+{
+    int n = prop.validShape.numDimensions;
+    bool perElement = prop.quantizeAxis == n - 1 && (prop.scale.scaleLen > 1 || prop.shift.shiftLen > 1);
+    for (size_t row = 0; row < rows; row++)
+    {
+        int channel;
+        const T *srcRow = src + aligned_row_offset(prop, row, channel);
+        float *dstRow = dst + row * rowLength;
+        if (perElement)
+        {
+            // 在最后一维上per-channel量化时每个元素的参数都不同
+            for (size_t i = 0; i < rowLength; i++)
+            {
+                dequantize_ref(srcRow + i, dstRow + i, 1, channel_quant_params(prop, (int)i));
+            }
+        }
+        else
+        {
+            dequantize(srcRow, dstRow, rowLength, channel_quant_params(prop, channel));
+        }
+    }
+}
+
+// 把对齐缓冲区中的输出按validShape反量化为连续的fp32，dims为有效形状；不支持的类型返回false
+bool dequantize_output(const hbDNNTensor &tensor, std::vector<float> &dst, std::vector<size_t> &dims)
+{
+    const hbDNNTensorProperties &prop = tensor.properties;
+    dims.assign(prop.validShape.dimensionSize, prop.validShape.dimensionSize + prop.validShape.numDimensions);
+    if (dims.empty())
+    {
+        return false;
+    }
+    size_t count = 1;
+    for (size_t dim : dims)
+    {
+        count *= dim;
+    }
+    dst.resize(count);
+    size_t rowLength = dims.back();
+    size_t rows = rowLength > 0 ? count / rowLength : 0;
+    const void *src = tensor.sysMem[0].virAddr;
+    switch (prop.tensorType)
+    {
+    case hbDNNDataType::HB_DNN_TENSOR_TYPE_S8:
+        dequantize_rows((const int8_t *)src, prop, rows, rowLength, dst.data());
+        return true;
+    case hbDNNDataType::HB_DNN_TENSOR_TYPE_U8:
+        dequantize_rows((const uint8_t *)src, prop, rows, rowLength, dst.data());
+        return true;
+    case hbDNNDataType::HB_DNN_TENSOR_TYPE_S16:
+        dequantize_rows((const int16_t *)src, prop, rows, rowLength, dst.data());
+        return true;
+    case hbDNNDataType::HB_DNN_TENSOR_TYPE_S32:
+        dequantize_rows((const int32_t *)src, prop, rows, rowLength, dst.data());
+        return true;
+    case hbDNNDataType::HB_DNN_TENSOR_TYPE_F32:
+        // fp32输出不需要反量化，只去掉对齐填充
+        for (size_t row = 0; row < rows; row++)
+        {
+            int channel;
+            memcpy(dst.data() + row * rowLength, (const float *)src + aligned_row_offset(prop, row, channel), rowLength * sizeof(float));
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+#endif
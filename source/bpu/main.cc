@@ -1,7 +1,17 @@
 #include "function.h"
-#include "Timer.h"
+#include "Timer.hpp"
 #include "Helper.h"
+#include "ModelDiscovery.hpp"
+#include "DynamicBatcher.hpp"
+#include "Colocation.hpp"
+#include "Placement.hpp"
+#include "Trace.hpp"
+#include "BenchmarkSummary.hpp"
+#include "PowerSampler.hpp"
 #include "tabulate.hpp"
+#include "nlohmann/json.hpp"
+#include <fstream>
+#include <vector>
 
 #define CHECK_STATUS(ret)                                                                                         \
     if ((ret) != HB_SYS_SUCCESS)                                                                                  \
@@ -25,7 +35,92 @@ DEFINE_bool(enable_profiling, false, "Flag to enable profiling of individual ope
 // 批量基准测试
 DEFINE_bool(enable_batch_benchmark, false, "Flag to enable batch benchmark performance.");
 
-int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results);
+// 模型目录扫描的manifest缓存文件，目录没有变化时不再重新列出，为空时不缓存
+DEFINE_string(manifest_cache, "", "The manifest cache of the model directory scan, unchanged directories are not listed again. Empty to disable.");
+
+// 端到端测试: 相机帧的前处理(裁剪、缩放、颜色转换并写入对齐的输入缓冲区) + 推理
+DEFINE_bool(enable_preprocess_benchmark, false, "Flag to benchmark image pre-processing plus inference end to end.");
+
+// 相机帧的原始文件路径，为空时生成一帧渐变图像
+DEFINE_string(image_file, "", "The raw camera frame file, a synthetic frame is used when empty.");
+
+// 相机帧的格式: nv12, rgb, bgr
+DEFINE_string(image_format, "nv12", "The camera frame format: nv12, rgb or bgr.");
+
+// 相机帧的分辨率
+DEFINE_int32(image_width, 1920, "The camera frame width.");
+DEFINE_int32(image_height, 1080, "The camera frame height.");
+
+// 裁剪区域x,y,width,height，为空时使用整帧
+DEFINE_string(image_crop, "", "The crop rectangle x,y,width,height applied before resizing.");
+
+// 后处理阶段: none, classify(softmax + top-k), detect(YOLOv8风格[4 + classes, boxes]输出的解码 + NMS)
+DEFINE_string(postprocess, "none", "The post-processing phase timed after inference: none, classify or detect.");
+
+// 分类后处理的top-k
+DEFINE_int32(postprocess_topk, 5, "The k of the classify post-processing.");
+
+// 检测后处理参数，score_sigmoid表示类别分数是logit
+DEFINE_double(score_threshold, 0.25, "The detection score threshold.");
+DEFINE_double(iou_threshold, 0.45, "The NMS IoU threshold.");
+DEFINE_int32(max_detections, 100, "The maximum number of detections kept by NMS.");
+DEFINE_bool(score_sigmoid, false, "Flag to apply sigmoid to the detection class scores.");
+
+// 输入数据: random[:low,high], constant:value 或 replay:目录/逗号分隔的.npy/.raw文件，回放文件按alignedByteSize存放
+DEFINE_string(input_data, "random", "The input data: random[:low,high], constant:value or replay:path.");
+
+// 随机输入的种子
+DEFINE_int32(input_seed, 0, "The seed of the random input data.");
+
+// 动态批处理: 模型的batch维大于1时，按逗号分隔的max_delay_us逐个测量开环负载下的延迟/吞吐，为空时不测
+DEFINE_string(batch_delays, "", "Comma separated max queue delays in us for the dynamic batching curve, empty to disable.");
+DEFINE_double(batch_request_rate, 100, "The Poisson arrival rate of the batching load in requests per second.");
+DEFINE_int32(batch_requests, 500, "The number of requests per batching curve point.");
+
+// 多模型共置场景文件(json)，设置后忽略--model，场景中的priority映射为BPU任务优先级，core映射为bpuCoreId
+DEFINE_string(scenario, "", "The json scenario file of co-located models, overrides --model.");
+
+// 放置扫描: 每个模型分别绑定BPU0/BPU1/任意核心以及两个核心数据并行运行，结果和推荐的配置写在PlacementResult中
+DEFINE_bool(enable_placement_sweep, false, "Flag to run each model under every BPU core assignment.");
+
+// 定义输出文件路径
+DEFINE_string(output_file, "output/hbpu_profile_result.json", "The file path to the output json file.");
+
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+
+// 功耗采样节点(例如INA226的hwmon power1_input)，为空时不采样；scale把读数换算为W，采样得到的平均功率和每次推理的能耗写在Summary中
+DEFINE_string(power_node, "", "The sysfs power node sampled during the timed rounds, empty to disable.");
+DEFINE_double(power_scale, 1e-6, "The scale converting the power node reading to watts, 1e-6 for microwatts.");
+DEFINE_int32(power_interval_ms, 10, "The sampling interval of the power node in milliseconds.");
+
+int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result);
+
+int scenario_benchmark(const std::string &path, nlohmann::json &all_models_result);
+
+int placement_sweep(const char *model, nlohmann::json &result);
+
+CameraFrame camera_frame;
+
+bool parse_image_crop(const std::string &text, ImageRect &crop)
+{
+    if (text.empty())
+    {
+        return true;
+    }
+    if (sscanf(text.c_str(), "%d,%d,%d,%d", &crop.x, &crop.y, &crop.width, &crop.height) != 4)
+    {
+        return false;
+    }
+    // NV12的色度按2x2采样，裁剪区域取偶数
+    crop.x &= ~1;
+    crop.y &= ~1;
+    crop.width &= ~1;
+    crop.height &= ~1;
+    return crop.x >= 0 && crop.y >= 0 && crop.width > 0 && crop.height > 0 &&
+           crop.x + crop.width <= camera_frame.width && crop.y + crop.height <= camera_frame.height;
+}
+
 int main(int argc, char **argv)
 {
     gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
@@ -35,6 +130,7 @@ int main(int argc, char **argv)
     FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
     FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
     FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+    TRACE_THREAD_NAME("main");
 
     char const *hbdnn_version = hbDNNGetVersion();
     LOG(INFO) << "HB DNN Version: " << hbdnn_version;
@@ -45,21 +141,64 @@ int main(int argc, char **argv)
     bool enable_profiling = FLAGS_enable_profiling;
     bool enable_batch_benchmark = FLAGS_enable_batch_benchmark;
     std::vector<std::tuple<std::string, LatencyPerfData>> batch_perf_results;
-    if (enable_batch_benchmark == false)
+    nlohmann::json all_models_result;
+    PostprocessMode postprocess_mode;
+    if (!parse_postprocess_mode(FLAGS_postprocess, postprocess_mode))
+    {
+        LOG(ERROR) << "Unsupported post-processing mode: " << FLAGS_postprocess;
+        return -1;
+    }
+    InputSpec input_spec;
+    if (!parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec))
+    {
+        LOG(ERROR) << "Unsupported input data: " << FLAGS_input_data;
+        return -1;
+    }
+    if (FLAGS_enable_preprocess_benchmark)
+    {
+        camera_frame.format = FLAGS_image_format;
+        camera_frame.width = FLAGS_image_width;
+        camera_frame.height = FLAGS_image_height;
+        if (!load_camera_frame(FLAGS_image_file, camera_frame) || !parse_image_crop(FLAGS_image_crop, camera_frame.crop))
+        {
+            LOG(ERROR) << "Invalid camera frame, format = " << FLAGS_image_format << ", crop = " << FLAGS_image_crop;
+            return -1;
+        }
+        LOG(INFO) << "Camera frame: " << camera_frame.format << " " << camera_frame.width << "x" << camera_frame.height
+                  << ", pre-processing kernels dispatched to: " << preprocess_isa();
+    }
+    if (!FLAGS_scenario.empty())
+    {
+        if (scenario_benchmark(FLAGS_scenario, all_models_result) < 0)
+        {
+            return -1;
+        }
+    }
+    else if (enable_batch_benchmark == false)
     {
 
-        batch_benchmark(model.c_str(), num_warmup, num_run, enable_profiling, batch_perf_results);
+        batch_benchmark(model.c_str(), num_warmup, num_run, enable_profiling, batch_perf_results, all_models_result);
     }
     else
     {
-        std::vector<std::filesystem::path> files = glob_files(model, ".bin");
-        for (auto path : files)
+        DiscoveryOptions discovery;
+        discovery.patterns = {".bin"};
+        // 跳过目录中OpenVINO模型的权重文件
+        discovery.siblings = {{".xml", ".bin"}};
+        discovery.cacheFile = FLAGS_manifest_cache;
+        for (const auto &path : discovered_paths(discover_models(model, discovery)))
         {
             LOG(INFO) << "Find model: " << path;
-            batch_benchmark(path.c_str(), num_warmup, num_run, enable_profiling, batch_perf_results);
+            batch_benchmark(path.c_str(), num_warmup, num_run, enable_profiling, batch_perf_results, all_models_result);
         }
     }
 
+    // 创建输出目录（如果不存在）并保存结果
+    std::filesystem::path output_path(FLAGS_output_file);
+    std::filesystem::create_directories(output_path.parent_path());
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << all_models_result << std::endl;
+
     tabulate::Table profileTable;
     profileTable.add_row({"index", "model", "avg", "std", "min", "max"});
     int iteration = 0;
@@ -81,18 +220,29 @@ int main(int argc, char **argv)
     }
     LOG(INFO) << "\n"
               << profileTable << "\n";
+    // 在进程退出前把缓冲池中的BPU内存还给运行时
+    bpu_memory_pool().trim();
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
+    }
     google::ShutdownGoogleLogging();
     return 0;
 }
 
-int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results)
+int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result)
 {
     const char **modelFileNames = new const char *[1];
     hbPackedDNNHandle_t packedDNNHandle;
     hbDNNHandle_t dnnHandle;
 
     modelFileNames[0] = model;
+    auto init_start = std::chrono::steady_clock::now();
+    TRACE_BEGIN("hbDNNInitializeFromFiles");
     CHECK_STATUS(hbDNNInitializeFromFiles(&packedDNNHandle, modelFileNames, 1));
+    TRACE_END("hbDNNInitializeFromFiles");
+    // 打包文件中的所有模型一起加载，每个模型都记录整个文件的加载时间
+    double init_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
     char const **modelNameList = nullptr;
     int32_t modelNameCount;
     CHECK_STATUS(hbDNNGetModelNameList(&modelNameList,
@@ -113,7 +263,9 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
         CHECK_STATUS(hbDNNGetOutputCount(&outputCount, dnnHandle));
 
         hbDNNTensorProperties *inputProperties = new hbDNNTensorProperties[inputCount];
-        hbDNNTensor *inputTensor = new hbDNNTensor[inputCount];
+        hbDNNTensor *inputTensor = new hbDNNTensor[inputCount]();
+        // 每个输入的sysMem[0]和sysMem[1]在缓冲池中的key
+        std::vector<PoolKey> inputKeys(inputCount * 2);
         for (int index = 0; index < inputCount; index++)
         {
             CHECK_STATUS(hbDNNGetInputTensorProperties(&inputProperties[index], dnnHandle, index));
@@ -124,17 +276,55 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
 
             inputTensor[index].properties = inputProperties[index];
             uint32_t size = inputTensor[index].properties.alignedByteSize;
-            CHECK_STATUS(hbSysAllocMem(&inputTensor[index].sysMem[0], size));
+            CHECK(bpu_memory_pool().acquire(size, 0, MemoryKind::Device, inputTensor[index].sysMem[0], inputKeys[index * 2]));
+            // NV12_SEPARATE的UV平面单独存放在sysMem[1]
+            if (inputProperties[index].tensorType == hbDNNDataType::HB_DNN_IMG_TYPE_NV12_SEPARATE)
+            {
+                ImageInputLayout layout;
+                if (get_image_input_layout(inputProperties[index], layout))
+                {
+                    CHECK(bpu_memory_pool().acquire(layout.alignedWidth * layout.alignedHeight / 2, 0, MemoryKind::Device, inputTensor[index].sysMem[1], inputKeys[index * 2 + 1]));
+                    // UV平面填中性色度
+                    memset(inputTensor[index].sysMem[1].virAddr, 128, inputTensor[index].sysMem[1].memSize);
+                    hbSysFlushMem(&inputTensor[index].sysMem[1], HB_SYS_MEM_CACHE_CLEAN);
+                }
+            }
         }
+        // 输入数据由InputProvider提供，样本一次性准备好，每轮只拷贝到BPU内存
+        InputSpec inputSpec;
+        parse_input_spec(FLAGS_input_data, FLAGS_input_seed, inputSpec);
+        InputProvider inputProvider(inputSpec);
+        std::vector<InputTensorInfo> inputInfos;
+        for (int index = 0; index < inputCount; index++)
+        {
+            const char *inputName;
+            CHECK_STATUS(hbDNNGetInputName(&inputName, dnnHandle, index));
+            inputInfos.push_back({inputName, to_input_dtype(inputProperties[index].tensorType), (size_t)inputProperties[index].alignedByteSize});
+        }
+        if (!inputProvider.prepare(inputInfos))
+        {
+            LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+            exit(-1);
+        }
+        auto fill_inputs = [&]()
+        {
+            for (int index = 0; index < inputCount; index++)
+            {
+                inputProvider.copy_to(index, inputTensor[index].sysMem[0].virAddr);
+                hbSysFlushMem(&inputTensor[index].sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
+            }
+        };
+        fill_inputs();
         hbDNNTensorProperties *outputProperties = new hbDNNTensorProperties[outputCount];
         hbDNNTensor *outputTensor = new hbDNNTensor[outputCount];
+        std::vector<PoolKey> outputKeys(outputCount);
         for (int index = 0; index < outputCount; index++)
         {
             CHECK_STATUS(hbDNNGetOutputTensorProperties(&outputProperties[index], dnnHandle, index));
 
             outputTensor[index].properties = outputProperties[index];
             uint32_t size = outputTensor[index].properties.alignedByteSize;
-            CHECK_STATUS(hbSysAllocMem(&outputTensor[index].sysMem[0], size))
+            CHECK(bpu_memory_pool().acquire(size, 0, MemoryKind::Device, outputTensor[index].sysMem[0], outputKeys[index]));
         }
 
         auto benchmark_function = [](hbDNNHandle_t dnnHandle, hbDNNTensor *inputTensor, hbDNNTensor *outputTensor)
@@ -169,17 +359,336 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
             }
         };
         Timer timer(num_warmup, num_run, benchmark_function, dnnHandle, inputTensor, outputTensor);
+        timer.set_trace_name("hbDNNInfer");
+        // 回放多份样本时，每轮计时前把下一份样本拷入输入缓冲区
+        if (inputProvider.samples() > 1)
+        {
+            timer.set_setup([&]()
+                            {
+                                inputProvider.next();
+                                fill_inputs(); });
+        }
+        PowerSampler power_sampler(FLAGS_power_node, FLAGS_power_scale, FLAGS_power_interval_ms);
+        power_sampler.start();
         timer.run();
+        double power = power_sampler.stop();
         auto data = timer.report();
         batch_perf_results.push_back(std::make_tuple(model, std::get<1>(data)));
+
+        // 单独统计host侧I/O阶段：输入从host缓冲区拷入BPU内存并刷cache，输出失效cache后拷回host
+        // host侧的输出缓冲区同样来自缓冲池
+        std::vector<HostTensor> hostOutputs(outputCount);
+        uint64_t inputBytes = 0;
+        uint64_t outputBytes = 0;
+        nlohmann::json result;
+        for (int index = 0; index < inputCount; index++)
+        {
+            inputBytes += inputProperties[index].alignedByteSize;
+            const char *inputName;
+            CHECK_STATUS(hbDNNGetInputName(&inputName, dnnHandle, index));
+            result["IOResult"]["Inputs"].push_back({{"Name", inputName},
+                                                    {"Type", string_tensortype(inputProperties[index].tensorType)},
+                                                    {"ByteSize", inputProperties[index].alignedByteSize}});
+        }
+        for (int index = 0; index < outputCount; index++)
+        {
+            hostOutputs[index] = HostTensor(outputProperties[index].alignedByteSize);
+            outputBytes += outputProperties[index].alignedByteSize;
+            const char *outputName;
+            CHECK_STATUS(hbDNNGetOutputName(&outputName, dnnHandle, index));
+            result["IOResult"]["Outputs"].push_back({{"Name", outputName},
+                                                     {"Type", string_tensortype(outputProperties[index].tensorType)},
+                                                     {"ByteSize", outputProperties[index].alignedByteSize}});
+        }
+        auto input_function = [](int32_t inputCount, hbDNNTensor *inputTensor, InputProvider *inputProvider)
+        {
+            for (int index = 0; index < inputCount; index++)
+            {
+                inputProvider->copy_to(index, inputTensor[index].sysMem[0].virAddr);
+                hbSysFlushMem(&inputTensor[index].sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
+            }
+        };
+        auto output_function = [](int32_t outputCount, hbDNNTensor *outputTensor, std::vector<HostTensor> *hostOutputs)
+        {
+            for (int index = 0; index < outputCount; index++)
+            {
+                hbSysFlushMem(&outputTensor[index].sysMem[0], HB_SYS_MEM_CACHE_INVALIDATE);
+                memcpy((*hostOutputs)[index].data(), outputTensor[index].sysMem[0].virAddr, (*hostOutputs)[index].size());
+            }
+        };
+        Timer input_timer(0, num_run, input_function, inputCount, inputTensor, &inputProvider);
+        input_timer.set_trace_name("input flush");
+        input_timer.set_setup([&]()
+                              { inputProvider.next(); });
+        input_timer.run();
+        auto input_data = input_timer.report_statistics(input_timer.durations_normal_);
+        Timer output_timer(0, num_run, output_function, outputCount, outputTensor, &hostOutputs);
+        output_timer.set_trace_name("output invalidate");
+        output_timer.run();
+        auto output_data = output_timer.report_statistics(output_timer.durations_normal_);
+
+        // 端到端: 每轮先把相机帧前处理到对齐的输入缓冲区，再推理；非图像输入保持原样
+        if (FLAGS_enable_preprocess_benchmark)
+        {
+            std::vector<ImageInputLayout> layouts(inputCount);
+            std::vector<bool> imageInputs(inputCount);
+            std::vector<std::vector<uint8_t>> scratches(inputCount);
+            nlohmann::json preprocess_result;
+            for (int index = 0; index < inputCount; index++)
+            {
+                imageInputs[index] = get_image_input_layout(inputProperties[index], layouts[index]);
+                if (!imageInputs[index])
+                {
+                    LOG(WARNING) << "Input " << index << " (" << string_tensortype(inputProperties[index].tensorType) << ") is not pre-processed.";
+                    continue;
+                }
+                preprocess_result["Inputs"].push_back({{"Index", index},
+                                                       {"Type", string_tensortype(layouts[index].type)},
+                                                       {"Width", layouts[index].width},
+                                                       {"Height", layouts[index].height},
+                                                       {"AlignedWidth", layouts[index].alignedWidth},
+                                                       {"AlignedHeight", layouts[index].alignedHeight},
+                                                       {"Planar", layouts[index].planar}});
+            }
+            auto preprocess_function = [&]()
+            {
+                for (int index = 0; index < inputCount; index++)
+                {
+                    if (imageInputs[index])
+                    {
+                        preprocess_image_input(camera_frame, layouts[index], inputTensor[index], scratches[index]);
+                    }
+                }
+            };
+            auto end_to_end_function = [&]()
+            {
+                preprocess_function();
+                benchmark_function(dnnHandle, inputTensor, outputTensor);
+            };
+            Timer preprocess_timer(num_warmup, num_run, preprocess_function);
+            preprocess_timer.set_trace_name("preprocess");
+            preprocess_timer.run();
+            auto preprocess_data = preprocess_timer.report_statistics(preprocess_timer.durations_normal_);
+            Timer end_to_end_timer(num_warmup, num_run, end_to_end_function);
+            end_to_end_timer.set_trace_name("end to end");
+            end_to_end_timer.run();
+            auto end_to_end_data = end_to_end_timer.report_statistics(end_to_end_timer.durations_normal_);
+
+            preprocess_result["Isa"] = preprocess_isa();
+            preprocess_result["SourceFormat"] = camera_frame.format;
+            preprocess_result["SourceWidth"] = camera_frame.width;
+            preprocess_result["SourceHeight"] = camera_frame.height;
+            preprocess_result["Crop"] = FLAGS_image_crop;
+            preprocess_result["AvgPreprocessLatency"] = preprocess_data.mean;
+            preprocess_result["MinPreprocessLatency"] = preprocess_data.min;
+            preprocess_result["AvgEndToEndLatency"] = end_to_end_data.mean;
+            preprocess_result["StdEndToEndLatency"] = end_to_end_data.stdev;
+            preprocess_result["MinEndToEndLatency"] = end_to_end_data.min;
+            preprocess_result["MaxEndToEndLatency"] = end_to_end_data.max;
+            result["PreprocessResult"] = preprocess_result;
+            LOG(INFO) << "Pre-processing avg " << preprocess_data.mean << " us, pre-processing + inference avg " << end_to_end_data.mean << " us";
+        }
+
+        // 可选的后处理阶段: 失效输出cache后反量化为fp32，再做分类或检测后处理，得到应用实际看到的输出延迟
+        PostprocessMode postprocess_mode = PostprocessMode::None;
+        parse_postprocess_mode(FLAGS_postprocess, postprocess_mode);
+        if (postprocess_mode != PostprocessMode::None)
+        {
+            std::vector<std::vector<float>> float_outputs(outputCount);
+            std::vector<std::vector<size_t>> output_dims(outputCount);
+            DetectParams params;
+            params.scoreThreshold = (float)FLAGS_score_threshold;
+            params.iouThreshold = (float)FLAGS_iou_threshold;
+            params.maxDetections = FLAGS_max_detections;
+            params.sigmoid = FLAGS_score_sigmoid;
+            PostprocessResult post_result;
+            bool supported = true;
+            auto postprocess_function = [&]()
+            {
+                for (int index = 0; index < outputCount; index++)
+                {
+                    hbSysFlushMem(&outputTensor[index].sysMem[0], HB_SYS_MEM_CACHE_INVALIDATE);
+                    supported = dequantize_output(outputTensor[index], float_outputs[index], output_dims[index]) && supported;
+                }
+                supported = run_postprocess(postprocess_mode, float_outputs[0].data(), output_dims[0], FLAGS_postprocess_topk, params, post_result) && supported;
+            };
+            auto end_to_end_function = [&]()
+            {
+                benchmark_function(dnnHandle, inputTensor, outputTensor);
+                postprocess_function();
+            };
+            Timer postprocess_timer(num_warmup, num_run, postprocess_function);
+            postprocess_timer.set_trace_name("postprocess");
+            postprocess_timer.run();
+            auto postprocess_data = postprocess_timer.report_statistics(postprocess_timer.durations_normal_);
+            Timer end_to_end_timer(num_warmup, num_run, end_to_end_function);
+            end_to_end_timer.set_trace_name("end to end");
+            end_to_end_timer.run();
+            auto end_to_end_data = end_to_end_timer.report_statistics(end_to_end_timer.durations_normal_);
+            if (!supported)
+            {
+                LOG(WARNING) << "Outputs do not fit the " << FLAGS_postprocess << " post-processing, only part of it was timed.";
+            }
+
+            nlohmann::json post_json;
+            post_json["Mode"] = FLAGS_postprocess;
+            post_json["Supported"] = supported;
+            post_json["AvgPostprocessLatency"] = postprocess_data.mean;
+            post_json["MinPostprocessLatency"] = postprocess_data.min;
+            post_json["AvgEndToEndLatency"] = end_to_end_data.mean;
+            post_json["StdEndToEndLatency"] = end_to_end_data.stdev;
+            post_json["MinEndToEndLatency"] = end_to_end_data.min;
+            post_json["MaxEndToEndLatency"] = end_to_end_data.max;
+            for (const auto &item : post_result.topk)
+            {
+                post_json["TopK"].push_back({{"Index", item.index}, {"Score", item.score}});
+            }
+            if (postprocess_mode == PostprocessMode::Detect)
+            {
+                post_json["Candidates"] = post_result.candidates.size();
+                post_json["Detections"] = post_result.detections.size();
+            }
+            result["PostprocessResult"] = post_json;
+            LOG(INFO) << "Post-processing avg " << postprocess_data.mean << " us, inference + post-processing avg " << end_to_end_data.mean << " us";
+        }
+
+        std::string model_name = modelNameList[i];
+        // 动态批处理曲线: 批次按alignedShape的batch维切分；每个批次组绑定一组BPU张量，请求直接写入BPU内存，
+        // 推理前只刷cache，推理后失效cache，输出由批处理器按batch维从BPU内存拆回各请求
+        int modelBatch = inputProperties[0].validShape.numDimensions > 0 ? inputProperties[0].validShape.dimensionSize[0] : 1;
+        std::vector<double> batchDelays;
+        if (!FLAGS_batch_delays.empty() && modelBatch > 1 && parse_delay_list(FLAGS_batch_delays, batchDelays))
+        {
+            BatcherConfig batchConfig;
+            batchConfig.maxBatch = modelBatch;
+            std::vector<const void *> samples;
+            for (int index = 0; index < inputCount; index++)
+            {
+                batchConfig.inputSampleBytes.push_back(inputProperties[index].alignedByteSize / modelBatch);
+                samples.push_back(inputProvider.data(index));
+            }
+            for (int index = 0; index < outputCount; index++)
+            {
+                batchConfig.outputSampleBytes.push_back(outputProperties[index].alignedByteSize / modelBatch);
+            }
+            // 每个批次组一组输入输出张量，sysMem[0]来自缓冲池，NV12_SEPARATE的UV平面与计时用的输入张量共用
+            int groupCount = batchConfig.inflightBatches + 1;
+            std::vector<std::vector<hbDNNTensor>> groupInputs(groupCount, std::vector<hbDNNTensor>(inputTensor, inputTensor + inputCount));
+            std::vector<std::vector<hbDNNTensor>> groupOutputs(groupCount, std::vector<hbDNNTensor>(outputTensor, outputTensor + outputCount));
+            std::vector<PoolKey> groupInputKeys(groupCount * inputCount);
+            std::vector<PoolKey> groupOutputKeys(groupCount * outputCount);
+            for (int group = 0; group < groupCount; group++)
+            {
+                batchConfig.inputBuffers.emplace_back();
+                batchConfig.outputBuffers.emplace_back();
+                for (int index = 0; index < inputCount; index++)
+                {
+                    CHECK(bpu_memory_pool().acquire(inputProperties[index].alignedByteSize, 0, MemoryKind::Device, groupInputs[group][index].sysMem[0], groupInputKeys[group * inputCount + index]));
+                    batchConfig.inputBuffers.back().push_back((uint8_t *)groupInputs[group][index].sysMem[0].virAddr);
+                }
+                for (int index = 0; index < outputCount; index++)
+                {
+                    CHECK(bpu_memory_pool().acquire(outputProperties[index].alignedByteSize, 0, MemoryKind::Device, groupOutputs[group][index].sysMem[0], groupOutputKeys[group * outputCount + index]));
+                    batchConfig.outputBuffers.back().push_back((uint8_t *)groupOutputs[group][index].sysMem[0].virAddr);
+                }
+            }
+            BatchRunner runner = [&](const std::vector<uint8_t *> &inputs, int, const std::vector<uint8_t *> &)
+            {
+                int group = 0;
+                while (batchConfig.inputBuffers[group][0] != inputs[0])
+                {
+                    group++;
+                }
+                for (int index = 0; index < inputCount; index++)
+                {
+                    hbSysFlushMem(&groupInputs[group][index].sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
+                }
+                benchmark_function(dnnHandle, groupInputs[group].data(), groupOutputs[group].data());
+                for (int index = 0; index < outputCount; index++)
+                {
+                    hbSysFlushMem(&groupOutputs[group][index].sysMem[0], HB_SYS_MEM_CACHE_INVALIDATE);
+                }
+            };
+            LoadConfig load;
+            load.requestRate = FLAGS_batch_request_rate;
+            load.numRequests = FLAGS_batch_requests;
+            std::vector<BatchingPoint> curve;
+            for (double delay : batchDelays)
+            {
+                batchConfig.maxDelayUs = delay;
+                curve.push_back(run_batching_load(batchConfig, runner, load, samples));
+                result["BatchingResult"]["Curve"].push_back(batching_point_json(curve.back()));
+            }
+            result["BatchingResult"]["RequestRate"] = FLAGS_batch_request_rate;
+            log_batching_curve(curve);
+            for (int group = 0; group < groupCount; group++)
+            {
+                for (int index = 0; index < inputCount; index++)
+                {
+                    bpu_memory_pool().release(groupInputKeys[group * inputCount + index], groupInputs[group][index].sysMem[0]);
+                }
+                for (int index = 0; index < outputCount; index++)
+                {
+                    bpu_memory_pool().release(groupOutputKeys[group * outputCount + index], groupOutputs[group][index].sysMem[0]);
+                }
+            }
+        }
+
+        result["IOResult"]["InputBytes"] = inputBytes;
+        result["InputData"] = inputProvider.describe();
+        result["IOResult"]["OutputBytes"] = outputBytes;
+        result["IOResult"]["AvgInputLatency"] = input_data.mean;
+        result["IOResult"]["AvgOutputLatency"] = output_data.mean;
+        result["IOResult"]["MinInputLatency"] = input_data.min;
+        result["IOResult"]["MinOutputLatency"] = output_data.min;
+        result["MetaInfo"]["BackendName"] = "BPU";
+        result["MetaInfo"]["BackendVersion"] = hbDNNGetVersion();
+        result["MetaInfo"]["ModelName"] = model_name;
+        result["MetaInfo"]["ModelPath"] = model;
+        result["MetaInfo"]["ModelHash"] = model_hash_string(model_file_hash(model));
+        result["RuntimeResult"]["Warmups"] = num_warmup;
+        result["RuntimeResult"]["Rounds"] = num_run;
+        // 计时器自身每轮的开销(空函数体)，需要时可以从各轮延迟中减去
+        result["RuntimeResult"]["TimerOverhead"] = calibrate_timer().mean;
+        result["RuntimeResult"]["AvgTotalRoundLatency"] = std::get<1>(data).mean;
+        result["RuntimeResult"]["StdTotalRoundLatency"] = std::get<1>(data).stdev;
+        result["RuntimeResult"]["MinTotalRoundLatency"] = std::get<1>(data).min;
+        result["RuntimeResult"]["MaxTotalRoundLatency"] = std::get<1>(data).max;
+        result["RuntimeResult"]["InitTime"] = init_time;
+        // 缓冲区归还缓冲池，留给下一个模型使用
         for (int index = 0; index < inputCount; index++)
         {
-            CHECK_STATUS(hbSysFreeMem(inputTensor[index].sysMem));
+            bpu_memory_pool().release(inputKeys[index * 2], inputTensor[index].sysMem[0]);
+            if (inputProperties[index].tensorType == hbDNNDataType::HB_DNN_IMG_TYPE_NV12_SEPARATE && inputTensor[index].sysMem[1].virAddr)
+            {
+                bpu_memory_pool().release(inputKeys[index * 2 + 1], inputTensor[index].sysMem[1]);
+            }
         }
         for (int index = 0; index < outputCount; index++)
         {
-            CHECK_STATUS(hbSysFreeMem(outputTensor[index].sysMem));
+            bpu_memory_pool().release(outputKeys[index], outputTensor[index].sysMem[0]);
+        }
+        // 放置扫描重新加载模型文件，打包了多个模型时只扫描第一个
+        if (FLAGS_enable_placement_sweep && i == 0)
+        {
+            placement_sweep(model, result["PlacementResult"]);
+        }
+        result["TensorPool"] = {{"Device", bpu_memory_pool().report()}, {"Host", host_tensor_pool().report()}};
+        // 各后端共同格式的Summary，逻辑模型名为打包文件中的模型名
+        BenchmarkSummary summary = summarize_benchmark(model_name, "BPU", device_model_name("BPU"), timer.durations_normal_);
+        summary.modelFile = std::filesystem::path(model).filename().string();
+        summary.modelHash = result["MetaInfo"]["ModelHash"];
+        summary.backendVersion = hbDNNGetVersion();
+        summary.initTime = init_time;
+        if (result.contains("PlacementResult") && result["PlacementResult"].contains("RecommendedForThroughput"))
+        {
+            summary.maxThroughput = result["PlacementResult"]["RecommendedForThroughput"]["Throughput"];
         }
+        set_summary_power(summary, power);
+        result["Summary"] = benchmark_summary_json(summary);
+        nlohmann::json model_result;
+        model_result[model_name] = result;
+        all_models_result.push_back(model_result);
 
         delete[] inputProperties;
         delete[] outputProperties;
@@ -192,4 +701,230 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
 
     delete[] modelFileNames;
     return 0;
-}
\ No newline at end of file
+}
+
+// 共置场景和放置扫描中一个模型的上下文
+struct ScenarioSession
+{
+    hbPackedDNNHandle_t packedDNNHandle = nullptr;
+    hbDNNHandle_t dnnHandle = nullptr;
+    hbDNNInferCtrlParam inferCtrlParam;
+    std::vector<hbDNNTensor> inputTensor;
+    std::vector<hbDNNTensor> outputTensor;
+    std::vector<PoolKey> inputKeys;
+    std::vector<PoolKey> outputKeys;
+};
+
+// 场景中的core: -1为任意核心，0和1分别绑定BPU0和BPU1，其他核心返回-1
+int32_t scenario_bpu_core(int core)
+{
+    if (core < 0)
+    {
+        return HB_BPU_CORE_ANY;
+    }
+    if (core > 1)
+    {
+        return -1;
+    }
+    return core == 0 ? HB_BPU_CORE_0 : HB_BPU_CORE_1;
+}
+
+void open_scenario_session(const ScenarioModel &model, ScenarioSession &session)
+{
+    const char *modelFileNames[1] = {model.model.c_str()};
+    CHECK_STATUS(hbDNNInitializeFromFiles(&session.packedDNNHandle, modelFileNames, 1));
+    char const **modelNameList = nullptr;
+    int32_t modelNameCount;
+    CHECK_STATUS(hbDNNGetModelNameList(&modelNameList, &modelNameCount, session.packedDNNHandle));
+    // 打包了多个模型时只运行第一个
+    CHECK_STATUS(hbDNNGetModelHandle(&session.dnnHandle, session.packedDNNHandle, modelNameList[0]));
+    int32_t inputCount;
+    CHECK_STATUS(hbDNNGetInputCount(&inputCount, session.dnnHandle));
+    int32_t outputCount;
+    CHECK_STATUS(hbDNNGetOutputCount(&outputCount, session.dnnHandle));
+
+    session.inputTensor.resize(inputCount);
+    session.inputKeys.resize(inputCount * 2);
+    std::vector<InputTensorInfo> inputInfos;
+    for (int index = 0; index < inputCount; index++)
+    {
+        hbDNNTensor &tensor = session.inputTensor[index];
+        memset(&tensor, 0, sizeof(hbDNNTensor));
+        CHECK_STATUS(hbDNNGetInputTensorProperties(&tensor.properties, session.dnnHandle, index));
+        CHECK(bpu_memory_pool().acquire(tensor.properties.alignedByteSize, 0, MemoryKind::Device, tensor.sysMem[0], session.inputKeys[index * 2]));
+        ImageInputLayout layout;
+        if (tensor.properties.tensorType == hbDNNDataType::HB_DNN_IMG_TYPE_NV12_SEPARATE && get_image_input_layout(tensor.properties, layout))
+        {
+            CHECK(bpu_memory_pool().acquire(layout.alignedWidth * layout.alignedHeight / 2, 0, MemoryKind::Device, tensor.sysMem[1], session.inputKeys[index * 2 + 1]));
+            memset(tensor.sysMem[1].virAddr, 128, tensor.sysMem[1].memSize);
+            hbSysFlushMem(&tensor.sysMem[1], HB_SYS_MEM_CACHE_CLEAN);
+        }
+        const char *inputName;
+        CHECK_STATUS(hbDNNGetInputName(&inputName, session.dnnHandle, index));
+        inputInfos.push_back({inputName, to_input_dtype(tensor.properties.tensorType), (size_t)tensor.properties.alignedByteSize});
+    }
+    // 共置测试关注调度，每个模型只准备一份输入，拷入BPU内存后每次推理复用
+    InputSpec inputSpec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, inputSpec);
+    InputProvider inputProvider(inputSpec);
+    if (!inputProvider.prepare(inputInfos))
+    {
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        exit(-1);
+    }
+    for (int index = 0; index < inputCount; index++)
+    {
+        inputProvider.copy_to(index, session.inputTensor[index].sysMem[0].virAddr);
+        hbSysFlushMem(&session.inputTensor[index].sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
+    }
+
+    session.outputTensor.resize(outputCount);
+    session.outputKeys.resize(outputCount);
+    for (int index = 0; index < outputCount; index++)
+    {
+        hbDNNTensor &tensor = session.outputTensor[index];
+        memset(&tensor, 0, sizeof(hbDNNTensor));
+        CHECK_STATUS(hbDNNGetOutputTensorProperties(&tensor.properties, session.dnnHandle, index));
+        CHECK(bpu_memory_pool().acquire(tensor.properties.alignedByteSize, 0, MemoryKind::Device, tensor.sysMem[0], session.outputKeys[index]));
+    }
+
+    session.inferCtrlParam = {
+        .bpuCoreId = scenario_bpu_core(model.core),
+        .dspCoreId = 0,
+        .priority = model.priority,
+        .more = 0,
+        .customId = 0,
+        .reserved1 = 0,
+        .reserved2 = 0};
+    LOG(INFO) << "Scenario model " << model.name << ": " << model.model << ", priority " << model.priority << ", bpuCoreId " << session.inferCtrlParam.bpuCoreId;
+}
+
+void run_scenario_session(ScenarioSession &session)
+{
+    hbDNNTaskHandle_t taskHandle = nullptr;
+    hbDNNTensor *outputTensor = session.outputTensor.data();
+    TRACE_BEGIN("hbDNNInfer");
+    int ret = hbDNNInfer(&taskHandle, &outputTensor, session.inputTensor.data(), session.dnnHandle, &session.inferCtrlParam);
+    if (ret != HB_SYS_SUCCESS)
+    {
+        LOG(ERROR) << "Failed to run inference. Return code: " << ret;
+        exit(1);
+    }
+    hbDNNWaitTaskDone(taskHandle, 0);
+    hbDNNReleaseTask(taskHandle);
+    TRACE_END("hbDNNInfer");
+    TRACE_BEGIN("output invalidate");
+    for (auto &tensor : session.outputTensor)
+    {
+        hbSysFlushMem(&tensor.sysMem[0], HB_SYS_MEM_CACHE_INVALIDATE);
+    }
+    TRACE_END("output invalidate");
+}
+
+void close_scenario_session(ScenarioSession &session)
+{
+    for (size_t index = 0; index < session.inputTensor.size(); index++)
+    {
+        bpu_memory_pool().release(session.inputKeys[index * 2], session.inputTensor[index].sysMem[0]);
+        if (session.inputTensor[index].sysMem[1].virAddr)
+        {
+            bpu_memory_pool().release(session.inputKeys[index * 2 + 1], session.inputTensor[index].sysMem[1]);
+        }
+    }
+    for (size_t index = 0; index < session.outputTensor.size(); index++)
+    {
+        bpu_memory_pool().release(session.outputKeys[index], session.outputTensor[index].sysMem[0]);
+    }
+    session.inputTensor.clear();
+    session.outputTensor.clear();
+    if (session.packedDNNHandle)
+    {
+        CHECK_STATUS(hbDNNRelease(session.packedDNNHandle));
+        session.packedDNNHandle = nullptr;
+    }
+}
+
+int scenario_benchmark(const std::string &path, nlohmann::json &all_models_result)
+{
+    Scenario scenario;
+    if (!load_scenario(path, scenario))
+    {
+        return -1;
+    }
+    // BPU按任务优先级调度，高优先级的任务先于排队中的低优先级任务运行
+    for (const auto &model : scenario.models)
+    {
+        if (scenario_bpu_core(model.core) < 0)
+        {
+            LOG(ERROR) << "Scenario model " << model.name << " asks for BPU core " << model.core << ", BPU has cores 0 and 1";
+            return -1;
+        }
+    }
+    std::vector<ScenarioSession> sessions(scenario.models.size());
+    std::vector<std::function<void()>> infers;
+    for (size_t i = 0; i < scenario.models.size(); i++)
+    {
+        open_scenario_session(scenario.models[i], sessions[i]);
+        ScenarioSession *session = &sessions[i];
+        infers.push_back([session]()
+                         { run_scenario_session(*session); });
+    }
+
+    nlohmann::json result;
+    result["ColocationResult"] = run_colocation(scenario, infers);
+    for (size_t i = 0; i < scenario.models.size(); i++)
+    {
+        result["ColocationResult"]["Models"][i]["BpuCoreId"] = sessions[i].inferCtrlParam.bpuCoreId;
+    }
+    result["MetaInfo"]["BackendName"] = "BPU";
+    result["MetaInfo"]["BackendVersion"] = hbDNNGetVersion();
+    result["MetaInfo"]["Scenario"] = path;
+
+    for (auto &session : sessions)
+    {
+        close_scenario_session(session);
+    }
+    result["TensorPool"] = {{"Device", bpu_memory_pool().report()}, {"Host", host_tensor_pool().report()}};
+    all_models_result.push_back(result);
+    return 0;
+}
+
+// 放置方式: 绑定BPU0、绑定BPU1、任意核心，以及两个上下文同时运行(各绑定一个核心的数据并行、都不绑定)
+std::vector<PlacementConfig> bpu_placements()
+{
+    return {
+        {"core0", 1, {{"BpuCoreIds", {HB_BPU_CORE_0}}}},
+        {"core1", 1, {{"BpuCoreIds", {HB_BPU_CORE_1}}}},
+        {"any", 1, {{"BpuCoreIds", {HB_BPU_CORE_ANY}}}},
+        {"dp2", 2, {{"BpuCoreIds", {HB_BPU_CORE_0, HB_BPU_CORE_1}}}},
+        {"any2", 2, {{"BpuCoreIds", {HB_BPU_CORE_ANY, HB_BPU_CORE_ANY}}}},
+    };
+}
+
+int placement_sweep(const char *model, nlohmann::json &result)
+{
+    ScenarioModel placementModel;
+    placementModel.name = std::filesystem::path(model).filename().string();
+    placementModel.model = model;
+    // 与单模型测试使用相同的任务优先级
+    placementModel.priority = 90;
+    PlacementSetup setup = [&](const PlacementConfig &config, std::vector<std::function<void()>> &infers)
+    {
+        for (int instance = 0; instance < config.instances; instance++)
+        {
+            std::shared_ptr<ScenarioSession> session(new ScenarioSession(), [](ScenarioSession *session)
+                                                     {
+                close_scenario_session(*session);
+                delete session; });
+            open_scenario_session(placementModel, *session);
+            session->inferCtrlParam.bpuCoreId = config.settings["BpuCoreIds"][instance].get<int32_t>();
+            infers.push_back([session]()
+                             { run_scenario_session(*session); });
+        }
+        return true;
+    };
+    std::vector<PlacementResult> results = run_placement_sweep(bpu_placements(), setup, FLAGS_num_warmup, FLAGS_num_run);
+    log_placement_sweep(placementModel.name, results);
+    result = placement_sweep_json(results);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "nlohmann/json.hpp"
+#include "Colocation.hpp"
+#include "SimulatedBackend.hpp"
+#include "Trace.hpp"
+
+// 场景文件，为空时使用内置的检测 + 分类 + 跟踪场景
+DEFINE_string(scenario, "", "The json file listing the co-located models, empty for the built-in scenario.");
+
+// 模拟加速器的核心数
+DEFINE_int32(sim_cores, 1, "The number of cores of the simulated accelerator.");
+
+// 忽略优先级，所有请求按到达顺序得到核心，用于对照
+DEFINE_bool(fifo, false, "Ignore the priorities and grant the cores in arrival order.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/colocation_benchmark.json", "The file path to the output json file.");
+
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+
+// 内置场景: 30fps检测(高优先级)、60fps分类、100fps跟踪(低优先级)
+Scenario builtin_scenario()
+{
+    Scenario scenario;
+    scenario.durationS = 5;
+    scenario.warmupS = 0.5;
+    scenario.models = {
+        {"det", "", 30, 200, -1, 0, {{"sim_compute_us", 8000}, {"sim_weight_mb", 16}}},
+        {"cls", "", 60, 100, -1, 0, {{"sim_compute_us", 3000}, {"sim_weight_mb", 8}}},
+        {"track", "", 100, 50, -1, 0, {{"sim_compute_us", 1000}, {"sim_weight_mb", 2}}},
+    };
+    return scenario;
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+    FLAGS_alsologtostderr = true;
+    FLAGS_colorlogtostderr = true;
+    FLAGS_log_prefix = true;
+    FLAGS_logbufsecs = 0;
+    TRACE_THREAD_NAME("main");
+
+    Scenario scenario;
+    if (FLAGS_scenario.empty())
+    {
+        scenario = builtin_scenario();
+    }
+    else if (!load_scenario(FLAGS_scenario, scenario))
+    {
+        return -1;
+    }
+
+    // 每个模型的模拟参数从场景文件中的sim_*字段读取
+    SimulatedDevice device(FLAGS_sim_cores);
+    std::vector<std::unique_ptr<SimulatedBackend>> backends;
+    std::vector<std::function<void()>> sessions;
+    nlohmann::json metaInfos;
+    for (const auto &model : scenario.models)
+    {
+        SimulatedModelConfig config;
+        config.name = model.name;
+        config.inputBytes = model.config.value("sim_input_bytes", config.inputBytes);
+        config.outputBytes = model.config.value("sim_output_bytes", config.outputBytes);
+        config.weightBytes = (size_t)model.config.value("sim_weight_mb", 8) * 1024 * 1024;
+        config.computeUs = model.config.value("sim_compute_us", 2000.0);
+        config.idleCompute = true;
+        backends.emplace_back(new SimulatedBackend(config));
+        metaInfos.push_back(backends.back()->meta_info());
+        SimulatedBackend *backend = backends.back().get();
+        int priority = FLAGS_fifo ? 0 : model.priority;
+        int pin = model.core;
+        sessions.push_back([backend, &device, priority, pin]()
+                           {
+            backend->inputs_set();
+            int core = device.acquire(priority, pin);
+            backend->run();
+            device.release(core);
+            backend->outputs_get(); });
+    }
+
+    nlohmann::json report;
+    report["MetaInfo"] = metaInfos;
+    report["Cores"] = FLAGS_sim_cores;
+    report["Fifo"] = FLAGS_fifo;
+    report["ColocationResult"] = run_colocation(scenario, sessions);
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << report << std::endl;
+
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
+    }
+
+    google::ShutdownGoogleLogging();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "nlohmann/json.hpp"
+#include "ResultCompare.hpp"
+
+// 逗号分隔的结果文件，第一个为基准，其余每个都和基准比较
+DEFINE_string(results, "", "Comma separated result json files, the first one is the baseline.");
+
+// 判断回退的指标(mean、p50或p99)和阈值(%)，变化超过阈值且Mann-Whitney U检验的p值小于alpha时判为回退
+DEFINE_string(metric, "p50", "The latency metric gated on: mean, p50 or p99.");
+DEFINE_double(threshold, 5, "The relative slowdown in percent beyond which a significant change is a regression.");
+DEFINE_double(alpha, 0.01, "The significance level of the Mann-Whitney U test.");
+
+// bootstrap重采样次数和种子，用于给出指标相对变化的置信区间
+DEFINE_int32(bootstrap, 1000, "The bootstrap iterations of the delta confidence interval, 0 to disable.");
+DEFINE_int32(seed, 0, "The seed of the bootstrap resampling.");
+
+// 没有逐轮结果(只能比较平均延迟)的模型和只在一边出现的模型默认使门禁失败，打开后只给出警告
+DEFINE_bool(allow_untested, false, "Pass the gate for models without per-round samples, which are only compared by the mean.");
+DEFINE_bool(allow_missing, false, "Pass the gate for models found in only one of the result files.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/compare_result.json", "The file path to the output json file.");
+
+// 返回值: 0没有回退，1有回退，2参数或结果文件错误，3没有回退但有不能检验或没有匹配上的模型，便于在夜间测试中作为门禁
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+    FLAGS_alsologtostderr = true;
+    FLAGS_colorlogtostderr = true;
+    FLAGS_log_prefix = true;
+    FLAGS_logbufsecs = 0;
+
+    std::vector<std::string> paths;
+    std::stringstream stream(FLAGS_results);
+    std::string path;
+    while (std::getline(stream, path, ','))
+    {
+        if (!path.empty())
+            paths.push_back(path);
+    }
+    if (paths.size() < 2)
+    {
+        LOG(ERROR) << "At least two result files are required: --results baseline.json,candidate.json";
+        return 2;
+    }
+    if (FLAGS_metric != "mean" && FLAGS_metric != "p50" && FLAGS_metric != "p99")
+    {
+        LOG(ERROR) << "Unsupported metric: " << FLAGS_metric;
+        return 2;
+    }
+    CompareOptions options;
+    options.metric = FLAGS_metric;
+    options.threshold = FLAGS_threshold;
+    options.alpha = FLAGS_alpha;
+    options.bootstrap = FLAGS_bootstrap;
+    options.seed = FLAGS_seed;
+
+    std::vector<ResultModel> baseline;
+    if (!load_result_models(paths[0], baseline))
+    {
+        return 2;
+    }
+    nlohmann::json report;
+    report["Baseline"] = paths[0];
+    report["Metric"] = options.metric;
+    report["Threshold"] = options.threshold;
+    report["Alpha"] = options.alpha;
+    int regressions = 0;
+    int untested = 0;
+    int unmatched = 0;
+    for (size_t index = 1; index < paths.size(); index++)
+    {
+        std::vector<ResultModel> candidate;
+        if (!load_result_models(paths[index], candidate))
+        {
+            return 2;
+        }
+        std::vector<std::string> missing;
+        std::vector<ModelComparison> comparisons = compare_results(baseline, candidate, options, missing);
+        log_comparisons(paths[0], paths[index], comparisons, options);
+        nlohmann::json item;
+        item["Candidate"] = paths[index];
+        item["Models"] = nlohmann::json::array();
+        for (const auto &comparison : comparisons)
+        {
+            item["Models"].push_back(model_comparison_json(comparison));
+            if (!comparison.tested)
+            {
+                untested++;
+                LOG(WARNING) << comparison.name << " has no per-round samples (MultiRoundsProfileResult), only the mean is compared.";
+            }
+            if (comparison.verdict == "regression")
+            {
+                regressions++;
+                LOG(ERROR) << "Regression: " << comparison.name << " " << options.metric << " " << comparison.delta[compare_metric_index(options.metric)] << "% slower in " << paths[index];
+            }
+        }
+        item["Missing"] = missing;
+        unmatched += (int)missing.size();
+        for (const auto &model : missing)
+        {
+            LOG(WARNING) << "Unmatched model, " << model;
+        }
+        report["Comparisons"].push_back(item);
+    }
+    report["Regressions"] = regressions;
+    report["Untested"] = untested;
+    report["Unmatched"] = unmatched;
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << report << std::endl;
+
+    bool incomplete = (untested > 0 && !FLAGS_allow_untested) || (unmatched > 0 && !FLAGS_allow_missing);
+    if (regressions == 0 && incomplete)
+    {
+        LOG(ERROR) << untested << " models without per-round samples and " << unmatched << " unmatched models, use --allow_untested/--allow_missing to pass the gate";
+    }
+    google::ShutdownGoogleLogging();
+    return regressions > 0 ? 1 : (incomplete ? 3 : 0);
+}
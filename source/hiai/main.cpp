@@ -8,8 +8,20 @@
 #include <graph/compatible/all_ops.h>
 #include <hiai_ir_build.h>
 #include <graph/buffer.h>
+#include <map>
+#include <memory>
 #include <vector>
+#include <fstream>
 #include "Timer.hpp"
+#include "InputProvider.hpp"
+#include "TensorPool.hpp"
+#include "OperatorProfile.hpp"
+#include "Trace.hpp"
+#include "Helper.h"
+#include "ModelDiscovery.hpp"
+#include "BenchmarkSummary.hpp"
+#include "PowerSampler.hpp"
+#include "nlohmann/json.hpp"
 #include "glog/logging.h"
 #include "gflags/gflags.h"
 #include <filesystem>
@@ -18,6 +30,9 @@
 // 定义模型文件的路径
 DEFINE_string(model, "path", "The file path to the rknn model.");
 
+// 模型目录扫描的manifest缓存文件，目录没有变化时不再重新列出，为空时不缓存
+DEFINE_string(manifest_cache, "", "The manifest cache of the model directory scan, unchanged directories are not listed again. Empty to disable.");
+
 // 定义预热运行的次数，用于模型初始化或数据预加载
 DEFINE_int32(num_warmup, 10, "The number of warmup runs before actual benchmarking.");
 
@@ -27,9 +42,29 @@ DEFINE_int32(num_run, 10, "The number of runs to measure the model's performance
 // 是否对操作进行性能分析，如果设置为true，将输出操作级别的性能数据
 DEFINE_bool(enable_profiling, false, "Flag to enable profiling of individual operations within the model.");
 
+// 算子级性能分析中输出耗时最多的前N个算子
+DEFINE_int32(profiling_topn, 10, "The number of the slowest operators reported by the operator profiling.");
+
 // 批量基准测试
 DEFINE_bool(enable_batch_benchmark, false, "Flag to enable batch benchmark performance.");
 
+// 输入数据: random[:low,high], constant:value 或 replay:目录/逗号分隔的.npy/.raw文件，replay时每轮使用下一份样本
+DEFINE_string(input_data, "random", "The input data: random[:low,high], constant:value or replay:path.");
+
+// 随机输入的种子
+DEFINE_int32(input_seed, 0, "The seed of the random input data.");
+
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+
+// 定义输出文件路径
+DEFINE_string(output_file, "output/hiai_profile_result.json", "The file path to the output json file.");
+
+// 功耗采样节点(例如整板功率的sysfs节点)，为空时不采样；scale把读数换算为W，采样得到的平均功率和每次推理的能耗写在Summary中
+DEFINE_string(power_node, "", "The sysfs power node sampled during the timed rounds, empty to disable.");
+DEFINE_double(power_scale, 1e-6, "The scale converting the power node reading to watts, 1e-6 for microwatts.");
+DEFINE_int32(power_interval_ms, 10, "The sampling interval of the power node in milliseconds.");
+
 #define CHECK_STATUS(ret)                                                                                         \
     if ((ret) != hiai::SUCCESS)                                                                                   \
     {                                                                                                             \
@@ -37,7 +72,64 @@ DEFINE_bool(enable_batch_benchmark, false, "Flag to enable batch benchmark perfo
         exit(-1);                                                                                                 \
     }
 
-int batch_benchmark(const char *model_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results);
+int batch_benchmark(const char *model_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result);
+
+// NDTensorBuffer的缓冲池，批量测试多个模型时不再重复创建相同的缓冲区；
+// 缓冲区由张量描述(形状、数据类型、格式)创建，描述不同的缓冲区不能互换，因此每种描述一个缓冲池
+using HiaiTensorPool = BufferPool<std::shared_ptr<hiai::INDTensorBuffer>>;
+
+std::map<std::string, std::unique_ptr<HiaiTensorPool>> &hiai_tensor_pools()
+{
+    static std::map<std::string, std::unique_ptr<HiaiTensorPool>> pools;
+    return pools;
+}
+
+HiaiTensorPool &hiai_tensor_pool(const hiai::NDTensorDesc &desc)
+{
+    std::string name = "hiai " + std::to_string((int)desc.dataType) + "/" + std::to_string((int)desc.format);
+    for (int32_t dim : desc.dims)
+    {
+        name += "x" + std::to_string(dim);
+    }
+    std::unique_ptr<HiaiTensorPool> &pool = hiai_tensor_pools()[name];
+    if (!pool)
+    {
+        pool.reset(new HiaiTensorPool(
+            name,
+            [desc](const PoolKey &, std::shared_ptr<hiai::INDTensorBuffer> &buffer)
+            {
+                buffer = hiai::CreateNDTensorBuffer(desc);
+                return buffer != nullptr;
+            },
+            [](const PoolKey &, std::shared_ptr<hiai::INDTensorBuffer> &buffer)
+            { buffer.reset(); }));
+    }
+    return *pool;
+}
+
+InputDataType to_input_dtype(hiai::DataType type)
+{
+    switch (type)
+    {
+    case hiai::DataType::FLOAT32:
+        return InputDataType::Float32;
+    case hiai::DataType::FLOAT16:
+        return InputDataType::Float16;
+    case hiai::DataType::INT8:
+        return InputDataType::Int8;
+    case hiai::DataType::INT16:
+        return InputDataType::Int16;
+    case hiai::DataType::INT32:
+    case hiai::DataType::UINT32:
+        return InputDataType::Int32;
+    case hiai::DataType::INT64:
+        return InputDataType::Int64;
+    case hiai::DataType::BOOL:
+        return InputDataType::Bool;
+    default:
+        return InputDataType::Uint8;
+    }
+}
 
 int main(int argc, char **argv)
 {
@@ -48,34 +140,46 @@ int main(int argc, char **argv)
     FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
     FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
     FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+    TRACE_THREAD_NAME("main");
 
     std::string model = FLAGS_model;
     int num_warmup = FLAGS_num_warmup;
     int num_run = FLAGS_num_run;
     bool enable_profiling = FLAGS_enable_profiling;
     bool enable_batch_benchmark = FLAGS_enable_batch_benchmark;
+    InputSpec input_spec;
+    if (!parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec))
+    {
+        LOG(ERROR) << "Unsupported input data: " << FLAGS_input_data;
+        return -1;
+    }
 
     {
         std::string directoryPath = model;
 
-        // 存储找到的文件名
-        std::vector<std::filesystem::path> omFiles;
-
-        // 遍历目录
-        for (const auto &entry : std::filesystem::recursive_directory_iterator(directoryPath))
-        {
-            if (entry.is_regular_file() && entry.path().extension() == ".om")
-            {
-                omFiles.push_back(entry.path());
-            }
-        }
+        // 并行扫描目录查找.om文件
+        DiscoveryOptions discovery;
+        discovery.patterns = {".om"};
+        discovery.cacheFile = FLAGS_manifest_cache;
+        std::vector<std::string> omFiles = discovered_paths(discover_models(directoryPath, discovery));
         std::vector<std::tuple<std::string, LatencyPerfData>> batch_perf_results;
+        nlohmann::json all_models_result;
         // 打印所有找到的文件
         for (const auto &file : omFiles)
         {
             // std::cout << file << std::endl;
-            batch_benchmark(file.string().c_str(), num_warmup, num_run, enable_profiling, batch_perf_results);
+            batch_benchmark(file.c_str(), num_warmup, num_run, enable_profiling, batch_perf_results, all_models_result);
         }
+
+        // 创建输出目录（如果不存在）并保存结果
+        std::filesystem::path output_path(FLAGS_output_file);
+        if (output_path.has_parent_path())
+        {
+            std::filesystem::create_directories(output_path.parent_path());
+        }
+        std::ofstream json_file(FLAGS_output_file);
+        json_file << std::setw(4) << all_models_result << std::endl;
+
         // std::ostringstream pt_oss;
         tabulate::Table profileTable;
         // pt_oss << "\nmodel\t avg\t std\t min\t max\n";
@@ -97,11 +201,19 @@ int main(int argc, char **argv)
         LOG(INFO) << "\n"
                   << profileTable << "\n";
     }
+    for (const auto &pool : hiai_tensor_pools())
+    {
+        pool.second->trim();
+    }
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
+    }
     google::ShutdownGoogleLogging();
     return 0;
 }
 
-int batch_benchmark(const char *model_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results)
+int batch_benchmark(const char *model_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result)
 {
     LOG(INFO) << "Profiling model:" << model_path;
     // 第一阶段
@@ -111,36 +223,152 @@ int batch_benchmark(const char *model_path, int num_warmup, int num_run, bool en
     initOptions.buildOptions.precisionMode = hiai::PrecisionMode::PRECISION_MODE_FP16;
     initOptions.perfMode = hiai::PerfMode::HIGH;
 
+    auto init_start = std::chrono::steady_clock::now();
     std::shared_ptr<hiai::IBuiltModel> builtModel = hiai::CreateBuiltModel();
     CHECK_STATUS(builtModel->RestoreFromFile(model_path));
 
     std::shared_ptr<hiai::IModelManager> modelManager = hiai::CreateModelManager();
+    TRACE_BEGIN("IModelManager::Init");
     CHECK_STATUS(modelManager->Init(initOptions, builtModel, nullptr));
+    TRACE_END("IModelManager::Init");
+    double init_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
 
+    // 缓冲区从张量描述对应的缓冲池中取，缓冲池中没有时按描述创建
     std::vector<std::shared_ptr<hiai::INDTensorBuffer>> inputTensors;
     std::vector<std::shared_ptr<hiai::INDTensorBuffer>> outputTensors;
+    std::vector<std::pair<HiaiTensorPool *, PoolKey>> tensorKeys;
+    auto acquire_tensors = [&](const std::vector<hiai::NDTensorDesc> &descs, std::vector<std::shared_ptr<hiai::INDTensorBuffer>> &tensors)
+    {
+        for (const auto &desc : descs)
+        {
+            size_t bytes = input_dtype_size(to_input_dtype(desc.dataType));
+            for (int32_t dim : desc.dims)
+            {
+                bytes *= dim;
+            }
+            HiaiTensorPool &pool = hiai_tensor_pool(desc);
+            std::shared_ptr<hiai::INDTensorBuffer> buffer;
+            PoolKey key;
+            if (!pool.acquire(bytes, 0, MemoryKind::Device, buffer, key))
+            {
+                exit(-1);
+            }
+            tensors.push_back(buffer);
+            tensorKeys.push_back({&pool, key});
+        }
+    };
     std::vector<hiai::NDTensorDesc> inputDesc = builtModel->GetInputTensorDescs();
+    acquire_tensors(inputDesc, inputTensors);
+    std::vector<hiai::NDTensorDesc> outputDesc = builtModel->GetOutputTensorDescs();
+    acquire_tensors(outputDesc, outputTensors);
+
+    // CreateNDTensorBuffer不初始化内容，输入数据由InputProvider按描述的数据类型提供
+    InputSpec inputSpec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, inputSpec);
+    InputProvider inputProvider(inputSpec);
+    std::vector<InputTensorInfo> inputInfos;
     for (size_t i = 0; i < inputDesc.size(); i++)
     {
-        std::shared_ptr<hiai::INDTensorBuffer> inputTensorBuffer = hiai::CreateNDTensorBuffer(inputDesc[i]);
-        inputTensors.push_back(inputTensorBuffer);
+        inputInfos.push_back({"input" + std::to_string(i), to_input_dtype(inputDesc[i].dataType), inputTensors[i]->GetSize()});
     }
-    std::vector<hiai::NDTensorDesc> outputDesc = builtModel->GetOutputTensorDescs();
-    for (size_t i = 0; i < outputDesc.size(); i++)
+    if (!inputProvider.prepare(inputInfos))
     {
-        std::shared_ptr<hiai::INDTensorBuffer> outputTensorBuffer = hiai::CreateNDTensorBuffer(outputDesc[i]);
-        outputTensors.push_back(outputTensorBuffer);
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        return -1;
     }
+    auto fill_inputs = [&]()
+    {
+        for (size_t i = 0; i < inputTensors.size(); i++)
+        {
+            inputProvider.copy_to(i, inputTensors[i]->GetData());
+        }
+    };
+    fill_inputs();
+    LOG(INFO) << "Input data: " << inputProvider.describe().dump();
 
-    auto benchmark_function = [](std::shared_ptr<hiai::IModelManager> modelManager, std::vector<std::shared_ptr<hiai::INDTensorBuffer>> inputTensors, std::vector<std::shared_ptr<hiai::INDTensorBuffer>> outputTensors)
+    auto benchmark_function = [](std::shared_ptr<hiai::IModelManager> &modelManager, std::vector<std::shared_ptr<hiai::INDTensorBuffer>> &inputTensors, std::vector<std::shared_ptr<hiai::INDTensorBuffer>> &outputTensors)
     {
-        CHECK_STATUS(modelManager->Run(*(const_cast<std::vector<std::shared_ptr<hiai::INDTensorBuffer>> *>(&inputTensors)), *(const_cast<std::vector<std::shared_ptr<hiai::INDTensorBuffer>> *>(&outputTensors))));
+        CHECK_STATUS(modelManager->Run(inputTensors, outputTensors));
     };
 
     Timer timer(num_warmup, num_run, benchmark_function, modelManager, inputTensors, outputTensors);
+    timer.set_trace_name("IModelManager::Run");
+    // 回放多份样本时，每轮计时前把下一份样本拷入输入缓冲区
+    if (inputProvider.samples() > 1)
+    {
+        timer.set_setup([&]()
+                        {
+                            inputProvider.next();
+                            fill_inputs(); });
+    }
+    PowerSampler power_sampler(FLAGS_power_node, FLAGS_power_scale, FLAGS_power_interval_ms);
+    power_sampler.start();
     timer.run();
+    double power = power_sampler.stop();
     auto data = timer.report();
+
     batch_perf_results.push_back(std::make_tuple(model_path, std::get<1>(data)));
 
+    // 与其他后端相同的结果格式，Summary用于跨后端的对比矩阵
+    std::string model_name = std::filesystem::path(model_path).filename().string();
+    nlohmann::json result;
+    result["MetaInfo"]["BackendName"] = "HiAI";
+    result["MetaInfo"]["ModelName"] = model_name;
+    result["MetaInfo"]["ModelPath"] = model_path;
+    result["MetaInfo"]["ModelHash"] = model_hash_string(model_file_hash(model_path));
+    result["RuntimeResult"]["Warmups"] = num_warmup;
+    result["RuntimeResult"]["Rounds"] = num_run;
+    result["RuntimeResult"]["TimerOverhead"] = calibrate_timer().mean;
+    result["RuntimeResult"]["AvgTotalRoundLatency"] = std::get<1>(data).mean;
+    result["RuntimeResult"]["StdTotalRoundLatency"] = std::get<1>(data).stdev;
+    result["RuntimeResult"]["MinTotalRoundLatency"] = std::get<1>(data).min;
+    result["RuntimeResult"]["MaxTotalRoundLatency"] = std::get<1>(data).max;
+    result["RuntimeResult"]["InitTime"] = init_time;
+    BenchmarkSummary summary = summarize_benchmark(logical_model_name(model_path), "HiAI", device_model_name("NPU"), timer.durations_normal_);
+    summary.modelFile = model_name;
+    summary.modelHash = result["MetaInfo"]["ModelHash"];
+    summary.initTime = init_time;
+    set_summary_power(summary, power);
+    result["Summary"] = benchmark_summary_json(summary);
+    // IModelManager没有提供算子级的耗时，整图作为一条记录写成与其他后端相同的OperatorProfile，
+    // 包含各轮的平均值和分位数，Granularity标记为Graph，便于和其他加速器的算子总耗时对比
+    if (enable_profiling)
+    {
+        OperatorSampler sampler;
+        for (double duration : timer.durations_normal_)
+        {
+            OperatorRecord record;
+            record.id = 0;
+            record.name = model_name;
+            record.opType = "Graph";
+            record.target = "NPU";
+            record.timeUs = duration;
+            sampler.add(record);
+        }
+        std::vector<OperatorRecord> operators = sampler.records();
+        log_operator_profile(model_path, operators, FLAGS_profiling_topn);
+        result["OperatorProfile"] = operator_profile_json(operators, FLAGS_profiling_topn);
+        result["OperatorProfile"]["Granularity"] = "Graph";
+    }
+    nlohmann::json model_result;
+    model_result[model_name] = result;
+    all_models_result.push_back(model_result);
+
+    // 缓冲区归还缓冲池，留给下一个描述相同的模型使用
+    for (size_t i = 0; i < inputTensors.size(); i++)
+    {
+        tensorKeys[i].first->release(tensorKeys[i].second, inputTensors[i]);
+    }
+    for (size_t i = 0; i < outputTensors.size(); i++)
+    {
+        tensorKeys[inputTensors.size() + i].first->release(tensorKeys[inputTensors.size() + i].second, outputTensors[i]);
+    }
+    nlohmann::json poolReport;
+    for (const auto &pool : hiai_tensor_pools())
+    {
+        poolReport[pool.first] = pool.second->report();
+    }
+    LOG(INFO) << "Tensor pool: " << poolReport.dump();
+
     return 0;
 }
\ No newline at end of file
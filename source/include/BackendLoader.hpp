@@ -0,0 +1,273 @@
+#ifndef BACKEND_LOADER_HPP
+#define BACKEND_LOADER_HPP
+#include <dlfcn.h>
+#include <unistd.h>
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "BackendPlugin.h"
+#include "InputProvider.hpp"
+#include "SimulatedPlugin.hpp"
+
+// npubench的后端层: 按后端名加载插件(内置的simulated或dlopen libnpubench_<name>.so)，
+// 每个后端在第一次用到时才加载，启动时不会加载用不到的SDK。
+
+// 模型文件扩展名对应的后端，选择后端时不需要先加载插件
+const std::map<std::string, std::string> BACKEND_EXTENSIONS = {
+    {".rknn", "rknn"},
+    {".bin", "bpu"},
+    {".hbm", "bpu"},
+    {".om", "hiai"},
+    {".xml", "openvino"},
+    {".onnx", "openvino"},
+    {".sim", "simulated"},
+};
+
+// 没有对应的后端时返回空字符串
+std::string backend_for_model(const std::string &path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    auto it = BACKEND_EXTENSIONS.find(extension);
+    return it == BACKEND_EXTENSIONS.end() ? "" : it->second;
+}
+
+// 插件的默认目录为npubench可执行文件所在的目录
+std::string default_plugin_dir()
+{
+    std::error_code ec;
+    std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+    return ec ? "." : exe.parent_path().string();
+}
+
+// 一个已加载的插件，内置插件没有dlopen句柄
+class BackendLibrary
+{
+public:
+    BackendLibrary(const NpuBackendPlugin *plugin, void *handle, const std::string &path)
+        : plugin_(plugin), handle_(handle), path_(path)
+    {
+    }
+
+    ~BackendLibrary()
+    {
+        if (handle_)
+        {
+            dlclose(handle_);
+        }
+    }
+
+    const NpuBackendPlugin *plugin() const
+    {
+        return plugin_;
+    }
+
+    const std::string &path() const
+    {
+        return path_;
+    }
+
+private:
+    const NpuBackendPlugin *plugin_;
+    void *handle_;
+    std::string path_;
+};
+
+class BackendRegistry
+{
+public:
+    explicit BackendRegistry(const std::string &pluginDir = "")
+        : pluginDir_(pluginDir.empty() ? default_plugin_dir() : pluginDir)
+    {
+    }
+
+    // 按名字取插件，第一次调用时加载；插件目录中没有时交给dlopen按LD_LIBRARY_PATH查找
+    std::shared_ptr<BackendLibrary> get(const std::string &name)
+    {
+        auto it = libraries_.find(name);
+        if (it != libraries_.end())
+        {
+            return it->second;
+        }
+        std::shared_ptr<BackendLibrary> library;
+        if (name == "simulated")
+        {
+            library = std::make_shared<BackendLibrary>(simulated_backend_plugin(), nullptr, "builtin");
+        }
+        else
+        {
+            library = open(name);
+        }
+        if (library)
+        {
+            LOG(INFO) << "Loaded backend plugin " << name << " " << library->plugin()->version() << " from " << library->path();
+            libraries_[name] = library;
+        }
+        return library;
+    }
+
+    std::vector<std::string> loaded() const
+    {
+        std::vector<std::string> names;
+        for (const auto &item : libraries_)
+        {
+            names.push_back(item.first);
+        }
+        return names;
+    }
+
+private:
+    std::shared_ptr<BackendLibrary> open(const std::string &name)
+    {
+        std::string file = "libnpubench_" + name + ".so";
+        std::filesystem::path path = std::filesystem::path(pluginDir_) / file;
+        std::string target = std::filesystem::exists(path) ? path.string() : file;
+        void *handle = dlopen(target.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle)
+        {
+            LOG(ERROR) << "Cannot load backend plugin " << name << ": " << dlerror();
+            return nullptr;
+        }
+        auto entry = (NpuBackendPluginEntry)dlsym(handle, NPUBENCH_PLUGIN_ENTRY);
+        const NpuBackendPlugin *plugin = entry ? entry() : nullptr;
+        if (!plugin || plugin->abi != NPUBENCH_PLUGIN_ABI)
+        {
+            LOG(ERROR) << "Invalid backend plugin " << target << ": " << (plugin ? "abi " + std::to_string(plugin->abi) + " != " + std::to_string(NPUBENCH_PLUGIN_ABI) : "no " NPUBENCH_PLUGIN_ENTRY);
+            dlclose(handle);
+            return nullptr;
+        }
+        return std::make_shared<BackendLibrary>(plugin, handle, target);
+    }
+
+    std::string pluginDir_;
+    std::map<std::string, std::shared_ptr<BackendLibrary>> libraries_;
+};
+
+// 插件中加载的一个模型，持有插件的引用，插件在所有模型释放后才卸载
+class BackendModel
+{
+public:
+    ~BackendModel()
+    {
+        if (handle_)
+        {
+            plugin()->unload(handle_);
+        }
+    }
+
+    // options为后端特有的选项，例如共置场景中模型的json
+    static std::unique_ptr<BackendModel> load(std::shared_ptr<BackendLibrary> library, const std::string &path, const nlohmann::json &options)
+    {
+        char error[512] = {0};
+        void *handle = library->plugin()->load(path.c_str(), options.dump().c_str(), error, sizeof(error));
+        if (!handle)
+        {
+            LOG(ERROR) << "Failed to load " << path << " with " << library->plugin()->name << ": " << error;
+            return nullptr;
+        }
+        std::unique_ptr<BackendModel> model(new BackendModel(library, handle, path));
+        model->describe();
+        return model;
+    }
+
+    const std::vector<InputTensorInfo> &inputs() const
+    {
+        return inputs_;
+    }
+
+    const std::vector<InputTensorInfo> &outputs() const
+    {
+        return outputs_;
+    }
+
+    bool inputs_set(const std::vector<const void *> &buffers)
+    {
+        return check(plugin()->inputs_set(handle_, buffers.data()), "inputs_set");
+    }
+
+    bool run()
+    {
+        return check(plugin()->run(handle_), "run");
+    }
+
+    bool outputs_get(const std::vector<void *> &buffers)
+    {
+        return check(plugin()->outputs_get(handle_, buffers.data()), "outputs_get");
+    }
+
+    nlohmann::json meta_info() const
+    {
+        nlohmann::json meta = nlohmann::json::parse(plugin()->meta_info(handle_), nullptr, false);
+        if (!meta.is_object())
+        {
+            meta = nlohmann::json::object();
+        }
+        // 插件给出的BackendName为与各驱动相同的显示名(例如RKNN)，没有时用插件名
+        if (!meta.contains("BackendName"))
+        {
+            meta["BackendName"] = plugin()->name;
+        }
+        meta["ModelPath"] = path_;
+        return meta;
+    }
+
+    std::string backend() const
+    {
+        return plugin()->name;
+    }
+
+private:
+    BackendModel(std::shared_ptr<BackendLibrary> library, void *handle, const std::string &path)
+        : library_(library), handle_(handle), path_(path)
+    {
+    }
+
+    const NpuBackendPlugin *plugin() const
+    {
+        return library_->plugin();
+    }
+
+    void describe()
+    {
+        auto to_info = [](const NpuTensorDesc &desc)
+        {
+            InputDataType dtype = desc.dtype >= NPU_DTYPE_FLOAT32 && desc.dtype <= NPU_DTYPE_BOOL ? (InputDataType)desc.dtype : InputDataType::Uint8;
+            return InputTensorInfo{desc.name, dtype, (size_t)desc.bytes};
+        };
+        for (int32_t i = 0; i < plugin()->input_count(handle_); i++)
+        {
+            NpuTensorDesc desc = {};
+            plugin()->input_desc(handle_, i, &desc);
+            inputs_.push_back(to_info(desc));
+        }
+        for (int32_t i = 0; i < plugin()->output_count(handle_); i++)
+        {
+            NpuTensorDesc desc = {};
+            plugin()->output_desc(handle_, i, &desc);
+            outputs_.push_back(to_info(desc));
+        }
+    }
+
+    bool check(int32_t ret, const char *stage)
+    {
+        if (ret != 0)
+        {
+            LOG(ERROR) << plugin()->name << " " << stage << " fail! ret=" << ret << " " << plugin()->last_error(handle_);
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<BackendLibrary> library_;
+    void *handle_;
+    std::string path_;
+    std::vector<InputTensorInfo> inputs_;
+    std::vector<InputTensorInfo> outputs_;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef BACKEND_PLUGIN_H
+#define BACKEND_PLUGIN_H
+#include <stddef.h>
+#include <stdint.h>
+
+// npubench的后端插件接口: 每个后端编译为一个共享库(libnpubench_<name>.so)，导出NPUBENCH_PLUGIN_ENTRY，
+// 返回一张函数表。接口只用C类型，插件和npubench可以用不同的编译器/STL版本编译，插件中不使用glog/gflags，
+// 错误通过last_error返回的字符串交给npubench记录。
+// 张量缓冲区由npubench分配，inputs_set/outputs_get按描述的字节数拷贝，run只包含推理本身。
+
+#define NPUBENCH_PLUGIN_ABI 1
+#define NPUBENCH_PLUGIN_ENTRY "npubench_backend_plugin"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // 与InputDataType的顺序相同
+    typedef enum
+    {
+        NPU_DTYPE_FLOAT32 = 0,
+        NPU_DTYPE_FLOAT16,
+        NPU_DTYPE_INT8,
+        NPU_DTYPE_UINT8,
+        NPU_DTYPE_INT16,
+        NPU_DTYPE_UINT16,
+        NPU_DTYPE_INT32,
+        NPU_DTYPE_INT64,
+        NPU_DTYPE_BOOL
+    } NpuDataType;
+
+    typedef struct
+    {
+        char name[128];
+        int32_t dtype;
+        uint64_t bytes;
+    } NpuTensorDesc;
+
+    typedef struct
+    {
+        uint32_t abi;
+        // 后端名，例如rknn
+        const char *name;
+        // 逗号分隔的模型文件扩展名，例如.rknn
+        const char *extensions;
+        const char *(*version)(void);
+        // options为json对象字符串，后端特有的选项(例如core、priority、device)，失败时返回NULL并写入error
+        void *(*load)(const char *model_path, const char *options, char *error, size_t error_size);
+        void (*unload)(void *model);
+        int32_t (*input_count)(void *model);
+        int32_t (*output_count)(void *model);
+        int32_t (*input_desc)(void *model, int32_t index, NpuTensorDesc *desc);
+        int32_t (*output_desc)(void *model, int32_t index, NpuTensorDesc *desc);
+        // 以下函数成功返回0
+        int32_t (*inputs_set)(void *model, const void *const *inputs);
+        int32_t (*run)(void *model);
+        int32_t (*outputs_get)(void *model, void *const *outputs);
+        // 模型的元信息(json对象字符串)，例如BackendVersion、Device、MemoryBytes，在unload之前有效
+        const char *(*meta_info)(void *model);
+        const char *(*last_error)(void *model);
+    } NpuBackendPlugin;
+
+    typedef const NpuBackendPlugin *(*NpuBackendPluginEntry)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,708 @@
+#ifndef BENCH_PLAN_HPP
+#define BENCH_PLAN_HPP
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "BackendLoader.hpp"
+#include "BenchmarkSummary.hpp"
+#include "Helper.h"
+#include "InputProvider.hpp"
+#include "ModelDiscovery.hpp"
+#include "PowerSampler.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+// 声明式的测试配置(npubench --config)，代替各个程序不同的命令行参数和批量测试的shell循环。
+// 配置文件为json:
+// {
+//     "name": "rknn_nightly",
+//     "manifest_cache": "output/manifest.json",
+//     "models": ["/userdata/models/**/*.rknn", {"path": "cls.sim", "backend": "simulated", "options": {"sim_compute_us": 3000}}],
+//     "sweep": {"concurrency": [1, 2, 4], "batch": [1, 8], "core": [-1, 0], "io_mode": ["full", "run"]},
+//     "run": {"warmup": 10, "rounds": 200},
+//     "input": {"data": "random", "seed": 0},
+//     "samplers": {"power": {"node": "/sys/class/hwmon/hwmon0/power1_input", "scale": 1e-6, "interval_ms": 10}, "trace": "output/trace.json"},
+//     "outputs": [{"type": "json", "path": "output/nightly.json"}, {"type": "csv", "path": "output/nightly.csv"}, {"type": "table"}]
+// }
+// models中的字符串含有*、?或[时按glob展开(**匹配任意层目录，manifest_cache缓存目录列表)；sweep中每个字段可以是单个值或数组，
+// 展开为models x core x concurrency x batch x io_mode的任务矩阵。
+// concurrency为同时推理的实例数(每个实例单独加载一份模型)，batch为每个计时样本中连续提交的请求数
+// (模型本身的batch维在编译时固定)，core作为后端选项core传给插件，io_mode为full(inputs_set + run + outputs_get)
+// 或run(只计时推理，输入在开始前设置一次)。
+// 同一个模型和后端选项的任务相邻执行，模型加载和输入数据只准备一次，增加并发时只加载新增的实例。
+
+// 运行长度: 固定rounds轮；duration_s > 0时按时间运行；target_rsd > 0时自适应，
+// 至少min_rounds轮，均值的相对标准误差(%)小于target_rsd或达到max_rounds时停止
+struct RunPolicy
+{
+    int warmup = 10;
+    int rounds = 100;
+    double durationS = 0;
+    double targetRsd = 0;
+    int minRounds = 20;
+    int maxRounds = 100000;
+};
+
+struct PlanModel
+{
+    std::string path;
+    std::string backend;
+    nlohmann::json options = nlohmann::json::object();
+};
+
+struct PlanOutput
+{
+    std::string type;
+    std::string path;
+};
+
+struct BenchPlan
+{
+    std::string name = "npubench";
+    std::string pluginDir;
+    std::string manifestCache;
+    std::vector<PlanModel> models;
+    std::vector<int> concurrency = {1};
+    std::vector<int> batch = {1};
+    std::vector<int> core = {-1};
+    std::vector<std::string> ioMode = {"full"};
+    RunPolicy run;
+    std::string inputData = "random";
+    int inputSeed = 0;
+    std::string powerNode;
+    double powerScale = 1e-6;
+    int powerIntervalMs = 10;
+    std::string traceFile;
+    std::vector<PlanOutput> outputs;
+};
+
+struct BenchJob
+{
+    size_t index = 0;
+    PlanModel model;
+    int concurrency = 1;
+    int batch = 1;
+    int core = -1;
+    std::string ioMode = "full";
+
+    // 传给插件的选项，core为-1时不设置
+    nlohmann::json options() const
+    {
+        nlohmann::json merged = model.options;
+        if (core >= 0)
+        {
+            merged["core"] = core;
+        }
+        return merged;
+    }
+
+    // 相同key的任务共用已加载的模型实例
+    std::string instance_key() const
+    {
+        return model.backend + "|" + model.path + "|" + options().dump();
+    }
+
+    std::string label() const
+    {
+        return std::filesystem::path(model.path).filename().string() + " [c=" + std::to_string(concurrency) + ",b=" + std::to_string(batch) +
+               ",core=" + std::to_string(core) + "," + ioMode + "]";
+    }
+};
+
+bool has_glob_chars(const std::string &pattern)
+{
+    return pattern.find_first_of("*?[") != std::string::npos;
+}
+
+// 展开glob: 通配符之前的目录为起点，**跨越任意层目录，其余通配符只匹配一层
+std::vector<std::string> expand_model_glob(const std::string &pattern, const std::string &cache_file)
+{
+    if (!has_glob_chars(pattern))
+    {
+        return {pattern};
+    }
+    size_t wildcard = pattern.find_first_of("*?[");
+    size_t slash = pattern.rfind('/', wildcard);
+    std::string base = slash == std::string::npos ? "." : pattern.substr(0, slash == 0 ? 1 : slash);
+    std::string rest = slash == std::string::npos ? pattern : pattern.substr(slash + 1);
+    DiscoveryOptions discovery;
+    discovery.patterns = {rest};
+    discovery.maxDepth = rest.find("**") != std::string::npos ? -1 : (int)std::count(rest.begin(), rest.end(), '/');
+    discovery.cacheFile = cache_file;
+    return discovered_paths(discover_models(base, discovery));
+}
+
+// sweep中的字段可以是单个值或数组
+template <typename T>
+std::vector<T> plan_values(const nlohmann::json &item, const std::string &key, const std::vector<T> &fallback)
+{
+    if (!item.contains(key))
+        return fallback;
+    const nlohmann::json &value = item[key];
+    if (value.is_array())
+        return value.get<std::vector<T>>();
+    return {value.get<T>()};
+}
+
+bool load_bench_plan(const std::string &path, BenchPlan &plan)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Cannot open config file: " << path;
+        return false;
+    }
+    try
+    {
+        nlohmann::json root;
+        file >> root;
+        plan.name = root.value("name", std::filesystem::path(path).stem().string());
+        plan.pluginDir = root.value("plugin_dir", "");
+        plan.manifestCache = root.value("manifest_cache", "");
+        for (const auto &item : root.at("models"))
+        {
+            PlanModel spec;
+            std::string pattern;
+            if (item.is_string())
+            {
+                pattern = item.get<std::string>();
+            }
+            else
+            {
+                pattern = item.value("path", item.value("glob", ""));
+                spec.backend = item.value("backend", "");
+                spec.options = item.value("options", nlohmann::json::object());
+            }
+            std::vector<std::string> paths = expand_model_glob(pattern, plan.manifestCache);
+            if (paths.empty())
+            {
+                LOG(WARNING) << "No model matches " << pattern;
+            }
+            for (const auto &model_path : paths)
+            {
+                PlanModel model = spec;
+                model.path = model_path;
+                if (model.backend.empty())
+                {
+                    model.backend = backend_for_model(model_path);
+                }
+                if (model.backend.empty())
+                {
+                    LOG(WARNING) << "Skip " << model_path << ", no backend for its extension";
+                    continue;
+                }
+                plan.models.push_back(model);
+            }
+        }
+        const nlohmann::json sweep = root.value("sweep", nlohmann::json::object());
+        plan.concurrency = plan_values<int>(sweep, "concurrency", plan.concurrency);
+        plan.batch = plan_values<int>(sweep, "batch", plan.batch);
+        plan.core = plan_values<int>(sweep, "core", plan.core);
+        plan.ioMode = plan_values<std::string>(sweep, "io_mode", plan.ioMode);
+        const nlohmann::json run = root.value("run", nlohmann::json::object());
+        plan.run.warmup = run.value("warmup", plan.run.warmup);
+        plan.run.rounds = run.value("rounds", plan.run.rounds);
+        plan.run.durationS = run.value("duration_s", plan.run.durationS);
+        plan.run.targetRsd = run.value("target_rsd", plan.run.targetRsd);
+        plan.run.minRounds = run.value("min_rounds", plan.run.minRounds);
+        plan.run.maxRounds = run.value("max_rounds", plan.run.maxRounds);
+        const nlohmann::json input = root.value("input", nlohmann::json::object());
+        plan.inputData = input.value("data", plan.inputData);
+        plan.inputSeed = input.value("seed", plan.inputSeed);
+        const nlohmann::json samplers = root.value("samplers", nlohmann::json::object());
+        if (samplers.contains("power"))
+        {
+            plan.powerNode = samplers["power"].value("node", "");
+            plan.powerScale = samplers["power"].value("scale", plan.powerScale);
+            plan.powerIntervalMs = samplers["power"].value("interval_ms", plan.powerIntervalMs);
+        }
+        plan.traceFile = samplers.value("trace", "");
+        for (const auto &item : root.value("outputs", nlohmann::json::array()))
+        {
+            plan.outputs.push_back({item.value("type", "json"), item.value("path", "")});
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        LOG(ERROR) << "Invalid config file " << path << ": " << ex.what();
+        return false;
+    }
+    InputSpec input_spec;
+    if (!parse_input_spec(plan.inputData, plan.inputSeed, input_spec))
+    {
+        LOG(ERROR) << "Unsupported input data: " << plan.inputData;
+        return false;
+    }
+    if (plan.outputs.empty())
+    {
+        plan.outputs = {{"json", "output/" + plan.name + ".json"}, {"table", ""}};
+    }
+    for (const auto &mode : plan.ioMode)
+    {
+        if (mode != "full" && mode != "run")
+        {
+            LOG(ERROR) << "Unsupported io_mode: " << mode << ", expected full or run";
+            return false;
+        }
+    }
+    for (size_t i = 0; i < plan.outputs.size(); i++)
+    {
+        const PlanOutput &output = plan.outputs[i];
+        if (output.type != "json" && output.type != "csv" && output.type != "table")
+        {
+            LOG(ERROR) << "Unsupported output type: " << output.type << ", expected json, csv or table";
+            return false;
+        }
+        if (output.type != "table" && output.path.empty())
+        {
+            LOG(ERROR) << "Output " << i << " (" << output.type << ") in " << path << " has no path";
+            return false;
+        }
+    }
+    return true;
+}
+
+// 任务矩阵: 同一个模型和core的任务相邻，便于复用已加载的实例
+std::vector<BenchJob> expand_bench_jobs(const BenchPlan &plan)
+{
+    std::vector<BenchJob> jobs;
+    for (const auto &model : plan.models)
+    {
+        for (int core : plan.core)
+        {
+            for (int concurrency : plan.concurrency)
+            {
+                for (int batch : plan.batch)
+                {
+                    for (const auto &mode : plan.ioMode)
+                    {
+                        BenchJob job;
+                        job.index = jobs.size();
+                        job.model = model;
+                        job.core = core;
+                        job.concurrency = std::max(concurrency, 1);
+                        job.batch = std::max(batch, 1);
+                        job.ioMode = mode;
+                        jobs.push_back(job);
+                    }
+                }
+            }
+        }
+    }
+    return jobs;
+}
+
+// 一个模型(和后端选项)的已加载实例，输入数据所有实例共用
+struct PlanInstances
+{
+    std::string key;
+    std::vector<std::unique_ptr<BackendModel>> models;
+    std::vector<std::vector<std::vector<uint8_t>>> outputBuffers;
+    std::unique_ptr<InputProvider> inputProvider;
+    double initTime = -1;
+};
+
+struct JobResult
+{
+    BenchJob job;
+    BenchmarkSummary summary;
+    nlohmann::json result;
+};
+
+class BenchEngine
+{
+public:
+    BenchEngine(BackendRegistry &registry, const BenchPlan &plan)
+        : registry_(registry), plan_(plan)
+    {
+    }
+
+    bool run_job(const BenchJob &job, JobResult &job_result)
+    {
+        LOG(INFO) << "Job " << job.index << ": " << job.label() << " on " << job.model.backend;
+        if (!prepare(job))
+        {
+            return false;
+        }
+        const RunPolicy &policy = plan_.run;
+        size_t reserve = policy.durationS > 0 || policy.targetRsd > 0 ? 1024 : (size_t)std::max(policy.rounds, 0);
+        std::vector<std::vector<double>> durations(job.concurrency);
+        for (auto &samples : durations)
+        {
+            samples.reserve(reserve);
+        }
+        // 所有实例同时开始，吞吐按从开始到最后一个实例结束的墙钟时间计算
+        std::mutex mutex;
+        std::condition_variable cond;
+        int ready = 0;
+        bool go = false;
+        std::chrono::steady_clock::time_point start;
+        std::vector<std::thread> workers;
+        PowerSampler power_sampler(plan_.powerNode, plan_.powerScale, plan_.powerIntervalMs);
+        for (int worker = 0; worker < job.concurrency; worker++)
+        {
+            workers.emplace_back([&, worker]()
+                                 {
+                TRACE_THREAD_NAME("job " + std::to_string(job.index) + " worker " + std::to_string(worker));
+                warm_up(job, worker);
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready++;
+                    cond.notify_all();
+                    cond.wait(lock, [&]()
+                              { return go; });
+                }
+                run_worker(job, worker, start, durations[worker]); });
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]()
+                      { return ready == job.concurrency; });
+            power_sampler.start();
+            start = std::chrono::steady_clock::now();
+            go = true;
+        }
+        cond.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double power = power_sampler.stop();
+
+        std::vector<double> merged;
+        for (const auto &samples : durations)
+        {
+            merged.insert(merged.end(), samples.begin(), samples.end());
+        }
+        job_result.job = job;
+        job_result.result = job_json(job, merged, wall_s, power, job_result.summary);
+        return true;
+    }
+
+private:
+    // 换到新的模型时释放上一个模型的实例，同一个模型只加载缺少的实例
+    bool prepare(const BenchJob &job)
+    {
+        std::string key = job.instance_key();
+        if (instances_.key != key)
+        {
+            instances_ = PlanInstances();
+            instances_.key = key;
+            InputSpec input_spec;
+            parse_input_spec(plan_.inputData, plan_.inputSeed, input_spec);
+            instances_.inputProvider.reset(new InputProvider(input_spec));
+        }
+        std::shared_ptr<BackendLibrary> library = registry_.get(job.model.backend);
+        if (!library)
+        {
+            return false;
+        }
+        while ((int)instances_.models.size() < job.concurrency)
+        {
+            auto init_start = std::chrono::steady_clock::now();
+            TRACE_BEGIN("load");
+            std::unique_ptr<BackendModel> model = BackendModel::load(library, job.model.path, job.options());
+            TRACE_END("load");
+            if (!model)
+            {
+                return false;
+            }
+            if (instances_.models.empty())
+            {
+                instances_.initTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
+                if (!instances_.inputProvider->prepare(model->inputs()))
+                {
+                    LOG(ERROR) << "Failed to prepare the input data: " << plan_.inputData;
+                    instances_ = PlanInstances();
+                    return false;
+                }
+            }
+            std::vector<std::vector<uint8_t>> buffers;
+            for (const auto &output : model->outputs())
+            {
+                buffers.emplace_back(output.bytes);
+            }
+            instances_.outputBuffers.push_back(std::move(buffers));
+            instances_.models.push_back(std::move(model));
+        }
+        return true;
+    }
+
+    void bind(int worker, std::vector<const void *> &inputs, std::vector<void *> &outputs)
+    {
+        BackendModel *model = instances_.models[worker].get();
+        inputs.resize(model->inputs().size());
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            inputs[i] = instances_.inputProvider->data(i);
+        }
+        outputs.clear();
+        for (auto &buffer : instances_.outputBuffers[worker])
+        {
+            outputs.push_back(buffer.data());
+        }
+    }
+
+    void request(const BenchJob &job, BackendModel *model, const std::vector<const void *> &inputs, const std::vector<void *> &outputs)
+    {
+        if (job.ioMode == "full")
+        {
+            model->inputs_set(inputs);
+            model->run();
+            model->outputs_get(outputs);
+        }
+        else
+        {
+            model->run();
+        }
+    }
+
+    void warm_up(const BenchJob &job, int worker)
+    {
+        std::vector<const void *> inputs;
+        std::vector<void *> outputs;
+        bind(worker, inputs, outputs);
+        BackendModel *model = instances_.models[worker].get();
+        model->inputs_set(inputs);
+        for (int i = 0; i < plan_.run.warmup; i++)
+        {
+            request(job, model, inputs, outputs);
+        }
+    }
+
+    // 每个样本为batch个连续的请求，样本耗时以us为单位
+    void run_worker(const BenchJob &job, int worker, std::chrono::steady_clock::time_point start, std::vector<double> &durations)
+    {
+        std::vector<const void *> inputs;
+        std::vector<void *> outputs;
+        bind(worker, inputs, outputs);
+        BackendModel *model = instances_.models[worker].get();
+        const RunPolicy &policy = plan_.run;
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(policy.durationS));
+        [[maybe_unused]] uint32_t trace_id = TRACE_EVENT_ID(job.model.backend + " request");
+        double sum = 0, sq_sum = 0;
+        while (true)
+        {
+            size_t count = durations.size();
+            if (policy.durationS > 0)
+            {
+                if (std::chrono::steady_clock::now() >= deadline || (int)count >= policy.maxRounds)
+                    break;
+            }
+            else if (policy.targetRsd > 0)
+            {
+                if ((int)count >= policy.maxRounds)
+                    break;
+                if ((int)count >= policy.minRounds)
+                {
+                    double mean = sum / count;
+                    double stdev = std::sqrt(std::max(sq_sum / count - mean * mean, 0.0));
+                    if (mean > 0 && stdev / std::sqrt((double)count) / mean * 100 < policy.targetRsd)
+                        break;
+                }
+            }
+            else if ((int)count >= policy.rounds)
+            {
+                break;
+            }
+            TRACE_BEGIN_ID(trace_id);
+            auto begin = std::chrono::steady_clock::now();
+            for (int i = 0; i < job.batch; i++)
+            {
+                request(job, model, inputs, outputs);
+            }
+            auto end = std::chrono::steady_clock::now();
+            TRACE_END_ID(trace_id);
+            double duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1000.0;
+            durations.push_back(duration);
+            sum += duration;
+            sq_sum += duration * duration;
+        }
+    }
+
+    nlohmann::json job_json(const BenchJob &job, const std::vector<double> &durations, double wall_s, double power, BenchmarkSummary &summary)
+    {
+        BackendModel *model = instances_.models[0].get();
+        nlohmann::json result;
+        result["MetaInfo"] = model->meta_info();
+        result["MetaInfo"]["ModelName"] = std::filesystem::path(job.model.path).filename().string();
+        result["MetaInfo"]["ModelHash"] = std::filesystem::exists(job.model.path) ? model_hash_string(model_file_hash(job.model.path)) : "";
+        result["Job"] = {{"Index", job.index}, {"Concurrency", job.concurrency}, {"Batch", job.batch}, {"Core", job.core}, {"IoMode", job.ioMode}, {"Options", job.options()}};
+        double requests = (double)durations.size() * job.batch;
+        double throughput = wall_s > 0 ? requests / wall_s : -1;
+        LatencyPerfData data = {0, 0, 0, 0};
+        if (!durations.empty())
+        {
+            data.mean = std::accumulate(durations.begin(), durations.end(), 0.0) / durations.size();
+            data.min = *std::min_element(durations.begin(), durations.end());
+            data.max = *std::max_element(durations.begin(), durations.end());
+            double sq_sum = std::inner_product(durations.begin(), durations.end(), durations.begin(), 0.0);
+            data.stdev = std::sqrt(std::max(sq_sum / durations.size() - data.mean * data.mean, 0.0));
+        }
+        result["RuntimeResult"]["Warmups"] = plan_.run.warmup;
+        result["RuntimeResult"]["Rounds"] = durations.size();
+        result["RuntimeResult"]["AvgTotalRoundLatency"] = data.mean;
+        result["RuntimeResult"]["StdTotalRoundLatency"] = data.stdev;
+        result["RuntimeResult"]["MinTotalRoundLatency"] = data.min;
+        result["RuntimeResult"]["MaxTotalRoundLatency"] = data.max;
+        result["RuntimeResult"]["InitTime"] = instances_.initTime;
+        result["RuntimeResult"]["WallTime"] = wall_s;
+        result["RuntimeResult"]["Throughput"] = throughput;
+        for (size_t i = 0; i < durations.size(); i++)
+        {
+            result["RuntimeResult"]["MultiRoundsProfileResult"].push_back({{"RoundIndex", i}, {"WarmupIndex", -1}, {"TotalRoundLatency", durations[i]}});
+        }
+        result["InputData"] = instances_.inputProvider->describe();
+
+        const nlohmann::json &meta = result["MetaInfo"];
+        summary = summarize_benchmark(logical_model_name(job.model.path), meta.value("BackendName", job.model.backend), meta.value("Device", device_model_name("NPU")), durations);
+        summary.modelFile = meta.value("ModelName", "");
+        summary.modelHash = meta.value("ModelHash", "");
+        summary.backendVersion = meta.value("BackendVersion", "");
+        summary.initTime = instances_.initTime;
+        // 并发和batch时吞吐按墙钟时间计算，能耗为平均功率除以吞吐
+        summary.throughput = throughput;
+        if (meta.contains("MemoryBytes"))
+        {
+            summary.memory = meta["MemoryBytes"].get<double>() * job.concurrency / 1024.0 / 1024.0;
+        }
+        summary.power = power;
+        summary.energy = power >= 0 && throughput > 0 ? power / throughput * 1000.0 : -1;
+        result["Summary"] = benchmark_summary_json(summary);
+        return result;
+    }
+
+    BackendRegistry &registry_;
+    const BenchPlan &plan_;
+    PlanInstances instances_;
+};
+
+std::string bench_csv_value(double value)
+{
+    return value >= 0 ? std::to_string(value) : "";
+}
+
+// 每行一个任务
+std::string bench_results_csv(const std::vector<JobResult> &results)
+{
+    std::ostringstream csv;
+    csv << "job,model,backend,device,concurrency,batch,core,io_mode,rounds,mean_us,p50_us,p90_us,p99_us,throughput,init_ms,memory_mb,peak_rss_mb,power_w,energy_mj\n";
+    for (const auto &item : results)
+    {
+        const BenchmarkSummary &summary = item.summary;
+        csv << item.job.index << "," << summary_csv_string(summary.modelFile) << "," << summary_csv_string(summary.backend) << "," << summary_csv_string(summary.device) << ","
+            << item.job.concurrency << "," << item.job.batch << "," << item.job.core << "," << summary_csv_string(item.job.ioMode) << "," << summary.rounds << ","
+            << bench_csv_value(summary.meanLatency) << "," << bench_csv_value(summary.p50Latency) << "," << bench_csv_value(summary.p90Latency) << ","
+            << bench_csv_value(summary.p99Latency) << "," << bench_csv_value(summary.throughput) << "," << bench_csv_value(summary.initTime) << ","
+            << bench_csv_value(summary.memory) << "," << bench_csv_value(summary.peakRss) << "," << bench_csv_value(summary.power) << ","
+            << bench_csv_value(summary.energy) << "\n";
+    }
+    return csv.str();
+}
+
+void log_bench_results(const std::vector<JobResult> &results)
+{
+    tabulate::Table jobTable;
+    jobTable.add_row({"job", "model", "backend", "concurrency", "batch", "core", "io", "rounds", "p50(us)", "p99(us)", "throughput", "energy(mJ)"});
+    for (const auto &item : results)
+    {
+        const BenchmarkSummary &summary = item.summary;
+        jobTable.add_row({std::to_string(item.job.index),
+                          summary.modelFile,
+                          summary.backend,
+                          std::to_string(item.job.concurrency),
+                          std::to_string(item.job.batch),
+                          std::to_string(item.job.core),
+                          item.job.ioMode,
+                          std::to_string(summary.rounds),
+                          summary_cell(summary.p50Latency),
+                          summary_cell(summary.p99Latency),
+                          summary_cell(summary.throughput),
+                          summary_cell(summary.energy)});
+    }
+    for (size_t i = 0; i < 12; ++i)
+    {
+        jobTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "\n"
+              << jobTable << "\n";
+}
+
+void write_plan_output(const std::string &path, const std::string &content)
+{
+    std::filesystem::path output_path(path);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream file(path);
+    file << content;
+}
+
+// 执行整个任务矩阵，返回失败的任务数
+int run_bench_plan(BackendRegistry &registry, const BenchPlan &plan)
+{
+    std::vector<BenchJob> jobs = expand_bench_jobs(plan);
+    LOG(INFO) << "Config " << plan.name << ": " << plan.models.size() << " models, " << jobs.size() << " jobs";
+    BenchEngine engine(registry, plan);
+    std::vector<JobResult> results;
+    int failed = 0;
+    for (const auto &job : jobs)
+    {
+        JobResult result;
+        if (engine.run_job(job, result))
+        {
+            results.push_back(std::move(result));
+        }
+        else
+        {
+            failed++;
+            LOG(ERROR) << "Job " << job.index << " failed: " << job.label();
+        }
+    }
+    for (const auto &output : plan.outputs)
+    {
+        if (output.type == "table")
+        {
+            log_bench_results(results);
+        }
+        else if (output.type == "csv")
+        {
+            write_plan_output(output.path, bench_results_csv(results));
+        }
+        else
+        {
+            nlohmann::json all_jobs_result = nlohmann::json::array();
+            for (const auto &item : results)
+            {
+                all_jobs_result.push_back({{item.job.label(), item.result}});
+            }
+            std::ostringstream json;
+            json << std::setw(4) << all_jobs_result << std::endl;
+            write_plan_output(output.path, json.str());
+        }
+    }
+    if (!plan.traceFile.empty())
+    {
+        write_chrome_trace(plan.traceFile);
+    }
+    return failed;
+}
+
+#endif
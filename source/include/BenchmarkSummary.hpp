@@ -0,0 +1,411 @@
+#ifndef BENCHMARK_SUMMARY_HPP
+#define BENCHMARK_SUMMARY_HPP
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "Timer.hpp"
+
+// 各个驱动共同的结果格式: 每个模型的结果中除了后端特有的内容，还有一个Summary，字段和单位在所有后端上相同，
+// 聚合工具(aggregate_results)按逻辑模型名把不同加速器上的Summary汇总成对比矩阵。
+// 逻辑模型名默认是模型文件名去掉扩展名(resnet50.rknn、resnet50.om都是resnet50)，BPU打包文件中为模型名。
+// 没有的数据为-1，写入json时为null。
+
+const int BENCHMARK_SUMMARY_VERSION = 1;
+
+struct BenchmarkSummary
+{
+    std::string model;
+    std::string modelFile;
+    std::string modelHash;
+    std::string backend;
+    std::string backendVersion;
+    std::string device;
+    int rounds = 0;
+    // 正式运行各轮的延迟(us)
+    double meanLatency = -1;
+    double stdLatency = -1;
+    double minLatency = -1;
+    double maxLatency = -1;
+    double p50Latency = -1;
+    double p90Latency = -1;
+    double p99Latency = -1;
+    // 单个上下文连续推理的吞吐(次/s)，即1e6 / meanLatency
+    double throughput = -1;
+    // 放置扫描等多上下文运行得到的最大吞吐(次/s)
+    double maxThroughput = -1;
+    // 模型加载和初始化的时间(ms)
+    double initTime = -1;
+    // 后端报告的模型占用的内存(MB)，例如RKNN的权重 + 中间结果
+    double memory = -1;
+    // 进程的峰值常驻内存(MB)
+    double peakRss = -1;
+    // 计时期间的平均功率(W)和每次推理的能耗(mJ)
+    double power = -1;
+    double energy = -1;
+};
+
+// 模型文件名去掉扩展名，OpenVINO的xml和其他后端的模型文件得到相同的名字
+std::string logical_model_name(const std::string &path)
+{
+    return std::filesystem::path(path).stem().string();
+}
+
+// 进程的峰值常驻内存(MB)，读取/proc/self/status中的VmHWM，不支持时返回-1
+double peak_rss_mb()
+{
+    std::ifstream file("/proc/self/status");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+        {
+            return std::atof(line.substr(6).c_str()) / 1024.0;
+        }
+    }
+    return -1;
+}
+
+// 设备名: 读取设备树中的板子型号(例如Rockchip RK3588 EVB)，读不到时使用fallback
+std::string device_model_name(const std::string &fallback)
+{
+    std::ifstream file("/proc/device-tree/model");
+    std::string model;
+    if (std::getline(file, model, '\0') && !model.empty())
+    {
+        return model;
+    }
+    return fallback;
+}
+
+// 由正式运行各轮的延迟填写延迟分位数和吞吐
+BenchmarkSummary summarize_benchmark(const std::string &model, const std::string &backend, const std::string &device, const std::vector<double> &durations)
+{
+    BenchmarkSummary summary;
+    summary.model = model;
+    summary.backend = backend;
+    summary.device = device;
+    summary.rounds = (int)durations.size();
+    if (!durations.empty())
+    {
+        summary.meanLatency = std::accumulate(durations.begin(), durations.end(), 0.0) / durations.size();
+        double sq_sum = std::inner_product(durations.begin(), durations.end(), durations.begin(), 0.0);
+        summary.stdLatency = std::sqrt(std::max(sq_sum / durations.size() - summary.meanLatency * summary.meanLatency, 0.0));
+        auto minmax = std::minmax_element(durations.begin(), durations.end());
+        summary.minLatency = *minmax.first;
+        summary.maxLatency = *minmax.second;
+        summary.p50Latency = latency_percentile(durations, 50);
+        summary.p90Latency = latency_percentile(durations, 90);
+        summary.p99Latency = latency_percentile(durations, 99);
+        summary.throughput = summary.meanLatency > 0 ? 1e6 / summary.meanLatency : -1;
+    }
+    summary.peakRss = peak_rss_mb();
+    return summary;
+}
+
+// 由平均功率(W)和平均延迟(us)得到每次推理的能耗(mJ)
+void set_summary_power(BenchmarkSummary &summary, double power)
+{
+    summary.power = power;
+    summary.energy = power >= 0 && summary.meanLatency >= 0 ? power * summary.meanLatency / 1000.0 : -1;
+}
+
+nlohmann::json summary_value(double value)
+{
+    return value >= 0 ? nlohmann::json(value) : nlohmann::json(nullptr);
+}
+
+double summary_number(const nlohmann::json &item, const std::string &key)
+{
+    return item.contains(key) && item[key].is_number() ? item[key].get<double>() : -1;
+}
+
+nlohmann::json benchmark_summary_json(const BenchmarkSummary &summary)
+{
+    nlohmann::json item;
+    item["SchemaVersion"] = BENCHMARK_SUMMARY_VERSION;
+    item["Model"] = summary.model;
+    item["ModelFile"] = summary.modelFile;
+    item["ModelHash"] = summary.modelHash;
+    item["Backend"] = summary.backend;
+    item["BackendVersion"] = summary.backendVersion;
+    item["Device"] = summary.device;
+    item["Rounds"] = summary.rounds;
+    item["Latency"] = {{"Mean", summary_value(summary.meanLatency)},
+                       {"Std", summary_value(summary.stdLatency)},
+                       {"Min", summary_value(summary.minLatency)},
+                       {"Max", summary_value(summary.maxLatency)},
+                       {"P50", summary_value(summary.p50Latency)},
+                       {"P90", summary_value(summary.p90Latency)},
+                       {"P99", summary_value(summary.p99Latency)}};
+    item["Throughput"] = summary_value(summary.throughput);
+    item["MaxThroughput"] = summary_value(summary.maxThroughput);
+    item["InitTime"] = summary_value(summary.initTime);
+    item["Memory"] = summary_value(summary.memory);
+    item["PeakRss"] = summary_value(summary.peakRss);
+    item["Power"] = summary_value(summary.power);
+    item["Energy"] = summary_value(summary.energy);
+    return item;
+}
+
+// 读取一个模型的结果: 有Summary时直接读取；旧版本的结果文件没有Summary，由MetaInfo和RuntimeResult尽量还原
+bool parse_benchmark_summary(const std::string &key, const nlohmann::json &result, BenchmarkSummary &summary)
+{
+    if (!result.is_object())
+        return false;
+    const nlohmann::json meta = result.value("MetaInfo", nlohmann::json::object());
+    const nlohmann::json runtime = result.value("RuntimeResult", nlohmann::json::object());
+    if (result.contains("Summary"))
+    {
+        const nlohmann::json &item = result["Summary"];
+        summary.model = item.value("Model", logical_model_name(key));
+        summary.modelFile = item.value("ModelFile", key);
+        summary.modelHash = item.value("ModelHash", "");
+        summary.backend = item.value("Backend", "");
+        summary.backendVersion = item.value("BackendVersion", "");
+        summary.device = item.value("Device", "");
+        summary.rounds = item.value("Rounds", 0);
+        const nlohmann::json latency = item.value("Latency", nlohmann::json::object());
+        summary.meanLatency = summary_number(latency, "Mean");
+        summary.stdLatency = summary_number(latency, "Std");
+        summary.minLatency = summary_number(latency, "Min");
+        summary.maxLatency = summary_number(latency, "Max");
+        summary.p50Latency = summary_number(latency, "P50");
+        summary.p90Latency = summary_number(latency, "P90");
+        summary.p99Latency = summary_number(latency, "P99");
+        summary.throughput = summary_number(item, "Throughput");
+        summary.maxThroughput = summary_number(item, "MaxThroughput");
+        summary.initTime = summary_number(item, "InitTime");
+        summary.memory = summary_number(item, "Memory");
+        summary.peakRss = summary_number(item, "PeakRss");
+        summary.power = summary_number(item, "Power");
+        summary.energy = summary_number(item, "Energy");
+    }
+    else if (!runtime.empty())
+    {
+        std::vector<double> durations;
+        for (const auto &round : runtime.value("MultiRoundsProfileResult", nlohmann::json::array()))
+        {
+            if (round.value("RoundIndex", -1) >= 0)
+                durations.push_back(round.value("TotalRoundLatency", 0.0));
+        }
+        summary = summarize_benchmark(logical_model_name(key), meta.value("BackendName", ""), meta.value("Device", ""), durations);
+        summary.peakRss = -1;
+        if (durations.empty())
+        {
+            summary.meanLatency = summary_number(runtime, "AvgTotalRoundLatency");
+            summary.stdLatency = summary_number(runtime, "StdTotalRoundLatency");
+            summary.minLatency = summary_number(runtime, "MinTotalRoundLatency");
+            summary.maxLatency = summary_number(runtime, "MaxTotalRoundLatency");
+            summary.throughput = summary.meanLatency > 0 ? 1e6 / summary.meanLatency : -1;
+            summary.rounds = runtime.value("Rounds", 0);
+        }
+        summary.modelFile = key;
+        summary.modelHash = meta.value("ModelHash", "");
+        summary.backendVersion = meta.value("BackendVersion", "");
+        summary.initTime = summary_number(runtime, "InitTime");
+        summary.memory = summary_number(runtime, "AvgPeakMemory");
+    }
+    else
+    {
+        return false;
+    }
+    // 放置扫描推荐的吞吐
+    if (summary.maxThroughput < 0 && result.contains("PlacementResult") && result["PlacementResult"].contains("RecommendedForThroughput"))
+    {
+        summary.maxThroughput = summary_number(result["PlacementResult"]["RecommendedForThroughput"], "Throughput");
+    }
+    return true;
+}
+
+// 结果文件为[{模型名: {...}}, ...]或{模型名: {...}}
+bool load_benchmark_summaries(const std::string &path, std::vector<BenchmarkSummary> &summaries)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Cannot open result file: " << path;
+        return false;
+    }
+    nlohmann::json root;
+    try
+    {
+        file >> root;
+    }
+    catch (const std::exception &ex)
+    {
+        LOG(ERROR) << "Invalid result file " << path << ": " << ex.what();
+        return false;
+    }
+    std::vector<nlohmann::json> entries;
+    if (root.is_array())
+        entries.assign(root.begin(), root.end());
+    else
+        entries.push_back(root);
+    for (const auto &entry : entries)
+    {
+        if (!entry.is_object())
+            continue;
+        for (const auto &item : entry.items())
+        {
+            BenchmarkSummary summary;
+            if (parse_benchmark_summary(item.key(), item.value(), summary))
+                summaries.push_back(summary);
+        }
+    }
+    return true;
+}
+
+// 对比矩阵中的一列，例如RKNN/Rockchip RK3588 EVB
+std::string summary_target(const BenchmarkSummary &summary)
+{
+    return summary.device.empty() ? summary.backend : summary.backend + "/" + summary.device;
+}
+
+// 按逻辑模型名分组，aliases把不同后端上的名字映射到同一个逻辑模型
+std::map<std::string, std::vector<BenchmarkSummary>> group_summaries(const std::vector<BenchmarkSummary> &summaries, const std::map<std::string, std::string> &aliases)
+{
+    std::map<std::string, std::vector<BenchmarkSummary>> groups;
+    for (auto summary : summaries)
+    {
+        auto alias = aliases.find(summary.model);
+        if (alias != aliases.end())
+            summary.model = alias->second;
+        groups[summary.model].push_back(summary);
+    }
+    return groups;
+}
+
+nlohmann::json summary_matrix_json(const std::map<std::string, std::vector<BenchmarkSummary>> &groups)
+{
+    nlohmann::json matrix;
+    matrix["SchemaVersion"] = BENCHMARK_SUMMARY_VERSION;
+    matrix["Models"] = nlohmann::json::object();
+    for (const auto &group : groups)
+    {
+        nlohmann::json targets = nlohmann::json::array();
+        for (const auto &summary : group.second)
+        {
+            nlohmann::json item = benchmark_summary_json(summary);
+            item["Target"] = summary_target(summary);
+            targets.push_back(item);
+        }
+        matrix["Models"][group.first] = targets;
+    }
+    return matrix;
+}
+
+std::string summary_csv_value(double value)
+{
+    return value >= 0 ? std::to_string(value) : "";
+}
+
+// 字符串字段统一加引号，内部的引号写两次
+std::string summary_csv_string(const std::string &value)
+{
+    std::string quoted = "\"";
+    for (char c : value)
+    {
+        quoted += c;
+        if (c == '"')
+        {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+// 每行一个(逻辑模型, 后端/设备)，没有的数据留空
+std::string summary_matrix_csv(const std::map<std::string, std::vector<BenchmarkSummary>> &groups)
+{
+    std::ostringstream csv;
+    csv << "model,backend,device,backend_version,model_file,rounds,mean_us,std_us,min_us,max_us,p50_us,p90_us,p99_us,"
+        << "throughput,max_throughput,init_ms,memory_mb,peak_rss_mb,power_w,energy_mj\n";
+    for (const auto &group : groups)
+    {
+        for (const auto &summary : group.second)
+        {
+            csv << summary_csv_string(group.first) << "," << summary_csv_string(summary.backend) << "," << summary_csv_string(summary.device) << ","
+                << summary_csv_string(summary.backendVersion) << "," << summary_csv_string(summary.modelFile) << ","
+                << summary.rounds << "," << summary_csv_value(summary.meanLatency) << "," << summary_csv_value(summary.stdLatency) << ","
+                << summary_csv_value(summary.minLatency) << "," << summary_csv_value(summary.maxLatency) << ","
+                << summary_csv_value(summary.p50Latency) << "," << summary_csv_value(summary.p90Latency) << "," << summary_csv_value(summary.p99Latency) << ","
+                << summary_csv_value(summary.throughput) << "," << summary_csv_value(summary.maxThroughput) << ","
+                << summary_csv_value(summary.initTime) << "," << summary_csv_value(summary.memory) << "," << summary_csv_value(summary.peakRss) << ","
+                << summary_csv_value(summary.power) << "," << summary_csv_value(summary.energy) << "\n";
+        }
+    }
+    return csv.str();
+}
+
+std::string summary_cell(double value)
+{
+    return value >= 0 ? std::to_string(value) : "-";
+}
+
+// 每个逻辑模型一张表(行为后端/设备)，最后是p50延迟的模型 x 后端矩阵
+void log_summary_matrix(const std::map<std::string, std::vector<BenchmarkSummary>> &groups)
+{
+    std::vector<std::string> targets;
+    for (const auto &group : groups)
+    {
+        tabulate::Table modelTable;
+        modelTable.add_row({"backend/device", "p50(us)", "p90(us)", "p99(us)", "throughput", "max throughput", "init(ms)", "memory(MB)", "peak rss(MB)", "power(W)", "energy(mJ)"});
+        for (const auto &summary : group.second)
+        {
+            modelTable.add_row({summary_target(summary),
+                                summary_cell(summary.p50Latency),
+                                summary_cell(summary.p90Latency),
+                                summary_cell(summary.p99Latency),
+                                summary_cell(summary.throughput),
+                                summary_cell(summary.maxThroughput),
+                                summary_cell(summary.initTime),
+                                summary_cell(summary.memory),
+                                summary_cell(summary.peakRss),
+                                summary_cell(summary.power),
+                                summary_cell(summary.energy)});
+            if (std::find(targets.begin(), targets.end(), summary_target(summary)) == targets.end())
+                targets.push_back(summary_target(summary));
+        }
+        for (size_t i = 0; i < 11; ++i)
+        {
+            modelTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+        }
+        LOG(INFO) << group.first << ":\n"
+                  << modelTable << "\n";
+    }
+    tabulate::Table matrixTable;
+    tabulate::Table::Row_t header = {"p50(us)"};
+    header.insert(header.end(), targets.begin(), targets.end());
+    matrixTable.add_row(header);
+    for (const auto &group : groups)
+    {
+        tabulate::Table::Row_t row = {group.first};
+        for (const auto &target : targets)
+        {
+            std::string cell = "-";
+            for (const auto &summary : group.second)
+            {
+                if (summary_target(summary) == target)
+                    cell = summary_cell(summary.p50Latency);
+            }
+            row.push_back(cell);
+        }
+        matrixTable.add_row(row);
+    }
+    for (size_t i = 0; i < header.size(); ++i)
+    {
+        matrixTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "Cross-backend matrix:\n"
+              << matrixTable << "\n";
+}
+
+#endif
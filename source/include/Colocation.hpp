@@ -0,0 +1,288 @@
+#ifndef COLOCATION_HPP
+#define COLOCATION_HPP
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+// 多模型共置: 多个模型按各自的目标速率同时在一个加速器上运行(例如检测 + 分类 + 跟踪)，
+// 比较每个模型单独运行和共置运行时的延迟分位数。
+// 场景文件为json:
+// {
+//     "duration_s": 10,
+//     "warmup_s": 1,
+//     "models": [
+//         {"name": "det", "model": "yolov5s.bin", "rate": 30, "priority": 200, "core": 0},
+//         {"name": "cls", "model": "resnet18.bin", "rate": 60, "priority": 100}
+//     ]
+// }
+// rate为每秒请求数，请求按固定周期到达(例如相机帧率)，0表示闭环连续运行；priority为0-255，越大越优先；
+// core为绑定的核心，-1或不写时由后端决定。优先级和核心如何映射到后端的控制参数由各个驱动决定。
+
+struct ScenarioModel
+{
+    std::string name;
+    std::string model;
+    double rate = 0;
+    int priority = 0;
+    int core = -1;
+    // OpenVINO的stream数，0为默认；大于1时每个stream一个推理请求，由各自的线程同时发出
+    int streams = 0;
+    // 原始的json，后端特有的字段从这里读取
+    nlohmann::json config;
+};
+
+struct Scenario
+{
+    double durationS = 10;
+    double warmupS = 1;
+    std::vector<ScenarioModel> models;
+};
+
+bool load_scenario(const std::string &path, Scenario &scenario)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Cannot open scenario file: " << path;
+        return false;
+    }
+    nlohmann::json root;
+    try
+    {
+        file >> root;
+        scenario.durationS = root.value("duration_s", 10.0);
+        scenario.warmupS = root.value("warmup_s", 1.0);
+        for (const auto &item : root.at("models"))
+        {
+            ScenarioModel model;
+            model.model = item.value("model", "");
+            model.name = item.value("name", model.model);
+            model.rate = item.value("rate", 0.0);
+            model.priority = std::min(std::max(item.value("priority", 0), 0), 255);
+            model.core = item.value("core", -1);
+            model.streams = item.value("streams", 0);
+            model.config = item;
+            scenario.models.push_back(model);
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        LOG(ERROR) << "Invalid scenario file " << path << ": " << ex.what();
+        return false;
+    }
+    return !scenario.models.empty() && scenario.durationS > 0;
+}
+
+// 一个模型在一次运行中的延迟分布(us)，延迟从计划到达时刻算起，跟不上目标速率时排队时间也计入
+struct ModelLatency
+{
+    // 测量窗口内完成的请求数，以及窗口内计划到达但没有在窗口内完成的请求数
+    uint64_t requests = 0;
+    uint64_t dropped = 0;
+    // 完成的请求数 / 测量窗口
+    double achievedRate = 0;
+    double avgLatency = 0;
+    double p50Latency = 0;
+    double p90Latency = 0;
+    double p99Latency = 0;
+    double maxLatency = 0;
+};
+
+// 同时运行active中的模型，sessions[i]中每个函数完成模型i的一次推理(设置输入、运行、取回输出)，每个函数一个线程；
+// 同一个模型的线程按顺序认领同一个到达序列中的请求，前一个请求还没完成时下一个请求可以由另一个线程发出
+std::vector<ModelLatency> run_scenario_models(const Scenario &scenario, const std::vector<std::vector<std::function<void()>>> &sessions, const std::vector<size_t> &active)
+{
+    using Clock = std::chrono::steady_clock;
+    struct ModelState
+    {
+        std::mutex mutex;
+        Clock::time_point arrival;
+        std::vector<double> latencies;
+        uint64_t dropped = 0;
+    };
+    std::vector<ModelLatency> results(scenario.models.size());
+    std::vector<ModelState> states(scenario.models.size());
+    std::vector<std::thread> threads;
+    // 所有线程从同一时刻开始，预热阶段的请求不计入结果
+    auto start = Clock::now() + std::chrono::milliseconds(10);
+    auto measureStart = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(scenario.warmupS));
+    auto end = measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(scenario.durationS));
+    for (size_t index : active)
+    {
+        double rate = scenario.models[index].rate;
+        states[index].arrival = start;
+        states[index].latencies.reserve(rate > 0 ? (size_t)(rate * scenario.durationS) + 1 : 1024);
+        for (size_t worker = 0; worker < sessions[index].size(); worker++)
+        {
+            threads.emplace_back([&, index, worker]()
+                                 {
+                const ScenarioModel &model = scenario.models[index];
+                TRACE_THREAD_NAME("scenario " + model.name + (worker > 0 ? " " + std::to_string(worker) : ""));
+                ModelState &state = states[index];
+                auto period = model.rate > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / model.rate)) : Clock::duration::zero();
+                std::this_thread::sleep_until(start);
+                // 按实际时间在end停止发出请求，跟不上速率时积压的到达不再补发；只统计在测量窗口内完成的请求
+                while (true)
+                {
+                    Clock::time_point arrival;
+                    {
+                        std::lock_guard<std::mutex> lock(state.mutex);
+                        if (state.arrival >= end || Clock::now() >= end)
+                        {
+                            break;
+                        }
+                        arrival = state.arrival;
+                        state.arrival += period;
+                    }
+                    if (model.rate > 0)
+                    {
+                        std::this_thread::sleep_until(arrival);
+                    }
+                    else
+                    {
+                        arrival = Clock::now();
+                    }
+                    {
+                        TRACE_SCOPE("request");
+                        sessions[index][worker]();
+                    }
+                    auto done = Clock::now();
+                    if (arrival >= measureStart)
+                    {
+                        std::lock_guard<std::mutex> lock(state.mutex);
+                        if (done <= end)
+                        {
+                            state.latencies.push_back(std::chrono::duration<double, std::micro>(done - arrival).count());
+                        }
+                        else
+                        {
+                            state.dropped++;
+                        }
+                    }
+                } });
+        }
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    for (size_t index : active)
+    {
+        const ScenarioModel &model = scenario.models[index];
+        ModelState &state = states[index];
+        // 没有来得及发出的计划到达
+        if (model.rate > 0)
+        {
+            auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / model.rate));
+            for (auto arrival = state.arrival; arrival < end; arrival += period)
+            {
+                state.dropped += arrival >= measureStart ? 1 : 0;
+            }
+        }
+        std::vector<double> &latencies = state.latencies;
+        ModelLatency &result = results[index];
+        result.requests = latencies.size();
+        result.dropped = state.dropped;
+        result.achievedRate = latencies.size() / std::chrono::duration<double>(end - measureStart).count();
+        if (!latencies.empty())
+        {
+            result.avgLatency = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+            result.p50Latency = latency_percentile(latencies, 50);
+            result.p90Latency = latency_percentile(latencies, 90);
+            result.p99Latency = latency_percentile(latencies, 99);
+            result.maxLatency = *std::max_element(latencies.begin(), latencies.end());
+        }
+    }
+    return results;
+}
+
+nlohmann::json model_latency_json(const ModelLatency &latency)
+{
+    nlohmann::json result;
+    result["Requests"] = latency.requests;
+    result["Dropped"] = latency.dropped;
+    result["AchievedRate"] = latency.achievedRate;
+    result["AvgLatency"] = latency.avgLatency;
+    result["P50Latency"] = latency.p50Latency;
+    result["P90Latency"] = latency.p90Latency;
+    result["P99Latency"] = latency.p99Latency;
+    result["MaxLatency"] = latency.maxLatency;
+    return result;
+}
+
+// 先逐个单独运行每个模型，再同时运行全部模型，返回每个模型两种情况下的延迟分位数；
+// sessions[i]为模型i的一个或多个推理函数，多个时同时发出多个请求(例如OpenVINO每个stream一个推理请求)
+nlohmann::json run_colocation(const Scenario &scenario, const std::vector<std::vector<std::function<void()>>> &sessions)
+{
+    std::vector<ModelLatency> isolation(scenario.models.size());
+    for (size_t index = 0; index < scenario.models.size(); index++)
+    {
+        LOG(INFO) << "Isolation: " << scenario.models[index].name;
+        isolation[index] = run_scenario_models(scenario, sessions, {index})[index];
+    }
+    LOG(INFO) << "Contention: " << scenario.models.size() << " models";
+    std::vector<size_t> all(scenario.models.size());
+    std::iota(all.begin(), all.end(), 0);
+    std::vector<ModelLatency> contention = run_scenario_models(scenario, sessions, all);
+
+    nlohmann::json result;
+    result["DurationS"] = scenario.durationS;
+    result["WarmupS"] = scenario.warmupS;
+    tabulate::Table colocationTable;
+    colocationTable.add_row({"model", "priority", "rate", "iso p50(us)", "iso p99(us)", "co p50(us)", "co p99(us)", "p99 slowdown", "co rate"});
+    for (size_t index = 0; index < scenario.models.size(); index++)
+    {
+        const ScenarioModel &model = scenario.models[index];
+        double slowdown = isolation[index].p99Latency > 0 ? contention[index].p99Latency / isolation[index].p99Latency : 0;
+        nlohmann::json item;
+        item["Name"] = model.name;
+        item["Model"] = model.model;
+        item["Rate"] = model.rate;
+        item["Priority"] = model.priority;
+        item["Core"] = model.core;
+        item["Isolation"] = model_latency_json(isolation[index]);
+        item["Contention"] = model_latency_json(contention[index]);
+        item["P99Slowdown"] = slowdown;
+        result["Models"].push_back(item);
+        colocationTable.add_row({model.name,
+                                 std::to_string(model.priority),
+                                 std::to_string(model.rate),
+                                 std::to_string(isolation[index].p50Latency),
+                                 std::to_string(isolation[index].p99Latency),
+                                 std::to_string(contention[index].p50Latency),
+                                 std::to_string(contention[index].p99Latency),
+                                 std::to_string(slowdown),
+                                 std::to_string(contention[index].achievedRate)});
+    }
+    for (size_t i = 0; i < 9; ++i)
+    {
+        colocationTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "\n"
+              << colocationTable << "\n";
+    return result;
+}
+
+// 每个模型一个推理函数
+nlohmann::json run_colocation(const Scenario &scenario, const std::vector<std::function<void()>> &sessions)
+{
+    std::vector<std::vector<std::function<void()>>> workers;
+    for (const auto &session : sessions)
+    {
+        workers.push_back({session});
+    }
+    return run_colocation(scenario, workers);
+}
+
+#endif
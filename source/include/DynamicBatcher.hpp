@@ -0,0 +1,448 @@
+#ifndef DYNAMIC_BATCHER_HPP
+#define DYNAMIC_BATCHER_HPP
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "LoadGenerator.hpp"
+#include "TensorPool.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+// 动态批处理: 把负载发生器产生的请求攒成批次送给按batch维编译的模型。
+// 一个批次在达到maxBatch或最早的请求等待超过maxDelayUs时关闭。
+// 请求的输入直接写进批次输入张量中属于它的位置(reserve得到的slot)，打包不需要额外拷贝；
+// 批次运行后输出按batch维切开，拷回每个请求自己的输出缓冲区。
+// 批次缓冲区可以由后端提供(例如BPU的hbSysMem)，这时请求直接写进设备内存，runner不需要再拷贝批次。
+// 模型的batch维固定时，不满的批次同样按maxBatch运行，空位保留上一次的数据。
+
+struct BatcherConfig
+{
+    int maxBatch = 8;
+    double maxDelayUs = 1000;
+    // 每个输入/输出张量单个样本的字节数，批次张量按batch维排布，第i个样本位于i * sampleBytes
+    std::vector<size_t> inputSampleBytes;
+    std::vector<size_t> outputSampleBytes;
+    // 同时在运行或等待运行的批次数，另有一个批次用于接收新请求
+    int inflightBatches = 2;
+    // 后端提供的批次缓冲区，每个批次组(共inflightBatches + 1组)按张量顺序一组，每个至少sampleBytes * maxBatch字节；为空时由批处理器分配
+    std::vector<std::vector<uint8_t *>> inputBuffers;
+    std::vector<std::vector<uint8_t *>> outputBuffers;
+};
+
+// 运行一个批次，inputs/outputs为每个张量的批次缓冲区，前batch个样本有效
+using BatchRunner = std::function<void(const std::vector<uint8_t *> &inputs, int batch, const std::vector<uint8_t *> &outputs)>;
+
+struct BatchSlot
+{
+    int group = -1;
+    int index = -1;
+};
+
+struct BatcherStatistics
+{
+    uint64_t requests = 0;
+    uint64_t batches = 0;
+    // submit()打包时的拷贝次数，直接写入slot的请求不计
+    uint64_t packCopies = 0;
+    // 每个请求从到达到输出拷回的延迟，以及从到达到所在批次开始运行的排队延迟(us)
+    std::vector<double> latencies;
+    std::vector<double> queueDelays;
+    std::vector<int> batchSizes;
+    std::chrono::steady_clock::time_point firstArrival;
+    std::chrono::steady_clock::time_point lastCompletion;
+};
+
+class DynamicBatcher
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    DynamicBatcher(const BatcherConfig &config, BatchRunner runner)
+        : config_(config), runner_(std::move(runner)), groups_(config.inflightBatches + 1)
+    {
+        CHECK(config_.inputBuffers.empty() || config_.inputBuffers.size() == groups_.size()) << "inputBuffers needs one set per batch group";
+        CHECK(config_.outputBuffers.empty() || config_.outputBuffers.size() == groups_.size()) << "outputBuffers needs one set per batch group";
+        for (size_t index = 0; index < groups_.size(); index++)
+        {
+            BatchGroup &group = groups_[index];
+            if (!config_.inputBuffers.empty())
+            {
+                group.inputPointers = config_.inputBuffers[index];
+            }
+            else
+            {
+                for (size_t bytes : config_.inputSampleBytes)
+                {
+                    group.inputs.emplace_back(bytes * config_.maxBatch, PAGE_SIZE_4K);
+                    group.inputPointers.push_back((uint8_t *)group.inputs.back().data());
+                }
+            }
+            if (!config_.outputBuffers.empty())
+            {
+                group.outputPointers = config_.outputBuffers[index];
+            }
+            else
+            {
+                for (size_t bytes : config_.outputSampleBytes)
+                {
+                    group.outputs.emplace_back(bytes * config_.maxBatch, PAGE_SIZE_4K);
+                    group.outputPointers.push_back((uint8_t *)group.outputs.back().data());
+                }
+            }
+            group.requestOutputs.resize(config_.maxBatch);
+            group.arrivals.resize(config_.maxBatch);
+        }
+        requestOutputBytes_ = std::accumulate(config_.outputSampleBytes.begin(), config_.outputSampleBytes.end(), (size_t)0);
+        groups_[0].state = BatchGroup::Filling;
+        worker_ = std::thread(&DynamicBatcher::dispatch_loop, this);
+    }
+
+    DynamicBatcher(const DynamicBatcher &) = delete;
+    DynamicBatcher &operator=(const DynamicBatcher &) = delete;
+
+    ~DynamicBatcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    // 为一个在arrival时刻到达的请求分配批次中的位置；所有批次都在运行时阻塞，排队时间计入请求延迟
+    BatchSlot reserve(Clock::time_point arrival)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]
+                 { return groups_[filling_].state == BatchGroup::Filling; });
+        BatchGroup &group = groups_[filling_];
+        BatchSlot slot{filling_, group.reserved++};
+        if (slot.index == 0)
+        {
+            group.opened = Clock::now();
+        }
+        if (statistics_.requests++ == 0)
+        {
+            statistics_.firstArrival = arrival;
+        }
+        group.arrivals[slot.index] = arrival;
+        if (group.reserved == config_.maxBatch)
+        {
+            close_filling();
+        }
+        cv_.notify_all();
+        return slot;
+    }
+
+    // slot中第tensor个输入的位置，请求在commit之前把输入写到这里
+    uint8_t *slot_input(const BatchSlot &slot, size_t tensor) const
+    {
+        return groups_[slot.group].inputPointers[tensor] + slot.index * config_.inputSampleBytes[tensor];
+    }
+
+    // 输入写完，output按顺序存放各输出张量的一个样本，共request_output_bytes()字节，为空时不拷回
+    void commit(const BatchSlot &slot, void *output)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        BatchGroup &group = groups_[slot.group];
+        group.requestOutputs[slot.index] = (uint8_t *)output;
+        group.committed++;
+        cv_.notify_all();
+    }
+
+    // 输入不在slot中时使用，打包需要一次拷贝
+    void submit(const std::vector<const void *> &inputs, void *output, Clock::time_point arrival)
+    {
+        BatchSlot slot = reserve(arrival);
+        for (size_t tensor = 0; tensor < inputs.size(); tensor++)
+        {
+            memcpy(slot_input(slot, tensor), inputs[tensor], config_.inputSampleBytes[tensor]);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            statistics_.packCopies++;
+        }
+        commit(slot, output);
+    }
+
+    size_t request_output_bytes() const
+    {
+        return requestOutputBytes_;
+    }
+
+    // 等待所有已提交的请求完成
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]
+                 { return completed_ == statistics_.requests; });
+    }
+
+    BatcherStatistics statistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statistics_;
+    }
+
+private:
+    struct BatchGroup
+    {
+        enum State
+        {
+            Free,
+            Filling,
+            Closed,
+            Running
+        } state = Free;
+        std::vector<HostTensor> inputs;
+        std::vector<HostTensor> outputs;
+        std::vector<uint8_t *> inputPointers;
+        std::vector<uint8_t *> outputPointers;
+        std::vector<uint8_t *> requestOutputs;
+        std::vector<Clock::time_point> arrivals;
+        Clock::time_point opened;
+        int reserved = 0;
+        int committed = 0;
+    };
+
+    // 调用者持有mutex_
+    void close_filling()
+    {
+        groups_[filling_].state = BatchGroup::Closed;
+        ready_.push_back(filling_);
+        filling_ = (filling_ + 1) % groups_.size();
+        open_filling();
+    }
+
+    void open_filling()
+    {
+        BatchGroup &group = groups_[filling_];
+        if (group.state == BatchGroup::Free)
+        {
+            group.state = BatchGroup::Filling;
+            group.reserved = 0;
+            group.committed = 0;
+        }
+    }
+
+    void dispatch_loop()
+    {
+        TRACE_THREAD_NAME("batcher dispatch");
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            if (!ready_.empty() && groups_[ready_.front()].committed == groups_[ready_.front()].reserved)
+            {
+                int index = ready_.front();
+                ready_.pop_front();
+                BatchGroup &group = groups_[index];
+                group.state = BatchGroup::Running;
+                lock.unlock();
+                run_group(group);
+                lock.lock();
+                completed_ += group.reserved;
+                group.state = BatchGroup::Free;
+                open_filling();
+                cv_.notify_all();
+                continue;
+            }
+            BatchGroup &filling = groups_[filling_];
+            if (filling.state == BatchGroup::Filling && filling.reserved > 0)
+            {
+                auto deadline = filling.opened + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::micro>(config_.maxDelayUs));
+                if (stopping_ || Clock::now() >= deadline)
+                {
+                    close_filling();
+                    continue;
+                }
+                cv_.wait_until(lock, deadline);
+                continue;
+            }
+            if (stopping_ && ready_.empty())
+            {
+                break;
+            }
+            cv_.wait(lock);
+        }
+    }
+
+    void run_group(BatchGroup &group)
+    {
+        auto start = Clock::now();
+        TRACE_BEGIN("batch run");
+        runner_(group.inputPointers, group.reserved, group.outputPointers);
+        TRACE_END("batch run");
+        TRACE_BEGIN("batch scatter");
+        // 按batch维切开输出，拷回各请求的输出缓冲区
+        for (int index = 0; index < group.reserved; index++)
+        {
+            uint8_t *dst = group.requestOutputs[index];
+            if (dst == nullptr)
+            {
+                continue;
+            }
+            for (size_t tensor = 0; tensor < group.outputPointers.size(); tensor++)
+            {
+                size_t bytes = config_.outputSampleBytes[tensor];
+                memcpy(dst, group.outputPointers[tensor] + index * bytes, bytes);
+                dst += bytes;
+            }
+        }
+        TRACE_END("batch scatter");
+        auto end = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_.batches++;
+        statistics_.batchSizes.push_back(group.reserved);
+        for (int index = 0; index < group.reserved; index++)
+        {
+            statistics_.latencies.push_back(std::chrono::duration<double, std::micro>(end - group.arrivals[index]).count());
+            statistics_.queueDelays.push_back(std::chrono::duration<double, std::micro>(start - group.arrivals[index]).count());
+        }
+        statistics_.lastCompletion = end;
+    }
+
+    BatcherConfig config_;
+    BatchRunner runner_;
+    std::vector<BatchGroup> groups_;
+    size_t requestOutputBytes_ = 0;
+    int filling_ = 0;
+    std::deque<int> ready_;
+    uint64_t completed_ = 0;
+    bool stopping_ = false;
+    BatcherStatistics statistics_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+};
+
+// 一个max_delay_us设置下的测量结果，对应延迟/吞吐曲线上的一个点
+struct BatchingPoint
+{
+    int maxBatch;
+    double maxDelayUs;
+    uint64_t requests;
+    uint64_t batches;
+    double avgBatchSize;
+    double throughput;
+    double avgLatency;
+    double p50Latency;
+    double p90Latency;
+    double p99Latency;
+    double avgQueueDelay;
+};
+
+// 用开环负载驱动一个批处理器，samples为每个输入张量的一个样本，请求直接把样本写进slot
+BatchingPoint run_batching_load(const BatcherConfig &config, const BatchRunner &runner, const LoadConfig &load, const std::vector<const void *> &samples)
+{
+    DynamicBatcher batcher(config, runner);
+    // 输出缓冲区循环使用，只用于承接拷回的数据
+    std::vector<uint8_t> outputs(std::max(batcher.request_output_bytes(), (size_t)1) * config.maxBatch * (config.inflightBatches + 1));
+    run_open_loop(load, [&](int request, DynamicBatcher::Clock::time_point arrival)
+                  {
+        BatchSlot slot = batcher.reserve(arrival);
+        for (size_t tensor = 0; tensor < samples.size(); tensor++)
+        {
+            memcpy(batcher.slot_input(slot, tensor), samples[tensor], config.inputSampleBytes[tensor]);
+        }
+        size_t outputSlot = request % (config.maxBatch * (config.inflightBatches + 1));
+        batcher.commit(slot, outputs.data() + outputSlot * batcher.request_output_bytes());
+        return true; });
+    batcher.drain();
+    BatcherStatistics stats = batcher.statistics();
+
+    BatchingPoint point;
+    point.maxBatch = config.maxBatch;
+    point.maxDelayUs = config.maxDelayUs;
+    point.requests = stats.requests;
+    point.batches = stats.batches;
+    point.avgBatchSize = stats.batches == 0 ? 0 : (double)stats.requests / stats.batches;
+    double elapsedUs = std::chrono::duration<double, std::micro>(stats.lastCompletion - stats.firstArrival).count();
+    point.throughput = elapsedUs > 0 ? stats.requests / elapsedUs * 1e6 : 0;
+    point.avgLatency = stats.latencies.empty() ? 0 : std::accumulate(stats.latencies.begin(), stats.latencies.end(), 0.0) / stats.latencies.size();
+    point.p50Latency = latency_percentile(stats.latencies, 50);
+    point.p90Latency = latency_percentile(stats.latencies, 90);
+    point.p99Latency = latency_percentile(stats.latencies, 99);
+    point.avgQueueDelay = stats.queueDelays.empty() ? 0 : std::accumulate(stats.queueDelays.begin(), stats.queueDelays.end(), 0.0) / stats.queueDelays.size();
+    return point;
+}
+
+nlohmann::json batching_point_json(const BatchingPoint &point)
+{
+    nlohmann::json result;
+    result["MaxBatch"] = point.maxBatch;
+    result["MaxDelayUs"] = point.maxDelayUs;
+    result["Requests"] = point.requests;
+    result["Batches"] = point.batches;
+    result["AvgBatchSize"] = point.avgBatchSize;
+    result["Throughput"] = point.throughput;
+    result["AvgLatency"] = point.avgLatency;
+    result["P50Latency"] = point.p50Latency;
+    result["P90Latency"] = point.p90Latency;
+    result["P99Latency"] = point.p99Latency;
+    result["AvgQueueDelay"] = point.avgQueueDelay;
+    return result;
+}
+
+// 解析逗号分隔的max_delay_us列表
+bool parse_delay_list(const std::string &text, std::vector<double> &delays)
+{
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+        char *end = nullptr;
+        double delay = strtod(item.c_str(), &end);
+        if (end == item.c_str() || *end != '\0' || !std::isfinite(delay) || delay < 0)
+        {
+            LOG(ERROR) << "Expected a comma separated list of non-negative delays in us, got " << text;
+            return false;
+        }
+        delays.push_back(delay);
+    }
+    return !delays.empty();
+}
+
+void log_batching_curve(const std::vector<BatchingPoint> &points)
+{
+    tabulate::Table curveTable;
+    curveTable.add_row({"max_batch", "max_delay(us)", "avg_batch", "throughput(req/s)", "avg(us)", "p50(us)", "p99(us)", "queue(us)"});
+    for (const auto &point : points)
+    {
+        curveTable.add_row({std::to_string(point.maxBatch),
+                            std::to_string(point.maxDelayUs),
+                            std::to_string(point.avgBatchSize),
+                            std::to_string(point.throughput),
+                            std::to_string(point.avgLatency),
+                            std::to_string(point.p50Latency),
+                            std::to_string(point.p99Latency),
+                            std::to_string(point.avgQueueDelay)});
+    }
+    for (size_t i = 0; i < 8; ++i)
+    {
+        curveTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "\n"
+              << curveTable << "\n";
+}
+
+#endif
@@ -1,21 +1,32 @@
 #ifndef HELPER_H
 #define HELPER_H
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
 #include <vector>
 #include <string>
-std::vector<std::filesystem::path> glob_files(std::string directoryPath, std::string pattern)
+// 模型文件内容的FNV-1a 64位哈希，多个文件(例如OpenVINO的.xml和.bin)把上一个的结果作为hash传入；
+// 写在结果的MetaInfo.ModelHash中，比较结果时用来判断模型文件是否变化
+uint64_t model_file_hash(const std::string &path, uint64_t hash = 14695981039346656037ULL)
 {
-    // 存储找到的文件名
-    std::vector<std::filesystem::path> foundFiles;
-    // 遍历目录
-    for (const auto &entry : std::filesystem::recursive_directory_iterator(directoryPath))
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
     {
-        if (entry.is_regular_file() && entry.path().extension() == pattern)
+        for (std::streamsize i = 0; i < file.gcount(); i++)
         {
-            foundFiles.push_back(entry.path());
+            hash = (hash ^ (uint8_t)buffer[i]) * 1099511628211ULL;
         }
     }
-    return foundFiles;
+    return hash;
+}
+
+std::string model_hash_string(uint64_t hash)
+{
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+    return text;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,636 @@
+#ifndef IMAGE_PROCESS_HPP
+#define IMAGE_PROCESS_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Preprocess.hpp"
+
+// 图像输入的前处理kernel: NV12<->RGB/BGR颜色空间转换与bilinear缩放/裁剪。
+// 与Preprocess.hpp一样，每个kernel都有标量参考实现(*_ref)，不带后缀的版本在运行时分派到AVX2或NEON，结果逐位一致。
+// 所有kernel都显式接收每行的字节跨度(stride)，可以直接写入模型输入按alignedShape对齐后的缓冲区。
+//
+// 颜色空间采用BT.601 limited range，定点系数:
+//   Y' = ((Y - 16) * 128 * 38152) >> 16 (约为74.52 * (Y - 16)，即1.164的6位定点)
+//   R = (Y' + 102 * (V - 128) + 32) >> 6
+//   G = (Y' -  25 * (U - 128) - 52 * (V - 128) + 32) >> 6
+//   B = (Y' + 129 * (U - 128) + 32) >> 6
+//   Y = ((66 * R + 129 * G + 25 * B + 128) >> 8) + 16
+//   U = ((-38 * R - 74 * G + 112 * B + 128) >> 8) + 128，V = ((112 * R - 94 * G - 18 * B + 128) >> 8) + 128，R/G/B取2x2块的均值
+
+// 亮度系数1.164 * 64 * 512，与左移7位的(Y - 16)相乘后取高16位
+#define YUV_Y_COEF 38152
+
+// bilinear插值系数的定点位数，水平与垂直各11位，垂直方向合并后右移22位
+#define RESIZE_COEF_BITS 11
+#define RESIZE_COEF_ONE (1 << RESIZE_COEF_BITS)
+
+// 裁剪区域，width或height为0表示整幅图像
+struct ImageRect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+inline uint8_t clamp_u8(int value)
+{
+    return (uint8_t)std::min(std::max(value, 0), 255);
+}
+
+/************************************ NV12 -> RGB/BGR ************************************/
+
+inline void yuv_to_rgb_pixel(int y, int u, int v, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+    int yv = (int)(((uint32_t)std::max(y - 16, 0) * 128 * YUV_Y_COEF) >> 16);
+    u -= 128;
+    v -= 128;
+    r = clamp_u8((yv + 102 * v + 32) >> 6);
+    g = clamp_u8((yv - 25 * u - 52 * v + 32) >> 6);
+    b = clamp_u8((yv + 129 * u + 32) >> 6);
+}
+
+void nv12_to_rgb_row_ref(const uint8_t *y, const uint8_t *uv, uint8_t *dst, int begin, int width, bool bgr)
+{
+    for (int x = begin; x < width; x++)
+    {
+        uint8_t r, g, b;
+        yuv_to_rgb_pixel(y[x], uv[x & ~1], uv[(x & ~1) + 1], r, g, b);
+        dst[3 * x + 0] = bgr ? b : r;
+        dst[3 * x + 1] = g;
+        dst[3 * x + 2] = bgr ? r : b;
+    }
+}
+
+// width x height的NV12图像(Y平面+交错的UV平面)转换为打包的RGB或BGR
+void nv12_to_rgb_ref(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride, int width, int height,
+                     uint8_t *dst, int dstStride, bool bgr)
+{
+    for (int row = 0; row < height; row++)
+    {
+        nv12_to_rgb_row_ref(y + row * yStride, uv + (row / 2) * uvStride, dst + row * dstStride, 0, width, bgr);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 16个像素，三个平面按masks打包成48字节
+PREPROCESS_TARGET_AVX2 static inline void store_rgb16_sse(uint8_t *dst, __m128i p0, __m128i p1, __m128i p2)
+{
+    static const Interleave3Masks masks;
+    for (int k = 0; k < 3; k++)
+    {
+        __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(p0, _mm_loadu_si128((const __m128i *)masks.interleave[k][0])),
+                                              _mm_shuffle_epi8(p1, _mm_loadu_si128((const __m128i *)masks.interleave[k][1]))),
+                                 _mm_shuffle_epi8(p2, _mm_loadu_si128((const __m128i *)masks.interleave[k][2])));
+        _mm_storeu_si128((__m128i *)(dst + 16 * k), v);
+    }
+}
+
+PREPROCESS_TARGET_AVX2 static inline void load_rgb16_sse(const uint8_t *src, __m128i &p0, __m128i &p1, __m128i &p2)
+{
+    static const Interleave3Masks masks;
+    __m128i a = _mm_loadu_si128((const __m128i *)src);
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+    __m128i *planes[3] = {&p0, &p1, &p2};
+    for (int ch = 0; ch < 3; ch++)
+    {
+        *planes[ch] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, _mm_loadu_si128((const __m128i *)masks.deinterleave[ch][0])),
+                                                _mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i *)masks.deinterleave[ch][1]))),
+                                   _mm_shuffle_epi8(c, _mm_loadu_si128((const __m128i *)masks.deinterleave[ch][2])));
+    }
+}
+
+PREPROCESS_TARGET_AVX2 static inline __m128i pack_u8_avx2(__m256i value)
+{
+    return _mm_packus_epi16(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+}
+
+PREPROCESS_TARGET_AVX2 void nv12_to_rgb_row_avx2(const uint8_t *y, const uint8_t *uv, uint8_t *dst, int width, bool bgr)
+{
+    const __m256i c16 = _mm256_set1_epi16(16);
+    const __m256i c128 = _mm256_set1_epi16(128);
+    const __m256i c32 = _mm256_set1_epi16(32);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i uDup = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+    const __m128i vDup = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i uvBytes = _mm_loadu_si128((const __m128i *)(uv + x));
+        __m256i yv = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(y + x)));
+        yv = _mm256_slli_epi16(_mm256_max_epi16(_mm256_sub_epi16(yv, c16), zero), 7);
+        yv = _mm256_mulhi_epu16(yv, _mm256_set1_epi16((short)YUV_Y_COEF));
+        __m256i u = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(uvBytes, uDup)), c128);
+        __m256i v = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_shuffle_epi8(uvBytes, vDup)), c128);
+        // 饱和加减只会在结果超出[0, 255]时发生，右移后再饱和打包与标量的clamp一致
+        __m256i r = _mm256_adds_epi16(_mm256_adds_epi16(yv, _mm256_mullo_epi16(v, _mm256_set1_epi16(102))), c32);
+        __m256i g = _mm256_subs_epi16(_mm256_subs_epi16(yv, _mm256_mullo_epi16(u, _mm256_set1_epi16(25))), _mm256_mullo_epi16(v, _mm256_set1_epi16(52)));
+        g = _mm256_adds_epi16(g, c32);
+        __m256i b = _mm256_adds_epi16(_mm256_adds_epi16(yv, _mm256_mullo_epi16(u, _mm256_set1_epi16(129))), c32);
+        __m128i r8 = pack_u8_avx2(_mm256_srai_epi16(r, 6));
+        __m128i g8 = pack_u8_avx2(_mm256_srai_epi16(g, 6));
+        __m128i b8 = pack_u8_avx2(_mm256_srai_epi16(b, 6));
+        if (bgr)
+        {
+            store_rgb16_sse(dst + 3 * x, b8, g8, r8);
+        }
+        else
+        {
+            store_rgb16_sse(dst + 3 * x, r8, g8, b8);
+        }
+    }
+    nv12_to_rgb_row_ref(y, uv, dst, x, width, bgr);
+}
+#elif defined(__aarch64__)
+static inline uint8x8_t yuv_to_channel_neon(int16x8_t value)
+{
+    return vqmovun_s16(vshrq_n_s16(vqaddq_s16(value, vdupq_n_s16(32)), 6));
+}
+
+void nv12_to_rgb_row_neon(const uint8_t *y, const uint8_t *uv, uint8_t *dst, int width, bool bgr)
+{
+    const int16x8_t c16 = vdupq_n_s16(16);
+    const int16x8_t c128 = vdupq_n_s16(128);
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t yBytes = vld1q_u8(y + x);
+        uint8x8x2_t uvBytes = vld2_u8(uv + x);
+        // 每个U/V复制给水平相邻的两个像素
+        uint8x8x2_t uDup = vzip_u8(uvBytes.val[0], uvBytes.val[0]);
+        uint8x8x2_t vDup = vzip_u8(uvBytes.val[1], uvBytes.val[1]);
+        uint8x8x3_t rgb[2];
+        for (int half = 0; half < 2; half++)
+        {
+            uint8x8_t yHalf = half == 0 ? vget_low_u8(yBytes) : vget_high_u8(yBytes);
+            int16x8_t yd = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yHalf)), c16);
+            uint16x8_t ys = vshlq_n_u16(vreinterpretq_u16_s16(vmaxq_s16(yd, vdupq_n_s16(0))), 7);
+            int16x8_t yv = vreinterpretq_s16_u16(vcombine_u16(vshrn_n_u32(vmull_n_u16(vget_low_u16(ys), YUV_Y_COEF), 16),
+                                                              vshrn_n_u32(vmull_n_u16(vget_high_u16(ys), YUV_Y_COEF), 16)));
+            int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uDup.val[half])), c128);
+            int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vDup.val[half])), c128);
+            uint8x8_t r = yuv_to_channel_neon(vqaddq_s16(yv, vmulq_n_s16(v, 102)));
+            uint8x8_t g = yuv_to_channel_neon(vqsubq_s16(vqsubq_s16(yv, vmulq_n_s16(u, 25)), vmulq_n_s16(v, 52)));
+            uint8x8_t b = yuv_to_channel_neon(vqaddq_s16(yv, vmulq_n_s16(u, 129)));
+            rgb[half].val[0] = bgr ? b : r;
+            rgb[half].val[1] = g;
+            rgb[half].val[2] = bgr ? r : b;
+        }
+        uint8x16x3_t out;
+        out.val[0] = vcombine_u8(rgb[0].val[0], rgb[1].val[0]);
+        out.val[1] = vcombine_u8(rgb[0].val[1], rgb[1].val[1]);
+        out.val[2] = vcombine_u8(rgb[0].val[2], rgb[1].val[2]);
+        vst3q_u8(dst + 3 * x, out);
+    }
+    nv12_to_rgb_row_ref(y, uv, dst, x, width, bgr);
+}
+#endif
+
+void nv12_to_rgb(const uint8_t *y, int yStride, const uint8_t *uv, int uvStride, int width, int height,
+                 uint8_t *dst, int dstStride, bool bgr)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        for (int row = 0; row < height; row++)
+        {
+            nv12_to_rgb_row_avx2(y + row * yStride, uv + (row / 2) * uvStride, dst + row * dstStride, width, bgr);
+        }
+        return;
+    }
+#elif defined(__aarch64__)
+    for (int row = 0; row < height; row++)
+    {
+        nv12_to_rgb_row_neon(y + row * yStride, uv + (row / 2) * uvStride, dst + row * dstStride, width, bgr);
+    }
+    return;
+#endif
+    nv12_to_rgb_ref(y, yStride, uv, uvStride, width, height, dst, dstStride, bgr);
+}
+
+/************************************ RGB/BGR -> NV12 ************************************/
+
+inline uint8_t rgb_to_y(int r, int g, int b)
+{
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+// 处理一对行中[begin, width)的像素，width为偶数
+void rgb_to_nv12_rows_ref(const uint8_t *rgb0, const uint8_t *rgb1, uint8_t *y0, uint8_t *y1, uint8_t *uv, int begin, int width, bool bgr)
+{
+    int ri = bgr ? 2 : 0;
+    int bi = bgr ? 0 : 2;
+    for (int x = begin; x < width; x += 2)
+    {
+        const uint8_t *p00 = rgb0 + 3 * x, *p01 = rgb0 + 3 * x + 3;
+        const uint8_t *p10 = rgb1 + 3 * x, *p11 = rgb1 + 3 * x + 3;
+        y0[x] = rgb_to_y(p00[ri], p00[1], p00[bi]);
+        y0[x + 1] = rgb_to_y(p01[ri], p01[1], p01[bi]);
+        y1[x] = rgb_to_y(p10[ri], p10[1], p10[bi]);
+        y1[x + 1] = rgb_to_y(p11[ri], p11[1], p11[bi]);
+        int r = (p00[ri] + p01[ri] + p10[ri] + p11[ri] + 2) >> 2;
+        int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+        int b = (p00[bi] + p01[bi] + p10[bi] + p11[bi] + 2) >> 2;
+        uv[x] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        uv[x + 1] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+// 打包的RGB或BGR转换为NV12，width和height需为偶数
+void rgb_to_nv12_ref(const uint8_t *rgb, int rgbStride, int width, int height,
+                     uint8_t *y, int yStride, uint8_t *uv, int uvStride, bool bgr)
+{
+    for (int row = 0; row + 1 < height; row += 2)
+    {
+        rgb_to_nv12_rows_ref(rgb + row * rgbStride, rgb + (row + 1) * rgbStride, y + row * yStride, y + (row + 1) * yStride,
+                             uv + (row / 2) * uvStride, 0, width, bgr);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+PREPROCESS_TARGET_AVX2 static inline __m128i rgb_to_y16_avx2(__m128i r, __m128i g, __m128i b)
+{
+    // 66 * 255 + 129 * 255 + 25 * 255 + 128 < 65536，按无符号16位计算不会溢出
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_cvtepu8_epi16(r), _mm256_set1_epi16(66)),
+                                   _mm256_mullo_epi16(_mm256_cvtepu8_epi16(g), _mm256_set1_epi16(129)));
+    sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(b), _mm256_set1_epi16(25)));
+    sum = _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(128)), 8);
+    return pack_u8_avx2(_mm256_add_epi16(sum, _mm256_set1_epi16(16)));
+}
+
+// 两行中水平相邻的两个像素求和再平均，得到8个2x2块的均值
+PREPROCESS_TARGET_AVX2 static inline __m128i average_2x2_sse(__m128i row0, __m128i row1)
+{
+    const __m128i ones = _mm_set1_epi8(1);
+    __m128i sum = _mm_add_epi16(_mm_maddubs_epi16(row0, ones), _mm_maddubs_epi16(row1, ones));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+PREPROCESS_TARGET_AVX2 static inline __m128i rgb_to_chroma_sse(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb)
+{
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+    sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+    sum = _mm_srai_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+    return _mm_add_epi16(sum, _mm_set1_epi16(128));
+}
+
+PREPROCESS_TARGET_AVX2 void rgb_to_nv12_rows_avx2(const uint8_t *rgb0, const uint8_t *rgb1, uint8_t *y0, uint8_t *y1, uint8_t *uv, int width, bool bgr)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i r0, g0, b0, r1, g1, b1;
+        load_rgb16_sse(rgb0 + 3 * x, r0, g0, b0);
+        load_rgb16_sse(rgb1 + 3 * x, r1, g1, b1);
+        if (bgr)
+        {
+            std::swap(r0, b0);
+            std::swap(r1, b1);
+        }
+        _mm_storeu_si128((__m128i *)(y0 + x), rgb_to_y16_avx2(r0, g0, b0));
+        _mm_storeu_si128((__m128i *)(y1 + x), rgb_to_y16_avx2(r1, g1, b1));
+        __m128i r = average_2x2_sse(r0, r1);
+        __m128i g = average_2x2_sse(g0, g1);
+        __m128i b = average_2x2_sse(b0, b1);
+        __m128i u = rgb_to_chroma_sse(r, g, b, -38, -74, 112);
+        __m128i v = rgb_to_chroma_sse(r, g, b, 112, -94, -18);
+        __m128i u8 = _mm_packus_epi16(u, u);
+        __m128i v8 = _mm_packus_epi16(v, v);
+        _mm_storeu_si128((__m128i *)(uv + x), _mm_unpacklo_epi8(u8, v8));
+    }
+    rgb_to_nv12_rows_ref(rgb0, rgb1, y0, y1, uv, x, width, bgr);
+}
+#elif defined(__aarch64__)
+static inline uint8x8_t rgb_to_y8_neon(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+    uint16x8_t sum = vmull_u8(r, vdup_n_u8(66));
+    sum = vmlal_u8(sum, g, vdup_n_u8(129));
+    sum = vmlal_u8(sum, b, vdup_n_u8(25));
+    return vadd_u8(vshrn_n_u16(vaddq_u16(sum, vdupq_n_u16(128)), 8), vdup_n_u8(16));
+}
+
+static inline uint8x8_t rgb_to_chroma_neon(int16x8_t r, int16x8_t g, int16x8_t b, int16_t cr, int16_t cg, int16_t cb)
+{
+    int16x8_t sum = vaddq_s16(vaddq_s16(vmulq_n_s16(r, cr), vmulq_n_s16(g, cg)), vmulq_n_s16(b, cb));
+    sum = vshrq_n_s16(vaddq_s16(sum, vdupq_n_s16(128)), 8);
+    return vqmovun_s16(vaddq_s16(sum, vdupq_n_s16(128)));
+}
+
+static inline int16x8_t average_2x2_neon(uint8x16_t row0, uint8x16_t row1)
+{
+    uint16x8_t sum = vaddq_u16(vpaddlq_u8(row0), vpaddlq_u8(row1));
+    return vreinterpretq_s16_u16(vshrq_n_u16(vaddq_u16(sum, vdupq_n_u16(2)), 2));
+}
+
+void rgb_to_nv12_rows_neon(const uint8_t *rgb0, const uint8_t *rgb1, uint8_t *y0, uint8_t *y1, uint8_t *uv, int width, bool bgr)
+{
+    int ri = bgr ? 2 : 0;
+    int bi = bgr ? 0 : 2;
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16x3_t p0 = vld3q_u8(rgb0 + 3 * x);
+        uint8x16x3_t p1 = vld3q_u8(rgb1 + 3 * x);
+        vst1q_u8(y0 + x, vcombine_u8(rgb_to_y8_neon(vget_low_u8(p0.val[ri]), vget_low_u8(p0.val[1]), vget_low_u8(p0.val[bi])),
+                                     rgb_to_y8_neon(vget_high_u8(p0.val[ri]), vget_high_u8(p0.val[1]), vget_high_u8(p0.val[bi]))));
+        vst1q_u8(y1 + x, vcombine_u8(rgb_to_y8_neon(vget_low_u8(p1.val[ri]), vget_low_u8(p1.val[1]), vget_low_u8(p1.val[bi])),
+                                     rgb_to_y8_neon(vget_high_u8(p1.val[ri]), vget_high_u8(p1.val[1]), vget_high_u8(p1.val[bi]))));
+        int16x8_t r = average_2x2_neon(p0.val[ri], p1.val[ri]);
+        int16x8_t g = average_2x2_neon(p0.val[1], p1.val[1]);
+        int16x8_t b = average_2x2_neon(p0.val[bi], p1.val[bi]);
+        uint8x8x2_t chroma;
+        chroma.val[0] = rgb_to_chroma_neon(r, g, b, -38, -74, 112);
+        chroma.val[1] = rgb_to_chroma_neon(r, g, b, 112, -94, -18);
+        vst2_u8(uv + x, chroma);
+    }
+    rgb_to_nv12_rows_ref(rgb0, rgb1, y0, y1, uv, x, width, bgr);
+}
+#endif
+
+void rgb_to_nv12(const uint8_t *rgb, int rgbStride, int width, int height,
+                 uint8_t *y, int yStride, uint8_t *uv, int uvStride, bool bgr)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        for (int row = 0; row + 1 < height; row += 2)
+        {
+            rgb_to_nv12_rows_avx2(rgb + row * rgbStride, rgb + (row + 1) * rgbStride, y + row * yStride, y + (row + 1) * yStride,
+                                  uv + (row / 2) * uvStride, width, bgr);
+        }
+        return;
+    }
+#elif defined(__aarch64__)
+    for (int row = 0; row + 1 < height; row += 2)
+    {
+        rgb_to_nv12_rows_neon(rgb + row * rgbStride, rgb + (row + 1) * rgbStride, y + row * yStride, y + (row + 1) * yStride,
+                              uv + (row / 2) * uvStride, width, bgr);
+    }
+    return;
+#endif
+    rgb_to_nv12_ref(rgb, rgbStride, width, height, y, yStride, uv, uvStride, bgr);
+}
+
+/************************************ bilinear缩放/裁剪 ************************************/
+
+// 一个方向上每个目标坐标对应的两个源坐标和定点权重，采用像素中心对齐
+struct ResizeAxis
+{
+    std::vector<int> index0;
+    std::vector<int> index1;
+    std::vector<int> weight0;
+    std::vector<int> weight1;
+};
+
+ResizeAxis build_resize_axis(int srcOffset, int srcSize, int dstSize)
+{
+    ResizeAxis axis;
+    double scale = (double)srcSize / dstSize;
+    for (int d = 0; d < dstSize; d++)
+    {
+        double f = std::max((d + 0.5) * scale - 0.5, 0.0);
+        int i0 = (int)std::floor(f);
+        double frac = f - i0;
+        if (i0 >= srcSize - 1)
+        {
+            i0 = srcSize - 1;
+            frac = 0;
+        }
+        int w1 = (int)std::lround(frac * RESIZE_COEF_ONE);
+        axis.index0.push_back(srcOffset + i0);
+        axis.index1.push_back(srcOffset + std::min(i0 + 1, srcSize - 1));
+        axis.weight0.push_back(RESIZE_COEF_ONE - w1);
+        axis.weight1.push_back(w1);
+    }
+    return axis;
+}
+
+ImageRect full_rect(const ImageRect &crop, int width, int height)
+{
+    ImageRect rect = crop;
+    if (rect.width <= 0 || rect.height <= 0)
+    {
+        rect = {0, 0, width, height};
+    }
+    return rect;
+}
+
+inline uint8_t resize_vertical(int h0, int h1, int w0, int w1)
+{
+    return clamp_u8((h0 * w0 + h1 * w1 + (1 << (2 * RESIZE_COEF_BITS - 1))) >> (2 * RESIZE_COEF_BITS));
+}
+
+// 逐像素计算的参考实现，channels为1-4的打包格式
+void resize_bilinear_ref(const uint8_t *src, int srcWidth, int srcHeight, int srcStride, int channels, const ImageRect &crop,
+                         uint8_t *dst, int dstWidth, int dstHeight, int dstStride)
+{
+    ImageRect rect = full_rect(crop, srcWidth, srcHeight);
+    ResizeAxis xAxis = build_resize_axis(rect.x, rect.width, dstWidth);
+    ResizeAxis yAxis = build_resize_axis(rect.y, rect.height, dstHeight);
+    for (int dy = 0; dy < dstHeight; dy++)
+    {
+        const uint8_t *row0 = src + yAxis.index0[dy] * srcStride;
+        const uint8_t *row1 = src + yAxis.index1[dy] * srcStride;
+        for (int dx = 0; dx < dstWidth; dx++)
+        {
+            int x0 = xAxis.index0[dx] * channels;
+            int x1 = xAxis.index1[dx] * channels;
+            for (int c = 0; c < channels; c++)
+            {
+                int h0 = row0[x0 + c] * xAxis.weight0[dx] + row0[x1 + c] * xAxis.weight1[dx];
+                int h1 = row1[x0 + c] * xAxis.weight0[dx] + row1[x1 + c] * xAxis.weight1[dx];
+                dst[dy * dstStride + dx * channels + c] = resize_vertical(h0, h1, yAxis.weight0[dy], yAxis.weight1[dy]);
+            }
+        }
+    }
+}
+
+// 按输出元素(像素 x 通道)展开的水平插值表
+struct ResizeRowTable
+{
+    std::vector<int> offset0;
+    std::vector<int> offset1;
+    std::vector<int> weight0;
+    std::vector<int> weight1;
+    // offset0 + 4 <= srcRowBytes 的前缀长度，这部分可以用32位gather一次取到两个相邻像素
+    size_t gatherCount = 0;
+};
+
+ResizeRowTable build_resize_row_table(const ResizeAxis &xAxis, int channels, int srcRowBytes)
+{
+    ResizeRowTable table;
+    bool gather = channels <= 3;
+    for (size_t dx = 0; dx < xAxis.index0.size(); dx++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            int offset0 = xAxis.index0[dx] * channels + c;
+            table.offset0.push_back(offset0);
+            table.offset1.push_back(xAxis.index1[dx] * channels + c);
+            table.weight0.push_back(xAxis.weight0[dx]);
+            // x1 == x0(右边界)时权重为0，gather取到的相邻字节不影响结果
+            table.weight1.push_back(xAxis.weight1[dx]);
+            gather = gather && offset0 + 4 <= srcRowBytes;
+            if (gather)
+            {
+                table.gatherCount = table.offset0.size();
+            }
+        }
+    }
+    table.gatherCount &= ~(size_t)7;
+    return table;
+}
+
+void resize_horizontal_ref(const uint8_t *row, const ResizeRowTable &table, int *out, size_t begin)
+{
+    for (size_t i = begin; i < table.offset0.size(); i++)
+    {
+        out[i] = row[table.offset0[i]] * table.weight0[i] + row[table.offset1[i]] * table.weight1[i];
+    }
+}
+
+void resize_vertical_ref(const int *h0, const int *h1, uint8_t *out, size_t count, int w0, int w1, size_t begin)
+{
+    for (size_t i = begin; i < count; i++)
+    {
+        out[i] = resize_vertical(h0[i], h1[i], w0, w1);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// x0与x1相邻时两个像素在同一个32位字里，相差channels个字节
+PREPROCESS_TARGET_AVX2 void resize_horizontal_avx2(const uint8_t *row, const ResizeRowTable &table, int channels, int *out)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m128i shift = _mm_cvtsi32_si128(8 * channels);
+    size_t i = 0;
+    for (; i < table.gatherCount; i += 8)
+    {
+        __m256i words = _mm256_i32gather_epi32((const int *)row, _mm256_loadu_si256((const __m256i *)&table.offset0[i]), 1);
+        __m256i p0 = _mm256_and_si256(words, mask);
+        __m256i p1 = _mm256_and_si256(_mm256_srl_epi32(words, shift), mask);
+        __m256i h = _mm256_add_epi32(_mm256_mullo_epi32(p0, _mm256_loadu_si256((const __m256i *)&table.weight0[i])),
+                                     _mm256_mullo_epi32(p1, _mm256_loadu_si256((const __m256i *)&table.weight1[i])));
+        _mm256_storeu_si256((__m256i *)(out + i), h);
+    }
+    resize_horizontal_ref(row, table, out, i);
+}
+
+PREPROCESS_TARGET_AVX2 void resize_vertical_avx2(const int *h0, const int *h1, uint8_t *out, size_t count, int w0, int w1)
+{
+    const __m256i weight0 = _mm256_set1_epi32(w0);
+    const __m256i weight1 = _mm256_set1_epi32(w1);
+    const __m256i round = _mm256_set1_epi32(1 << (2 * RESIZE_COEF_BITS - 1));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(h0 + i)), weight0),
+                                     _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(h1 + i)), weight1));
+        v = _mm256_srai_epi32(_mm256_add_epi32(v, round), 2 * RESIZE_COEF_BITS);
+        __m128i v16 = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(v16, v16));
+    }
+    resize_vertical_ref(h0, h1, out, count, w0, w1, i);
+}
+#elif defined(__aarch64__)
+void resize_vertical_neon(const int *h0, const int *h1, uint8_t *out, size_t count, int w0, int w1)
+{
+    const int32x4_t round = vdupq_n_s32(1 << (2 * RESIZE_COEF_BITS - 1));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        int32x4_t lo = vmlaq_n_s32(vmulq_n_s32(vld1q_s32(h0 + i), w0), vld1q_s32(h1 + i), w1);
+        int32x4_t hi = vmlaq_n_s32(vmulq_n_s32(vld1q_s32(h0 + i + 4), w0), vld1q_s32(h1 + i + 4), w1);
+        lo = vshrq_n_s32(vaddq_s32(lo, round), 2 * RESIZE_COEF_BITS);
+        hi = vshrq_n_s32(vaddq_s32(hi, round), 2 * RESIZE_COEF_BITS);
+        vst1_u8(out + i, vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi))));
+    }
+    resize_vertical_ref(h0, h1, out, count, w0, w1, i);
+}
+#endif
+
+// 先对用到的源行做水平插值并缓存(相邻输出行共享源行时不重复计算)，再做垂直插值。
+// channels为1-4的打包格式，dst可以是带行对齐填充的模型输入缓冲区。
+void resize_bilinear(const uint8_t *src, int srcWidth, int srcHeight, int srcStride, int channels, const ImageRect &crop,
+                     uint8_t *dst, int dstWidth, int dstHeight, int dstStride)
+{
+    ImageRect rect = full_rect(crop, srcWidth, srcHeight);
+    ResizeAxis xAxis = build_resize_axis(rect.x, rect.width, dstWidth);
+    ResizeAxis yAxis = build_resize_axis(rect.y, rect.height, dstHeight);
+    ResizeRowTable table = build_resize_row_table(xAxis, channels, srcWidth * channels);
+    size_t count = (size_t)dstWidth * channels;
+    std::vector<int> rows[2] = {std::vector<int>(count), std::vector<int>(count)};
+    int cached[2] = {-1, -1};
+
+    auto horizontal = [&](int srcRow, int *out)
+    {
+        const uint8_t *row = src + srcRow * srcStride;
+#if defined(__x86_64__) || defined(__i386__)
+        if (preprocess_has_avx2())
+        {
+            resize_horizontal_avx2(row, table, channels, out);
+            return;
+        }
+#endif
+        resize_horizontal_ref(row, table, out, 0);
+    };
+    auto vertical = [&](const int *h0, const int *h1, uint8_t *out, int w0, int w1)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (preprocess_has_avx2())
+        {
+            resize_vertical_avx2(h0, h1, out, count, w0, w1);
+            return;
+        }
+#elif defined(__aarch64__)
+        resize_vertical_neon(h0, h1, out, count, w0, w1);
+        return;
+#endif
+        resize_vertical_ref(h0, h1, out, count, w0, w1, 0);
+    };
+
+    for (int dy = 0; dy < dstHeight; dy++)
+    {
+        int y0 = yAxis.index0[dy];
+        int y1 = yAxis.index1[dy];
+        // 上一行的下方源行变成这一行的上方源行时直接交换缓存
+        if (cached[0] != y0 && cached[1] == y0)
+        {
+            std::swap(rows[0], rows[1]);
+            std::swap(cached[0], cached[1]);
+        }
+        if (cached[0] != y0)
+        {
+            horizontal(y0, rows[0].data());
+            cached[0] = y0;
+        }
+        if (cached[1] != y1)
+        {
+            if (y1 == y0)
+            {
+                rows[1] = rows[0];
+            }
+            else
+            {
+                horizontal(y1, rows[1].data());
+            }
+            cached[1] = y1;
+        }
+        vertical(rows[0].data(), rows[1].data(), dst + dy * dstStride, yAxis.weight0[dy], yAxis.weight1[dy]);
+    }
+}
+
+// NV12的缩放: Y平面按单通道、交错的UV平面按双通道分别缩放，裁剪区域的坐标需为偶数
+void resize_nv12(const uint8_t *srcY, int srcYStride, const uint8_t *srcUV, int srcUVStride, int srcWidth, int srcHeight, const ImageRect &crop,
+                 uint8_t *dstY, int dstYStride, uint8_t *dstUV, int dstUVStride, int dstWidth, int dstHeight, bool reference = false)
+{
+    ImageRect rect = full_rect(crop, srcWidth, srcHeight);
+    ImageRect uvRect = {rect.x / 2, rect.y / 2, rect.width / 2, rect.height / 2};
+    auto resize = reference ? resize_bilinear_ref : resize_bilinear;
+    resize(srcY, srcWidth, srcHeight, srcYStride, 1, rect, dstY, dstWidth, dstHeight, dstYStride);
+    resize(srcUV, srcWidth / 2, srcHeight / 2, srcUVStride, 2, uvRect, dstUV, dstWidth / 2, dstHeight / 2, dstUVStride);
+}
+
+#endif
@@ -0,0 +1,619 @@
+#ifndef INPUT_PROVIDER_HPP
+#define INPUT_PROVIDER_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "Preprocess.hpp"
+
+// 给各个后端的输入张量提供数据:
+//   random[:low,high]  每种数据类型按给定范围(默认取该类型的常用范围)均匀分布，随机种子固定
+//   constant:value     所有元素填同一个值
+//   replay:path        回放录制的输入，path为目录或逗号分隔的.npy/.raw文件列表，文件通过mmap映射，每轮循环取下一份样本
+// 一些NPU的延迟与数据有关(稀疏、零值跳过)，全零或未初始化的输入会让结果偏乐观，因此所用的数据分布会记录到结果里。
+
+enum class InputDataType
+{
+    Float32,
+    Float16,
+    Int8,
+    Uint8,
+    Int16,
+    Uint16,
+    Int32,
+    Int64,
+    Bool
+};
+
+size_t input_dtype_size(InputDataType dtype)
+{
+    switch (dtype)
+    {
+    case InputDataType::Float32:
+    case InputDataType::Int32:
+        return 4;
+    case InputDataType::Float16:
+    case InputDataType::Int16:
+    case InputDataType::Uint16:
+        return 2;
+    case InputDataType::Int64:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+std::string input_dtype_name(InputDataType dtype)
+{
+    switch (dtype)
+    {
+    case InputDataType::Float32:
+        return "float32";
+    case InputDataType::Float16:
+        return "float16";
+    case InputDataType::Int8:
+        return "int8";
+    case InputDataType::Uint8:
+        return "uint8";
+    case InputDataType::Int16:
+        return "int16";
+    case InputDataType::Uint16:
+        return "uint16";
+    case InputDataType::Int32:
+        return "int32";
+    case InputDataType::Int64:
+        return "int64";
+    default:
+        return "bool";
+    }
+}
+
+// 未指定范围时随机数据的默认范围: 整数类型取uint8图像或int8量化输入的常用范围，浮点取归一化后的范围
+void input_dtype_default_range(InputDataType dtype, double &low, double &high)
+{
+    switch (dtype)
+    {
+    case InputDataType::Float32:
+    case InputDataType::Float16:
+        low = -1.0;
+        high = 1.0;
+        break;
+    case InputDataType::Int8:
+        low = -128;
+        high = 127;
+        break;
+    case InputDataType::Bool:
+        low = 0;
+        high = 1;
+        break;
+    default:
+        low = 0;
+        high = 255;
+        break;
+    }
+}
+
+// 把double写成目标类型的一个元素，整数类型先四舍五入并截断到该类型的范围
+void input_store(InputDataType dtype, double value, uint8_t *dst)
+{
+    auto store_int = [&](auto type, double lo, double hi)
+    {
+        decltype(type) v = (decltype(type))std::min(std::max(std::nearbyint(value), lo), hi);
+        memcpy(dst, &v, sizeof(v));
+    };
+    switch (dtype)
+    {
+    case InputDataType::Float32:
+    {
+        float v = (float)value;
+        memcpy(dst, &v, sizeof(v));
+        break;
+    }
+    case InputDataType::Float16:
+    {
+        uint16_t v = float_to_half((float)value);
+        memcpy(dst, &v, sizeof(v));
+        break;
+    }
+    case InputDataType::Int8:
+        store_int(int8_t(), -128.0, 127.0);
+        break;
+    case InputDataType::Uint8:
+        store_int(uint8_t(), 0.0, 255.0);
+        break;
+    case InputDataType::Int16:
+        store_int(int16_t(), -32768.0, 32767.0);
+        break;
+    case InputDataType::Uint16:
+        store_int(uint16_t(), 0.0, 65535.0);
+        break;
+    case InputDataType::Int32:
+        store_int(int32_t(), -2147483648.0, 2147483647.0);
+        break;
+    case InputDataType::Int64:
+        store_int(int64_t(), -9.2e18, 9.2e18);
+        break;
+    default:
+        *dst = value != 0;
+        break;
+    }
+}
+
+// 读取一个元素，用于回放文件与张量的数据类型不同时的转换
+double input_load(InputDataType dtype, const uint8_t *src)
+{
+    auto load = [&](auto type)
+    {
+        decltype(type) v;
+        memcpy(&v, src, sizeof(v));
+        return (double)v;
+    };
+    switch (dtype)
+    {
+    case InputDataType::Float32:
+        return load(float());
+    case InputDataType::Float16:
+    {
+        uint16_t v;
+        memcpy(&v, src, sizeof(v));
+        return half_to_float(v);
+    }
+    case InputDataType::Int8:
+        return load(int8_t());
+    case InputDataType::Uint8:
+        return load(uint8_t());
+    case InputDataType::Int16:
+        return load(int16_t());
+    case InputDataType::Uint16:
+        return load(uint16_t());
+    case InputDataType::Int32:
+        return load(int32_t());
+    case InputDataType::Int64:
+        return load(int64_t());
+    default:
+        return *src != 0;
+    }
+}
+
+struct InputSpec
+{
+    std::string mode = "random";
+    uint32_t seed = 0;
+    // random模式的范围，未指定时按数据类型取默认值
+    bool hasRange = false;
+    double low = 0;
+    double high = 0;
+    // constant模式的值
+    double value = 0;
+    // replay模式的文件，按文件名排序
+    std::vector<std::string> files;
+};
+
+// 解析 random[:low,high] / constant:value / replay:path
+bool parse_input_spec(const std::string &text, uint32_t seed, InputSpec &spec)
+{
+    size_t colon = text.find(':');
+    spec.mode = text.substr(0, colon);
+    spec.seed = seed;
+    std::string arg = colon == std::string::npos ? "" : text.substr(colon + 1);
+    if (spec.mode == "random")
+    {
+        if (!arg.empty())
+        {
+            if (sscanf(arg.c_str(), "%lf,%lf", &spec.low, &spec.high) != 2 || spec.low > spec.high)
+            {
+                return false;
+            }
+            spec.hasRange = true;
+        }
+        return true;
+    }
+    if (spec.mode == "constant")
+    {
+        spec.value = arg.empty() ? 0.0 : std::stod(arg);
+        return true;
+    }
+    if (spec.mode == "replay")
+    {
+        std::stringstream stream(arg);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            if (std::filesystem::is_directory(item))
+            {
+                for (const auto &entry : std::filesystem::directory_iterator(item))
+                {
+                    auto extension = entry.path().extension();
+                    if (entry.is_regular_file() && (extension == ".npy" || extension == ".raw" || extension == ".bin"))
+                    {
+                        spec.files.push_back(entry.path().string());
+                    }
+                }
+            }
+            else if (!item.empty())
+            {
+                spec.files.push_back(item);
+            }
+        }
+        std::sort(spec.files.begin(), spec.files.end());
+        return !spec.files.empty();
+    }
+    return false;
+}
+
+// 只读映射的文件，析构时解除映射
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (data_ != nullptr)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap(data_, size_);
+#endif
+        }
+    }
+
+#ifdef _WIN32
+    bool open(const std::string &path)
+    {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        size_ = (size_t)fileSize.QuadPart;
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+        {
+            return false;
+        }
+        data_ = (uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        return data_ != nullptr;
+    }
+#else
+    bool open(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        size_ = info.st_size;
+        void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+        data_ = (uint8_t *)data;
+        return true;
+    }
+#endif
+
+    const uint8_t *data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 解析.npy的头部，得到数据的起始偏移和数据类型；只支持小端、C顺序
+bool parse_npy_header(const uint8_t *data, size_t size, size_t &offset, InputDataType &dtype)
+{
+    if (size < 10 || memcmp(data, "\x93NUMPY", 6) != 0)
+    {
+        return false;
+    }
+    size_t headerLength;
+    if (data[6] == 1)
+    {
+        headerLength = data[8] | (data[9] << 8);
+        offset = 10 + headerLength;
+    }
+    else
+    {
+        if (size < 12)
+        {
+            return false;
+        }
+        headerLength = data[8] | (data[9] << 8) | (data[10] << 16) | ((size_t)data[11] << 24);
+        offset = 12 + headerLength;
+    }
+    if (offset > size)
+    {
+        return false;
+    }
+    std::string header((const char *)data + offset - headerLength, headerLength);
+    if (header.find("'fortran_order': True") != std::string::npos)
+    {
+        return false;
+    }
+    size_t descr = header.find("'descr'");
+    size_t quote = descr == std::string::npos ? std::string::npos : header.find('\'', descr + 7);
+    if (quote == std::string::npos)
+    {
+        return false;
+    }
+    std::string type = header.substr(quote + 1, header.find('\'', quote + 1) - quote - 1);
+    const std::vector<std::pair<std::string, InputDataType>> types = {
+        {"<f4", InputDataType::Float32}, {"<f2", InputDataType::Float16}, {"|i1", InputDataType::Int8}, {"|u1", InputDataType::Uint8},
+        {"<i2", InputDataType::Int16}, {"<u2", InputDataType::Uint16}, {"<i4", InputDataType::Int32}, {"<i8", InputDataType::Int64},
+        {"|b1", InputDataType::Bool}};
+    for (const auto &item : types)
+    {
+        if (item.first == type)
+        {
+            dtype = item.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct InputTensorInfo
+{
+    std::string name;
+    InputDataType dtype;
+    size_t bytes;
+};
+
+class InputProvider
+{
+public:
+    explicit InputProvider(const InputSpec &spec) : spec_(spec)
+    {
+    }
+
+    // 根据后端的输入描述准备全部样本；replay模式下排序后的第i个文件属于第(i % 输入个数)个输入，
+    // 一个文件里可以连续存放多份样本。所有内存在这里一次性准备好，之后每轮只移动游标
+    bool prepare(const std::vector<InputTensorInfo> &inputs)
+    {
+        inputs_ = inputs;
+        samples_.assign(inputs.size(), {});
+        sources_.assign(inputs.size(), {});
+        files_.clear();
+        owned_.clear();
+        cursor_ = 0;
+        for (size_t index = 0; index < inputs.size(); index++)
+        {
+            const auto &input = inputs[index];
+            if (spec_.mode == "replay")
+            {
+                for (size_t f = index; f < spec_.files.size(); f += inputs.size())
+                {
+                    if (!add_replay_file(index, spec_.files[f]))
+                    {
+                        return false;
+                    }
+                }
+                if (samples_[index].empty())
+                {
+                    LOG(ERROR) << "No replay file for input " << index << " (" << input.name << ")";
+                    return false;
+                }
+                continue;
+            }
+            owned_.emplace_back(input.bytes);
+            uint8_t *dst = owned_.back().data();
+            size_t elementSize = input_dtype_size(input.dtype);
+            size_t count = input.bytes / elementSize;
+            if (spec_.mode == "constant")
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    input_store(input.dtype, spec_.value, dst + i * elementSize);
+                }
+            }
+            else
+            {
+                double low, high;
+                input_dtype_default_range(input.dtype, low, high);
+                if (spec_.hasRange)
+                {
+                    low = spec_.low;
+                    high = spec_.high;
+                }
+                // 每个输入使用不同但固定的种子，多次运行得到相同的数据
+                std::mt19937 rng(spec_.seed + (uint32_t)index);
+                if (input.dtype == InputDataType::Bool)
+                {
+                    // 均匀分布的值几乎都不为0，bool按0/1各一半生成
+                    std::bernoulli_distribution dist(0.5);
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        input_store(input.dtype, dist(rng) ? 1.0 : 0.0, dst + i * elementSize);
+                    }
+                }
+                else
+                {
+                    std::uniform_real_distribution<double> dist(low, high);
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        input_store(input.dtype, dist(rng), dst + i * elementSize);
+                    }
+                }
+            }
+            samples_[index].push_back(dst);
+        }
+        return true;
+    }
+
+    // 第index个输入当前样本的数据，字节数与prepare时给出的一致
+    const void *data(size_t index) const
+    {
+        const auto &samples = samples_[index];
+        return samples[cursor_ % samples.size()];
+    }
+
+    void copy_to(size_t index, void *dst) const
+    {
+        memcpy(dst, data(index), inputs_[index].bytes);
+    }
+
+    // 切换到下一份样本，各输入的样本数不同时分别循环
+    void next()
+    {
+        cursor_++;
+    }
+
+    // 最多的样本数，大于1时每轮需要重新设置输入
+    size_t samples() const
+    {
+        size_t count = 0;
+        for (const auto &samples : samples_)
+        {
+            count = std::max(count, samples.size());
+        }
+        return count;
+    }
+
+    nlohmann::json describe() const
+    {
+        nlohmann::json info;
+        info["Mode"] = spec_.mode;
+        if (spec_.mode == "random")
+        {
+            info["Distribution"] = "uniform";
+            info["Seed"] = spec_.seed;
+            if (spec_.hasRange)
+            {
+                info["Range"] = {spec_.low, spec_.high};
+            }
+        }
+        else if (spec_.mode == "constant")
+        {
+            info["Value"] = spec_.value;
+        }
+        info["Samples"] = samples();
+        for (size_t index = 0; index < inputs_.size(); index++)
+        {
+            nlohmann::json item;
+            item["Name"] = inputs_[index].name;
+            item["DataType"] = input_dtype_name(inputs_[index].dtype);
+            item["ByteSize"] = inputs_[index].bytes;
+            item["Samples"] = samples_[index].size();
+            if (spec_.mode == "random")
+            {
+                double low, high;
+                input_dtype_default_range(inputs_[index].dtype, low, high);
+                item["Range"] = spec_.hasRange ? std::vector<double>{spec_.low, spec_.high} : std::vector<double>{low, high};
+            }
+            if (!sources_[index].empty())
+            {
+                item["Files"] = sources_[index];
+            }
+            info["Inputs"].push_back(item);
+        }
+        return info;
+    }
+
+private:
+    bool add_replay_file(size_t index, const std::string &path)
+    {
+        const auto &input = inputs_[index];
+        auto file = std::make_unique<MappedFile>();
+        if (!file->open(path))
+        {
+            LOG(ERROR) << "Failed to map replay file: " << path;
+            return false;
+        }
+        size_t offset = 0;
+        InputDataType fileType = input.dtype;
+        bool npy = std::filesystem::path(path).extension() == ".npy";
+        if (npy && !parse_npy_header(file->data(), file->size(), offset, fileType))
+        {
+            LOG(ERROR) << "Unsupported npy file: " << path;
+            return false;
+        }
+        // 文件与张量的元素个数必须一致(或为整数倍)，数据类型不同时在这里转换一次
+        size_t elements = input.bytes / input_dtype_size(input.dtype);
+        size_t sampleBytes = elements * input_dtype_size(fileType);
+        size_t payload = file->size() - offset;
+        if (sampleBytes == 0 || payload % sampleBytes != 0)
+        {
+            LOG(ERROR) << "Replay file " << path << " has " << payload << " bytes of " << input_dtype_name(fileType)
+                       << ", which is not a multiple of input " << input.name << " (" << elements << " elements)";
+            return false;
+        }
+        for (size_t sample = 0; sample < payload / sampleBytes; sample++)
+        {
+            const uint8_t *src = file->data() + offset + sample * sampleBytes;
+            if (fileType == input.dtype)
+            {
+                samples_[index].push_back(src);
+                continue;
+            }
+            owned_.emplace_back(input.bytes);
+            uint8_t *dst = owned_.back().data();
+            for (size_t i = 0; i < elements; i++)
+            {
+                input_store(input.dtype, input_load(fileType, src + i * input_dtype_size(fileType)), dst + i * input_dtype_size(input.dtype));
+            }
+            samples_[index].push_back(dst);
+        }
+        sources_[index].push_back(path);
+        files_.push_back(std::move(file));
+        return true;
+    }
+
+    InputSpec spec_;
+    std::vector<InputTensorInfo> inputs_;
+    // 每个输入的样本指针，指向映射的文件或owned_中的缓冲区
+    std::vector<std::vector<const uint8_t *>> samples_;
+    std::vector<std::vector<std::string>> sources_;
+    std::vector<std::unique_ptr<MappedFile>> files_;
+    std::vector<std::vector<uint8_t>> owned_;
+    size_t cursor_ = 0;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LOAD_GENERATOR_HPP
+#define LOAD_GENERATOR_HPP
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+#include "Trace.hpp"
+
+// 开环负载: 请求按泊松过程以requestRate(请求/s)到达，到达时刻按计划时间计算，发送端落后时排队时间计入延迟；
+// requestRate <= 0时为闭环，issue返回后立即发出下一个请求
+struct LoadConfig
+{
+    double requestRate = 1000;
+    int numRequests = 2000;
+    uint32_t seed = 0;
+};
+
+// 在每个请求的计划到达时刻调用issue(request, arrival)，issue返回false时不再发出后续请求；动态批处理和npuserve的客户端共用
+void run_open_loop(const LoadConfig &load, const std::function<bool(int, std::chrono::steady_clock::time_point)> &issue)
+{
+    std::mt19937 rng(load.seed);
+    std::exponential_distribution<double> interval(load.requestRate > 0 ? load.requestRate / 1e6 : 1.0);
+    auto arrival = std::chrono::steady_clock::now();
+    for (int request = 0; request < load.numRequests; request++)
+    {
+        if (load.requestRate > 0)
+        {
+            arrival += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::micro>(interval(rng)));
+            std::this_thread::sleep_until(arrival);
+        }
+        else
+        {
+            arrival = std::chrono::steady_clock::now();
+        }
+        TRACE_INSTANT("request arrival");
+        if (!issue(request, arrival))
+        {
+            break;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,529 @@
+#ifndef MODEL_CACHE_HPP
+#define MODEL_CACHE_HPP
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "BackendLoader.hpp"
+#include "Soak.hpp"
+#include "Timer.hpp"
+
+// 常驻模型缓存: 多模型部署中不能让所有模型都常驻，按需重新rknn_init/hbDNNInitializeFromFiles要几十到几百ms。
+// 缓存在后端插件之上按内存预算保留已加载的模型，超出预算时按LRU(最久未使用)或LFU(累计访问次数最少，驱逐后计数保留)驱逐；
+// 固定(pin)的模型和正在被使用(acquire返回的shared_ptr还在)的模型不会被驱逐。
+// 模型的占用优先取插件元信息中的MemoryBytes(例如RKNN_QUERY_MEM_SIZE的权重 + 中间结果)，没有时取加载前后RSS的增量。
+// 加载前按上次测得的占用预留空间；第一次加载时文件大小不代表实际占用(例如.sim的权重不在文件中)，
+// 预留驱逐所有可驱逐的模型后剩余的全部预算，预留的空间在加载期间计入常驻占用，加载后换成实际占用再检查一次。
+// prefetch只加载测得过占用的模型，腾不出空间时(例如当前模型还在使用)跳过，加载后实际占用超出预算时把预取的模型卸载，不让预取撑破预算。
+// 模型加载串行进行，RSS增量不会混入其他模型；prefetch在后台线程中加载，acquire遇到正在加载的模型时等待其完成。
+
+struct ModelCacheConfig
+{
+    // 内存预算(字节)，0为不限制
+    uint64_t budgetBytes = 0;
+    // lru或lfu
+    std::string policy = "lru";
+};
+
+struct ModelCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // 命中的模型由prefetch加载，且是加载后第一次使用
+    uint64_t prefetchHits = 0;
+    // 访问时模型正在由prefetch加载，需要等待加载完成
+    uint64_t prefetchWaits = 0;
+    // 占用未知或腾不出空间而跳过(或加载后又卸载)的prefetch
+    uint64_t prefetchSkips = 0;
+    uint64_t loads = 0;
+    uint64_t loadFailures = 0;
+    uint64_t evictions = 0;
+    double loadMs = 0;
+    uint64_t residentBytes = 0;
+    uint64_t peakResidentBytes = 0;
+};
+
+class ModelCache
+{
+public:
+    ModelCache(BackendRegistry &registry, const ModelCacheConfig &config)
+        : registry_(registry), config_(config)
+    {
+    }
+
+    ~ModelCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        prefetchCv_.notify_all();
+        if (prefetcher_.joinable())
+        {
+            prefetcher_.join();
+        }
+    }
+
+    // 登记一个可以被缓存的模型，acquire/prefetch/pin只接受登记过的路径
+    void add(const std::string &path, const std::string &backend, const nlohmann::json &options)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry &entry = entries_[path];
+        entry.path = path;
+        entry.backend = backend;
+        entry.options = options;
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(path, error);
+        entry.footprint = error ? 0 : (uint64_t)size;
+    }
+
+    // 取得模型，不在缓存中时同步加载(必要时先驱逐其他模型)；hit不为空时返回是否命中。失败时返回nullptr
+    std::shared_ptr<BackendModel> acquire(const std::string &path, bool *hit = nullptr)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it == entries_.end())
+        {
+            LOG(ERROR) << "Model " << path << " is not added to the cache";
+            return nullptr;
+        }
+        Entry &entry = it->second;
+        entry.accesses++;
+        entry.lastUse = ++tick_;
+        // 访问时已经常驻才算命中，等待正在进行的prefetch完成的访问算未命中
+        bool resident = entry.state == RESIDENT;
+        if (entry.state == LOADING)
+        {
+            stats_.prefetchWaits++;
+            cv_.wait(lock, [&]()
+                     { return entry.state != LOADING; });
+        }
+        if (hit)
+        {
+            *hit = resident;
+        }
+        if (entry.state == RESIDENT)
+        {
+            if (resident)
+            {
+                stats_.hits++;
+                stats_.prefetchHits += entry.prefetched ? 1 : 0;
+            }
+            else
+            {
+                stats_.misses++;
+            }
+            entry.prefetched = false;
+            return entry.model;
+        }
+        stats_.misses++;
+        return load(entry, lock);
+    }
+
+    // 在后台线程中加载模型，已经常驻或正在加载时忽略；没有加载过的模型占用未知，不预取
+    void prefetch(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!entries_.count(path))
+        {
+            return;
+        }
+        if (!prefetcher_.joinable())
+        {
+            prefetcher_ = std::thread(&ModelCache::prefetch_loop, this);
+        }
+        prefetchQueue_.push_back(path);
+        prefetchCv_.notify_one();
+    }
+
+    // 固定的模型不会被驱逐，也不计入可以腾出的空间
+    void pin(const std::string &path, bool pinned = true)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it != entries_.end())
+        {
+            it->second.pinned = pinned;
+        }
+    }
+
+    // 等待后台的prefetch全部完成
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]()
+                 { return prefetchQueue_.empty() && !prefetching_; });
+    }
+
+    // 清零计数(例如固定的模型预先加载之后)，常驻占用保留
+    void reset_stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t resident = stats_.residentBytes;
+        stats_ = ModelCacheStats();
+        stats_.residentBytes = resident;
+        stats_.peakResidentBytes = resident;
+        for (auto &item : entries_)
+        {
+            item.second.prefetched = false;
+        }
+    }
+
+    ModelCacheStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    // 各模型测得的占用(字节)，未加载过的为文件大小
+    std::map<std::string, uint64_t> footprints() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, uint64_t> result;
+        for (const auto &item : entries_)
+        {
+            result[item.first] = item.second.footprint;
+        }
+        return result;
+    }
+
+private:
+    enum EntryState
+    {
+        EVICTED,
+        LOADING,
+        RESIDENT,
+    };
+
+    struct Entry
+    {
+        std::string path;
+        std::string backend;
+        nlohmann::json options;
+        std::shared_ptr<BackendModel> model;
+        EntryState state = EVICTED;
+        uint64_t footprint = 0;
+        // footprint是加载后测得的占用，而不是文件大小
+        bool measured = false;
+        uint64_t accesses = 0;
+        uint64_t lastUse = 0;
+        bool pinned = false;
+        bool prefetched = false;
+    };
+
+    // 加载entry，调用时持有mutex_，加载期间释放；被驱逐的模型在释放锁之后才卸载。
+    // prefetch为true时腾不出预留空间则不加载，加载后超出预算则卸载，都返回nullptr
+    std::shared_ptr<BackendModel> load(Entry &entry, std::unique_lock<std::mutex> &lock, bool prefetch = false)
+    {
+        uint64_t reserved = reservation(entry);
+        if (prefetch && config_.budgetBytes > 0 && (!entry.measured || stats_.residentBytes - evictable_bytes(&entry) + reserved > config_.budgetBytes))
+        {
+            stats_.prefetchSkips++;
+            return nullptr;
+        }
+        entry.state = LOADING;
+        std::vector<std::shared_ptr<BackendModel>> victims = make_room(reserved, &entry);
+        stats_.residentBytes += reserved;
+        stats_.peakResidentBytes = std::max(stats_.peakResidentBytes, stats_.residentBytes);
+        lock.unlock();
+        victims.clear();
+        std::shared_ptr<BackendModel> model;
+        uint64_t footprint = 0;
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> load_lock(loadMutex_);
+            std::shared_ptr<BackendLibrary> library = registry_.get(entry.backend);
+            double rss_before = process_status_value("VmRSS");
+            if (library)
+            {
+                model = BackendModel::load(library, entry.path, entry.options);
+            }
+            if (model)
+            {
+                nlohmann::json meta = model->meta_info();
+                double rss_after = process_status_value("VmRSS");
+                if (meta.contains("MemoryBytes") && meta["MemoryBytes"].is_number())
+                {
+                    footprint = meta["MemoryBytes"].get<uint64_t>();
+                }
+                else if (rss_before >= 0 && rss_after > rss_before)
+                {
+                    footprint = (uint64_t)((rss_after - rss_before) * 1024);
+                }
+            }
+        }
+        double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        lock.lock();
+        stats_.loadMs += load_ms;
+        stats_.residentBytes -= reserved;
+        if (!model)
+        {
+            stats_.loadFailures++;
+            entry.state = EVICTED;
+            cv_.notify_all();
+            return nullptr;
+        }
+        stats_.loads++;
+        entry.model = model;
+        entry.footprint = footprint;
+        entry.measured = true;
+        entry.state = RESIDENT;
+        stats_.residentBytes += footprint;
+        victims = make_room(0, &entry);
+        stats_.peakResidentBytes = std::max(stats_.peakResidentBytes, stats_.residentBytes);
+        if (prefetch && config_.budgetBytes > 0 && stats_.residentBytes > config_.budgetBytes)
+        {
+            victims.push_back(std::move(entry.model));
+            entry.state = EVICTED;
+            stats_.residentBytes -= footprint;
+            stats_.prefetchSkips++;
+            model = nullptr;
+        }
+        // 在唤醒等待者之前标记，等待这次加载的acquire会清除标记，不算预取命中
+        entry.prefetched = model != nullptr && prefetch;
+        cv_.notify_all();
+        lock.unlock();
+        victims.clear();
+        lock.lock();
+        return model;
+    }
+
+    // 加载前预留的空间: 测得过占用时用测得的占用，否则为驱逐所有可驱逐的模型后剩余的预算(至少为文件大小)
+    uint64_t reservation(const Entry &entry) const
+    {
+        if (entry.measured || config_.budgetBytes == 0)
+        {
+            return entry.footprint;
+        }
+        uint64_t unevictable = stats_.residentBytes - evictable_bytes(&entry);
+        uint64_t headroom = config_.budgetBytes > unevictable ? config_.budgetBytes - unevictable : 0;
+        return std::max(entry.footprint, headroom);
+    }
+
+    // make_room可以驱逐的模型的总占用
+    uint64_t evictable_bytes(const Entry *keep) const
+    {
+        uint64_t bytes = 0;
+        for (const auto &item : entries_)
+        {
+            const Entry &entry = item.second;
+            if (evictable(entry, keep))
+            {
+                bytes += entry.footprint;
+            }
+        }
+        return bytes;
+    }
+
+    bool evictable(const Entry &entry, const Entry *keep) const
+    {
+        return &entry != keep && entry.state == RESIDENT && !entry.pinned && entry.model.use_count() <= 1;
+    }
+
+    // 驱逐模型直到常驻占用 + incoming不超过预算，返回被驱逐的模型，由调用者在释放锁之后卸载
+    std::vector<std::shared_ptr<BackendModel>> make_room(uint64_t incoming, const Entry *keep)
+    {
+        std::vector<std::shared_ptr<BackendModel>> victims;
+        while (config_.budgetBytes > 0 && stats_.residentBytes + incoming > config_.budgetBytes)
+        {
+            Entry *victim = nullptr;
+            for (auto &item : entries_)
+            {
+                Entry &entry = item.second;
+                if (!evictable(entry, keep))
+                {
+                    continue;
+                }
+                if (!victim || evict_before(entry, *victim))
+                {
+                    victim = &entry;
+                }
+            }
+            if (!victim)
+            {
+                if (!overBudgetWarned_)
+                {
+                    LOG(WARNING) << "Model cache is over the budget of " << config_.budgetBytes / 1024 / 1024 << " MB, no model can be evicted";
+                    overBudgetWarned_ = true;
+                }
+                break;
+            }
+            victims.push_back(std::move(victim->model));
+            victim->state = EVICTED;
+            victim->prefetched = false;
+            stats_.residentBytes -= victim->footprint;
+            stats_.evictions++;
+        }
+        return victims;
+    }
+
+    bool evict_before(const Entry &a, const Entry &b) const
+    {
+        if (config_.policy == "lfu" && a.accesses != b.accesses)
+        {
+            return a.accesses < b.accesses;
+        }
+        return a.lastUse < b.lastUse;
+    }
+
+    void prefetch_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            prefetchCv_.wait(lock, [&]()
+                             { return stop_ || !prefetchQueue_.empty(); });
+            if (stop_)
+            {
+                break;
+            }
+            Entry &entry = entries_[prefetchQueue_.front()];
+            prefetchQueue_.pop_front();
+            if (entry.state == EVICTED)
+            {
+                prefetching_ = true;
+                load(entry, lock, true);
+                prefetching_ = false;
+            }
+            cv_.notify_all();
+        }
+    }
+
+    BackendRegistry &registry_;
+    ModelCacheConfig config_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::mutex loadMutex_;
+    std::map<std::string, Entry> entries_;
+    uint64_t tick_ = 0;
+    ModelCacheStats stats_;
+    std::deque<std::string> prefetchQueue_;
+    std::condition_variable prefetchCv_;
+    std::thread prefetcher_;
+    bool prefetching_ = false;
+    bool stop_ = false;
+    bool overBudgetWarned_ = false;
+};
+
+// 解析缓存回放的访问序列:
+// 1. 文件: 每行一个模型路径(相对路径相对于序列文件所在目录)，#开头的行忽略
+// 2. zipf:s,n: 在models中按Zipf(s)分布生成n次访问，排名按models的顺序，s越大访问越集中
+bool load_cache_trace(const std::string &text, const std::vector<std::string> &models, uint32_t seed, std::vector<std::string> &trace)
+{
+    trace.clear();
+    if (text.rfind("zipf:", 0) == 0)
+    {
+        double s = 0;
+        int n = 0;
+        if (models.empty() || sscanf(text.c_str() + 5, "%lf,%d", &s, &n) != 2 || s < 0 || n <= 0)
+        {
+            return false;
+        }
+        std::vector<double> weights;
+        for (size_t rank = 1; rank <= models.size(); rank++)
+        {
+            weights.push_back(1.0 / std::pow((double)rank, s));
+        }
+        std::mt19937 rng(seed);
+        std::discrete_distribution<size_t> dist(weights.begin(), weights.end());
+        for (int i = 0; i < n; i++)
+        {
+            trace.push_back(models[dist(rng)]);
+        }
+        return true;
+    }
+    std::ifstream file(text);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::filesystem::path base = std::filesystem::path(text).parent_path();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::filesystem::path path(line);
+        trace.push_back(path.is_absolute() ? line : (base / path).string());
+    }
+    return !trace.empty();
+}
+
+struct CacheReplayResult
+{
+    ModelCacheStats stats;
+    // 每次访问取得模型的时间(命中时接近0，未命中时为加载时间)和推理时间(us)
+    std::vector<double> acquireUs;
+    std::vector<double> computeUs;
+    int errors = 0;
+};
+
+// 按访问序列依次取得模型并推理一次；prefetch为true时每次访问后预取序列中的下一个模型(调度器提前知道下一个请求)
+CacheReplayResult replay_cache_trace(ModelCache &cache, const std::vector<std::string> &trace, bool prefetch)
+{
+    CacheReplayResult result;
+    std::map<std::string, std::pair<std::vector<std::vector<uint8_t>>, std::vector<std::vector<uint8_t>>>> buffers;
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<BackendModel> model = cache.acquire(trace[i]);
+        auto acquired = std::chrono::steady_clock::now();
+        if (prefetch && i + 1 < trace.size())
+        {
+            cache.prefetch(trace[i + 1]);
+        }
+        if (!model)
+        {
+            result.errors++;
+            continue;
+        }
+        // 输入输出缓冲区按模型路径分配，模型被驱逐后重新加载时继续使用
+        auto &io = buffers[trace[i]];
+        io.first.resize(model->inputs().size());
+        io.second.resize(model->outputs().size());
+        std::vector<const void *> inputs;
+        std::vector<void *> outputs;
+        for (size_t j = 0; j < io.first.size(); j++)
+        {
+            io.first[j].resize(model->inputs()[j].bytes);
+            inputs.push_back(io.first[j].data());
+        }
+        for (size_t j = 0; j < io.second.size(); j++)
+        {
+            io.second[j].resize(model->outputs()[j].bytes);
+            outputs.push_back(io.second[j].data());
+        }
+        bool ok = model->inputs_set(inputs) && model->run() && model->outputs_get(outputs);
+        auto end = std::chrono::steady_clock::now();
+        if (!ok)
+        {
+            result.errors++;
+            continue;
+        }
+        result.acquireUs.push_back(std::chrono::duration<double, std::micro>(acquired - start).count());
+        result.computeUs.push_back(std::chrono::duration<double, std::micro>(end - acquired).count());
+    }
+    cache.drain();
+    result.stats = cache.stats();
+    return result;
+}
+
+#endif
@@ -0,0 +1,523 @@
+#ifndef MODEL_DISCOVERY_HPP
+#define MODEL_DISCOVERY_HPP
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+
+// 模型目录扫描: 多个线程并行列目录(NFS上列目录的延迟远大于CPU开销)，支持多个模式、成对文件(OpenVINO的.xml + .bin)，
+// 没有权限的目录记录警告后跳过。设置cacheFile时把每个目录的mtime和文件列表写入manifest，
+// 下次扫描时mtime没有变化的目录直接使用缓存的列表，只有新增、删除或改名过文件的目录才重新列出。
+// 先扫描不经过符号链接的目录树，再按路径顺序逐轮扫描指向目录的符号链接，同一个目录总是以固定的路径报告，不取决于线程的先后。
+
+struct DiscoveryOptions
+{
+    // 文件名模式(fnmatch，不区分大小写)，以.开头且没有通配符时按扩展名匹配(.rknn)，
+    // 含/时逐段匹配相对扫描目录的路径，单独成段的**匹配零层或多层目录；为空时匹配所有文件
+    std::vector<std::string> patterns;
+    // 成对出现的文件扩展名，例如{".xml", ".bin"}: 没有同名.bin的.xml被跳过，配对的.bin不再单独匹配
+    std::map<std::string, std::string> siblings;
+    // 扫描的目录层数，0只扫描顶层，-1不限
+    int maxDepth = -1;
+    int threads = 8;
+    // manifest缓存文件，为空时不使用缓存
+    std::string cacheFile;
+};
+
+struct DiscoveredModel
+{
+    std::string path;
+    // 配对的文件，顺序与siblings相同
+    std::vector<std::string> siblings;
+    int64_t mtime = 0;
+    uint64_t size = 0;
+};
+
+// 一个目录的文件和子目录名，缓存在manifest中
+struct DirectoryListing
+{
+    int64_t mtime = -1;
+    std::vector<std::string> files;
+    std::vector<std::string> dirs;
+    // 指向目录的符号链接，在不经过符号链接的目录之后扫描
+    std::vector<std::string> links;
+};
+
+int64_t stat_mtime_ns(const struct stat &info)
+{
+    return (int64_t)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+}
+
+std::string lower_extension(const std::string &name)
+{
+    std::string extension = std::filesystem::path(name).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+class ModelScanner
+{
+public:
+    ModelScanner(const std::string &root, const DiscoveryOptions &options)
+        : root_(root), options_(options)
+    {
+        std::error_code ec;
+        absoluteRoot_ = std::filesystem::absolute(root, ec).lexically_normal().string();
+        for (const auto &pattern : options.patterns)
+        {
+            bool has_wildcard = pattern.find_first_of("*?[") != std::string::npos;
+            Matcher matcher;
+            matcher.pattern = !pattern.empty() && pattern[0] == '.' && !has_wildcard ? "*" + pattern : pattern;
+            matcher.matchPath = pattern.find('/') != std::string::npos;
+            if (matcher.matchPath)
+            {
+                matcher.segments = split_path(matcher.pattern);
+            }
+            matchers_.push_back(matcher);
+        }
+    }
+
+    std::vector<DiscoveredModel> scan()
+    {
+        auto start = std::chrono::steady_clock::now();
+        load_cache();
+        queue_.push_back({"", 0, false});
+        run_workers();
+        // 每轮按路径顺序认领符号链接指向的目录，已经访问过(或本轮已被路径更小的链接认领)的跳过，
+        // 再并行扫描认领的目录，其中新的符号链接留到下一轮
+        while (!links_.empty())
+        {
+            std::vector<PendingDirectory> links;
+            links.swap(links_);
+            std::sort(links.begin(), links.end(), [](const PendingDirectory &a, const PendingDirectory &b)
+                      { return a.relative < b.relative; });
+            for (auto &link : links)
+            {
+                struct stat info;
+                if (::stat(full_path(link.relative).c_str(), &info) != 0)
+                {
+                    LOG(WARNING) << "Skip " << full_path(link.relative) << ": " << strerror(errno);
+                    continue;
+                }
+                if (visited_.insert(std::make_pair((uint64_t)info.st_dev, (uint64_t)info.st_ino)).second)
+                {
+                    link.claimed = true;
+                    queue_.push_back(link);
+                }
+            }
+            run_workers();
+        }
+        save_cache();
+        std::sort(models_.begin(), models_.end(), [](const DiscoveredModel &a, const DiscoveredModel &b)
+                  { return a.path < b.path; });
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        LOG(INFO) << "Discovered " << models_.size() << " models in " << listings_.size() << " directories under " << root_ << " ("
+                  << listed_ << " listed, " << listings_.size() - listed_ << " from cache) in " << elapsed << " ms";
+        return models_;
+    }
+
+private:
+    struct Matcher
+    {
+        std::string pattern;
+        bool matchPath = false;
+        // matchPath时按/切开的模式
+        std::vector<std::string> segments;
+    };
+
+    static std::vector<std::string> split_path(const std::string &path)
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= path.size())
+        {
+            size_t end = path.find('/', start);
+            end = end == std::string::npos ? path.size() : end;
+            if (end > start)
+            {
+                parts.push_back(path.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+        return parts;
+    }
+
+    // 从第segment段模式和第part段路径开始逐段匹配，**段依次尝试匹配零段到剩余的全部路径段，其他段用fnmatch匹配一段
+    static bool match_segments(const std::vector<std::string> &segments, size_t segment, const std::vector<std::string> &parts, size_t part)
+    {
+        for (; segment < segments.size(); segment++, part++)
+        {
+            if (segments[segment] == "**")
+            {
+                for (size_t skip = part; skip <= parts.size(); skip++)
+                {
+                    if (match_segments(segments, segment + 1, parts, skip))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            if (part >= parts.size() || fnmatch(segments[segment].c_str(), parts[part].c_str(), FNM_PATHNAME | FNM_CASEFOLD) != 0)
+            {
+                return false;
+            }
+        }
+        return part == parts.size();
+    }
+
+    struct PendingDirectory
+    {
+        std::string relative;
+        int depth;
+        // 符号链接的目标已在scan中认领
+        bool claimed;
+    };
+
+    void run_workers()
+    {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < std::max(options_.threads, 1); i++)
+        {
+            workers.emplace_back(&ModelScanner::worker, this);
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void worker()
+    {
+        while (true)
+        {
+            PendingDirectory directory;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [&]()
+                           { return !queue_.empty() || active_ == 0; });
+                if (queue_.empty())
+                {
+                    return;
+                }
+                directory = queue_.front();
+                queue_.pop_front();
+                active_++;
+            }
+            visit(directory);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                active_--;
+            }
+            cond_.notify_all();
+        }
+    }
+
+    std::string full_path(const std::string &relative) const
+    {
+        return relative.empty() ? root_ : root_ + "/" + relative;
+    }
+
+    void visit(const PendingDirectory &directory)
+    {
+        std::string path = full_path(directory.relative);
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0)
+        {
+            LOG(WARNING) << "Skip " << path << ": " << strerror(errno);
+            return;
+        }
+        DirectoryListing listing;
+        bool cached = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // 每个目录只访问一次(例如绑定挂载)，符号链接在scan中认领
+            if (!directory.claimed && !visited_.insert(std::make_pair((uint64_t)info.st_dev, (uint64_t)info.st_ino)).second)
+            {
+                return;
+            }
+            auto it = cache_.find(directory.relative);
+            if (it != cache_.end() && it->second.mtime == stat_mtime_ns(info))
+            {
+                listing = it->second;
+                cached = true;
+            }
+        }
+        if (!cached && !list_directory(path, listing))
+        {
+            return;
+        }
+        listing.mtime = stat_mtime_ns(info);
+
+        std::vector<DiscoveredModel> models = match(directory.relative, listing);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!cached)
+        {
+            listed_++;
+        }
+        if (options_.maxDepth < 0 || directory.depth < options_.maxDepth)
+        {
+            for (const auto &name : listing.dirs)
+            {
+                queue_.push_back({directory.relative.empty() ? name : directory.relative + "/" + name, directory.depth + 1, false});
+            }
+            for (const auto &name : listing.links)
+            {
+                links_.push_back({directory.relative.empty() ? name : directory.relative + "/" + name, directory.depth + 1, false});
+            }
+            cond_.notify_all();
+        }
+        models_.insert(models_.end(), models.begin(), models.end());
+        listings_[directory.relative] = std::move(listing);
+    }
+
+    bool list_directory(const std::string &path, DirectoryListing &listing)
+    {
+        std::error_code ec;
+        std::filesystem::directory_iterator it(path, ec);
+        for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+        {
+            std::error_code type_ec;
+            std::string name = it->path().filename().string();
+            if (it->is_directory(type_ec))
+            {
+                (it->is_symlink(type_ec) ? listing.links : listing.dirs).push_back(name);
+            }
+            else if (it->is_regular_file(type_ec))
+            {
+                listing.files.push_back(name);
+            }
+        }
+        if (ec)
+        {
+            LOG(WARNING) << "Skip " << path << ": " << ec.message();
+            return false;
+        }
+        std::sort(listing.files.begin(), listing.files.end());
+        std::sort(listing.dirs.begin(), listing.dirs.end());
+        std::sort(listing.links.begin(), listing.links.end());
+        return true;
+    }
+
+    bool matches(const std::string &relative, const std::string &name) const
+    {
+        if (matchers_.empty())
+        {
+            return true;
+        }
+        std::vector<std::string> parts;
+        for (const auto &matcher : matchers_)
+        {
+            if (!matcher.matchPath)
+            {
+                if (fnmatch(matcher.pattern.c_str(), name.c_str(), FNM_CASEFOLD) == 0)
+                {
+                    return true;
+                }
+                continue;
+            }
+            if (parts.empty())
+            {
+                parts = split_path(relative);
+                parts.push_back(name);
+            }
+            if (match_segments(matcher.segments, 0, parts, 0))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 同名不同扩展名的文件，扩展名大小写与已有文件一致时才算存在
+    std::string sibling_name(const std::unordered_set<std::string> &files, const std::string &name, const std::string &extension) const
+    {
+        std::string stem = std::filesystem::path(name).stem().string();
+        std::string upper = extension;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        for (const auto &candidate : {stem + extension, stem + upper})
+        {
+            if (files.count(candidate))
+            {
+                return candidate;
+            }
+        }
+        return "";
+    }
+
+    std::vector<DiscoveredModel> match(const std::string &relative, const DirectoryListing &listing) const
+    {
+        std::vector<DiscoveredModel> models;
+        std::unordered_set<std::string> files(listing.files.begin(), listing.files.end());
+        std::string directory = full_path(relative);
+        for (const auto &name : listing.files)
+        {
+            std::string extension = lower_extension(name);
+            bool paired = false;
+            for (const auto &pair : options_.siblings)
+            {
+                if (extension == pair.second && !sibling_name(files, name, pair.first).empty())
+                {
+                    paired = true;
+                }
+            }
+            if (paired || !matches(relative, name))
+            {
+                continue;
+            }
+            DiscoveredModel model;
+            model.path = directory + "/" + name;
+            auto pair = options_.siblings.find(extension);
+            if (pair != options_.siblings.end())
+            {
+                std::string sibling = sibling_name(files, name, pair->second);
+                if (sibling.empty())
+                {
+                    LOG(WARNING) << "Skip " << model.path << ", cannot find the corresponding " << pair->second << " file";
+                    continue;
+                }
+                model.siblings.push_back(directory + "/" + sibling);
+            }
+            struct stat info;
+            if (::stat(model.path.c_str(), &info) != 0)
+            {
+                LOG(WARNING) << "Skip " << model.path << ": " << strerror(errno);
+                continue;
+            }
+            model.mtime = stat_mtime_ns(info);
+            model.size = (uint64_t)info.st_size;
+            models.push_back(model);
+        }
+        return models;
+    }
+
+    // manifest按扫描目录的绝对路径分开保存，同一个缓存文件可以给多个目录使用
+    void load_cache()
+    {
+        if (options_.cacheFile.empty())
+        {
+            return;
+        }
+        std::ifstream file(options_.cacheFile);
+        if (!file.is_open())
+        {
+            return;
+        }
+        manifest_ = nlohmann::json::parse(file, nullptr, false);
+        if (!manifest_.is_object() || !manifest_.contains("roots"))
+        {
+            LOG(WARNING) << "Ignore the invalid manifest cache " << options_.cacheFile;
+            manifest_ = nlohmann::json::object();
+            return;
+        }
+        const nlohmann::json directories = manifest_["roots"].value(absoluteRoot_, nlohmann::json::object());
+        for (const auto &item : directories.items())
+        {
+            DirectoryListing listing;
+            // 没有links的旧manifest不区分符号链接，这些目录重新列出
+            listing.mtime = item.value().contains("links") ? item.value().value("mtime", (int64_t)-1) : -1;
+            listing.files = item.value().value("files", std::vector<std::string>());
+            listing.dirs = item.value().value("dirs", std::vector<std::string>());
+            listing.links = item.value().value("links", std::vector<std::string>());
+            cache_[item.key()] = std::move(listing);
+        }
+    }
+
+    // 先写临时文件再改名，多个进程同时扫描时不会读到写了一半的manifest
+    void save_cache()
+    {
+        if (options_.cacheFile.empty())
+        {
+            return;
+        }
+        // 限制了层数时没有访问到的目录保留原来的缓存，完整扫描时已删除的目录不再保留
+        std::map<std::string, DirectoryListing> directories = options_.maxDepth < 0 ? std::map<std::string, DirectoryListing>() : cache_;
+        for (const auto &item : listings_)
+        {
+            directories[item.first] = item.second;
+        }
+        nlohmann::json entries = nlohmann::json::object();
+        for (const auto &item : directories)
+        {
+            entries[item.first] = {{"mtime", item.second.mtime}, {"files", item.second.files}, {"dirs", item.second.dirs}, {"links", item.second.links}};
+        }
+        manifest_["roots"][absoluteRoot_] = entries;
+        std::filesystem::path cache_path(options_.cacheFile);
+        std::error_code ec;
+        if (cache_path.has_parent_path())
+        {
+            std::filesystem::create_directories(cache_path.parent_path(), ec);
+        }
+        std::string temp = options_.cacheFile + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream file(temp);
+            file << manifest_.dump();
+        }
+        std::filesystem::rename(temp, options_.cacheFile, ec);
+        if (ec)
+        {
+            LOG(WARNING) << "Failed to write the manifest cache " << options_.cacheFile << ": " << ec.message();
+        }
+    }
+
+    std::string root_;
+    std::string absoluteRoot_;
+    DiscoveryOptions options_;
+    std::vector<Matcher> matchers_;
+    nlohmann::json manifest_ = nlohmann::json::object();
+    std::map<std::string, DirectoryListing> cache_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<PendingDirectory> queue_;
+    std::vector<PendingDirectory> links_;
+    int active_ = 0;
+    size_t listed_ = 0;
+    std::set<std::pair<uint64_t, uint64_t>> visited_;
+    std::map<std::string, DirectoryListing> listings_;
+    std::vector<DiscoveredModel> models_;
+};
+
+// 扫描root下的模型文件，按路径排序
+std::vector<DiscoveredModel> discover_models(const std::string &root, const DiscoveryOptions &options)
+{
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec))
+    {
+        LOG(ERROR) << "Not a directory: " << root;
+        return {};
+    }
+    std::string directory = root;
+    while (directory.size() > 1 && directory.back() == '/')
+    {
+        directory.pop_back();
+    }
+    return ModelScanner(directory, options).scan();
+}
+
+std::vector<std::string> discovered_paths(const std::vector<DiscoveredModel> &models)
+{
+    std::vector<std::string> paths;
+    for (const auto &model : models)
+    {
+        paths.push_back(model.path);
+    }
+    return paths;
+}
+
+#endif
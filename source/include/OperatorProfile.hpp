@@ -0,0 +1,256 @@
+#ifndef OPERATOR_PROFILE_HPP
+#define OPERATOR_PROFILE_HPP
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "Timer.hpp"
+
+// 统一的算子级性能记录，各后端的profiling结果(RKNN perf_detail、OpenVINO profiling info等)都转换成这个格式，
+// 便于在不同加速器之间比较同一个网络的热点算子。没有的字段保持默认值，不写入json。
+struct OperatorRecord
+{
+    int id = -1;
+    // 算子的完整名称，例如Conv:Conv_0
+    std::string name;
+    std::string opType;
+    // 后端实际执行的实现或数据类型，例如OpenVINO的exec_type、RKNN的DataType
+    std::string execType;
+    // 执行单元，例如NPU、CPU
+    std::string target;
+    std::string inputShape;
+    std::string outputShape;
+    // 每次推理的平均耗时(us)，多次推理时另有分位数
+    double timeUs = 0;
+    double p50TimeUs = -1;
+    double p99TimeUs = -1;
+    double cpuTimeUs = -1;
+    int64_t cycles = -1;
+    // MAC利用率(%)
+    double macUsage = -1;
+    // 读写的内存(KB)
+    double rwKB = -1;
+    // 本应在加速器上运行却回退到CPU执行
+    bool fallback = false;
+};
+
+// 多次推理的算子记录按名称累积，得到每个算子的平均耗时和分位数，按第一次出现的顺序输出
+class OperatorSampler
+{
+public:
+    // record.timeUs和record.cpuTimeUs为这一次推理的耗时
+    void add(const OperatorRecord &record)
+    {
+        auto it = index_.find(record.name);
+        if (it == index_.end())
+        {
+            it = index_.emplace(record.name, records_.size()).first;
+            records_.push_back(record);
+            times_.emplace_back();
+            cpuTimes_.emplace_back();
+        }
+        times_[it->second].push_back(record.timeUs);
+        if (record.cpuTimeUs >= 0)
+        {
+            cpuTimes_[it->second].push_back(record.cpuTimeUs);
+        }
+    }
+
+    std::vector<OperatorRecord> records() const
+    {
+        std::vector<OperatorRecord> records(records_);
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const std::vector<double> &times = times_[i];
+            records[i].timeUs = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+            records[i].p50TimeUs = latency_percentile(times, 50);
+            records[i].p99TimeUs = latency_percentile(times, 99);
+            const std::vector<double> &cpuTimes = cpuTimes_[i];
+            records[i].cpuTimeUs = cpuTimes.empty() ? -1 : std::accumulate(cpuTimes.begin(), cpuTimes.end(), 0.0) / cpuTimes.size();
+        }
+        return records;
+    }
+
+private:
+    std::map<std::string, size_t> index_;
+    std::vector<OperatorRecord> records_;
+    std::vector<std::vector<double>> times_;
+    std::vector<std::vector<double>> cpuTimes_;
+};
+
+// 按算子类型汇总的耗时
+struct OperatorTypeSummary
+{
+    std::string opType;
+    int count = 0;
+    int fallbacks = 0;
+    double timeUs = 0;
+    double percent = 0;
+};
+
+double operator_total_time(const std::vector<OperatorRecord> &records)
+{
+    double total = 0;
+    for (const auto &record : records)
+    {
+        total += record.timeUs;
+    }
+    return total;
+}
+
+std::vector<OperatorTypeSummary> summarize_operator_types(const std::vector<OperatorRecord> &records)
+{
+    std::map<std::string, OperatorTypeSummary> types;
+    for (const auto &record : records)
+    {
+        OperatorTypeSummary &summary = types[record.opType];
+        summary.opType = record.opType;
+        summary.count++;
+        summary.fallbacks += record.fallback ? 1 : 0;
+        summary.timeUs += record.timeUs;
+    }
+    double total = operator_total_time(records);
+    std::vector<OperatorTypeSummary> summaries;
+    for (auto &item : types)
+    {
+        item.second.percent = total > 0 ? item.second.timeUs / total * 100 : 0;
+        summaries.push_back(item.second);
+    }
+    std::stable_sort(summaries.begin(), summaries.end(), [](const OperatorTypeSummary &a, const OperatorTypeSummary &b)
+                     { return a.timeUs > b.timeUs; });
+    return summaries;
+}
+
+// 耗时最多的top_n个算子
+std::vector<OperatorRecord> operator_hotspots(const std::vector<OperatorRecord> &records, int top_n)
+{
+    std::vector<OperatorRecord> hotspots(records);
+    std::stable_sort(hotspots.begin(), hotspots.end(), [](const OperatorRecord &a, const OperatorRecord &b)
+                     { return a.timeUs > b.timeUs; });
+    if (top_n >= 0 && (size_t)top_n < hotspots.size())
+    {
+        hotspots.resize(top_n);
+    }
+    return hotspots;
+}
+
+nlohmann::json operator_record_json(const OperatorRecord &record)
+{
+    nlohmann::json item;
+    item["Id"] = record.id;
+    item["Name"] = record.name;
+    item["OpType"] = record.opType;
+    if (!record.execType.empty())
+        item["ExecType"] = record.execType;
+    if (!record.target.empty())
+        item["Target"] = record.target;
+    if (!record.inputShape.empty())
+        item["InputShape"] = record.inputShape;
+    if (!record.outputShape.empty())
+        item["OutputShape"] = record.outputShape;
+    item["Time"] = record.timeUs;
+    if (record.p50TimeUs >= 0)
+        item["P50Time"] = record.p50TimeUs;
+    if (record.p99TimeUs >= 0)
+        item["P99Time"] = record.p99TimeUs;
+    if (record.cpuTimeUs >= 0)
+        item["CpuTime"] = record.cpuTimeUs;
+    if (record.cycles >= 0)
+        item["Cycles"] = record.cycles;
+    if (record.macUsage >= 0)
+        item["MacUsage"] = record.macUsage;
+    if (record.rwKB >= 0)
+        item["RW"] = record.rwKB;
+    item["Fallback"] = record.fallback;
+    return item;
+}
+
+// 结果中的OperatorProfile: 全部算子、按类型汇总、top_n热点和回退到CPU的算子，时间单位为us
+nlohmann::json operator_profile_json(const std::vector<OperatorRecord> &records, int top_n)
+{
+    nlohmann::json profile;
+    profile["TotalTime"] = operator_total_time(records);
+    profile["Operators"] = nlohmann::json::array();
+    profile["Fallbacks"] = nlohmann::json::array();
+    for (const auto &record : records)
+    {
+        profile["Operators"].push_back(operator_record_json(record));
+        if (record.fallback)
+        {
+            profile["Fallbacks"].push_back(operator_record_json(record));
+        }
+    }
+    profile["OpTypes"] = nlohmann::json::array();
+    for (const auto &summary : summarize_operator_types(records))
+    {
+        profile["OpTypes"].push_back({{"OpType", summary.opType},
+                                      {"Count", summary.count},
+                                      {"Fallbacks", summary.fallbacks},
+                                      {"Time", summary.timeUs},
+                                      {"Percent", summary.percent}});
+    }
+    profile["Hotspots"] = nlohmann::json::array();
+    for (const auto &record : operator_hotspots(records, top_n))
+    {
+        profile["Hotspots"].push_back(operator_record_json(record));
+    }
+    return profile;
+}
+
+// 算子记录转换为时间线上依次排列的区间(TRACE_SPANS)，回退到CPU的算子单独归类，参数为完整的算子记录
+std::vector<TraceSpan> operator_trace_spans(const std::vector<OperatorRecord> &records)
+{
+    std::vector<TraceSpan> spans;
+    for (const auto &record : records)
+    {
+        spans.push_back({record.opType.empty() ? record.name : record.opType,
+                         record.fallback ? "operator,fallback" : "operator",
+                         record.timeUs,
+                         operator_record_json(record)});
+    }
+    return spans;
+}
+
+void log_operator_profile(const std::string &model, const std::vector<OperatorRecord> &records, int top_n)
+{
+    double total = operator_total_time(records);
+    tabulate::Table hotspotTable;
+    hotspotTable.add_row({"id", "name", "op type", "target", "time(us)", "percent", "fallback"});
+    for (const auto &record : operator_hotspots(records, top_n))
+    {
+        hotspotTable.add_row({std::to_string(record.id),
+                              record.name,
+                              record.opType,
+                              record.target,
+                              std::to_string(record.timeUs),
+                              std::to_string(total > 0 ? record.timeUs / total * 100 : 0),
+                              record.fallback ? "yes" : ""});
+    }
+    for (size_t i = 0; i < 7; ++i)
+    {
+        hotspotTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    tabulate::Table typeTable;
+    typeTable.add_row({"op type", "count", "time(us)", "percent", "fallbacks"});
+    for (const auto &summary : summarize_operator_types(records))
+    {
+        typeTable.add_row({summary.opType,
+                           std::to_string(summary.count),
+                           std::to_string(summary.timeUs),
+                           std::to_string(summary.percent),
+                           std::to_string(summary.fallbacks)});
+    }
+    for (size_t i = 0; i < 5; ++i)
+    {
+        typeTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "Operator hotspots of " << model << ", total " << total << " us:\n"
+              << hotspotTable << "\n"
+              << typeTable << "\n";
+}
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+// 多核NPU的放置扫描: 同一个模型在每种核心分配方式下运行，比较延迟和吞吐，给出推荐的配置。
+// 分配方式包括单核(每个核心各测一次)、一个请求跨多个核心、多个上下文各绑定一个核心的数据并行和驱动自动分配。
+// 扫描逻辑与后端无关，后端只需要按配置创建推理函数(见PlacementSetup)，因此可以在模拟后端上测试。
+
+// 一种核心分配方式
+struct PlacementConfig
+{
+    // 例如core0、core0_1_2、dp3、auto
+    std::string name;
+    // 同时运行的上下文(请求)个数，数据并行时每个核心一个
+    int instances = 1;
+    // 后端参数，例如RKNN每个上下文的核心掩码{"CoreMasks": [1, 2, 4]}，原样写入结果
+    nlohmann::json settings;
+};
+
+// 按配置创建instances个推理函数，每个函数在自己的线程中闭环运行；
+// 函数捕获的资源(上下文、缓冲区)在返回的vector销毁时释放，失败时返回false，该配置被跳过
+using PlacementSetup = std::function<bool(const PlacementConfig &config, std::vector<std::function<void()>> &infers)>;
+
+struct PlacementResult
+{
+    PlacementConfig config;
+    bool supported = false;
+    uint64_t requests = 0;
+    double throughput = 0;
+    double avgLatency = 0;
+    double p50Latency = 0;
+    double p99Latency = 0;
+};
+
+// 每个上下文先预热num_warmup次，然后所有上下文同时闭环运行num_run次，吞吐为总请求数除以墙钟时间
+PlacementResult run_placement(const PlacementConfig &config, const PlacementSetup &setup, int num_warmup, int num_run)
+{
+    PlacementResult result;
+    result.config = config;
+    std::vector<std::function<void()>> infers;
+    if (!setup(config, infers) || infers.empty())
+    {
+        LOG(WARNING) << "Placement " << config.name << " is not supported, skipped.";
+        return result;
+    }
+    result.supported = true;
+    // 后端可以按设备的建议创建不同个数的上下文(例如OpenVINO的吞吐模式)
+    result.config.instances = (int)infers.size();
+    for (auto &infer : infers)
+    {
+        for (int i = 0; i < num_warmup; i++)
+        {
+            infer();
+        }
+    }
+    std::vector<std::vector<double>> latencies(infers.size());
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t index = 0; index < infers.size(); index++)
+    {
+        threads.emplace_back([&, index]()
+                             {
+            TRACE_THREAD_NAME("placement " + config.name + " #" + std::to_string(index));
+            latencies[index].reserve(num_run);
+            for (int i = 0; i < num_run; i++)
+            {
+                auto begin = std::chrono::steady_clock::now();
+                TRACE_BEGIN("request");
+                infers[index]();
+                TRACE_END("request");
+                latencies[index].push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::vector<double> all;
+    for (const auto &values : latencies)
+    {
+        all.insert(all.end(), values.begin(), values.end());
+    }
+    result.requests = all.size();
+    result.throughput = elapsed > 0 ? all.size() / elapsed : 0;
+    if (!all.empty())
+    {
+        result.avgLatency = std::accumulate(all.begin(), all.end(), 0.0) / all.size();
+        result.p50Latency = latency_percentile(all, 50);
+        result.p99Latency = latency_percentile(all, 99);
+    }
+    return result;
+}
+
+std::vector<PlacementResult> run_placement_sweep(const std::vector<PlacementConfig> &configs, const PlacementSetup &setup, int num_warmup, int num_run)
+{
+    std::vector<PlacementResult> results;
+    for (const auto &config : configs)
+    {
+        LOG(INFO) << "Placement " << config.name << ", instances " << config.instances << ", settings " << config.settings.dump();
+        results.push_back(run_placement(config, setup, num_warmup, num_run));
+    }
+    return results;
+}
+
+// 推荐: 延迟优先选平均延迟最小的配置，吞吐优先选吞吐最大的配置
+nlohmann::json placement_sweep_json(const std::vector<PlacementResult> &results)
+{
+    nlohmann::json sweep;
+    const PlacementResult *bestLatency = nullptr;
+    const PlacementResult *bestThroughput = nullptr;
+    for (const auto &result : results)
+    {
+        nlohmann::json item;
+        item["Name"] = result.config.name;
+        item["Instances"] = result.config.instances;
+        item["Settings"] = result.config.settings;
+        item["Supported"] = result.supported;
+        if (result.supported)
+        {
+            item["Requests"] = result.requests;
+            item["Throughput"] = result.throughput;
+            item["AvgLatency"] = result.avgLatency;
+            item["P50Latency"] = result.p50Latency;
+            item["P99Latency"] = result.p99Latency;
+            if (!bestLatency || result.avgLatency < bestLatency->avgLatency)
+            {
+                bestLatency = &result;
+            }
+            if (!bestThroughput || result.throughput > bestThroughput->throughput)
+            {
+                bestThroughput = &result;
+            }
+        }
+        sweep["Placements"].push_back(item);
+    }
+    if (bestLatency)
+    {
+        sweep["RecommendedForLatency"] = {{"Name", bestLatency->config.name}, {"Settings", bestLatency->config.settings}, {"AvgLatency", bestLatency->avgLatency}};
+        sweep["RecommendedForThroughput"] = {{"Name", bestThroughput->config.name}, {"Instances", bestThroughput->config.instances}, {"Settings", bestThroughput->config.settings}, {"Throughput", bestThroughput->throughput}};
+    }
+    return sweep;
+}
+
+void log_placement_sweep(const std::string &model, const std::vector<PlacementResult> &results)
+{
+    tabulate::Table placementTable;
+    placementTable.add_row({"placement", "instances", "avg(us)", "p50(us)", "p99(us)", "throughput(req/s)"});
+    for (const auto &result : results)
+    {
+        if (!result.supported)
+        {
+            placementTable.add_row({result.config.name, std::to_string(result.config.instances), "-", "-", "-", "-"});
+            continue;
+        }
+        placementTable.add_row({result.config.name,
+                                std::to_string(result.config.instances),
+                                std::to_string(result.avgLatency),
+                                std::to_string(result.p50Latency),
+                                std::to_string(result.p99Latency),
+                                std::to_string(result.throughput)});
+    }
+    for (size_t i = 0; i < 6; ++i)
+    {
+        placementTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "Placement sweep of " << model << ":\n"
+              << placementTable << "\n";
+}
+
+#endif
@@ -0,0 +1,910 @@
+#ifndef POSTPROCESS_HPP
+#define POSTPROCESS_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Preprocess.hpp"
+
+// 推理后处理kernel: 反量化、softmax、top-k以及检测模型的候选框解码和NMS。
+// 与Preprocess.hpp一样，每个kernel都有标量参考实现(*_ref)，不带后缀的版本在运行时分派到AVX2或NEON。
+// 反量化、top-k、解码和NMS的结果与参考实现完全一致；softmax使用多项式近似的exp，相对误差在1e-6以内。
+
+// 一个top-k或NMS结果，index为在输入中的下标
+struct ScoredIndex
+{
+    int index;
+    float score;
+};
+
+// 候选框按SoA存放，NMS时每个分量都是连续的数组，便于一次比较多个框
+struct DetectionBoxes
+{
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> x2;
+    std::vector<float> y2;
+    std::vector<float> score;
+    std::vector<int> classId;
+
+    size_t size() const
+    {
+        return score.size();
+    }
+
+    void clear()
+    {
+        x1.clear();
+        y1.clear();
+        x2.clear();
+        y2.clear();
+        score.clear();
+        classId.clear();
+    }
+
+    void push_back(float bx1, float by1, float bx2, float by2, float s, int c)
+    {
+        x1.push_back(bx1);
+        y1.push_back(by1);
+        x2.push_back(bx2);
+        y2.push_back(by2);
+        score.push_back(s);
+        classId.push_back(c);
+    }
+};
+
+struct DetectParams
+{
+    // 类别分数不超过阈值的框在解码时直接丢弃
+    float scoreThreshold = 0.25f;
+    float iouThreshold = 0.45f;
+    // 保留的框达到这个数量后NMS提前结束
+    int maxDetections = 100;
+    // 进入NMS的候选框上限，按分数取前maxCandidates个
+    int maxCandidates = 1000;
+    // 为true时只在同类别的框之间抑制
+    bool classAware = true;
+    // 类别分数是logit时，用logit(scoreThreshold)比较，只对保留下来的框计算sigmoid
+    bool sigmoid = false;
+};
+
+/************************************ 反量化 ************************************/
+
+// x = (q - zeroPoint) * scale
+template <typename T>
+void dequantize_ref(const T *src, float *dst, size_t count, const QuantParams &quant)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] = (float)((int32_t)src[i] - quant.zeroPoint) * quant.scale;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 一次读取8个元素并扩展为int32
+PREPROCESS_TARGET_AVX2 static inline __m256i load8_epi32(const int8_t *src)
+{
+    return _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)src));
+}
+
+PREPROCESS_TARGET_AVX2 static inline __m256i load8_epi32(const uint8_t *src)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src));
+}
+
+PREPROCESS_TARGET_AVX2 static inline __m256i load8_epi32(const int16_t *src)
+{
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)src));
+}
+
+PREPROCESS_TARGET_AVX2 static inline __m256i load8_epi32(const int32_t *src)
+{
+    return _mm256_loadu_si256((const __m256i *)src);
+}
+
+template <typename T>
+PREPROCESS_TARGET_AVX2 void dequantize_avx2(const T *src, float *dst, size_t count, const QuantParams &quant)
+{
+    const __m256i zeroPoint = _mm256_set1_epi32(quant.zeroPoint);
+    const __m256 scale = _mm256_set1_ps(quant.scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 value = _mm256_cvtepi32_ps(_mm256_sub_epi32(load8_epi32(src + i), zeroPoint));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(value, scale));
+    }
+    dequantize_ref(src + i, dst + i, count - i, quant);
+}
+#elif defined(__aarch64__)
+static inline void load8_s32(const int8_t *src, int32x4_t &lo, int32x4_t &hi)
+{
+    int16x8_t value = vmovl_s8(vld1_s8(src));
+    lo = vmovl_s16(vget_low_s16(value));
+    hi = vmovl_s16(vget_high_s16(value));
+}
+
+static inline void load8_s32(const uint8_t *src, int32x4_t &lo, int32x4_t &hi)
+{
+    uint16x8_t value = vmovl_u8(vld1_u8(src));
+    lo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(value)));
+    hi = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(value)));
+}
+
+static inline void load8_s32(const int16_t *src, int32x4_t &lo, int32x4_t &hi)
+{
+    int16x8_t value = vld1q_s16(src);
+    lo = vmovl_s16(vget_low_s16(value));
+    hi = vmovl_s16(vget_high_s16(value));
+}
+
+static inline void load8_s32(const int32_t *src, int32x4_t &lo, int32x4_t &hi)
+{
+    lo = vld1q_s32(src);
+    hi = vld1q_s32(src + 4);
+}
+
+template <typename T>
+void dequantize_neon(const T *src, float *dst, size_t count, const QuantParams &quant)
+{
+    const int32x4_t zeroPoint = vdupq_n_s32(quant.zeroPoint);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        int32x4_t lo, hi;
+        load8_s32(src + i, lo, hi);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vsubq_s32(lo, zeroPoint)), quant.scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vsubq_s32(hi, zeroPoint)), quant.scale));
+    }
+    dequantize_ref(src + i, dst + i, count - i, quant);
+}
+#endif
+
+// 支持int8、uint8、int16、int32的输出
+template <typename T>
+void dequantize(const T *src, float *dst, size_t count, const QuantParams &quant)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        dequantize_avx2(src, dst, count, quant);
+        return;
+    }
+#elif defined(__aarch64__)
+    dequantize_neon(src, dst, count, quant);
+    return;
+#endif
+    dequantize_ref(src, dst, count, quant);
+}
+
+// 按某一维(per-channel)量化的张量: [outer, channels, inner]，每个通道一组scale/zeroPoint
+template <typename T>
+void dequantize_per_axis(const T *src, float *dst, size_t outer, size_t channels, size_t inner,
+                         const float *scales, const int32_t *zeroPoints)
+{
+    for (size_t o = 0; o < outer; o++)
+    {
+        for (size_t c = 0; c < channels; c++)
+        {
+            size_t offset = (o * channels + c) * inner;
+            dequantize(src + offset, dst + offset, inner, QuantParams{scales[c], zeroPoints ? zeroPoints[c] : 0});
+        }
+    }
+}
+
+/************************************ softmax ************************************/
+
+void softmax_ref(const float *src, float *dst, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    float maxValue = *std::max_element(src, src + count);
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] = std::exp(src[i] - maxValue);
+        sum += dst[i];
+    }
+    float inverse = 1.0f / sum;
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] *= inverse;
+    }
+}
+
+// exp的多项式近似(Cephes expf)，x = n * ln2 + r，exp(x) = 2^n * P(r)
+#define POSTPROCESS_EXP_HI 88.3762626647949f
+#define POSTPROCESS_EXP_LO -87.3365447504019f
+#define POSTPROCESS_LOG2E 1.44269504088896341f
+#define POSTPROCESS_LN2_HI 0.693359375f
+#define POSTPROCESS_LN2_LO -2.12194440e-4f
+
+#if defined(__x86_64__) || defined(__i386__)
+PREPROCESS_TARGET_AVX2 static inline __m256 exp_avx2(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(POSTPROCESS_EXP_LO)), _mm256_set1_ps(POSTPROCESS_EXP_HI));
+    __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(POSTPROCESS_LOG2E), _mm256_set1_ps(0.5f)));
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(POSTPROCESS_LN2_HI), x);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(POSTPROCESS_LN2_LO), x);
+    __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507e-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073e-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894e-2f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201e-1f));
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+    __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+}
+
+PREPROCESS_TARGET_AVX2 void softmax_avx2(const float *src, float *dst, size_t count)
+{
+    size_t i = 0;
+    __m256 maxVector = _mm256_set1_ps(-INFINITY);
+    for (; i + 8 <= count; i += 8)
+    {
+        maxVector = _mm256_max_ps(maxVector, _mm256_loadu_ps(src + i));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, maxVector);
+    float maxValue = *std::max_element(lanes, lanes + 8);
+    for (; i < count; i++)
+    {
+        maxValue = std::max(maxValue, src[i]);
+    }
+    __m256 sumVector = _mm256_setzero_ps();
+    __m256 maxBroadcast = _mm256_set1_ps(maxValue);
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        __m256 value = exp_avx2(_mm256_sub_ps(_mm256_loadu_ps(src + i), maxBroadcast));
+        _mm256_storeu_ps(dst + i, value);
+        sumVector = _mm256_add_ps(sumVector, value);
+    }
+    _mm256_storeu_ps(lanes, sumVector);
+    float sum = 0.0f;
+    for (float lane : lanes)
+    {
+        sum += lane;
+    }
+    for (; i < count; i++)
+    {
+        dst[i] = std::exp(src[i] - maxValue);
+        sum += dst[i];
+    }
+    float inverse = 1.0f / sum;
+    for (i = 0; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_set1_ps(inverse)));
+    }
+    for (; i < count; i++)
+    {
+        dst[i] *= inverse;
+    }
+}
+#elif defined(__aarch64__)
+static inline float32x4_t exp_neon(float32x4_t x)
+{
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(POSTPROCESS_EXP_LO)), vdupq_n_f32(POSTPROCESS_EXP_HI));
+    float32x4_t n = vrndmq_f32(vfmaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(POSTPROCESS_LOG2E)));
+    x = vfmsq_f32(x, n, vdupq_n_f32(POSTPROCESS_LN2_HI));
+    x = vfmsq_f32(x, n, vdupq_n_f32(POSTPROCESS_LN2_LO));
+    float32x4_t y = vdupq_n_f32(1.9875691500e-4f);
+    y = vfmaq_f32(vdupq_n_f32(1.3981999507e-3f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(8.3334519073e-3f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(4.1665795894e-2f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(1.6666665459e-1f), y, x);
+    y = vfmaq_f32(vdupq_n_f32(5.0000001201e-1f), y, x);
+    y = vfmaq_f32(vaddq_f32(x, vdupq_n_f32(1.0f)), y, vmulq_f32(x, x));
+    int32x4_t exponent = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+    return vmulq_f32(y, vreinterpretq_f32_s32(exponent));
+}
+
+void softmax_neon(const float *src, float *dst, size_t count)
+{
+    size_t i = 0;
+    float32x4_t maxVector = vdupq_n_f32(-INFINITY);
+    for (; i + 4 <= count; i += 4)
+    {
+        maxVector = vmaxq_f32(maxVector, vld1q_f32(src + i));
+    }
+    float maxValue = vmaxvq_f32(maxVector);
+    for (; i < count; i++)
+    {
+        maxValue = std::max(maxValue, src[i]);
+    }
+    float32x4_t sumVector = vdupq_n_f32(0.0f);
+    float32x4_t maxBroadcast = vdupq_n_f32(maxValue);
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        float32x4_t value = exp_neon(vsubq_f32(vld1q_f32(src + i), maxBroadcast));
+        vst1q_f32(dst + i, value);
+        sumVector = vaddq_f32(sumVector, value);
+    }
+    float sum = vaddvq_f32(sumVector);
+    for (; i < count; i++)
+    {
+        dst[i] = std::exp(src[i] - maxValue);
+        sum += dst[i];
+    }
+    float inverse = 1.0f / sum;
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(dst + i), inverse));
+    }
+    for (; i < count; i++)
+    {
+        dst[i] *= inverse;
+    }
+}
+#endif
+
+void softmax(const float *src, float *dst, size_t count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        softmax_avx2(src, dst, count);
+        return;
+    }
+#elif defined(__aarch64__)
+    softmax_neon(src, dst, count);
+    return;
+#endif
+    softmax_ref(src, dst, count);
+}
+
+/************************************ top-k ************************************/
+
+// 分数高的在前，分数相同时下标小的在前
+inline bool scored_index_better(const ScoredIndex &a, const ScoredIndex &b)
+{
+    return a.score > b.score || (a.score == b.score && a.index < b.index);
+}
+
+std::vector<ScoredIndex> topk_ref(const float *scores, size_t count, size_t k)
+{
+    std::vector<ScoredIndex> items(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        items[i] = {(int)i, scores[i]};
+    }
+    k = std::min(k, count);
+    std::partial_sort(items.begin(), items.begin() + k, items.end(), scored_index_better);
+    items.resize(k);
+    return items;
+}
+
+// 大小为k的小顶堆，堆顶是当前第k名。按下标递增扫描，分数严格大于堆顶才需要入堆
+struct TopkHeap
+{
+    std::vector<ScoredIndex> heap;
+    size_t k;
+
+    explicit TopkHeap(size_t topk) : k(topk)
+    {
+        heap.reserve(topk);
+    }
+
+    float threshold() const
+    {
+        return heap.size() < k ? -INFINITY : heap.front().score;
+    }
+
+    void push(int index, float score)
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back({index, score});
+            std::push_heap(heap.begin(), heap.end(), scored_index_better);
+        }
+        else if (score > heap.front().score)
+        {
+            std::pop_heap(heap.begin(), heap.end(), scored_index_better);
+            heap.back() = {index, score};
+            std::push_heap(heap.begin(), heap.end(), scored_index_better);
+        }
+    }
+
+    std::vector<ScoredIndex> sorted()
+    {
+        std::sort(heap.begin(), heap.end(), scored_index_better);
+        return heap;
+    }
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+// 大部分元素都不超过堆顶，一次比较8个元素，全部不超过时整块跳过
+PREPROCESS_TARGET_AVX2 void topk_scan_avx2(const float *scores, size_t count, TopkHeap &heap)
+{
+    size_t i = 0;
+    for (; i < count && heap.heap.size() < heap.k; i++)
+    {
+        heap.push((int)i, scores[i]);
+    }
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 value = _mm256_loadu_ps(scores + i);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(value, _mm256_set1_ps(heap.threshold()), _CMP_GT_OQ));
+        while (mask)
+        {
+            int lane = __builtin_ctz(mask);
+            heap.push((int)(i + lane), scores[i + lane]);
+            mask &= mask - 1;
+        }
+    }
+    for (; i < count; i++)
+    {
+        heap.push((int)i, scores[i]);
+    }
+}
+#elif defined(__aarch64__)
+void topk_scan_neon(const float *scores, size_t count, TopkHeap &heap)
+{
+    size_t i = 0;
+    for (; i < count && heap.heap.size() < heap.k; i++)
+    {
+        heap.push((int)i, scores[i]);
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32x4_t mask = vcgtq_f32(vld1q_f32(scores + i), vdupq_n_f32(heap.threshold()));
+        if (vmaxvq_u32(mask) == 0)
+        {
+            continue;
+        }
+        for (size_t lane = i; lane < i + 4; lane++)
+        {
+            heap.push((int)lane, scores[lane]);
+        }
+    }
+    for (; i < count; i++)
+    {
+        heap.push((int)i, scores[i]);
+    }
+}
+#endif
+
+std::vector<ScoredIndex> topk(const float *scores, size_t count, size_t k)
+{
+    TopkHeap heap(std::min(k, count));
+    if (heap.k == 0)
+    {
+        return {};
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        topk_scan_avx2(scores, count, heap);
+        return heap.sorted();
+    }
+#elif defined(__aarch64__)
+    topk_scan_neon(scores, count, heap);
+    return heap.sorted();
+#endif
+    for (size_t i = 0; i < count; i++)
+    {
+        heap.push((int)i, scores[i]);
+    }
+    return heap.sorted();
+}
+
+/************************************ 检测框解码 ************************************/
+
+// 分数阈值在logit空间里的值，sigmoid单调，比较logit与比较概率等价
+inline float detection_threshold(const DetectParams &params)
+{
+    if (!params.sigmoid)
+    {
+        return params.scoreThreshold;
+    }
+    float p = std::min(std::max(params.scoreThreshold, 1e-7f), 1.0f - 1e-7f);
+    return std::log(p / (1.0f - p));
+}
+
+inline void push_detection(const float *data, size_t numBoxes, size_t box, int classId, float score, bool sigmoid, DetectionBoxes &boxes)
+{
+    float cx = data[box];
+    float cy = data[numBoxes + box];
+    float halfW = data[2 * numBoxes + box] * 0.5f;
+    float halfH = data[3 * numBoxes + box] * 0.5f;
+    if (sigmoid)
+    {
+        score = 1.0f / (1.0f + std::exp(-score));
+    }
+    boxes.push_back(cx - halfW, cy - halfH, cx + halfW, cy + halfH, score, classId);
+}
+
+void decode_detections_range(const float *data, size_t numBoxes, size_t numClasses, size_t begin, const DetectParams &params, DetectionBoxes &boxes)
+{
+    float threshold = detection_threshold(params);
+    const float *classScores = data + 4 * numBoxes;
+    for (size_t box = begin; box < numBoxes; box++)
+    {
+        float best = classScores[box];
+        int bestClass = 0;
+        for (size_t c = 1; c < numClasses; c++)
+        {
+            float value = classScores[c * numBoxes + box];
+            if (value > best)
+            {
+                best = value;
+                bestClass = (int)c;
+            }
+        }
+        if (best > threshold)
+        {
+            push_detection(data, numBoxes, box, bestClass, best, params.sigmoid, boxes);
+        }
+    }
+}
+
+// YOLOv8风格的输出[4 + numClasses, numBoxes]: 前4行为cx, cy, w, h，其余每行是一个类别的分数。
+// 每个框取分数最高的类别，超过阈值的框转换为x1, y1, x2, y2追加到boxes
+void decode_detections_ref(const float *data, size_t numBoxes, size_t numClasses, const DetectParams &params, DetectionBoxes &boxes)
+{
+    boxes.clear();
+    decode_detections_range(data, numBoxes, numClasses, 0, params, boxes);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 类别分数按行连续存放，一次对8个框逐行取最大值，每行的访问都是连续的
+PREPROCESS_TARGET_AVX2 void decode_detections_avx2(const float *data, size_t numBoxes, size_t numClasses, const DetectParams &params, DetectionBoxes &boxes)
+{
+    const __m256 threshold = _mm256_set1_ps(detection_threshold(params));
+    const float *classScores = data + 4 * numBoxes;
+    size_t box = 0;
+    for (; box + 8 <= numBoxes; box += 8)
+    {
+        __m256 best = _mm256_loadu_ps(classScores + box);
+        __m256i bestClass = _mm256_setzero_si256();
+        for (size_t c = 1; c < numClasses; c++)
+        {
+            __m256 value = _mm256_loadu_ps(classScores + c * numBoxes + box);
+            __m256 greater = _mm256_cmp_ps(value, best, _CMP_GT_OQ);
+            best = _mm256_blendv_ps(best, value, greater);
+            bestClass = _mm256_blendv_epi8(bestClass, _mm256_set1_epi32((int)c), _mm256_castps_si256(greater));
+        }
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(best, threshold, _CMP_GT_OQ));
+        if (mask == 0)
+        {
+            continue;
+        }
+        float scores[8];
+        int classes[8];
+        _mm256_storeu_ps(scores, best);
+        _mm256_storeu_si256((__m256i *)classes, bestClass);
+        while (mask)
+        {
+            int lane = __builtin_ctz(mask);
+            push_detection(data, numBoxes, box + lane, classes[lane], scores[lane], params.sigmoid, boxes);
+            mask &= mask - 1;
+        }
+    }
+    decode_detections_range(data, numBoxes, numClasses, box, params, boxes);
+}
+#elif defined(__aarch64__)
+void decode_detections_neon(const float *data, size_t numBoxes, size_t numClasses, const DetectParams &params, DetectionBoxes &boxes)
+{
+    const float32x4_t threshold = vdupq_n_f32(detection_threshold(params));
+    const float *classScores = data + 4 * numBoxes;
+    size_t box = 0;
+    for (; box + 4 <= numBoxes; box += 4)
+    {
+        float32x4_t best = vld1q_f32(classScores + box);
+        uint32x4_t bestClass = vdupq_n_u32(0);
+        for (size_t c = 1; c < numClasses; c++)
+        {
+            float32x4_t value = vld1q_f32(classScores + c * numBoxes + box);
+            uint32x4_t greater = vcgtq_f32(value, best);
+            best = vbslq_f32(greater, value, best);
+            bestClass = vbslq_u32(greater, vdupq_n_u32((uint32_t)c), bestClass);
+        }
+        uint32x4_t mask = vcgtq_f32(best, threshold);
+        if (vmaxvq_u32(mask) == 0)
+        {
+            continue;
+        }
+        float scores[4];
+        uint32_t classes[4], passed[4];
+        vst1q_f32(scores, best);
+        vst1q_u32(classes, bestClass);
+        vst1q_u32(passed, mask);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (passed[lane])
+            {
+                push_detection(data, numBoxes, box + lane, (int)classes[lane], scores[lane], params.sigmoid, boxes);
+            }
+        }
+    }
+    decode_detections_range(data, numBoxes, numClasses, box, params, boxes);
+}
+#endif
+
+void decode_detections(const float *data, size_t numBoxes, size_t numClasses, const DetectParams &params, DetectionBoxes &boxes)
+{
+    boxes.clear();
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        decode_detections_avx2(data, numBoxes, numClasses, params, boxes);
+        return;
+    }
+#elif defined(__aarch64__)
+    decode_detections_neon(data, numBoxes, numClasses, params, boxes);
+    return;
+#endif
+    decode_detections_range(data, numBoxes, numClasses, 0, params, boxes);
+}
+
+/************************************ NMS ************************************/
+
+// 按分数从高到低排序，只保留前maxCandidates个候选框
+std::vector<int> sort_candidates(const DetectionBoxes &boxes, int maxCandidates)
+{
+    std::vector<ScoredIndex> items(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        items[i] = {(int)i, boxes.score[i]};
+    }
+    size_t keep = std::min(items.size(), (size_t)std::max(maxCandidates, 0));
+    std::partial_sort(items.begin(), items.begin() + keep, items.end(), scored_index_better);
+    std::vector<int> order(keep);
+    for (size_t i = 0; i < keep; i++)
+    {
+        order[i] = items[i].index;
+    }
+    return order;
+}
+
+// IoU > threshold 写成 inter > threshold * union，避免除法
+inline bool iou_exceeds(float ax1, float ay1, float ax2, float ay2, float bx1, float by1, float bx2, float by2, float threshold)
+{
+    float w = std::max(std::min(ax2, bx2) - std::max(ax1, bx1), 0.0f);
+    float h = std::max(std::min(ay2, by2) - std::max(ay1, by1), 0.0f);
+    float inter = w * h;
+    float areaA = (ax2 - ax1) * (ay2 - ay1);
+    float areaB = (bx2 - bx1) * (by2 - by1);
+    return inter > threshold * (areaA + areaB - inter);
+}
+
+// 经典的贪心NMS: 每个候选框与已经保留的所有框比较。返回保留的框在boxes中的下标和分数
+std::vector<ScoredIndex> nms_ref(const DetectionBoxes &boxes, const DetectParams &params)
+{
+    std::vector<ScoredIndex> kept;
+    for (int index : sort_candidates(boxes, params.maxCandidates))
+    {
+        if ((int)kept.size() >= params.maxDetections)
+        {
+            break;
+        }
+        bool suppressed = false;
+        for (const auto &item : kept)
+        {
+            int k = item.index;
+            if (params.classAware && boxes.classId[k] != boxes.classId[index])
+            {
+                continue;
+            }
+            if (iou_exceeds(boxes.x1[k], boxes.y1[k], boxes.x2[k], boxes.y2[k],
+                            boxes.x1[index], boxes.y1[index], boxes.x2[index], boxes.y2[index], params.iouThreshold))
+            {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed)
+        {
+            kept.push_back({index, boxes.score[index]});
+        }
+    }
+    return kept;
+}
+
+// 按分数排序后的候选框，每个分量连续存放并补齐到8的倍数，补齐的框预先标记为已抑制
+struct SortedBoxes
+{
+    std::vector<int> order;
+    std::vector<float> x1, y1, x2, y2, area;
+    std::vector<int> classId;
+    std::vector<int32_t> suppressed;
+
+    SortedBoxes(const DetectionBoxes &boxes, const DetectParams &params)
+        : order(sort_candidates(boxes, params.maxCandidates))
+    {
+        size_t padded = (order.size() + 7) & ~(size_t)7;
+        x1.assign(padded, 0.0f);
+        y1.assign(padded, 0.0f);
+        x2.assign(padded, 0.0f);
+        y2.assign(padded, 0.0f);
+        area.assign(padded, 0.0f);
+        classId.assign(padded, -1);
+        suppressed.assign(padded, -1);
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            int index = order[i];
+            x1[i] = boxes.x1[index];
+            y1[i] = boxes.y1[index];
+            x2[i] = boxes.x2[index];
+            y2[i] = boxes.y2[index];
+            area[i] = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+            classId[i] = boxes.classId[index];
+            suppressed[i] = 0;
+        }
+    }
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+// 每保留一个框，就用它一次抑制后面8个候选框；已经全部被抑制的块直接跳过
+PREPROCESS_TARGET_AVX2 void nms_suppress_avx2(SortedBoxes &sorted, size_t i, const DetectParams &params)
+{
+    const __m256 ax1 = _mm256_set1_ps(sorted.x1[i]);
+    const __m256 ay1 = _mm256_set1_ps(sorted.y1[i]);
+    const __m256 ax2 = _mm256_set1_ps(sorted.x2[i]);
+    const __m256 ay2 = _mm256_set1_ps(sorted.y2[i]);
+    const __m256 areaA = _mm256_set1_ps(sorted.area[i]);
+    const __m256 threshold = _mm256_set1_ps(params.iouThreshold);
+    const __m256i classA = _mm256_set1_epi32(sorted.classId[i]);
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t j = (i + 1) & ~(size_t)7; j < sorted.suppressed.size(); j += 8)
+    {
+        __m256i done = _mm256_loadu_si256((const __m256i *)&sorted.suppressed[j]);
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(done)) == 0xff)
+        {
+            continue;
+        }
+        __m256 w = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(ax2, _mm256_loadu_ps(&sorted.x2[j])), _mm256_max_ps(ax1, _mm256_loadu_ps(&sorted.x1[j]))), zero);
+        __m256 h = _mm256_max_ps(_mm256_sub_ps(_mm256_min_ps(ay2, _mm256_loadu_ps(&sorted.y2[j])), _mm256_max_ps(ay1, _mm256_loadu_ps(&sorted.y1[j]))), zero);
+        __m256 inter = _mm256_mul_ps(w, h);
+        __m256 unionArea = _mm256_sub_ps(_mm256_add_ps(areaA, _mm256_loadu_ps(&sorted.area[j])), inter);
+        __m256 overlap = _mm256_cmp_ps(inter, _mm256_mul_ps(threshold, unionArea), _CMP_GT_OQ);
+        __m256i suppress = _mm256_castps_si256(overlap);
+        if (params.classAware)
+        {
+            suppress = _mm256_and_si256(suppress, _mm256_cmpeq_epi32(classA, _mm256_loadu_si256((const __m256i *)&sorted.classId[j])));
+        }
+        _mm256_storeu_si256((__m256i *)&sorted.suppressed[j], _mm256_or_si256(done, suppress));
+    }
+}
+#elif defined(__aarch64__)
+void nms_suppress_neon(SortedBoxes &sorted, size_t i, const DetectParams &params)
+{
+    const float32x4_t ax1 = vdupq_n_f32(sorted.x1[i]);
+    const float32x4_t ay1 = vdupq_n_f32(sorted.y1[i]);
+    const float32x4_t ax2 = vdupq_n_f32(sorted.x2[i]);
+    const float32x4_t ay2 = vdupq_n_f32(sorted.y2[i]);
+    const float32x4_t areaA = vdupq_n_f32(sorted.area[i]);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const int32x4_t classA = vdupq_n_s32(sorted.classId[i]);
+    for (size_t j = (i + 1) & ~(size_t)3; j < sorted.suppressed.size(); j += 4)
+    {
+        uint32x4_t done = vreinterpretq_u32_s32(vld1q_s32(&sorted.suppressed[j]));
+        if (vminvq_u32(done) != 0)
+        {
+            continue;
+        }
+        float32x4_t w = vmaxq_f32(vsubq_f32(vminq_f32(ax2, vld1q_f32(&sorted.x2[j])), vmaxq_f32(ax1, vld1q_f32(&sorted.x1[j]))), zero);
+        float32x4_t h = vmaxq_f32(vsubq_f32(vminq_f32(ay2, vld1q_f32(&sorted.y2[j])), vmaxq_f32(ay1, vld1q_f32(&sorted.y1[j]))), zero);
+        float32x4_t inter = vmulq_f32(w, h);
+        float32x4_t unionArea = vsubq_f32(vaddq_f32(areaA, vld1q_f32(&sorted.area[j])), inter);
+        uint32x4_t suppress = vcgtq_f32(inter, vmulq_n_f32(unionArea, params.iouThreshold));
+        if (params.classAware)
+        {
+            suppress = vandq_u32(suppress, vceqq_s32(classA, vld1q_s32(&sorted.classId[j])));
+        }
+        vst1q_s32(&sorted.suppressed[j], vreinterpretq_s32_u32(vorrq_u32(done, suppress)));
+    }
+}
+#endif
+
+// 按分数顺序遍历，保留一个框后立即向后抑制与它重叠的框，保留数达到maxDetections时提前结束
+std::vector<ScoredIndex> nms(const DetectionBoxes &boxes, const DetectParams &params)
+{
+    SortedBoxes sorted(boxes, params);
+    std::vector<ScoredIndex> kept;
+    for (size_t i = 0; i < sorted.order.size() && (int)kept.size() < params.maxDetections; i++)
+    {
+        if (sorted.suppressed[i])
+        {
+            continue;
+        }
+        int index = sorted.order[i];
+        kept.push_back({index, boxes.score[index]});
+#if defined(__x86_64__) || defined(__i386__)
+        if (preprocess_has_avx2())
+        {
+            nms_suppress_avx2(sorted, i, params);
+            continue;
+        }
+#elif defined(__aarch64__)
+        nms_suppress_neon(sorted, i, params);
+        continue;
+#endif
+        for (size_t j = i + 1; j < sorted.order.size(); j++)
+        {
+            if (sorted.suppressed[j] || (params.classAware && sorted.classId[j] != sorted.classId[i]))
+            {
+                continue;
+            }
+            if (iou_exceeds(sorted.x1[i], sorted.y1[i], sorted.x2[i], sorted.y2[i],
+                            sorted.x1[j], sorted.y1[j], sorted.x2[j], sorted.y2[j], params.iouThreshold))
+            {
+                sorted.suppressed[j] = -1;
+            }
+        }
+    }
+    return kept;
+}
+
+/************************************ 驱动中的后处理阶段 ************************************/
+
+// none不做后处理；classify对第一个输出做softmax + top-k；detect把第一个输出当作YOLOv8风格的[4 + classes, boxes]解码后做NMS
+enum class PostprocessMode
+{
+    None,
+    Classify,
+    Detect
+};
+
+bool parse_postprocess_mode(const std::string &text, PostprocessMode &mode)
+{
+    if (text == "none")
+    {
+        mode = PostprocessMode::None;
+    }
+    else if (text == "classify")
+    {
+        mode = PostprocessMode::Classify;
+    }
+    else if (text == "detect")
+    {
+        mode = PostprocessMode::Detect;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+struct PostprocessResult
+{
+    std::vector<float> probabilities;
+    std::vector<ScoredIndex> topk;
+    DetectionBoxes candidates;
+    std::vector<ScoredIndex> detections;
+};
+
+// data为第一个输出反量化后的fp32数据，dims为它的有效形状；形状不符合该模式时返回false
+bool run_postprocess(PostprocessMode mode, const float *data, const std::vector<size_t> &dims, size_t k,
+                     const DetectParams &params, PostprocessResult &result)
+{
+    size_t count = 1;
+    for (size_t dim : dims)
+    {
+        count *= dim;
+    }
+    if (mode == PostprocessMode::Classify)
+    {
+        result.probabilities.resize(count);
+        softmax(data, result.probabilities.data(), count);
+        result.topk = topk(result.probabilities.data(), count, k);
+        return true;
+    }
+    if (mode == PostprocessMode::Detect)
+    {
+        if (dims.size() < 2 || dims[dims.size() - 2] <= 4 || count != dims[dims.size() - 2] * dims.back())
+        {
+            return false;
+        }
+        size_t numBoxes = dims.back();
+        decode_detections(data, numBoxes, dims[dims.size() - 2] - 4, params, result.candidates);
+        result.detections = nms(result.candidates, params);
+        return true;
+    }
+    return true;
+}
+
+#endif
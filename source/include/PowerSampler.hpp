@@ -0,0 +1,88 @@
+#ifndef POWER_SAMPLER_HPP
+#define POWER_SAMPLER_HPP
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "glog/logging.h"
+#include "Trace.hpp"
+
+// 功耗采样: 后台线程按固定间隔读取一个sysfs功率节点，得到计时期间的平均功率(W)。
+// 节点例如INA226/INA3221的hwmon power1_input(uW，scale为1e-6)或板子提供的整板功率节点；
+// 读数是整个节点(通常是整板或某一路电源)的功率，包含空闲功耗。
+class PowerSampler
+{
+public:
+    PowerSampler(const std::string &node, double scale, int intervalMs)
+        : node_(node), scale_(scale), intervalMs_(intervalMs > 0 ? intervalMs : 10) {}
+
+    ~PowerSampler()
+    {
+        stop();
+    }
+
+    // 没有指定节点或节点不可读时返回false，之后stop()返回-1
+    bool start()
+    {
+        if (node_.empty())
+            return false;
+        double watts = 0;
+        if (!read(watts))
+        {
+            LOG(WARNING) << "Cannot read power node: " << node_;
+            return false;
+        }
+        sum_ = 0;
+        count_ = 0;
+        running_ = true;
+        thread_ = std::thread([this]()
+                              {
+            TRACE_THREAD_NAME("power sampler");
+            auto next = std::chrono::steady_clock::now();
+            while (running_)
+            {
+                double watts = 0;
+                if (read(watts))
+                {
+                    TRACE_INSTANT("power sample");
+                    sum_ += watts;
+                    count_++;
+                }
+                next += std::chrono::milliseconds(intervalMs_);
+                std::this_thread::sleep_until(next);
+            } });
+        return true;
+    }
+
+    // 停止采样，返回平均功率(W)，没有采样时返回-1
+    double stop()
+    {
+        if (!thread_.joinable())
+            return -1;
+        running_ = false;
+        thread_.join();
+        return count_ > 0 ? sum_ / count_ : -1;
+    }
+
+private:
+    bool read(double &watts)
+    {
+        std::ifstream file(node_);
+        double value = 0;
+        if (!(file >> value))
+            return false;
+        watts = value * scale_;
+        return true;
+    }
+
+    std::string node_;
+    double scale_;
+    int intervalMs_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    double sum_ = 0;
+    uint64_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,946 @@
+#ifndef PREPROCESS_HPP
+#define PREPROCESS_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 推理前处理kernel: NCHW<->NHWC布局转换、uint8->fp32/fp16归一化、per-tensor int8量化以及归一化+量化的融合kernel。
+// 每个kernel都有一个标量参考实现(*_ref)，不带后缀的版本在运行时按指令集分派到AVX2或NEON实现，两者的结果逐位一致:
+// 归一化统一写成 x * (1 / std) + (-mean / std) 的fma形式，量化统一写成 x * (1 / scale) 后按round-to-nearest-even取整。
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PREPROCESS_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// 一个块内处理的元素个数，AVX2与NEON的实现都按8个uint8为一组
+#define PREPROCESS_VECTOR 8
+// 布局转换的cache分块大小(元素个数)
+#define PREPROCESS_BLOCK 32
+
+struct TensorShape4D
+{
+    size_t n = 1;
+    size_t c = 1;
+    size_t h = 1;
+    size_t w = 1;
+
+    size_t count() const
+    {
+        return n * c * h * w;
+    }
+};
+
+enum class PreprocessLayout
+{
+    NCHW,
+    NHWC
+};
+
+// 每个通道的均值和标准差，对应模型训练时的 (x - mean) / std
+struct NormalizeParams
+{
+    std::vector<float> mean;
+    std::vector<float> std;
+};
+
+// q = round(x / scale) + zeroPoint，与rknn_tensor_attr.scale/zp、hbDNNTensorProperties.scale.scaleData/zeroPointData一致
+struct QuantParams
+{
+    float scale = 1.0f;
+    int32_t zeroPoint = 0;
+};
+
+// 量化前先把 x / scale 限制在这个范围内，保证加上zero point之后不会溢出int32
+#define PREPROCESS_QUANT_LIMIT 65536.0f
+
+#if defined(__x86_64__) || defined(__i386__)
+bool preprocess_has_avx2()
+{
+    static bool hasAvx2 = []()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+    }();
+    return hasAvx2;
+}
+#endif
+
+// 当前分派使用的指令集
+std::string preprocess_isa()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return preprocess_has_avx2() ? "avx2" : "scalar";
+#elif defined(__aarch64__)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+// IEEE 754 binary16，round-to-nearest-even，与F16C/NEON的转换指令一致
+uint16_t float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7fffffff;
+    if (absBits >= 0x7f800000)
+    {
+        // inf / nan
+        return sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0);
+    }
+    if (absBits >= 0x477ff000)
+    {
+        // >= 65520，舍入后溢出为inf
+        return sign | 0x7c00;
+    }
+    if (absBits < 0x38800000)
+    {
+        // 小于2^-14，结果为非规格化数，最小单位2^-24
+        float absValue;
+        memcpy(&absValue, &absBits, sizeof(absValue));
+        return sign | (uint16_t)std::nearbyint(absValue * 16777216.0f);
+    }
+    // 指数从127偏移改为15偏移，同时按尾数的最低保留位做round-to-nearest-even
+    absBits += 0xc8000fff + ((absBits >> 13) & 1);
+    return sign | (uint16_t)(absBits >> 13);
+}
+
+float half_to_float(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent == 0)
+    {
+        float result = mantissa / 16777216.0f;
+        return sign ? -result : result;
+    }
+    else
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/************************************ 布局转换 ************************************/
+
+// dst[c][r] = src[r][c]，src为rows x cols
+template <typename T>
+void transpose_2d_ref(const T *src, T *dst, size_t rows, size_t cols)
+{
+    for (size_t r = 0; r < rows; r++)
+    {
+        for (size_t c = 0; c < cols; c++)
+        {
+            dst[c * rows + r] = src[r * cols + c];
+        }
+    }
+}
+
+// 有一维很短时(例如3通道图像)，短的一维放在外层，内层沿长的一维连续读或连续写，比分块更快
+template <typename T>
+void transpose_2d_narrow(const T *src, T *dst, size_t rows, size_t cols)
+{
+    if (rows > cols)
+    {
+        for (size_t c = 0; c < cols; c++)
+        {
+            for (size_t r = 0; r < rows; r++)
+            {
+                dst[c * rows + r] = src[r * cols + c];
+            }
+        }
+        return;
+    }
+    for (size_t r = 0; r < rows; r++)
+    {
+        for (size_t c = 0; c < cols; c++)
+        {
+            dst[c * rows + r] = src[r * cols + c];
+        }
+    }
+}
+
+// 按PREPROCESS_BLOCK分块，保证块内的读写都落在少量cache line上；
+// 块内再按Tile x Tile调用tile(src, srcStride, dst, dstStride)做寄存器转置，边角部分退回标量
+template <size_t Tile, typename T, typename TileFunc>
+void transpose_2d_tiled(const T *src, T *dst, size_t rows, size_t cols, TileFunc &&tile)
+{
+    if (std::min(rows, cols) < 8)
+    {
+        transpose_2d_narrow(src, dst, rows, cols);
+        return;
+    }
+    for (size_t r0 = 0; r0 < rows; r0 += PREPROCESS_BLOCK)
+    {
+        size_t r1 = std::min(rows, r0 + PREPROCESS_BLOCK);
+        for (size_t c0 = 0; c0 < cols; c0 += PREPROCESS_BLOCK)
+        {
+            size_t c1 = std::min(cols, c0 + PREPROCESS_BLOCK);
+            size_t r = r0;
+            for (; r + Tile <= r1; r += Tile)
+            {
+                size_t c = c0;
+                for (; c + Tile <= c1; c += Tile)
+                {
+                    tile(src + r * cols + c, cols, dst + c * rows + r, rows);
+                }
+                for (size_t rr = r; rr < r + Tile; rr++)
+                {
+                    for (size_t cc = c; cc < c1; cc++)
+                    {
+                        dst[cc * rows + rr] = src[rr * cols + cc];
+                    }
+                }
+            }
+            for (; r < r1; r++)
+            {
+                for (size_t c = c0; c < c1; c++)
+                {
+                    dst[c * rows + r] = src[r * cols + c];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void transpose_2d_blocked(const T *src, T *dst, size_t rows, size_t cols)
+{
+    transpose_2d_tiled<1>(src, dst, rows, cols, [](const T *s, size_t, T *d, size_t)
+                          { *d = *s; });
+}
+
+template <typename T>
+void nchw_to_nhwc_ref(const T *src, T *dst, const TensorShape4D &shape)
+{
+    size_t plane = shape.h * shape.w;
+    for (size_t n = 0; n < shape.n; n++)
+    {
+        transpose_2d_ref(src + n * shape.c * plane, dst + n * shape.c * plane, shape.c, plane);
+    }
+}
+
+template <typename T>
+void nhwc_to_nchw_ref(const T *src, T *dst, const TensorShape4D &shape)
+{
+    size_t plane = shape.h * shape.w;
+    for (size_t n = 0; n < shape.n; n++)
+    {
+        transpose_2d_ref(src + n * shape.c * plane, dst + n * shape.c * plane, plane, shape.c);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+PREPROCESS_TARGET_AVX2 static inline void transpose_8x8_avx2(const float *src, size_t srcStride, float *dst, size_t dstStride)
+{
+    __m256 r0 = _mm256_loadu_ps(src + 0 * srcStride);
+    __m256 r1 = _mm256_loadu_ps(src + 1 * srcStride);
+    __m256 r2 = _mm256_loadu_ps(src + 2 * srcStride);
+    __m256 r3 = _mm256_loadu_ps(src + 3 * srcStride);
+    __m256 r4 = _mm256_loadu_ps(src + 4 * srcStride);
+    __m256 r5 = _mm256_loadu_ps(src + 5 * srcStride);
+    __m256 r6 = _mm256_loadu_ps(src + 6 * srcStride);
+    __m256 r7 = _mm256_loadu_ps(src + 7 * srcStride);
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, 0x44);
+    __m256 s1 = _mm256_shuffle_ps(t0, t2, 0xee);
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, 0x44);
+    __m256 s3 = _mm256_shuffle_ps(t1, t3, 0xee);
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, 0x44);
+    __m256 s5 = _mm256_shuffle_ps(t4, t6, 0xee);
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, 0x44);
+    __m256 s7 = _mm256_shuffle_ps(t5, t7, 0xee);
+    _mm256_storeu_ps(dst + 0 * dstStride, _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(dst + 1 * dstStride, _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(dst + 2 * dstStride, _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(dst + 3 * dstStride, _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(dst + 4 * dstStride, _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(dst + 5 * dstStride, _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(dst + 6 * dstStride, _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(dst + 7 * dstStride, _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+PREPROCESS_TARGET_AVX2 static inline void transpose_8x8_u8_sse(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride)
+{
+    __m128i t0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 0 * srcStride)), _mm_loadl_epi64((const __m128i *)(src + 1 * srcStride)));
+    __m128i t1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 2 * srcStride)), _mm_loadl_epi64((const __m128i *)(src + 3 * srcStride)));
+    __m128i t2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 4 * srcStride)), _mm_loadl_epi64((const __m128i *)(src + 5 * srcStride)));
+    __m128i t3 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 6 * srcStride)), _mm_loadl_epi64((const __m128i *)(src + 7 * srcStride)));
+    // u0/u1: 第0-3行的第0-3/4-7列，u2/u3: 第4-7行
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+    // 每个寄存器包含两整列
+    __m128i v0 = _mm_unpacklo_epi32(u0, u2);
+    __m128i v1 = _mm_unpackhi_epi32(u0, u2);
+    __m128i v2 = _mm_unpacklo_epi32(u1, u3);
+    __m128i v3 = _mm_unpackhi_epi32(u1, u3);
+    _mm_storel_epi64((__m128i *)(dst + 0 * dstStride), v0);
+    _mm_storel_epi64((__m128i *)(dst + 1 * dstStride), _mm_unpackhi_epi64(v0, v0));
+    _mm_storel_epi64((__m128i *)(dst + 2 * dstStride), v1);
+    _mm_storel_epi64((__m128i *)(dst + 3 * dstStride), _mm_unpackhi_epi64(v1, v1));
+    _mm_storel_epi64((__m128i *)(dst + 4 * dstStride), v2);
+    _mm_storel_epi64((__m128i *)(dst + 5 * dstStride), _mm_unpackhi_epi64(v2, v2));
+    _mm_storel_epi64((__m128i *)(dst + 6 * dstStride), v3);
+    _mm_storel_epi64((__m128i *)(dst + 7 * dstStride), _mm_unpackhi_epi64(v3, v3));
+}
+
+// 3通道uint8的打包<->平面转换，每次16个像素，用pshufb从3个16字节的寄存器中收集
+struct Interleave3Masks
+{
+    uint8_t deinterleave[3][3][16]; // [通道][输入寄存器][字节]
+    uint8_t interleave[3][3][16];   // [输出寄存器][通道][字节]
+
+    Interleave3Masks()
+    {
+        for (int ch = 0; ch < 3; ch++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                for (int j = 0; j < 16; j++)
+                {
+                    int packed = 3 * j + ch;
+                    deinterleave[ch][k][j] = packed / 16 == k ? packed % 16 : 0x80;
+                    int index = 16 * k + j;
+                    interleave[k][ch][j] = index % 3 == ch ? index / 3 : 0x80;
+                }
+            }
+        }
+    }
+};
+
+PREPROCESS_TARGET_AVX2 void nhwc_to_nchw_c3_u8_avx2(const uint8_t *src, uint8_t *dst, size_t plane)
+{
+    static const Interleave3Masks masks;
+    __m128i m[3][3];
+    for (int ch = 0; ch < 3; ch++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            m[ch][k] = _mm_loadu_si128((const __m128i *)masks.deinterleave[ch][k]);
+        }
+    }
+    size_t i = 0;
+    for (; i + 16 <= plane; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 3 * i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 3 * i + 32));
+        for (int ch = 0; ch < 3; ch++)
+        {
+            __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m[ch][0]), _mm_shuffle_epi8(b, m[ch][1])),
+                                     _mm_shuffle_epi8(c, m[ch][2]));
+            _mm_storeu_si128((__m128i *)(dst + ch * plane + i), v);
+        }
+    }
+    for (; i < plane; i++)
+    {
+        for (int ch = 0; ch < 3; ch++)
+        {
+            dst[ch * plane + i] = src[3 * i + ch];
+        }
+    }
+}
+
+PREPROCESS_TARGET_AVX2 void nchw_to_nhwc_c3_u8_avx2(const uint8_t *src, uint8_t *dst, size_t plane)
+{
+    static const Interleave3Masks masks;
+    __m128i m[3][3];
+    for (int k = 0; k < 3; k++)
+    {
+        for (int ch = 0; ch < 3; ch++)
+        {
+            m[k][ch] = _mm_loadu_si128((const __m128i *)masks.interleave[k][ch]);
+        }
+    }
+    size_t i = 0;
+    for (; i + 16 <= plane; i += 16)
+    {
+        __m128i p0 = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i p1 = _mm_loadu_si128((const __m128i *)(src + plane + i));
+        __m128i p2 = _mm_loadu_si128((const __m128i *)(src + 2 * plane + i));
+        for (int k = 0; k < 3; k++)
+        {
+            __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(p0, m[k][0]), _mm_shuffle_epi8(p1, m[k][1])),
+                                     _mm_shuffle_epi8(p2, m[k][2]));
+            _mm_storeu_si128((__m128i *)(dst + 3 * i + 16 * k), v);
+        }
+    }
+    for (; i < plane; i++)
+    {
+        for (int ch = 0; ch < 3; ch++)
+        {
+            dst[3 * i + ch] = src[ch * plane + i];
+        }
+    }
+}
+#elif defined(__aarch64__)
+static inline void transpose_4x4_neon(const float *src, size_t srcStride, float *dst, size_t dstStride)
+{
+    float32x4x2_t t01 = vtrnq_f32(vld1q_f32(src), vld1q_f32(src + srcStride));
+    float32x4x2_t t23 = vtrnq_f32(vld1q_f32(src + 2 * srcStride), vld1q_f32(src + 3 * srcStride));
+    vst1q_f32(dst, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+    vst1q_f32(dst + dstStride, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+    vst1q_f32(dst + 2 * dstStride, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+    vst1q_f32(dst + 3 * dstStride, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+}
+
+static inline void transpose_8x8_u8_neon(const uint8_t *src, size_t srcStride, uint8_t *dst, size_t dstStride)
+{
+    uint8x8x2_t b01 = vtrn_u8(vld1_u8(src), vld1_u8(src + srcStride));
+    uint8x8x2_t b23 = vtrn_u8(vld1_u8(src + 2 * srcStride), vld1_u8(src + 3 * srcStride));
+    uint8x8x2_t b45 = vtrn_u8(vld1_u8(src + 4 * srcStride), vld1_u8(src + 5 * srcStride));
+    uint8x8x2_t b67 = vtrn_u8(vld1_u8(src + 6 * srcStride), vld1_u8(src + 7 * srcStride));
+    // c02: 第0-3行的第0/4列与第2/6列，c13: 第1/5列与第3/7列，c46/c57为第4-7行
+    uint16x4x2_t c02 = vtrn_u16(vreinterpret_u16_u8(b01.val[0]), vreinterpret_u16_u8(b23.val[0]));
+    uint16x4x2_t c13 = vtrn_u16(vreinterpret_u16_u8(b01.val[1]), vreinterpret_u16_u8(b23.val[1]));
+    uint16x4x2_t c46 = vtrn_u16(vreinterpret_u16_u8(b45.val[0]), vreinterpret_u16_u8(b67.val[0]));
+    uint16x4x2_t c57 = vtrn_u16(vreinterpret_u16_u8(b45.val[1]), vreinterpret_u16_u8(b67.val[1]));
+    uint32x2x2_t d04 = vtrn_u32(vreinterpret_u32_u16(c02.val[0]), vreinterpret_u32_u16(c46.val[0]));
+    uint32x2x2_t d15 = vtrn_u32(vreinterpret_u32_u16(c13.val[0]), vreinterpret_u32_u16(c57.val[0]));
+    uint32x2x2_t d26 = vtrn_u32(vreinterpret_u32_u16(c02.val[1]), vreinterpret_u32_u16(c46.val[1]));
+    uint32x2x2_t d37 = vtrn_u32(vreinterpret_u32_u16(c13.val[1]), vreinterpret_u32_u16(c57.val[1]));
+    vst1_u8(dst, vreinterpret_u8_u32(d04.val[0]));
+    vst1_u8(dst + dstStride, vreinterpret_u8_u32(d15.val[0]));
+    vst1_u8(dst + 2 * dstStride, vreinterpret_u8_u32(d26.val[0]));
+    vst1_u8(dst + 3 * dstStride, vreinterpret_u8_u32(d37.val[0]));
+    vst1_u8(dst + 4 * dstStride, vreinterpret_u8_u32(d04.val[1]));
+    vst1_u8(dst + 5 * dstStride, vreinterpret_u8_u32(d15.val[1]));
+    vst1_u8(dst + 6 * dstStride, vreinterpret_u8_u32(d26.val[1]));
+    vst1_u8(dst + 7 * dstStride, vreinterpret_u8_u32(d37.val[1]));
+}
+
+void nhwc_to_nchw_c3_u8_neon(const uint8_t *src, uint8_t *dst, size_t plane)
+{
+    size_t i = 0;
+    for (; i + 16 <= plane; i += 16)
+    {
+        uint8x16x3_t v = vld3q_u8(src + 3 * i);
+        vst1q_u8(dst + i, v.val[0]);
+        vst1q_u8(dst + plane + i, v.val[1]);
+        vst1q_u8(dst + 2 * plane + i, v.val[2]);
+    }
+    for (; i < plane; i++)
+    {
+        for (int ch = 0; ch < 3; ch++)
+        {
+            dst[ch * plane + i] = src[3 * i + ch];
+        }
+    }
+}
+
+void nchw_to_nhwc_c3_u8_neon(const uint8_t *src, uint8_t *dst, size_t plane)
+{
+    size_t i = 0;
+    for (; i + 16 <= plane; i += 16)
+    {
+        uint8x16x3_t v;
+        v.val[0] = vld1q_u8(src + i);
+        v.val[1] = vld1q_u8(src + plane + i);
+        v.val[2] = vld1q_u8(src + 2 * plane + i);
+        vst3q_u8(dst + 3 * i, v);
+    }
+    for (; i < plane; i++)
+    {
+        for (int ch = 0; ch < 3; ch++)
+        {
+            dst[3 * i + ch] = src[ch * plane + i];
+        }
+    }
+}
+#endif
+
+// dst[c][r] = src[r][c]，按指令集选择块内的寄存器转置
+void transpose_2d(const uint8_t *src, uint8_t *dst, size_t rows, size_t cols)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        transpose_2d_tiled<8>(src, dst, rows, cols, transpose_8x8_u8_sse);
+        return;
+    }
+#elif defined(__aarch64__)
+    transpose_2d_tiled<8>(src, dst, rows, cols, transpose_8x8_u8_neon);
+    return;
+#endif
+    transpose_2d_blocked(src, dst, rows, cols);
+}
+
+void transpose_2d(const float *src, float *dst, size_t rows, size_t cols)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        transpose_2d_tiled<8>(src, dst, rows, cols, transpose_8x8_avx2);
+        return;
+    }
+#elif defined(__aarch64__)
+    transpose_2d_tiled<4>(src, dst, rows, cols, transpose_4x4_neon);
+    return;
+#endif
+    transpose_2d_blocked(src, dst, rows, cols);
+}
+
+void nchw_to_nhwc(const uint8_t *src, uint8_t *dst, const TensorShape4D &shape)
+{
+    size_t plane = shape.h * shape.w;
+    for (size_t n = 0; n < shape.n; n++)
+    {
+        const uint8_t *s = src + n * shape.c * plane;
+        uint8_t *d = dst + n * shape.c * plane;
+#if defined(__x86_64__) || defined(__i386__)
+        if (shape.c == 3 && preprocess_has_avx2())
+        {
+            nchw_to_nhwc_c3_u8_avx2(s, d, plane);
+            continue;
+        }
+#elif defined(__aarch64__)
+        if (shape.c == 3)
+        {
+            nchw_to_nhwc_c3_u8_neon(s, d, plane);
+            continue;
+        }
+#endif
+        transpose_2d(s, d, shape.c, plane);
+    }
+}
+
+void nhwc_to_nchw(const uint8_t *src, uint8_t *dst, const TensorShape4D &shape)
+{
+    size_t plane = shape.h * shape.w;
+    for (size_t n = 0; n < shape.n; n++)
+    {
+        const uint8_t *s = src + n * shape.c * plane;
+        uint8_t *d = dst + n * shape.c * plane;
+#if defined(__x86_64__) || defined(__i386__)
+        if (shape.c == 3 && preprocess_has_avx2())
+        {
+            nhwc_to_nchw_c3_u8_avx2(s, d, plane);
+            continue;
+        }
+#elif defined(__aarch64__)
+        if (shape.c == 3)
+        {
+            nhwc_to_nchw_c3_u8_neon(s, d, plane);
+            continue;
+        }
+#endif
+        transpose_2d(s, d, plane, shape.c);
+    }
+}
+
+void nchw_to_nhwc(const float *src, float *dst, const TensorShape4D &shape)
+{
+    size_t plane = shape.h * shape.w;
+    for (size_t n = 0; n < shape.n; n++)
+    {
+        transpose_2d(src + n * shape.c * plane, dst + n * shape.c * plane, shape.c, plane);
+    }
+}
+
+void nhwc_to_nchw(const float *src, float *dst, const TensorShape4D &shape)
+{
+    size_t plane = shape.h * shape.w;
+    for (size_t n = 0; n < shape.n; n++)
+    {
+        transpose_2d(src + n * shape.c * plane, dst + n * shape.c * plane, plane, shape.c);
+    }
+}
+
+/************************************ 归一化与量化 ************************************/
+
+// 把每个通道的 (x - mean) / std 展开成 x * scale + bias 的系数表。
+// NHWC时通道沿元素循环，系数表长度为 c * PREPROCESS_VECTOR，按块对齐后块内第j个元素的通道是 j % c；
+// NCHW时每个平面内通道不变，每个通道一张长度为PREPROCESS_VECTOR的表。
+struct AffineTable
+{
+    size_t period;
+    std::vector<float> scale;
+    std::vector<float> bias;
+};
+
+std::vector<AffineTable> build_affine_tables(const NormalizeParams &params, size_t channels, PreprocessLayout layout, float extraScale = 1.0f)
+{
+    auto channel_scale = [&](size_t ch)
+    {
+        float stdValue = params.std.empty() ? 1.0f : params.std[ch % params.std.size()];
+        return (1.0f / stdValue) * extraScale;
+    };
+    auto channel_bias = [&](size_t ch)
+    {
+        float meanValue = params.mean.empty() ? 0.0f : params.mean[ch % params.mean.size()];
+        float stdValue = params.std.empty() ? 1.0f : params.std[ch % params.std.size()];
+        return (-meanValue / stdValue) * extraScale;
+    };
+    std::vector<AffineTable> tables;
+    if (layout == PreprocessLayout::NHWC)
+    {
+        AffineTable table;
+        table.period = channels * PREPROCESS_VECTOR;
+        for (size_t j = 0; j < table.period; j++)
+        {
+            table.scale.push_back(channel_scale(j % channels));
+            table.bias.push_back(channel_bias(j % channels));
+        }
+        tables.push_back(table);
+    }
+    else
+    {
+        for (size_t ch = 0; ch < channels; ch++)
+        {
+            AffineTable table;
+            table.period = PREPROCESS_VECTOR;
+            table.scale.assign(PREPROCESS_VECTOR, channel_scale(ch));
+            table.bias.assign(PREPROCESS_VECTOR, channel_bias(ch));
+            tables.push_back(table);
+        }
+    }
+    return tables;
+}
+
+inline float quantize_clamp(float value)
+{
+    return std::min(std::max(value, -PREPROCESS_QUANT_LIMIT), PREPROCESS_QUANT_LIMIT);
+}
+
+inline int8_t quantize_round(float value, int32_t zeroPoint)
+{
+    int32_t q = (int32_t)std::nearbyint(quantize_clamp(value)) + zeroPoint;
+    return (int8_t)std::min(std::max(q, -128), 127);
+}
+
+// 对一段数据逐块应用系数表，Kernel处理一个完整的表周期，尾部不足一个周期的部分用Scalar处理
+template <typename SrcT, typename DstT, typename Kernel, typename Scalar>
+void apply_affine(const SrcT *src, DstT *dst, size_t count, const AffineTable &table, Kernel &&kernel, Scalar &&scalar)
+{
+    size_t i = 0;
+    for (; i + table.period <= count; i += table.period)
+    {
+        kernel(src + i, dst + i, table);
+    }
+    for (size_t j = 0; i < count; i++, j++)
+    {
+        dst[i] = scalar(src[i], table.scale[j], table.bias[j]);
+    }
+}
+
+// layout决定通道在数据中的排列，NCHW时按平面分别套用各通道的系数
+template <typename SrcT, typename DstT, typename Kernel, typename Scalar>
+void apply_affine_tensor(const SrcT *src, DstT *dst, const TensorShape4D &shape, PreprocessLayout layout,
+                         const std::vector<AffineTable> &tables, Kernel &&kernel, Scalar &&scalar)
+{
+    // 没有通道时系数表的周期为0，apply_affine的分块循环不会前进
+    if (shape.c == 0 || tables.empty())
+    {
+        return;
+    }
+    size_t plane = shape.h * shape.w;
+    if (layout == PreprocessLayout::NHWC)
+    {
+        apply_affine(src, dst, shape.count(), tables[0], kernel, scalar);
+        return;
+    }
+    for (size_t n = 0; n < shape.n; n++)
+    {
+        for (size_t ch = 0; ch < shape.c; ch++)
+        {
+            size_t offset = (n * shape.c + ch) * plane;
+            apply_affine(src + offset, dst + offset, plane, tables[ch], kernel, scalar);
+        }
+    }
+}
+
+void normalize_to_fp32_ref(const uint8_t *src, float *dst, const TensorShape4D &shape, PreprocessLayout layout, const NormalizeParams &params)
+{
+    auto tables = build_affine_tables(params, shape.c, layout);
+    auto scalar = [](uint8_t x, float scale, float bias)
+    { return std::fma((float)x, scale, bias); };
+    apply_affine_tensor(src, dst, shape, layout, tables, [&](const uint8_t *s, float *d, const AffineTable &table)
+                        {
+                            for (size_t j = 0; j < table.period; j++)
+                            {
+                                d[j] = scalar(s[j], table.scale[j], table.bias[j]);
+                            } },
+                        scalar);
+}
+
+void normalize_to_fp16_ref(const uint8_t *src, uint16_t *dst, const TensorShape4D &shape, PreprocessLayout layout, const NormalizeParams &params)
+{
+    auto tables = build_affine_tables(params, shape.c, layout);
+    auto scalar = [](uint8_t x, float scale, float bias)
+    { return float_to_half(std::fma((float)x, scale, bias)); };
+    apply_affine_tensor(src, dst, shape, layout, tables, [&](const uint8_t *s, uint16_t *d, const AffineTable &table)
+                        {
+                            for (size_t j = 0; j < table.period; j++)
+                            {
+                                d[j] = scalar(s[j], table.scale[j], table.bias[j]);
+                            } },
+                        scalar);
+}
+
+void quantize_to_int8_ref(const float *src, int8_t *dst, size_t count, const QuantParams &quant)
+{
+    float inverse = 1.0f / quant.scale;
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] = quantize_round(src[i] * inverse, quant.zeroPoint);
+    }
+}
+
+// 融合的归一化+量化: q = round(x * (scale_c / qscale) + bias_c / qscale) + zp，中间结果不落地
+void normalize_quantize_to_int8_ref(const uint8_t *src, int8_t *dst, const TensorShape4D &shape, PreprocessLayout layout,
+                                    const NormalizeParams &params, const QuantParams &quant)
+{
+    auto tables = build_affine_tables(params, shape.c, layout, 1.0f / quant.scale);
+    int32_t zeroPoint = quant.zeroPoint;
+    auto scalar = [zeroPoint](uint8_t x, float scale, float bias)
+    { return quantize_round(std::fma((float)x, scale, bias), zeroPoint); };
+    apply_affine_tensor(src, dst, shape, layout, tables, [&](const uint8_t *s, int8_t *d, const AffineTable &table)
+                        {
+                            for (size_t j = 0; j < table.period; j++)
+                            {
+                                d[j] = scalar(s[j], table.scale[j], table.bias[j]);
+                            } },
+                        scalar);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+PREPROCESS_TARGET_AVX2 static inline __m256 load_u8x8_as_f32_avx2(const uint8_t *src)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src)));
+}
+
+PREPROCESS_TARGET_AVX2 void normalize_to_fp32_block_avx2(const uint8_t *src, float *dst, const AffineTable &table)
+{
+    for (size_t j = 0; j < table.period; j += 8)
+    {
+        __m256 x = load_u8x8_as_f32_avx2(src + j);
+        _mm256_storeu_ps(dst + j, _mm256_fmadd_ps(x, _mm256_loadu_ps(&table.scale[j]), _mm256_loadu_ps(&table.bias[j])));
+    }
+}
+
+PREPROCESS_TARGET_AVX2 void normalize_to_fp16_block_avx2(const uint8_t *src, uint16_t *dst, const AffineTable &table)
+{
+    for (size_t j = 0; j < table.period; j += 8)
+    {
+        __m256 x = load_u8x8_as_f32_avx2(src + j);
+        __m256 y = _mm256_fmadd_ps(x, _mm256_loadu_ps(&table.scale[j]), _mm256_loadu_ps(&table.bias[j]));
+        _mm_storeu_si128((__m128i *)(dst + j), _mm256_cvtps_ph(y, _MM_FROUND_TO_NEAREST_INT));
+    }
+}
+
+// 8个float取整加zero point后饱和为int8，结果在返回值的低8字节
+PREPROCESS_TARGET_AVX2 static inline __m128i quantize_f32x8_avx2(__m256 value, __m256i zeroPoint)
+{
+    const __m256 limit = _mm256_set1_ps(PREPROCESS_QUANT_LIMIT);
+    value = _mm256_min_ps(_mm256_max_ps(value, _mm256_sub_ps(_mm256_setzero_ps(), limit)), limit);
+    __m256i q = _mm256_add_epi32(_mm256_cvtps_epi32(value), zeroPoint);
+    __m128i q16 = _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+    return _mm_packs_epi16(q16, q16);
+}
+
+PREPROCESS_TARGET_AVX2 void quantize_to_int8_avx2(const float *src, int8_t *dst, size_t count, const QuantParams &quant)
+{
+    float inverse = 1.0f / quant.scale;
+    __m256 inv = _mm256_set1_ps(inverse);
+    __m256i zeroPoint = _mm256_set1_epi32(quant.zeroPoint);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i q = quantize_f32x8_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i), inv), zeroPoint);
+        _mm_storel_epi64((__m128i *)(dst + i), q);
+    }
+    for (; i < count; i++)
+    {
+        dst[i] = quantize_round(src[i] * inverse, quant.zeroPoint);
+    }
+}
+
+PREPROCESS_TARGET_AVX2 void normalize_quantize_to_int8_block_avx2(const uint8_t *src, int8_t *dst, const AffineTable &table, int32_t zp)
+{
+    __m256i zeroPoint = _mm256_set1_epi32(zp);
+    for (size_t j = 0; j < table.period; j += 8)
+    {
+        __m256 x = load_u8x8_as_f32_avx2(src + j);
+        __m256 y = _mm256_fmadd_ps(x, _mm256_loadu_ps(&table.scale[j]), _mm256_loadu_ps(&table.bias[j]));
+        _mm_storel_epi64((__m128i *)(dst + j), quantize_f32x8_avx2(y, zeroPoint));
+    }
+}
+#elif defined(__aarch64__)
+static inline void load_u8x8_as_f32_neon(const uint8_t *src, float32x4_t &lo, float32x4_t &hi)
+{
+    uint16x8_t w = vmovl_u8(vld1_u8(src));
+    lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(w)));
+    hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(w)));
+}
+
+void normalize_to_fp32_block_neon(const uint8_t *src, float *dst, const AffineTable &table)
+{
+    for (size_t j = 0; j < table.period; j += 8)
+    {
+        float32x4_t lo, hi;
+        load_u8x8_as_f32_neon(src + j, lo, hi);
+        vst1q_f32(dst + j, vfmaq_f32(vld1q_f32(&table.bias[j]), lo, vld1q_f32(&table.scale[j])));
+        vst1q_f32(dst + j + 4, vfmaq_f32(vld1q_f32(&table.bias[j + 4]), hi, vld1q_f32(&table.scale[j + 4])));
+    }
+}
+
+void normalize_to_fp16_block_neon(const uint8_t *src, uint16_t *dst, const AffineTable &table)
+{
+    for (size_t j = 0; j < table.period; j += 8)
+    {
+        float32x4_t lo, hi;
+        load_u8x8_as_f32_neon(src + j, lo, hi);
+        lo = vfmaq_f32(vld1q_f32(&table.bias[j]), lo, vld1q_f32(&table.scale[j]));
+        hi = vfmaq_f32(vld1q_f32(&table.bias[j + 4]), hi, vld1q_f32(&table.scale[j + 4]));
+        vst1_u16(dst + j, vreinterpret_u16_f16(vcvt_f16_f32(lo)));
+        vst1_u16(dst + j + 4, vreinterpret_u16_f16(vcvt_f16_f32(hi)));
+    }
+}
+
+// 8个float取整加zero point后饱和为int8
+static inline int8x8_t quantize_f32x8_neon(float32x4_t lo, float32x4_t hi, int32x4_t zeroPoint)
+{
+    const float32x4_t limit = vdupq_n_f32(PREPROCESS_QUANT_LIMIT);
+    const float32x4_t negLimit = vdupq_n_f32(-PREPROCESS_QUANT_LIMIT);
+    lo = vminq_f32(vmaxq_f32(lo, negLimit), limit);
+    hi = vminq_f32(vmaxq_f32(hi, negLimit), limit);
+    int32x4_t qlo = vaddq_s32(vcvtnq_s32_f32(lo), zeroPoint);
+    int32x4_t qhi = vaddq_s32(vcvtnq_s32_f32(hi), zeroPoint);
+    return vqmovn_s16(vcombine_s16(vqmovn_s32(qlo), vqmovn_s32(qhi)));
+}
+
+void quantize_to_int8_neon(const float *src, int8_t *dst, size_t count, const QuantParams &quant)
+{
+    float inverse = 1.0f / quant.scale;
+    float32x4_t inv = vdupq_n_f32(inverse);
+    int32x4_t zeroPoint = vdupq_n_s32(quant.zeroPoint);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        float32x4_t lo = vmulq_f32(vld1q_f32(src + i), inv);
+        float32x4_t hi = vmulq_f32(vld1q_f32(src + i + 4), inv);
+        vst1_s8(dst + i, quantize_f32x8_neon(lo, hi, zeroPoint));
+    }
+    for (; i < count; i++)
+    {
+        dst[i] = quantize_round(src[i] * inverse, quant.zeroPoint);
+    }
+}
+
+void normalize_quantize_to_int8_block_neon(const uint8_t *src, int8_t *dst, const AffineTable &table, int32_t zp)
+{
+    int32x4_t zeroPoint = vdupq_n_s32(zp);
+    for (size_t j = 0; j < table.period; j += 8)
+    {
+        float32x4_t lo, hi;
+        load_u8x8_as_f32_neon(src + j, lo, hi);
+        lo = vfmaq_f32(vld1q_f32(&table.bias[j]), lo, vld1q_f32(&table.scale[j]));
+        hi = vfmaq_f32(vld1q_f32(&table.bias[j + 4]), hi, vld1q_f32(&table.scale[j + 4]));
+        vst1_s8(dst + j, quantize_f32x8_neon(lo, hi, zeroPoint));
+    }
+}
+#endif
+
+void normalize_to_fp32(const uint8_t *src, float *dst, const TensorShape4D &shape, PreprocessLayout layout, const NormalizeParams &params)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        auto tables = build_affine_tables(params, shape.c, layout);
+        apply_affine_tensor(src, dst, shape, layout, tables, normalize_to_fp32_block_avx2, [](uint8_t x, float scale, float bias)
+                            { return std::fma((float)x, scale, bias); });
+        return;
+    }
+#elif defined(__aarch64__)
+    auto tables = build_affine_tables(params, shape.c, layout);
+    apply_affine_tensor(src, dst, shape, layout, tables, normalize_to_fp32_block_neon, [](uint8_t x, float scale, float bias)
+                        { return std::fma((float)x, scale, bias); });
+    return;
+#endif
+    normalize_to_fp32_ref(src, dst, shape, layout, params);
+}
+
+void normalize_to_fp16(const uint8_t *src, uint16_t *dst, const TensorShape4D &shape, PreprocessLayout layout, const NormalizeParams &params)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        auto tables = build_affine_tables(params, shape.c, layout);
+        apply_affine_tensor(src, dst, shape, layout, tables, normalize_to_fp16_block_avx2, [](uint8_t x, float scale, float bias)
+                            { return float_to_half(std::fma((float)x, scale, bias)); });
+        return;
+    }
+#elif defined(__aarch64__)
+    auto tables = build_affine_tables(params, shape.c, layout);
+    apply_affine_tensor(src, dst, shape, layout, tables, normalize_to_fp16_block_neon, [](uint8_t x, float scale, float bias)
+                        { return float_to_half(std::fma((float)x, scale, bias)); });
+    return;
+#endif
+    normalize_to_fp16_ref(src, dst, shape, layout, params);
+}
+
+void quantize_to_int8(const float *src, int8_t *dst, size_t count, const QuantParams &quant)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        quantize_to_int8_avx2(src, dst, count, quant);
+        return;
+    }
+#elif defined(__aarch64__)
+    quantize_to_int8_neon(src, dst, count, quant);
+    return;
+#endif
+    quantize_to_int8_ref(src, dst, count, quant);
+}
+
+void normalize_quantize_to_int8(const uint8_t *src, int8_t *dst, const TensorShape4D &shape, PreprocessLayout layout,
+                                const NormalizeParams &params, const QuantParams &quant)
+{
+    int32_t zeroPoint = quant.zeroPoint;
+    auto scalar = [zeroPoint](uint8_t x, float scale, float bias)
+    { return quantize_round(std::fma((float)x, scale, bias), zeroPoint); };
+#if defined(__x86_64__) || defined(__i386__)
+    if (preprocess_has_avx2())
+    {
+        auto tables = build_affine_tables(params, shape.c, layout, 1.0f / quant.scale);
+        apply_affine_tensor(src, dst, shape, layout, tables, [zeroPoint](const uint8_t *s, int8_t *d, const AffineTable &table)
+                            { normalize_quantize_to_int8_block_avx2(s, d, table, zeroPoint); },
+                            scalar);
+        return;
+    }
+#elif defined(__aarch64__)
+    auto tables = build_affine_tables(params, shape.c, layout, 1.0f / quant.scale);
+    apply_affine_tensor(src, dst, shape, layout, tables, [zeroPoint](const uint8_t *s, int8_t *d, const AffineTable &table)
+                        { normalize_quantize_to_int8_block_neon(s, d, table, zeroPoint); },
+                        scalar);
+    return;
+#endif
+    normalize_quantize_to_int8_ref(src, dst, shape, layout, params, quant);
+}
+
+#endif
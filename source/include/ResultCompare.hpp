@@ -0,0 +1,385 @@
+#ifndef RESULT_COMPARE_HPP
+#define RESULT_COMPARE_HPP
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "Timer.hpp"
+
+// 比较两次测试的结果文件(例如SDK或固件升级前后的output/rknn_profile_result.json)，检测延迟的回退。
+// 模型按名称匹配，名称不同但MetaInfo中的ModelHash相同时按哈希匹配(模型文件被改名)；
+// 在RuntimeResult.MultiRoundsProfileResult的各轮延迟样本上做Mann-Whitney U检验(双侧，正态近似，含结的修正)，
+// 效应量为Cliff's delta，比较指标的相对变化另外给出bootstrap置信区间。
+
+// 结果文件中的一个模型
+struct ResultModel
+{
+    std::string name;
+    std::string hash;
+    // 正式运行各轮的延迟(us)，没有逐轮结果时为空
+    std::vector<double> samples;
+    // 没有逐轮结果时使用的汇总值
+    double mean = 0;
+};
+
+// 结果文件为[{模型名: {...}}, ...]或{模型名: {...}}，每个模型取RoundIndex >= 0的各轮延迟
+bool load_result_models(const std::string &path, std::vector<ResultModel> &models)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Cannot open result file: " << path;
+        return false;
+    }
+    nlohmann::json root;
+    try
+    {
+        file >> root;
+    }
+    catch (const std::exception &ex)
+    {
+        LOG(ERROR) << "Invalid result file " << path << ": " << ex.what();
+        return false;
+    }
+    std::vector<nlohmann::json> entries;
+    if (root.is_array())
+    {
+        entries.assign(root.begin(), root.end());
+    }
+    else
+    {
+        entries.push_back(root);
+    }
+    for (const auto &entry : entries)
+    {
+        if (!entry.is_object())
+            continue;
+        for (const auto &item : entry.items())
+        {
+            const nlohmann::json &result = item.value();
+            if (!result.is_object() || !result.contains("RuntimeResult"))
+                continue;
+            ResultModel model;
+            model.name = item.key();
+            const nlohmann::json &meta = result.value("MetaInfo", nlohmann::json::object());
+            model.hash = meta.value("ModelHash", "");
+            const nlohmann::json &runtime = result["RuntimeResult"];
+            model.mean = runtime.value("AvgTotalRoundLatency", 0.0);
+            for (const auto &round : runtime.value("MultiRoundsProfileResult", nlohmann::json::array()))
+            {
+                if (round.value("RoundIndex", -1) >= 0)
+                {
+                    model.samples.push_back(round.value("TotalRoundLatency", 0.0));
+                }
+            }
+            models.push_back(model);
+        }
+    }
+    return true;
+}
+
+// Mann-Whitney U检验的结果，u为candidate的样本大于baseline样本的对数(相等计0.5)
+struct RankTest
+{
+    double u = 0;
+    double z = 0;
+    double pValue = 1;
+    // Cliff's delta，(-1, 1)，正数表示candidate更慢
+    double cliffsDelta = 0;
+};
+
+RankTest mann_whitney_u(const std::vector<double> &baseline, const std::vector<double> &candidate)
+{
+    RankTest test;
+    size_t n1 = baseline.size(), n2 = candidate.size();
+    if (n1 == 0 || n2 == 0)
+        return test;
+    // 合并排序后按秩求和，相等的值取平均秩
+    std::vector<std::pair<double, int>> values;
+    for (double value : baseline)
+        values.push_back({value, 0});
+    for (double value : candidate)
+        values.push_back({value, 1});
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    double candidateRanks = 0;
+    double tieSum = 0;
+    for (size_t i = 0; i < n;)
+    {
+        size_t j = i;
+        while (j < n && values[j].first == values[i].first)
+            j++;
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++)
+        {
+            if (values[k].second == 1)
+                candidateRanks += rank;
+        }
+        double ties = j - i;
+        tieSum += ties * ties * ties - ties;
+        i = j;
+    }
+    test.u = candidateRanks - n2 * (n2 + 1) / 2.0;
+    test.cliffsDelta = 2 * test.u / (double)(n1 * n2) - 1;
+    double mu = n1 * n2 / 2.0;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tieSum / (n * (n - 1.0)));
+    if (variance <= 0)
+        return test;
+    // 连续性修正
+    double diff = test.u - mu;
+    diff = diff > 0 ? std::max(diff - 0.5, 0.0) : std::min(diff + 0.5, 0.0);
+    test.z = diff / std::sqrt(variance);
+    test.pValue = std::erfc(std::fabs(test.z) / std::sqrt(2.0));
+    return test;
+}
+
+// Cliff's delta的大小: negligible、small、medium、large
+std::string effect_size_label(double delta)
+{
+    double magnitude = std::fabs(delta);
+    if (magnitude < 0.147)
+        return "negligible";
+    if (magnitude < 0.33)
+        return "small";
+    if (magnitude < 0.474)
+        return "medium";
+    return "large";
+}
+
+// 比较的指标: mean、p50、p99
+double compare_metric(const std::vector<double> &samples, const std::string &metric)
+{
+    if (samples.empty())
+        return 0;
+    if (metric == "mean")
+        return std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    if (metric == "p99")
+        return latency_percentile(samples, 99);
+    return latency_percentile(samples, 50);
+}
+
+// 指标相对变化(%)的bootstrap置信区间，两组样本各自有放回重采样
+std::pair<double, double> bootstrap_delta_interval(const std::vector<double> &baseline, const std::vector<double> &candidate, const std::string &metric,
+                                                   int iterations, double confidence, uint32_t seed)
+{
+    if (baseline.empty() || candidate.empty() || iterations <= 0)
+        return {0, 0};
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> pickBaseline(0, baseline.size() - 1);
+    std::uniform_int_distribution<size_t> pickCandidate(0, candidate.size() - 1);
+    std::vector<double> deltas;
+    deltas.reserve(iterations);
+    std::vector<double> a(baseline.size()), b(candidate.size());
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        for (auto &value : a)
+            value = baseline[pickBaseline(rng)];
+        for (auto &value : b)
+            value = candidate[pickCandidate(rng)];
+        double base = compare_metric(a, metric);
+        deltas.push_back(base > 0 ? (compare_metric(b, metric) - base) / base * 100 : 0);
+    }
+    double tail = (1 - confidence) / 2 * 100;
+    return {latency_percentile(deltas, tail), latency_percentile(deltas, 100 - tail)};
+}
+
+struct CompareOptions
+{
+    // 比较指标的相对变化超过threshold(%)且显著(p < alpha)时判为回退
+    std::string metric = "p50";
+    double threshold = 5;
+    double alpha = 0.01;
+    int bootstrap = 1000;
+    uint32_t seed = 0;
+};
+
+// 一个模型在两次结果之间的比较
+struct ModelComparison
+{
+    std::string name;
+    std::string candidateName;
+    bool hashChanged = false;
+    size_t baselineRounds = 0;
+    size_t candidateRounds = 0;
+    // 各指标的baseline值、candidate值和相对变化(%)，顺序为mean、p50、p99
+    double baseline[3] = {0, 0, 0};
+    double candidate[3] = {0, 0, 0};
+    double delta[3] = {0, 0, 0};
+    // 有逐轮样本时才做检验
+    bool tested = false;
+    RankTest test;
+    double ciLow = 0;
+    double ciHigh = 0;
+    // regression、improvement或unchanged
+    std::string verdict = "unchanged";
+};
+
+const char *COMPARE_METRICS[3] = {"mean", "p50", "p99"};
+
+size_t compare_metric_index(const std::string &metric)
+{
+    for (size_t i = 0; i < 3; i++)
+    {
+        if (metric == COMPARE_METRICS[i])
+            return i;
+    }
+    return 1;
+}
+
+ModelComparison compare_model(const ResultModel &baseline, const ResultModel &candidate, const CompareOptions &options)
+{
+    ModelComparison comparison;
+    comparison.name = baseline.name;
+    comparison.candidateName = candidate.name;
+    comparison.hashChanged = !baseline.hash.empty() && !candidate.hash.empty() && baseline.hash != candidate.hash;
+    comparison.baselineRounds = baseline.samples.size();
+    comparison.candidateRounds = candidate.samples.size();
+    for (size_t i = 0; i < 3; i++)
+    {
+        comparison.baseline[i] = baseline.samples.empty() ? (i == 0 ? baseline.mean : 0) : compare_metric(baseline.samples, COMPARE_METRICS[i]);
+        comparison.candidate[i] = candidate.samples.empty() ? (i == 0 ? candidate.mean : 0) : compare_metric(candidate.samples, COMPARE_METRICS[i]);
+        comparison.delta[i] = comparison.baseline[i] > 0 ? (comparison.candidate[i] - comparison.baseline[i]) / comparison.baseline[i] * 100 : 0;
+    }
+    if (baseline.samples.size() < 2 || candidate.samples.size() < 2)
+    {
+        return comparison;
+    }
+    comparison.tested = true;
+    comparison.test = mann_whitney_u(baseline.samples, candidate.samples);
+    std::tie(comparison.ciLow, comparison.ciHigh) = bootstrap_delta_interval(baseline.samples, candidate.samples, options.metric, options.bootstrap, 1 - options.alpha, options.seed);
+    double delta = comparison.delta[compare_metric_index(options.metric)];
+    if (comparison.test.pValue < options.alpha && delta > options.threshold)
+    {
+        comparison.verdict = "regression";
+    }
+    else if (comparison.test.pValue < options.alpha && delta < -options.threshold)
+    {
+        comparison.verdict = "improvement";
+    }
+    return comparison;
+}
+
+// 按名称匹配，剩下的按ModelHash匹配；只在一边出现的模型写入missing
+std::vector<ModelComparison> compare_results(const std::vector<ResultModel> &baseline, const std::vector<ResultModel> &candidate, const CompareOptions &options,
+                                             std::vector<std::string> &missing)
+{
+    std::vector<ModelComparison> comparisons;
+    std::vector<bool> used(candidate.size(), false);
+    std::vector<const ResultModel *> unmatched;
+    for (const auto &model : baseline)
+    {
+        size_t index = 0;
+        while (index < candidate.size() && (used[index] || candidate[index].name != model.name))
+            index++;
+        if (index < candidate.size())
+        {
+            used[index] = true;
+            comparisons.push_back(compare_model(model, candidate[index], options));
+        }
+        else
+        {
+            unmatched.push_back(&model);
+        }
+    }
+    for (const ResultModel *model : unmatched)
+    {
+        size_t index = 0;
+        while (index < candidate.size() && (used[index] || model->hash.empty() || candidate[index].hash != model->hash))
+            index++;
+        if (index < candidate.size())
+        {
+            used[index] = true;
+            comparisons.push_back(compare_model(*model, candidate[index], options));
+        }
+        else
+        {
+            missing.push_back("baseline only: " + model->name);
+        }
+    }
+    for (size_t index = 0; index < candidate.size(); index++)
+    {
+        if (!used[index])
+            missing.push_back("candidate only: " + candidate[index].name);
+    }
+    return comparisons;
+}
+
+nlohmann::json model_comparison_json(const ModelComparison &comparison)
+{
+    nlohmann::json item;
+    item["Name"] = comparison.name;
+    if (comparison.candidateName != comparison.name)
+        item["CandidateName"] = comparison.candidateName;
+    item["HashChanged"] = comparison.hashChanged;
+    item["BaselineRounds"] = comparison.baselineRounds;
+    item["CandidateRounds"] = comparison.candidateRounds;
+    for (size_t i = 0; i < 3; i++)
+    {
+        std::string metric = COMPARE_METRICS[i];
+        metric[0] = (char)std::toupper(metric[0]);
+        item[metric] = {{"Baseline", comparison.baseline[i]}, {"Candidate", comparison.candidate[i]}, {"Delta", comparison.delta[i]}};
+    }
+    item["Tested"] = comparison.tested;
+    if (comparison.tested)
+    {
+        item["U"] = comparison.test.u;
+        item["Z"] = comparison.test.z;
+        item["PValue"] = comparison.test.pValue;
+        item["CliffsDelta"] = comparison.test.cliffsDelta;
+        item["EffectSize"] = effect_size_label(comparison.test.cliffsDelta);
+        item["DeltaInterval"] = {comparison.ciLow, comparison.ciHigh};
+    }
+    item["Verdict"] = comparison.verdict;
+    return item;
+}
+
+void log_comparisons(const std::string &baseline, const std::string &candidate, const std::vector<ModelComparison> &comparisons, const CompareOptions &options)
+{
+    tabulate::Table compareTable;
+    compareTable.add_row({"model", "rounds", "mean(us)", "delta", "p50(us)", "delta", "p99(us)", "delta", "p-value", "effect", options.metric + " CI(%)", "verdict"});
+    for (const auto &comparison : comparisons)
+    {
+        tabulate::Table::Row_t row = {comparison.name + (comparison.hashChanged ? " *" : ""),
+                                        std::to_string(comparison.baselineRounds) + "/" + std::to_string(comparison.candidateRounds)};
+        for (size_t i = 0; i < 3; i++)
+        {
+            row.push_back(std::to_string(comparison.candidate[i]));
+            row.push_back(std::to_string(comparison.delta[i]) + "%");
+        }
+        if (comparison.tested)
+        {
+            row.push_back(std::to_string(comparison.test.pValue));
+            row.push_back(effect_size_label(comparison.test.cliffsDelta) + " (" + std::to_string(comparison.test.cliffsDelta) + ")");
+            row.push_back("[" + std::to_string(comparison.ciLow) + ", " + std::to_string(comparison.ciHigh) + "]");
+        }
+        else
+        {
+            row.insert(row.end(), {"-", "-", "-"});
+        }
+        row.push_back(comparison.verdict);
+        compareTable.add_row(row);
+    }
+    for (size_t i = 0; i < 12; ++i)
+    {
+        compareTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    for (size_t row = 0; row < comparisons.size(); row++)
+    {
+        if (comparisons[row].verdict == "regression")
+            compareTable[row + 1][11].format().font_color(tabulate::Color::red);
+        else if (comparisons[row].verdict == "improvement")
+            compareTable[row + 1][11].format().font_color(tabulate::Color::green);
+    }
+    LOG(INFO) << candidate << " vs " << baseline << " (" << options.metric << " threshold " << options.threshold << "%, alpha " << options.alpha << ", * model file changed):\n"
+              << compareTable << "\n";
+}
+
+#endif
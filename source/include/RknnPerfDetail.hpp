@@ -0,0 +1,184 @@
+#ifndef RKNN_PERF_DETAIL_HPP
+#define RKNN_PERF_DETAIL_HPP
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "OperatorProfile.hpp"
+
+// 解析RKNN_QUERY_PERF_DETAIL返回的文本表格(perf_detail.perf_data)，不依赖rknn_api.h，可以直接用保存下来的文本测试。
+// 表格形如(RKNPU2 1.5之后):
+// ID   OpType           DataType Target InputShape            OutputShape     Cycles(DDR/NPU/Total)  Time(us)  MacUsage(%)  WorkLoad(0/1/2)   RW(KB)  FullName
+// 1    InputOperator    UINT8    CPU    \                     (1,3,224,224)   0/0/0                  5                      0.0%/0.0%/0.0%    0       InputOperator:input
+// 2    ConvRelu         UINT8    NPU    (1,3,224,224),(32...  (1,32,112,112)  7803/28224/28224       348       0.34         100.0%/0.0%/0.0%  150     Conv:Conv_0
+// ...
+// Total Operator Elapsed Per Frame Time(us): 4527
+// 旧版本的表头为DDR Cycles、NPU Cycles、Total Cycles等分开的列。
+// CPU上的算子MacUsage为空，因此按表头中每列的起始位置而不是按顺序把单元格归到列上。
+
+struct RknnPerfDetail
+{
+    std::vector<OperatorRecord> operators;
+    // 表格末尾的汇总，没有时为-1
+    double totalTimeUs = -1;
+    double totalRwKB = -1;
+};
+
+struct RknnPerfColumn
+{
+    std::string name;
+    size_t start;
+};
+
+// 按空白切分一行，记录每个单元格的起始位置
+std::vector<RknnPerfColumn> rknn_perf_tokens(const std::string &line)
+{
+    std::vector<RknnPerfColumn> tokens;
+    size_t i = 0;
+    while (i < line.size())
+    {
+        while (i < line.size() && std::isspace((unsigned char)line[i]))
+            i++;
+        size_t start = i;
+        while (i < line.size() && !std::isspace((unsigned char)line[i]))
+            i++;
+        if (i > start)
+            tokens.push_back({line.substr(start, i - start), start});
+    }
+    return tokens;
+}
+
+// 表头: 把旧版本中两个词的列名(DDR Cycles、Task Number等)合并为一列
+std::vector<RknnPerfColumn> rknn_perf_header(const std::string &line)
+{
+    std::vector<RknnPerfColumn> columns;
+    for (const auto &token : rknn_perf_tokens(line))
+    {
+        if (!columns.empty() && (token.name == "Cycles" || token.name == "Number"))
+        {
+            columns.back().name += " " + token.name;
+        }
+        else
+        {
+            columns.push_back(token);
+        }
+    }
+    return columns;
+}
+
+bool rknn_perf_is_integer(const std::string &text)
+{
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c)
+                                        { return std::isdigit((unsigned char)c); });
+}
+
+// 解析数值，忽略后面的%等单位，失败时返回fallback
+double rknn_perf_number(const std::string &text, double fallback = -1)
+{
+    char *end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    return end == text.c_str() ? fallback : value;
+}
+
+// 表格末尾汇总行冒号后面的数值
+double rknn_perf_total(const std::string &line)
+{
+    size_t colon = line.rfind(':');
+    return colon == std::string::npos ? -1 : rknn_perf_number(line.substr(colon + 1));
+}
+
+void rknn_perf_set_field(OperatorRecord &record, const std::string &column, const std::string &value)
+{
+    if (column == "ID")
+        record.id = std::atoi(value.c_str());
+    else if (column == "OpType")
+        record.opType = value;
+    else if (column == "DataType")
+        record.execType = value;
+    else if (column == "Target")
+        record.target = value;
+    else if (column == "InputShape")
+        record.inputShape = value == "\\" ? "" : value;
+    else if (column == "OutputShape")
+        record.outputShape = value == "\\" ? "" : value;
+    else if (column.rfind("Cycles(", 0) == 0)
+    {
+        // DDR/NPU/Total，取Total
+        size_t slash = value.rfind('/');
+        record.cycles = (int64_t)rknn_perf_number(slash == std::string::npos ? value : value.substr(slash + 1));
+    }
+    else if (column == "Total Cycles")
+        record.cycles = (int64_t)rknn_perf_number(value);
+    else if (column.rfind("Time", 0) == 0)
+        record.timeUs = rknn_perf_number(value, 0);
+    else if (column.rfind("MacUsage", 0) == 0)
+        record.macUsage = rknn_perf_number(value);
+    else if (column.rfind("RW", 0) == 0)
+        record.rwKB = rknn_perf_number(value);
+    else if (column == "FullName")
+        record.name = value;
+}
+
+bool parse_rknn_perf_detail(const std::string &text, RknnPerfDetail &detail)
+{
+    detail = RknnPerfDetail();
+    std::vector<RknnPerfColumn> header;
+    std::istringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::vector<RknnPerfColumn> tokens = rknn_perf_tokens(line);
+        if (tokens.empty())
+            continue;
+        if (tokens[0].name == "ID" && line.find("OpType") != std::string::npos)
+        {
+            header = rknn_perf_header(line);
+            continue;
+        }
+        if (line.find("Total Operator Elapsed") != std::string::npos)
+        {
+            detail.totalTimeUs = rknn_perf_total(line);
+            continue;
+        }
+        if (line.find("Total Memory Read/Write") != std::string::npos)
+        {
+            detail.totalRwKB = rknn_perf_total(line);
+            continue;
+        }
+        if (header.empty() || !rknn_perf_is_integer(tokens[0].name))
+            continue;
+        // 单元格归到起始位置不晚于它的最后一列；单元格比列宽时后面的单元格整体右移，按溢出的宽度修正起始位置
+        OperatorRecord record;
+        size_t column = 0;
+        size_t shift = 0;
+        for (size_t t = 0; t < tokens.size() && column < header.size(); t++)
+        {
+            size_t start = tokens[t].start - std::min(shift, tokens[t].start);
+            size_t target = column;
+            while (target + 1 < header.size() && header[target + 1].start <= start)
+                target++;
+            // 最后一列FullName可能含空格
+            if (target + 1 == header.size())
+            {
+                std::string rest = line.substr(tokens[t].start);
+                rknn_perf_set_field(record, header[target].name, rest.substr(0, rest.find_last_not_of(" \t") + 1));
+                break;
+            }
+            rknn_perf_set_field(record, header[target].name, tokens[t].name);
+            size_t end = start + tokens[t].name.size() + 1;
+            if (end > header[target + 1].start)
+                shift += end - header[target + 1].start;
+            column = target + 1;
+        }
+        // 输入输出算子本来就在CPU上，其余CPU算子是不支持的算子回退到CPU执行
+        record.fallback = record.target == "CPU" && record.opType != "InputOperator" && record.opType != "OutputOperator";
+        detail.operators.push_back(record);
+    }
+    return !detail.operators.empty();
+}
+
+#endif
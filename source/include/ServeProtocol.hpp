@@ -0,0 +1,282 @@
+#ifndef SERVE_PROTOCOL_HPP
+#define SERVE_PROTOCOL_HPP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// npuserve的进程间协议: AF_UNIX SOCK_SEQPACKET连接，每个消息是一个定长结构体，消息边界由套接字保证。
+// 张量不经过套接字: 客户端创建memfd作为共享内存区，ATTACH时用SCM_RIGHTS把fd传给服务端，
+// 之后INFER只携带slot编号，服务端直接从共享内存中的输入区调用inputs_set，outputs_get写到共享内存中的输出区。
+// memfd用F_SEAL_SHRINK封住，客户端不能在ATTACH之后把它截短，服务端访问映射时不会因此收到SIGBUS。
+// 一个连接绑定一个模型，连接内的请求按顺序处理，多个连接可以并发访问不同或相同的模型(同一个模型串行推理)。
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_GET_SEALS 1034
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#endif
+
+#define NPUSERVE_MAX_TENSORS 16
+#define NPUSERVE_NAME_SIZE 128
+#define NPUSERVE_ALIGN 64
+// 一个连接的共享内存中最多的slot数，ATTACH时超过的请求被拒绝
+#define NPUSERVE_MAX_SLOTS 1024
+
+enum ServeOp : uint32_t
+{
+    SERVE_DESCRIBE = 1,
+    SERVE_ATTACH,
+    SERVE_INFER,
+};
+
+struct ServeRequest
+{
+    uint32_t op;
+    // ATTACH时共享内存中的slot数，INFER时使用的slot
+    uint32_t slot;
+    uint64_t id;
+    // INFER: 客户端发出请求时的CLOCK_MONOTONIC(ns)，同一台机器上两端的时钟相同
+    int64_t sentNs;
+    char model[NPUSERVE_NAME_SIZE];
+};
+
+struct ServeReply
+{
+    int32_t status;
+    uint32_t slot;
+    uint64_t id;
+    // DESCRIBE: 模型的后端、输入张量类型(InputDataType)和输入输出张量字节数
+    char backend[NPUSERVE_NAME_SIZE];
+    uint32_t inputCount;
+    uint32_t outputCount;
+    int32_t inputTypes[NPUSERVE_MAX_TENSORS];
+    uint64_t inputBytes[NPUSERVE_MAX_TENSORS];
+    uint64_t outputBytes[NPUSERVE_MAX_TENSORS];
+    // INFER: 服务端从取出请求到发出回复的时间，以及其中inputs_set + run + outputs_get的时间(us)
+    double serverUs;
+    double computeUs;
+    // INFER: 请求在套接字中等待服务端处理完同一连接上前面的请求的时间(us)，即发出时刻到前一个回复发出时刻
+    double socketQueueUs;
+    char error[NPUSERVE_NAME_SIZE];
+};
+
+static_assert(std::is_trivially_copyable<ServeRequest>::value && std::is_trivially_copyable<ServeReply>::value, "serve messages are sent as raw bytes");
+
+// 共享内存区的布局: 每个slot依次存放所有输入和输出张量，每个张量按64字节对齐，客户端和服务端按DESCRIBE的结果计算出相同的偏移
+struct SharedArenaLayout
+{
+    std::vector<size_t> inputOffsets;
+    std::vector<size_t> outputOffsets;
+    size_t slotBytes = 0;
+    uint32_t slots = 0;
+
+    SharedArenaLayout() = default;
+
+    SharedArenaLayout(const ServeReply &describe, uint32_t slotCount)
+        : slots(slotCount)
+    {
+        auto place = [&](uint64_t bytes)
+        {
+            size_t offset = slotBytes;
+            slotBytes += (bytes + NPUSERVE_ALIGN - 1) / NPUSERVE_ALIGN * NPUSERVE_ALIGN;
+            return offset;
+        };
+        for (uint32_t i = 0; i < describe.inputCount; i++)
+        {
+            inputOffsets.push_back(place(describe.inputBytes[i]));
+        }
+        for (uint32_t i = 0; i < describe.outputCount; i++)
+        {
+            outputOffsets.push_back(place(describe.outputBytes[i]));
+        }
+        slotBytes = std::max(slotBytes, (size_t)NPUSERVE_ALIGN);
+    }
+
+    size_t total_bytes() const
+    {
+        return slotBytes * slots;
+    }
+
+    // slot数在1到NPUSERVE_MAX_SLOTS之间，且total_bytes()没有溢出
+    bool valid() const
+    {
+        return slots > 0 && slots <= NPUSERVE_MAX_SLOTS && slotBytes <= SIZE_MAX / slots;
+    }
+
+    uint8_t *input(uint8_t *base, uint32_t slot, size_t index) const
+    {
+        return base + slot * slotBytes + inputOffsets[index];
+    }
+
+    uint8_t *output(uint8_t *base, uint32_t slot, size_t index) const
+    {
+        return base + slot * slotBytes + outputOffsets[index];
+    }
+};
+
+// CLOCK_MONOTONIC(ns)，客户端和服务端用它计算请求在套接字中等待的时间
+int64_t serve_monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// 创建并映射memfd，设置大小后封住截短和之后的封印，失败时返回-1
+int create_shared_arena(size_t bytes, uint8_t **base)
+{
+    int fd = (int)syscall(SYS_memfd_create, "npuserve", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)bytes) != 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+    *base = (uint8_t *)memory;
+    return fd;
+}
+
+// 映射对端传来的memfd，没有封住截短或大小不足时失败
+uint8_t *map_shared_arena(int fd, size_t bytes)
+{
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK))
+    {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < bytes)
+    {
+        return nullptr;
+    }
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return memory == MAP_FAILED ? nullptr : (uint8_t *)memory;
+}
+
+// 发送一个消息，fd >= 0时通过SCM_RIGHTS一起发送
+bool serve_send(int sock, const void *message, size_t bytes, int fd = -1)
+{
+    struct iovec iov = {const_cast<void *>(message), bytes};
+    struct msghdr header = {};
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    if (fd >= 0)
+    {
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    ssize_t sent;
+    do
+    {
+        sent = sendmsg(sock, &header, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    return sent == (ssize_t)bytes;
+}
+
+// 接收一个消息，fd不为空时取出SCM_RIGHTS传来的fd(没有时为-1)；对端关闭连接时返回false
+bool serve_recv(int sock, void *message, size_t bytes, int *fd = nullptr)
+{
+    struct iovec iov = {message, bytes};
+    struct msghdr header = {};
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    ssize_t received;
+    do
+    {
+        received = recvmsg(sock, &header, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    if (fd)
+    {
+        *fd = -1;
+    }
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            int received_fd;
+            memcpy(&received_fd, CMSG_DATA(cmsg), sizeof(int));
+            if (fd)
+            {
+                *fd = received_fd;
+            }
+            else
+            {
+                close(received_fd);
+            }
+        }
+    }
+    return received == (ssize_t)bytes;
+}
+
+bool serve_socket_address(const std::string &path, struct sockaddr_un &address)
+{
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return true;
+}
+
+int serve_connect(const std::string &path)
+{
+    struct sockaddr_un address;
+    if (!serve_socket_address(path, address))
+    {
+        return -1;
+    }
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock >= 0 && connect(sock, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void serve_copy_name(char *target, const std::string &name)
+{
+    memset(target, 0, NPUSERVE_NAME_SIZE);
+    strncpy(target, name.c_str(), NPUSERVE_NAME_SIZE - 1);
+}
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef SIMULATED_BACKEND_HPP
+#define SIMULATED_BACKEND_HPP
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "Trace.hpp"
+
+// 在没有NPU的机器(例如x86)上模拟一次推理:
+// 1. host把输入拷贝到"设备"输入缓冲区
+// 2. NPU通过DMA从DDR读取权重，同时计算，耗时取两者的较大值
+// 3. host把"设备"输出缓冲区拷贝回来
+// 权重读取和host拷贝都会真实地经过内存总线，因此内存争用、调度等与硬件无关的逻辑可以在x86上测试。
+struct SimulatedModelConfig
+{
+    std::string name = "simulated_model";
+    size_t inputBytes = 1 * 3 * 224 * 224;
+    size_t outputBytes = 1000 * sizeof(float);
+    // 每次推理从DDR读取的权重字节数
+    size_t weightBytes = 32 * 1024 * 1024;
+    // 不受内存带宽影响时的纯计算时间(us)
+    double computeUs = 2000;
+    // 计算期间让出host CPU(sleep)而不是忙等，NPU计算本身不占用CPU，多个模拟模型并发时使用
+    bool idleCompute = false;
+};
+
+class SimulatedBackend
+{
+public:
+    explicit SimulatedBackend(const SimulatedModelConfig &config)
+        : config_(config),
+          hostInput_(config.inputBytes, 1),
+          deviceInput_(config.inputBytes, 0),
+          deviceOutput_(config.outputBytes, 0),
+          hostOutput_(config.outputBytes, 0),
+          weights_(config.weightBytes / sizeof(uint64_t) + 1, 1)
+    {
+    }
+
+    // 对应rknn_inputs_set / hbSysFlushMem，data为空时拷贝内部的host缓冲区
+    void inputs_set(const void *data = nullptr)
+    {
+        TRACE_SCOPE("inputs_set");
+        memcpy(deviceInput_.data(), data ? data : hostInput_.data(), config_.inputBytes);
+    }
+
+    void run()
+    {
+        TRACE_SCOPE("run");
+        auto start = std::chrono::steady_clock::now();
+        // 每个cache line读一个字，模拟DMA按行搬运权重
+        const size_t stride = 64 / sizeof(uint64_t);
+        uint64_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+        size_t i = 0;
+        for (; i + 3 * stride < weights_.size(); i += 4 * stride)
+        {
+            sum0 += weights_[i];
+            sum1 += weights_[i + stride];
+            sum2 += weights_[i + 2 * stride];
+            sum3 += weights_[i + 3 * stride];
+        }
+        sink_ = sink_ + sum0 + sum1 + sum2 + sum3;
+        if (!deviceOutput_.empty())
+        {
+            memset(deviceOutput_.data(), (int)(sink_ + deviceInput_[0]) & 0xff, deviceOutput_.size());
+        }
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::micro>(config_.computeUs));
+        if (config_.idleCompute)
+        {
+            std::this_thread::sleep_until(deadline);
+        }
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+        }
+    }
+
+    // 对应rknn_outputs_get，data为空时拷贝到内部的host缓冲区
+    void outputs_get(void *data = nullptr)
+    {
+        TRACE_SCOPE("outputs_get");
+        memcpy(data ? data : hostOutput_.data(), deviceOutput_.data(), config_.outputBytes);
+    }
+
+    const SimulatedModelConfig &config() const
+    {
+        return config_;
+    }
+
+    nlohmann::json meta_info() const
+    {
+        nlohmann::json meta;
+        meta["BackendName"] = "Simulated";
+        meta["ModelName"] = config_.name;
+        meta["InputBytes"] = config_.inputBytes;
+        meta["OutputBytes"] = config_.outputBytes;
+        meta["WeightBytes"] = config_.weightBytes;
+        meta["ComputeUs"] = config_.computeUs;
+        return meta;
+    }
+
+private:
+    SimulatedModelConfig config_;
+    std::vector<uint8_t> hostInput_;
+    std::vector<uint8_t> deviceInput_;
+    std::vector<uint8_t> deviceOutput_;
+    std::vector<uint8_t> hostOutput_;
+    std::vector<uint64_t> weights_;
+    volatile uint64_t sink_ = 0;
+};
+
+// 模拟有多个核心的加速器的仲裁: 一个请求占用一个核心直到完成(不可抢占)，
+// 核心空闲时优先级高的等待者先得到，同优先级按到达顺序，对应BPU的任务优先级队列。
+class SimulatedDevice
+{
+public:
+    explicit SimulatedDevice(int cores)
+        : busy_(cores > 0 ? cores : 1, false)
+    {
+    }
+
+    // 等待一个空闲核心并占用，core为-1时可以使用任意核心，返回占用的核心
+    int acquire(int priority, int core = -1)
+    {
+        TRACE_SCOPE("wait core");
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto self = waiters_.insert(waiters_.end(), Waiter{priority, core < (int)busy_.size() ? core : -1});
+        int granted = -1;
+        cond_.wait(lock, [&]()
+                   { return (granted = grantable(self)) >= 0; });
+        busy_[granted] = true;
+        waiters_.erase(self);
+        // 其他等待者可能在等另一个空闲核心
+        cond_.notify_all();
+        return granted;
+    }
+
+    void release(int core)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_[core] = false;
+        }
+        cond_.notify_all();
+    }
+
+    int cores() const
+    {
+        return (int)busy_.size();
+    }
+
+private:
+    struct Waiter
+    {
+        int priority;
+        int core;
+    };
+
+    bool matches(const Waiter &waiter, int core) const
+    {
+        return waiter.core < 0 || waiter.core == core;
+    }
+
+    // 返回self可以占用的空闲核心: 没有更高优先级(或同优先级更早到达)的等待者也能使用该核心
+    // 不绑定核心的请求从编号大的核心开始找，尽量把小编号的核心留给绑定的模型
+    int grantable(std::list<Waiter>::iterator self) const
+    {
+        for (int core = (int)busy_.size() - 1; core >= 0; core--)
+        {
+            if (busy_[core] || !matches(*self, core))
+            {
+                continue;
+            }
+            // waiters_按到达顺序排列
+            bool preceded = false;
+            bool earlier = true;
+            for (auto it = waiters_.begin(); it != waiters_.end() && !preceded; ++it)
+            {
+                if (it == self)
+                {
+                    earlier = false;
+                    continue;
+                }
+                if (matches(*it, core))
+                {
+                    preceded = it->priority > self->priority || (it->priority == self->priority && earlier);
+                }
+            }
+            if (!preceded)
+            {
+                return core;
+            }
+        }
+        return -1;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::vector<bool> busy_;
+    std::list<Waiter> waiters_;
+};
+
+#endif
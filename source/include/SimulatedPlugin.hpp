@@ -0,0 +1,165 @@
+#ifndef SIMULATED_PLUGIN_HPP
+#define SIMULATED_PLUGIN_HPP
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "nlohmann/json.hpp"
+#include "BackendPlugin.h"
+#include "SimulatedBackend.hpp"
+
+// 内置的模拟后端插件，编译在npubench中，不需要dlopen，没有NPU的机器上也能运行完整的流程。
+// 模型文件(.sim)为json，与共置场景中的sim_*字段相同:
+// {"sim_input_bytes": 150528, "sim_output_bytes": 4000, "sim_weight_mb": 16, "sim_compute_us": 3000}
+// 文件不存在时使用默认参数；options中的同名字段覆盖文件中的值，priority/core/sim_cores用于模拟多核加速器的仲裁，
+// sim_init_us模拟rknn_init等模型初始化的耗时。
+
+struct SimulatedPluginModel
+{
+    std::unique_ptr<SimulatedBackend> backend;
+    int priority = 0;
+    int core = -1;
+    std::string meta;
+    std::string error;
+};
+
+// 同一进程中所有模拟模型共享一个加速器，核心数由第一个加载的模型决定
+SimulatedDevice &simulated_plugin_device(int cores)
+{
+    static SimulatedDevice device(cores);
+    return device;
+}
+
+void *simulated_plugin_load(const char *model_path, const char *options, char *error, size_t error_size)
+{
+    try
+    {
+        nlohmann::json config = nlohmann::json::object();
+        std::ifstream file(model_path);
+        if (file.is_open())
+        {
+            file >> config;
+        }
+        nlohmann::json overrides = nlohmann::json::parse(options && *options ? options : "{}");
+        for (const auto &item : overrides.items())
+        {
+            config[item.key()] = item.value();
+        }
+        SimulatedModelConfig sim;
+        sim.name = std::filesystem::path(model_path).stem().string();
+        sim.inputBytes = config.value("sim_input_bytes", sim.inputBytes);
+        sim.outputBytes = config.value("sim_output_bytes", sim.outputBytes);
+        sim.weightBytes = (size_t)(config.value("sim_weight_mb", 32.0) * 1024 * 1024);
+        sim.computeUs = config.value("sim_compute_us", sim.computeUs);
+        sim.idleCompute = config.value("sim_idle", false);
+        simulated_plugin_device(config.value("sim_cores", 1));
+        std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(config.value("sim_init_us", 0.0)));
+        auto model = new SimulatedPluginModel();
+        model->backend.reset(new SimulatedBackend(sim));
+        model->priority = config.value("priority", 0);
+        model->core = config.value("core", -1);
+        nlohmann::json meta = model->backend->meta_info();
+        meta["BackendVersion"] = "builtin";
+        meta["Device"] = "Simulated";
+        meta["MemoryBytes"] = sim.weightBytes + sim.inputBytes + sim.outputBytes;
+        model->meta = meta.dump();
+        return model;
+    }
+    catch (const std::exception &ex)
+    {
+        snprintf(error, error_size, "invalid simulated model %s: %s", model_path, ex.what());
+        return nullptr;
+    }
+}
+
+void simulated_plugin_unload(void *model)
+{
+    delete static_cast<SimulatedPluginModel *>(model);
+}
+
+int32_t simulated_plugin_count(void *)
+{
+    return 1;
+}
+
+int32_t simulated_plugin_input_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    auto sim = static_cast<SimulatedPluginModel *>(model);
+    snprintf(desc->name, sizeof(desc->name), "input%d", index);
+    desc->dtype = NPU_DTYPE_UINT8;
+    desc->bytes = sim->backend->config().inputBytes;
+    return 0;
+}
+
+int32_t simulated_plugin_output_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    auto sim = static_cast<SimulatedPluginModel *>(model);
+    snprintf(desc->name, sizeof(desc->name), "output%d", index);
+    desc->dtype = NPU_DTYPE_FLOAT32;
+    desc->bytes = sim->backend->config().outputBytes;
+    return 0;
+}
+
+int32_t simulated_plugin_inputs_set(void *model, const void *const *inputs)
+{
+    static_cast<SimulatedPluginModel *>(model)->backend->inputs_set(inputs[0]);
+    return 0;
+}
+
+int32_t simulated_plugin_run(void *model)
+{
+    auto sim = static_cast<SimulatedPluginModel *>(model);
+    SimulatedDevice &device = simulated_plugin_device(1);
+    int core = device.acquire(sim->priority, sim->core);
+    sim->backend->run();
+    device.release(core);
+    return 0;
+}
+
+int32_t simulated_plugin_outputs_get(void *model, void *const *outputs)
+{
+    static_cast<SimulatedPluginModel *>(model)->backend->outputs_get(outputs[0]);
+    return 0;
+}
+
+const char *simulated_plugin_meta_info(void *model)
+{
+    return static_cast<SimulatedPluginModel *>(model)->meta.c_str();
+}
+
+const char *simulated_plugin_last_error(void *model)
+{
+    return static_cast<SimulatedPluginModel *>(model)->error.c_str();
+}
+
+const char *simulated_plugin_version()
+{
+    return "builtin";
+}
+
+const NpuBackendPlugin *simulated_backend_plugin()
+{
+    static const NpuBackendPlugin plugin = {
+        NPUBENCH_PLUGIN_ABI,
+        "simulated",
+        ".sim",
+        simulated_plugin_version,
+        simulated_plugin_load,
+        simulated_plugin_unload,
+        simulated_plugin_count,
+        simulated_plugin_count,
+        simulated_plugin_input_desc,
+        simulated_plugin_output_desc,
+        simulated_plugin_inputs_set,
+        simulated_plugin_run,
+        simulated_plugin_outputs_get,
+        simulated_plugin_meta_info,
+        simulated_plugin_last_error,
+    };
+    return &plugin;
+}
+
+#endif
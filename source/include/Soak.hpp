@@ -0,0 +1,437 @@
+#ifndef SOAK_HPP
+#define SOAK_HPP
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+
+// 长时间稳定性测试(soak): 连续推理数小时，内存占用固定。
+// 每个窗口(默认1分钟)的延迟记录在对数分桶的直方图中(相对误差约1%)，窗口结束时得到分位数，
+// 同时读取进程的RSS、打开的文件描述符数和线程数，窗口记录逐行追加到jsonl文件中，不保留在内存里。
+// 对各窗口的p50/p99延迟和RSS做线性回归(与lmbench lib_stats.c中的regression()相同，sig = NULL，
+// 以累加和的形式在线计算)，斜率显著(超过2倍标准误差)且漂移超过阈值时告警；文件描述符和线程数相对第一个窗口增长超过阈值时告警。
+
+struct SoakConfig
+{
+    double durationS = 3600;
+    double windowS = 60;
+    // 延迟在整个运行期间按趋势线增长的百分比阈值
+    double latencyDrift = 10;
+    // RSS增长速度阈值(MB/h)
+    double rssDriftMb = 10;
+    // 文件描述符、线程数相对第一个窗口的增长阈值
+    int handleDrift = 16;
+    // 窗口记录文件(jsonl)，为空时不写
+    std::string windowFile;
+    // 写在每条窗口记录中，区分多个模型
+    std::string label;
+};
+
+// 对数分桶的延迟直方图(us)，桶宽为1%，覆盖1us到约100s
+class LatencyHistogram
+{
+public:
+    static const int BUCKETS = 1900;
+
+    void add(double us)
+    {
+        int index = us <= 1.0 ? 0 : std::min((int)(std::log(us) / std::log(1.01)) + 1, BUCKETS - 1);
+        counts_[index]++;
+        count_++;
+        sum_ += us;
+        sqSum_ += us * us;
+        min_ = count_ == 1 ? us : std::min(min_, us);
+        max_ = count_ == 1 ? us : std::max(max_, us);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        min_ = count_ == 0 ? other.min_ : (other.count_ == 0 ? min_ : std::min(min_, other.min_));
+        max_ = std::max(max_, other.max_);
+        count_ += other.count_;
+        sum_ += other.sum_;
+        sqSum_ += other.sqSum_;
+    }
+
+    void reset()
+    {
+        counts_.fill(0);
+        count_ = 0;
+        sum_ = sqSum_ = 0;
+        min_ = max_ = 0;
+    }
+
+    uint64_t count() const
+    {
+        return count_;
+    }
+
+    double mean() const
+    {
+        return count_ ? sum_ / count_ : -1;
+    }
+
+    double stdev() const
+    {
+        return count_ ? std::sqrt(std::max(sqSum_ / count_ - mean() * mean(), 0.0)) : -1;
+    }
+
+    double min() const
+    {
+        return count_ ? min_ : -1;
+    }
+
+    double max() const
+    {
+        return count_ ? max_ : -1;
+    }
+
+    // 取桶的几何中点，结果限制在[min, max]内
+    double percentile(double p) const
+    {
+        if (count_ == 0)
+        {
+            return -1;
+        }
+        uint64_t rank = (uint64_t)std::ceil(p / 100.0 * count_);
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++)
+        {
+            seen += counts_[i];
+            if (seen >= std::max<uint64_t>(rank, 1))
+            {
+                double value = i == 0 ? 1.0 : std::pow(1.01, i - 0.5);
+                return std::min(std::max(value, min_), max_);
+            }
+        }
+        return max_;
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> counts_ = {};
+    uint64_t count_ = 0;
+    double sum_ = 0;
+    double sqSum_ = 0;
+    double min_ = 0;
+    double max_ = 0;
+};
+
+// 在线线性回归y = a + bx，y以第一个点为基准累加，避免长时间运行后平方和损失精度
+struct TrendFit
+{
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+    double y0 = 0;
+
+    void add(double x, double y)
+    {
+        if (n == 0)
+        {
+            y0 = y;
+        }
+        y -= y0;
+        n++;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        syy += y * y;
+    }
+
+    // 至少3个点时返回true，sig_b为斜率的标准误差
+    bool fit(double &a, double &b, double &sig_b) const
+    {
+        double stt = sxx - sx * sx / n;
+        if (n < 3 || stt <= 0)
+        {
+            return false;
+        }
+        b = (sxy - sx * sy / n) / stt;
+        a = (sy - b * sx) / n;
+        double chi2 = syy - 2 * a * sy - 2 * b * sxy + n * a * a + 2 * a * b * sx + b * b * sxx;
+        sig_b = std::sqrt(std::max(chi2, 0.0) / (n - 2) / stt);
+        a += y0;
+        return true;
+    }
+};
+
+// 读取/proc/self/status中的数值字段，例如VmRSS(kB)、Threads，不支持时返回-1
+double process_status_value(const std::string &key)
+{
+    std::ifstream file("/proc/self/status");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.rfind(key + ":", 0) == 0)
+        {
+            return std::atof(line.substr(key.size() + 1).c_str());
+        }
+    }
+    return -1;
+}
+
+int open_fd_count()
+{
+    std::error_code ec;
+    int count = 0;
+    for (std::filesystem::directory_iterator it("/proc/self/fd", ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+    {
+        count++;
+    }
+    return ec && count == 0 ? -1 : count;
+}
+
+struct SoakWindow
+{
+    int index = 0;
+    double startS = 0;
+    double endS = 0;
+    uint64_t errors = 0;
+    double rssMb = -1;
+    int fds = -1;
+    int threads = -1;
+};
+
+struct SoakAlert
+{
+    std::string kind;
+    int firstWindow = 0;
+    int lastWindow = 0;
+    int windows = 0;
+    double value = 0;
+    double threshold = 0;
+    std::string message;
+};
+
+class SoakMonitor
+{
+public:
+    explicit SoakMonitor(const SoakConfig &config)
+        : config_(config)
+    {
+    }
+
+    // request执行一次推理，失败时返回false；一个窗口中所有请求都失败时提前结束
+    nlohmann::json run(const std::function<bool()> &request)
+    {
+        if (!config_.windowFile.empty())
+        {
+            std::filesystem::path path(config_.windowFile);
+            if (path.has_parent_path())
+            {
+                std::filesystem::create_directories(path.parent_path());
+            }
+            windowFile_.open(config_.windowFile, std::ios::app);
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(config_.durationS));
+        auto window_length = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(config_.windowS));
+        auto window_end = std::min(start + window_length, deadline);
+        SoakWindow window;
+        bool failed = false;
+        while (!failed)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            if (begin >= window_end)
+            {
+                window.endS = std::chrono::duration<double>(begin - start).count();
+                failed = window_.count() == 0 && window.errors > 0;
+                close_window(window);
+                if (begin >= deadline)
+                {
+                    break;
+                }
+                window = SoakWindow();
+                window.index = windows_;
+                window.startS = std::chrono::duration<double>(begin - start).count();
+                window_end = std::min(begin + window_length, deadline);
+            }
+            bool ok = request();
+            auto end = std::chrono::steady_clock::now();
+            if (ok)
+            {
+                window_.add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / 1000.0);
+            }
+            else
+            {
+                window.errors++;
+            }
+        }
+        if (failed)
+        {
+            LOG(ERROR) << "Soak stopped at window " << windows_ - 1 << ", every request of the window failed";
+        }
+        return report(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    const LatencyHistogram &total() const
+    {
+        return total_;
+    }
+
+    bool alerted() const
+    {
+        return !alerts_.empty();
+    }
+
+private:
+    void close_window(SoakWindow &window)
+    {
+        window.rssMb = process_status_value("VmRSS") / 1024.0;
+        window.fds = open_fd_count();
+        window.threads = (int)process_status_value("Threads");
+        if (windows_ == 0)
+        {
+            first_ = window;
+        }
+        last_ = window;
+        errors_ += window.errors;
+        double hours = (window.startS + window.endS) / 2 / 3600.0;
+        if (window_.count() > 0)
+        {
+            p50Fit_.add(hours, window_.percentile(50));
+            p99Fit_.add(hours, window_.percentile(99));
+        }
+        if (window.rssMb >= 0)
+        {
+            rssFit_.add(hours, window.rssMb);
+        }
+
+        nlohmann::json record = {{"Window", window.index}, {"StartS", window.startS}, {"EndS", window.endS}, {"Requests", window_.count()}, {"Errors", window.errors},
+                                 {"MeanLatency", window_.mean()}, {"P50Latency", window_.percentile(50)}, {"P90Latency", window_.percentile(90)},
+                                 {"P99Latency", window_.percentile(99)}, {"MaxLatency", window_.max()}, {"RssMb", window.rssMb}, {"Fds", window.fds}, {"Threads", window.threads}};
+        if (!config_.label.empty())
+        {
+            record["Model"] = config_.label;
+        }
+        if (windowFile_.is_open())
+        {
+            windowFile_ << record.dump() << std::endl;
+        }
+        LOG(INFO) << "Soak window " << window.index << " [" << (int)window.startS << "s, " << (int)window.endS << "s): " << window_.count() << " requests, p50 "
+                  << window_.percentile(50) << " us, p99 " << window_.percentile(99) << " us, rss " << window.rssMb << " MB, fds " << window.fds
+                  << ", threads " << window.threads;
+        total_.merge(window_);
+        window_.reset();
+        windows_++;
+        check(window);
+    }
+
+    // 告警按类型去重，只在第一次出现时打印
+    void raise(const std::string &kind, int window, double value, double threshold, const std::string &message)
+    {
+        auto it = alerts_.find(kind);
+        if (it == alerts_.end())
+        {
+            LOG(WARNING) << "Soak alert " << kind << " at window " << window << ": " << message;
+            alerts_[kind] = {kind, window, window, 1, value, threshold, message};
+            return;
+        }
+        it->second.lastWindow = window;
+        it->second.windows++;
+        it->second.value = value;
+        it->second.message = message;
+    }
+
+    // 趋势线在整个运行期间的变化，相对t=0时的截距
+    static double drift_percent(const TrendFit &fit, double hours)
+    {
+        double a, b, sig_b;
+        if (!fit.fit(a, b, sig_b) || a <= 0 || std::fabs(b) <= 2 * sig_b)
+        {
+            return 0;
+        }
+        return b * hours / a * 100;
+    }
+
+    void check(const SoakWindow &window)
+    {
+        double hours = window.endS / 3600.0;
+        double a, b, sig_b;
+        for (const auto &item : {std::make_pair(std::string("p50_latency_drift"), &p50Fit_), std::make_pair(std::string("p99_latency_drift"), &p99Fit_)})
+        {
+            double drift = drift_percent(*item.second, hours);
+            if (drift > config_.latencyDrift)
+            {
+                raise(item.first, window.index, drift, config_.latencyDrift, "latency grew " + std::to_string(drift) + "% along the trend line");
+            }
+        }
+        if (rssFit_.fit(a, b, sig_b) && b > config_.rssDriftMb && b > 2 * sig_b)
+        {
+            raise("rss_growth", window.index, b, config_.rssDriftMb, "rss grows " + std::to_string(b) + " MB/h");
+        }
+        if (first_.fds >= 0 && window.fds - first_.fds > config_.handleDrift)
+        {
+            raise("fd_growth", window.index, window.fds - first_.fds, config_.handleDrift, std::to_string(window.fds - first_.fds) + " more open fds than the first window");
+        }
+        if (first_.threads >= 0 && window.threads - first_.threads > config_.handleDrift)
+        {
+            raise("thread_growth", window.index, window.threads - first_.threads, config_.handleDrift, std::to_string(window.threads - first_.threads) + " more threads than the first window");
+        }
+        if (window.errors > 0)
+        {
+            raise("errors", window.index, window.errors, 0, std::to_string(window.errors) + " failed requests");
+        }
+    }
+
+    nlohmann::json trend_json(const TrendFit &fit, double hours) const
+    {
+        double a, b, sig_b;
+        if (!fit.fit(a, b, sig_b))
+        {
+            return nullptr;
+        }
+        return {{"Intercept", a}, {"SlopePerHour", b}, {"SlopeStdErr", sig_b}, {"DriftPercent", drift_percent(fit, hours)}};
+    }
+
+    nlohmann::json report(double elapsed_s) const
+    {
+        double hours = elapsed_s / 3600.0;
+        nlohmann::json result;
+        result["DurationS"] = elapsed_s;
+        result["WindowS"] = config_.windowS;
+        result["Windows"] = windows_;
+        result["Requests"] = total_.count();
+        result["Errors"] = errors_;
+        result["WindowFile"] = config_.windowFile;
+        result["Trends"]["P50Latency"] = trend_json(p50Fit_, hours);
+        result["Trends"]["P99Latency"] = trend_json(p99Fit_, hours);
+        result["Trends"]["RssMb"] = trend_json(rssFit_, hours);
+        result["Handles"] = {{"FdsStart", first_.fds}, {"FdsEnd", last_.fds}, {"ThreadsStart", first_.threads}, {"ThreadsEnd", last_.threads}};
+        result["Thresholds"] = {{"LatencyDriftPercent", config_.latencyDrift}, {"RssDriftMbPerHour", config_.rssDriftMb}, {"HandleDrift", config_.handleDrift}};
+        result["Alerts"] = nlohmann::json::array();
+        for (const auto &item : alerts_)
+        {
+            const SoakAlert &alert = item.second;
+            result["Alerts"].push_back({{"Kind", alert.kind}, {"FirstWindow", alert.firstWindow}, {"LastWindow", alert.lastWindow}, {"Windows", alert.windows},
+                                        {"Value", alert.value}, {"Threshold", alert.threshold}, {"Message", alert.message}});
+        }
+        return result;
+    }
+
+    SoakConfig config_;
+    std::ofstream windowFile_;
+    LatencyHistogram window_;
+    LatencyHistogram total_;
+    TrendFit p50Fit_;
+    TrendFit p99Fit_;
+    TrendFit rssFit_;
+    SoakWindow first_;
+    SoakWindow last_;
+    int windows_ = 0;
+    uint64_t errors_ = 0;
+    std::map<std::string, SoakAlert> alerts_;
+};
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef TENSOR_POOL_HPP
+#define TENSOR_POOL_HPP
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// 输入输出张量的缓冲池，按(大小, 对齐, 内存类型)复用缓冲区。
+// 释放的缓冲区先放进当前线程的空闲链表，超过上限后再放回共享链表，批量测试多个模型或多路并发时稳定状态下不再调用系统分配器。
+// Buffer是分配得到的句柄: host内存为void*，BPU为hbSysMem，HiAI为INDTensorBuffer的shared_ptr。
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr size_t PAGE_SIZE_4K = 4096;
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+enum class MemoryKind
+{
+    Host,
+    HostHugePage,
+    Device
+};
+
+std::string memory_kind_name(MemoryKind kind)
+{
+    switch (kind)
+    {
+    case MemoryKind::Host:
+        return "host";
+    case MemoryKind::HostHugePage:
+        return "host_hugepage";
+    default:
+        return "device";
+    }
+}
+
+// 大小按2的幂的1/4分级向上取整，相近的大小共用同一级，浪费不超过25%
+size_t pool_size_class(size_t size)
+{
+    if (size <= CACHE_LINE_SIZE)
+    {
+        return CACHE_LINE_SIZE;
+    }
+    size_t power = 1;
+    while (power * 2 <= size)
+    {
+        power *= 2;
+    }
+    size_t step = std::max(power / 4, CACHE_LINE_SIZE);
+    return (size + step - 1) / step * step;
+}
+
+struct PoolKey
+{
+    size_t size;
+    size_t alignment;
+    MemoryKind kind;
+
+    bool operator==(const PoolKey &other) const
+    {
+        return size == other.size && alignment == other.alignment && kind == other.kind;
+    }
+};
+
+struct PoolKeyHash
+{
+    size_t operator()(const PoolKey &key) const
+    {
+        return std::hash<size_t>()(key.size) ^ (std::hash<size_t>()(key.alignment) << 1) ^ ((size_t)key.kind << 2);
+    }
+};
+
+struct PoolStatistics
+{
+    uint64_t acquires = 0;
+    uint64_t threadHits = 0;
+    uint64_t sharedHits = 0;
+    uint64_t misses = 0;
+    uint64_t bytesInUse = 0;
+    uint64_t peakBytesInUse = 0;
+    uint64_t bytesReserved = 0;
+    uint64_t peakBytesReserved = 0;
+
+    double hit_rate() const
+    {
+        return acquires == 0 ? 0.0 : (double)(threadHits + sharedHits) / acquires;
+    }
+};
+
+template <typename Buffer>
+class BufferPool
+{
+public:
+    // 分配失败返回false，key.size已经按大小分级取整
+    using Allocate = std::function<bool(const PoolKey &key, Buffer &buffer)>;
+    using Release = std::function<void(const PoolKey &key, Buffer &buffer)>;
+
+    BufferPool(const std::string &name, Allocate allocate, Release release, size_t threadCacheLimit = 8)
+        : name_(name), state_(std::make_shared<State>())
+    {
+        static std::atomic<uint64_t> nextId{0};
+        id_ = nextId++;
+        state_->allocate = std::move(allocate);
+        state_->release = std::move(release);
+        state_->threadCacheLimit = threadCacheLimit;
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // 线程局部的空闲链表在线程退出时已经交还共享链表，这里只释放共享链表
+    ~BufferPool()
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        release_free_lists(state_->free);
+        state_->closed = true;
+    }
+
+    // 取一块不小于size的缓冲区，依次查找线程空闲链表、共享空闲链表，都没有时才分配；
+    // allocate不为空时用它代替构造时给出的分配函数(例如需要张量描述的后端)
+    bool acquire(size_t size, size_t alignment, MemoryKind kind, Buffer &buffer, PoolKey &key, const Allocate &allocate = nullptr)
+    {
+        key = PoolKey{pool_size_class(size), alignment, kind};
+        State &state = *state_;
+        state.acquires++;
+        auto &local = thread_cache().lists[key];
+        if (!local.empty())
+        {
+            buffer = std::move(local.back());
+            local.pop_back();
+            state.threadHits++;
+            add_in_use(key.size);
+            return true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            auto iter = state.free.find(key);
+            if (iter != state.free.end() && !iter->second.empty())
+            {
+                buffer = std::move(iter->second.back());
+                iter->second.pop_back();
+                state.sharedHits++;
+                add_in_use(key.size);
+                return true;
+            }
+        }
+        state.misses++;
+        if (!(allocate ? allocate(key, buffer) : state.allocate(key, buffer)))
+        {
+            LOG(ERROR) << name_ << ": failed to allocate " << key.size << " bytes of " << memory_kind_name(kind) << " memory";
+            return false;
+        }
+        uint64_t reserved = state.bytesReserved += key.size;
+        update_peak(state.peakBytesReserved, reserved);
+        add_in_use(key.size);
+        return true;
+    }
+
+    // 归还acquire得到的缓冲区，key为acquire时返回的key
+    void release(const PoolKey &key, Buffer buffer)
+    {
+        State &state = *state_;
+        state.bytesInUse -= key.size;
+        auto &local = thread_cache().lists[key];
+        if (local.size() < state.threadCacheLimit)
+        {
+            local.push_back(std::move(buffer));
+            return;
+        }
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.free[key].push_back(std::move(buffer));
+    }
+
+    // 把共享链表和当前线程链表中的空闲缓冲区还给系统，在后端运行时释放之前调用
+    void trim()
+    {
+        auto &cache = thread_cache();
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        release_free_lists(cache.lists);
+        release_free_lists(state_->free);
+    }
+
+    PoolStatistics statistics() const
+    {
+        const State &state = *state_;
+        PoolStatistics stats;
+        stats.acquires = state.acquires;
+        stats.threadHits = state.threadHits;
+        stats.sharedHits = state.sharedHits;
+        stats.misses = state.misses;
+        stats.bytesInUse = state.bytesInUse;
+        stats.peakBytesInUse = state.peakBytesInUse;
+        stats.bytesReserved = state.bytesReserved;
+        stats.peakBytesReserved = state.peakBytesReserved;
+        return stats;
+    }
+
+    nlohmann::json report() const
+    {
+        PoolStatistics stats = statistics();
+        nlohmann::json result;
+        result["Name"] = name_;
+        result["Acquires"] = stats.acquires;
+        result["ThreadCacheHits"] = stats.threadHits;
+        result["SharedHits"] = stats.sharedHits;
+        result["Misses"] = stats.misses;
+        result["HitRate"] = stats.hit_rate();
+        result["BytesInUse"] = stats.bytesInUse;
+        result["PeakBytesInUse"] = stats.peakBytesInUse;
+        result["BytesReserved"] = stats.bytesReserved;
+        result["PeakBytesReserved"] = stats.peakBytesReserved;
+        return result;
+    }
+
+private:
+    using FreeLists = std::unordered_map<PoolKey, std::vector<Buffer>, PoolKeyHash>;
+
+    struct State
+    {
+        std::mutex mutex;
+        FreeLists free;
+        Allocate allocate;
+        Release release;
+        size_t threadCacheLimit = 8;
+        bool closed = false;
+        std::atomic<uint64_t> acquires{0};
+        std::atomic<uint64_t> threadHits{0};
+        std::atomic<uint64_t> sharedHits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> bytesInUse{0};
+        std::atomic<uint64_t> peakBytesInUse{0};
+        std::atomic<uint64_t> bytesReserved{0};
+        std::atomic<uint64_t> peakBytesReserved{0};
+    };
+
+    // 一个线程在一个池上的空闲链表，线程退出时把缓冲区交还共享链表，池已销毁时直接释放
+    struct ThreadCache
+    {
+        std::shared_ptr<State> state;
+        FreeLists lists;
+
+        ~ThreadCache()
+        {
+            if (!state)
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            for (auto &item : lists)
+            {
+                for (auto &buffer : item.second)
+                {
+                    if (state->closed)
+                    {
+                        state->release(item.first, buffer);
+                    }
+                    else
+                    {
+                        state->free[item.first].push_back(std::move(buffer));
+                    }
+                }
+            }
+        }
+    };
+
+    ThreadCache &thread_cache()
+    {
+        thread_local std::unordered_map<uint64_t, ThreadCache> caches;
+        ThreadCache &cache = caches[id_];
+        if (!cache.state)
+        {
+            cache.state = state_;
+        }
+        return cache;
+    }
+
+    // 调用者持有state_->mutex
+    void release_free_lists(FreeLists &lists)
+    {
+        for (auto &item : lists)
+        {
+            for (auto &buffer : item.second)
+            {
+                state_->release(item.first, buffer);
+                state_->bytesReserved -= item.first.size;
+            }
+        }
+        lists.clear();
+    }
+
+    void add_in_use(size_t size)
+    {
+        uint64_t inUse = state_->bytesInUse += size;
+        update_peak(state_->peakBytesInUse, inUse);
+    }
+
+    static void update_peak(std::atomic<uint64_t> &peak, uint64_t value)
+    {
+        uint64_t current = peak.load();
+        while (value > current && !peak.compare_exchange_weak(current, value))
+        {
+        }
+    }
+
+    std::string name_;
+    uint64_t id_;
+    std::shared_ptr<State> state_;
+};
+
+// host内存: 至少按cache line对齐；HostHugePage优先使用hugetlbfs的2MB大页，没有预留大页时退回到透明大页
+bool host_buffer_allocate(const PoolKey &key, void *&buffer)
+{
+    size_t alignment = std::max(key.alignment, CACHE_LINE_SIZE);
+#ifdef _WIN32
+    buffer = _aligned_malloc(key.size, alignment);
+    return buffer != nullptr;
+#else
+    if (key.kind == MemoryKind::HostHugePage)
+    {
+        size_t size = (key.size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED)
+        {
+            data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (data == MAP_FAILED)
+            {
+                return false;
+            }
+            madvise(data, size, MADV_HUGEPAGE);
+        }
+        buffer = data;
+        return true;
+    }
+    return posix_memalign(&buffer, alignment, key.size) == 0;
+#endif
+}
+
+void host_buffer_release(const PoolKey &key, void *&buffer)
+{
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    if (key.kind == MemoryKind::HostHugePage)
+    {
+        munmap(buffer, (key.size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+        return;
+    }
+    free(buffer);
+#endif
+}
+
+// 所有后端共用的host缓冲池
+BufferPool<void *> &host_tensor_pool()
+{
+    static BufferPool<void *> pool("host", host_buffer_allocate, host_buffer_release);
+    return pool;
+}
+
+// 从host缓冲池取得的一块缓冲区，析构时归还
+class HostTensor
+{
+public:
+    HostTensor() = default;
+    HostTensor(size_t size, size_t alignment = CACHE_LINE_SIZE, MemoryKind kind = MemoryKind::Host)
+    {
+        if (!host_tensor_pool().acquire(size, alignment, kind, data_, key_))
+        {
+            data_ = nullptr;
+        }
+        size_ = size;
+    }
+    HostTensor(const HostTensor &) = delete;
+    HostTensor &operator=(const HostTensor &) = delete;
+    HostTensor(HostTensor &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+    HostTensor &operator=(HostTensor &&other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(key_, other.key_);
+        return *this;
+    }
+    ~HostTensor()
+    {
+        if (data_ != nullptr)
+        {
+            host_tensor_pool().release(key_, data_);
+        }
+    }
+
+    void *data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    void *data_ = nullptr;
+    size_t size_ = 0;
+    PoolKey key_{0, 0, MemoryKind::Host};
+};
+
+#endif
@@ -9,6 +9,7 @@
 #include <functional>
 #include <tuple>
 #include "glog/logging.h"
+#include "Trace.hpp"
 using namespace std;
 using namespace std::chrono;
 typedef struct LatencyPerformanceData
@@ -19,33 +20,51 @@ typedef struct LatencyPerformanceData
     double max;
 } LatencyPerfData;
 
+// 第p百分位(0-100)，相邻两个样本之间线性插值
+double latency_percentile(vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    double rank = std::min(std::max(p, 0.0), 100.0) / 100.0 * (values.size() - 1);
+    size_t lower = (size_t)rank;
+    size_t upper = std::min(lower + 1, values.size() - 1);
+    return values[lower] + (values[upper] - values[lower]) * (rank - lower);
+}
+
+// 计时器按可调用对象和参数的类型特化，被测函数在计时循环中直接内联调用，没有std::function的间接调用；
+// 左值参数按引用保存，右值参数按值保存，每轮调用不拷贝参数。耗时以us为单位、按ns精度记录，样本空间预先分配。
+template <typename Func, typename... Args>
 class Timer
 {
 public:
-    template <typename Func, typename... Args>
-    Timer(int warmup_iters, int normal_iters, Func &&func, Args &&...args)
-        : warmup_iters_(warmup_iters), normal_iters_(normal_iters)
+    template <typename F, typename... A>
+    Timer(int warmup_iters, int normal_iters, F &&func, A &&...args)
+        : warmup_iters_(warmup_iters), normal_iters_(normal_iters), func_(std::forward<F>(func)), args_(std::forward<A>(args)...)
     {
-        func_ = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
+        durations_warmup_.reserve(std::max(warmup_iters, 0));
+        durations_normal_.reserve(std::max(normal_iters, 0));
+        set_trace_name("iteration");
     }
 
-    void run()
+    // 每轮计时之前调用，不计入耗时，例如切换到下一份输入样本
+    void set_setup(function<void()> setup)
     {
-        for (int i = 0; i < warmup_iters_; ++i)
-        {
-            auto start = high_resolution_clock::now();
-            func_();
-            auto end = high_resolution_clock::now();
-            durations_warmup_.push_back(duration_cast<microseconds>(end - start).count());
-        }
+        setup_ = std::move(setup);
+    }
 
-        for (int i = 0; i < normal_iters_; ++i)
-        {
-            auto start = high_resolution_clock::now();
-            func_();
-            auto end = high_resolution_clock::now();
-            durations_normal_.push_back(duration_cast<microseconds>(end - start).count());
-        }
+    // 时间线跟踪中每轮的事件名，预热轮次和setup另外加后缀区分；没有编译跟踪时不记录
+    void set_trace_name([[maybe_unused]] const std::string &name)
+    {
+        trace_id_ = TRACE_EVENT_ID(name);
+        trace_warmup_id_ = TRACE_EVENT_ID(name + " (warmup)");
+        trace_setup_id_ = TRACE_EVENT_ID(name + " setup");
+    }
+
+    void run()
+    {
+        run_rounds(warmup_iters_, durations_warmup_, trace_warmup_id_);
+        run_rounds(normal_iters_, durations_normal_, trace_id_);
     }
 
     std::tuple<LatencyPerfData, LatencyPerfData> report()
@@ -62,11 +81,36 @@ public:
 // private:
     int warmup_iters_;
     int normal_iters_;
-    function<void()> func_;
-    vector<long long> durations_warmup_;
-    vector<long long> durations_normal_;
+    Func func_;
+    std::tuple<Args...> args_;
+    function<void()> setup_;
+    vector<double> durations_warmup_;
+    vector<double> durations_normal_;
+    uint32_t trace_id_ = 0;
+    uint32_t trace_warmup_id_ = 0;
+    uint32_t trace_setup_id_ = 0;
+
+    // 跟踪事件记录在计时区间之外，不计入测得的耗时
+    void run_rounds(int iters, vector<double> &durations, [[maybe_unused]] uint32_t trace_id)
+    {
+        for (int i = 0; i < iters; ++i)
+        {
+            if (setup_)
+            {
+                TRACE_BEGIN_ID(trace_setup_id_);
+                setup_();
+                TRACE_END_ID(trace_setup_id_);
+            }
+            TRACE_BEGIN_ID(trace_id);
+            auto start = steady_clock::now();
+            std::apply(func_, args_);
+            auto end = steady_clock::now();
+            TRACE_END_ID(trace_id);
+            durations.push_back(duration_cast<nanoseconds>(end - start).count() / 1000.0);
+        }
+    }
 
-    LatencyPerfData report_statistics(const vector<long long> &durations)
+    LatencyPerfData report_statistics(const vector<double> &durations)
     {
         if (durations.empty())
             return {0, 0, 0, 0};
@@ -75,21 +119,34 @@ public:
         double mean = sum / durations.size();
 
         auto minmax = minmax_element(durations.begin(), durations.end());
-        long long min_val = *minmax.first;
-        long long max_val = *minmax.second;
+        double min_val = *minmax.first;
+        double max_val = *minmax.second;
 
         double sq_sum = inner_product(durations.begin(), durations.end(), durations.begin(), 0.0);
-        double stdev = sqrt(sq_sum / durations.size() - mean * mean);
+        double stdev = sqrt(std::max(sq_sum / durations.size() - mean * mean, 0.0));
 
         LOG(INFO)  << "Count:" << durations.size() << ", avg: " << mean << " us, std: " << stdev << " us, " << "min: " << min_val << " us, " << "max: " << max_val << " us" << endl;
         return {
             mean,
             stdev,
-            (double)min_val,
-            (double)max_val};
+            min_val,
+            max_val};
         // return std::make_tuple(mean, stdev, (double)min_val, (double)max_val);
         // cout << "Count: " << durations.size() << endl;
     }
 };
 
+template <typename F, typename... A>
+Timer(int, int, F &&, A &&...) -> Timer<F, A...>;
+
+// 校准: 用空函数体运行计时循环，得到计时器自身每轮的开销(us)，可以从测得的延迟中减去
+LatencyPerfData calibrate_timer(int iters = 1000)
+{
+    auto empty_function = []() {};
+    Timer timer(0, iters, empty_function);
+    timer.run();
+    LOG(INFO) << "Timer overhead:";
+    return timer.report_statistics(timer.durations_normal_);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,355 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#include "glog/logging.h"
+#include "nlohmann/json.hpp"
+
+// 时间线跟踪: 在迭代和各阶段(输入、运行、输出、批处理、共置请求等)的边界记录(时间戳, 事件id, 阶段)，
+// 运行结束后导出为Chrome trace-event json，可以直接在chrome://tracing或ui.perfetto.dev中打开，
+// 查看各线程的迭代、I/O阶段和并发的工作线程在时间上如何重叠。
+// 每个线程写自己的环形缓冲区，记录一个事件只有一次计时器读取和几次store，不加锁、不分配内存；
+// 缓冲区写满后覆盖最早的事件。事件名在第一次经过时注册为id，之后只记录id。
+// 只有编译时定义了ENABLE_TRACE(cmake -DENABLE_TRACE=ON)才记录，否则TRACE_*宏展开为空，没有任何开销。
+// 用法:
+//     TRACE_THREAD_NAME("main");
+//     { TRACE_SCOPE("rknn_run"); rknn_run(ctx, nullptr); }
+//     TRACE_BEGIN("load"); ... TRACE_END("load");
+//     TRACE_INSTANT("request arrival");
+//     write_chrome_trace("output/trace.json");
+
+// 每个线程缓冲区的事件个数，必须是2的幂，每个事件16字节
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS (1 << 16)
+#endif
+
+enum class TracePhase : uint8_t
+{
+    Begin,
+    End,
+    Instant
+};
+
+struct TraceEvent
+{
+    uint64_t ticks;
+    uint32_t id;
+    TracePhase phase;
+};
+
+// 时间戳直接读取硬件计数器，比clock_gettime(虚拟机中可能要几十ns)更快:
+// aarch64读取通用定时器(cntvct_el0)，x86读取TSC，其他平台使用steady_clock的ns计数。
+// 计数器的频率在导出时用steady_clock经过的时间换算
+uint64_t trace_ticks()
+{
+#if defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#elif defined(__x86_64__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// 单个线程的环形缓冲区，只有所属线程写入；导出在工作线程结束后进行，读取head_时用acquire保证看到完整的事件
+class TraceBuffer
+{
+public:
+    TraceBuffer(int tid, const std::string &name)
+        : tid_(tid), name_(name), events_(new TraceEvent[TRACE_BUFFER_EVENTS]) {}
+
+    void record(uint32_t id, TracePhase phase)
+    {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        TraceEvent &event = events_[head & (TRACE_BUFFER_EVENTS - 1)];
+        event.ticks = trace_ticks();
+        event.id = id;
+        event.phase = phase;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // 按时间顺序返回缓冲区中保留的事件，dropped为被覆盖的事件个数
+    std::vector<TraceEvent> snapshot(uint64_t &dropped) const
+    {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        dropped = first;
+        std::vector<TraceEvent> events;
+        events.reserve(head - first);
+        for (uint64_t index = first; index < head; index++)
+        {
+            events.push_back(events_[index & (TRACE_BUFFER_EVENTS - 1)]);
+        }
+        return events;
+    }
+
+    int tid_;
+    std::string name_;
+
+private:
+    std::unique_ptr<TraceEvent[]> events_;
+    std::atomic<uint64_t> head_{0};
+};
+
+// 只知道耗时、没有时间戳的区间，例如后端profiling得到的每个算子的平均耗时
+struct TraceSpan
+{
+    std::string name;
+    std::string category;
+    double durationUs = 0;
+    nlohmann::json args;
+};
+
+// 一组区间在时间线上单独显示为一个轨道
+struct TraceSpanTrack
+{
+    std::string name;
+    // 区间从当前线程中这个事件最后一次开始的时刻起依次排列，事件不存在时从0开始
+    std::string anchor;
+    std::vector<TraceSpan> spans;
+    uint64_t startTicks = 0;
+};
+
+// 全局的事件名表和所有线程的缓冲区；线程退出后缓冲区仍然保留，直到导出
+class TraceRegistry
+{
+public:
+    static TraceRegistry &instance()
+    {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    uint32_t event_id(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t id = 0; id < names_.size(); id++)
+        {
+            if (names_[id] == name)
+                return (uint32_t)id;
+        }
+        names_.push_back(name);
+        return (uint32_t)(names_.size() - 1);
+    }
+
+    // 当前线程的缓冲区，第一次调用时创建
+    TraceBuffer &thread_buffer()
+    {
+        thread_local TraceBuffer *buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.emplace_back(new TraceBuffer((int)buffers_.size() + 1, "thread " + std::to_string(buffers_.size() + 1)));
+            buffer = buffers_.back().get();
+        }
+        return *buffer;
+    }
+
+    void set_thread_name(const std::string &name)
+    {
+        TraceBuffer &buffer = thread_buffer();
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer.name_ = name;
+    }
+
+    void add_spans(TraceSpanTrack track)
+    {
+        uint64_t dropped = 0;
+        std::vector<TraceEvent> events = thread_buffer().snapshot(dropped);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto event = events.rbegin(); event != events.rend(); ++event)
+        {
+            if (event->phase == TracePhase::Begin && names_[event->id] == track.anchor)
+            {
+                track.startTicks = event->ticks;
+                break;
+            }
+        }
+        spans_.push_back(track);
+    }
+
+    // Chrome trace-event格式的事件，时间单位为us，从第一次使用跟踪的时刻算起
+    nlohmann::json chrome_events()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        double ticksPerUs = ticks_per_us();
+        nlohmann::json events = nlohmann::json::array();
+        events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", 1}, {"args", {{"name", "benchmark"}}}});
+        uint64_t dropped = 0;
+        for (const auto &buffer : buffers_)
+        {
+            events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->tid_}, {"args", {{"name", buffer->name_}}}});
+            uint64_t bufferDropped = 0;
+            int depth = 0;
+            for (const auto &event : buffer->snapshot(bufferDropped))
+            {
+                double ts = event.ticks >= epoch_ ? (event.ticks - epoch_) / ticksPerUs : 0;
+                nlohmann::json item = {{"name", names_[event.id]}, {"cat", "benchmark"}, {"pid", 1}, {"tid", buffer->tid_}, {"ts", ts}};
+                if (event.phase == TracePhase::Begin)
+                {
+                    item["ph"] = "B";
+                    depth++;
+                }
+                else if (event.phase == TracePhase::End)
+                {
+                    // 开始事件被覆盖时丢弃对应的结束事件
+                    if (depth == 0)
+                        continue;
+                    item["ph"] = "E";
+                    depth--;
+                }
+                else
+                {
+                    item["ph"] = "i";
+                    item["s"] = "t";
+                }
+                events.push_back(item);
+            }
+            dropped += bufferDropped;
+        }
+        if (dropped > 0)
+        {
+            LOG(WARNING) << "Trace buffers overflowed, " << dropped << " earliest events dropped.";
+        }
+        if (!spans_.empty())
+        {
+            events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", 2}, {"args", {{"name", "profiling"}}}});
+        }
+        for (size_t track = 0; track < spans_.size(); track++)
+        {
+            const TraceSpanTrack &spans = spans_[track];
+            int tid = (int)track + 1;
+            events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 2}, {"tid", tid}, {"args", {{"name", spans.name}}}});
+            double ts = spans.startTicks >= epoch_ ? (spans.startTicks - epoch_) / ticksPerUs : 0;
+            for (const auto &span : spans.spans)
+            {
+                events.push_back({{"name", span.name},
+                                  {"cat", span.category},
+                                  {"ph", "X"},
+                                  {"pid", 2},
+                                  {"tid", tid},
+                                  {"ts", ts},
+                                  {"dur", span.durationUs},
+                                  {"args", span.args}});
+                ts += span.durationUs;
+            }
+        }
+        return events;
+    }
+
+private:
+    TraceRegistry() : epoch_(trace_ticks()), epochTime_(std::chrono::steady_clock::now()) {}
+
+    // 计数器每us的计数，由注册表创建以来的计数和steady_clock时间得到
+    double ticks_per_us() const
+    {
+        uint64_t ticks = trace_ticks();
+        double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epochTime_).count();
+        return elapsedUs > 0 && ticks > epoch_ ? (ticks - epoch_) / elapsedUs : 1e3;
+    }
+
+    uint64_t epoch_;
+    std::chrono::steady_clock::time_point epochTime_;
+    std::mutex mutex_;
+    std::vector<std::string> names_;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+    std::vector<TraceSpanTrack> spans_;
+};
+
+uint32_t trace_event_id(const std::string &name)
+{
+    return TraceRegistry::instance().event_id(name);
+}
+
+void trace_record(uint32_t id, TracePhase phase)
+{
+    TraceRegistry::instance().thread_buffer().record(id, phase);
+}
+
+// 作用域内的事件，构造时开始、析构时结束
+class TraceScope
+{
+public:
+    explicit TraceScope(uint32_t id) : id_(id)
+    {
+        trace_record(id_, TracePhase::Begin);
+    }
+    ~TraceScope()
+    {
+        trace_record(id_, TracePhase::End);
+    }
+
+private:
+    uint32_t id_;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_TRACE
+// 名称为常量的事件在第一次经过时注册，id保存在静态变量中
+#define TRACE_STATIC_ID(name) \
+    ([]() { static const uint32_t trace_id = trace_event_id(name); return trace_id; }())
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(TRACE_STATIC_ID(name))
+#define TRACE_BEGIN(name) trace_record(TRACE_STATIC_ID(name), TracePhase::Begin)
+#define TRACE_END(name) trace_record(TRACE_STATIC_ID(name), TracePhase::End)
+#define TRACE_INSTANT(name) trace_record(TRACE_STATIC_ID(name), TracePhase::Instant)
+// 名称在运行时才确定的事件(例如计时器的名称)，先用TRACE_EVENT_ID取得id，再按id记录
+#define TRACE_EVENT_ID(name) trace_event_id(name)
+#define TRACE_BEGIN_ID(id) trace_record(id, TracePhase::Begin)
+#define TRACE_END_ID(id) trace_record(id, TracePhase::End)
+#define TRACE_THREAD_NAME(name) TraceRegistry::instance().set_thread_name(name)
+// 没有时间戳的区间(例如算子profiling)作为单独的轨道，放在当前线程anchor事件最后一次开始的位置
+#define TRACE_SPANS(track, anchor, spans) TraceRegistry::instance().add_spans({track, anchor, spans, 0})
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_EVENT_ID(name) 0u
+#define TRACE_BEGIN_ID(id) ((void)0)
+#define TRACE_END_ID(id) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_SPANS(track, anchor, spans) ((void)0)
+#endif
+
+// 把所有线程记录的事件和区间轨道写成Chrome trace-event json，应在工作线程结束后调用
+bool write_chrome_trace(const std::string &path)
+{
+#ifdef ENABLE_TRACE
+    std::filesystem::path tracePath(path);
+    if (tracePath.has_parent_path())
+    {
+        std::filesystem::create_directories(tracePath.parent_path());
+    }
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Cannot open trace file: " << path;
+        return false;
+    }
+    nlohmann::json trace;
+    trace["traceEvents"] = TraceRegistry::instance().chrome_events();
+    trace["displayTimeUnit"] = "ns";
+    file << trace.dump() << std::endl;
+    LOG(INFO) << "Trace saved to " << path << ", " << trace["traceEvents"].size() << " events.";
+    return true;
+#else
+    LOG(WARNING) << "Tracing is not compiled in, rebuild with -DENABLE_TRACE=ON to write " << path;
+    return false;
+#endif
+}
+
+#endif
@@ -0,0 +1,714 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "BackendLoader.hpp"
+#include "BenchPlan.hpp"
+#include "BenchmarkSummary.hpp"
+#include "Colocation.hpp"
+#include "Helper.h"
+#include "ModelCache.hpp"
+#include "ModelDiscovery.hpp"
+#include "InputProvider.hpp"
+#include "PowerSampler.hpp"
+#include "Soak.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+// 模型文件或目录，目录中所有已知扩展名(.rknn/.bin/.hbm/.om/.xml/.onnx/.sim)的模型都会测试
+DEFINE_string(model, "", "The model file or directory to benchmark.");
+
+// 模型目录扫描的manifest缓存文件，目录没有变化时不再重新列出，为空时不缓存
+DEFINE_string(manifest_cache, "", "The manifest cache of the model directory scan, unchanged directories are not listed again. Empty to disable.");
+
+// 后端: rknn、bpu、hiai、openvino或simulated，为空时按模型文件扩展名选择
+DEFINE_string(backend, "", "The backend plugin to use, empty to pick it by the model file extension.");
+
+// 后端特有的选项(json对象)，例如{"core": 0}、{"device": "CPU", "streams": 2}，原样传给插件
+DEFINE_string(backend_options, "{}", "The json object of backend specific options passed to the plugin.");
+
+// 插件目录，为空时为npubench所在的目录，插件文件名为libnpubench_<backend>.so
+DEFINE_string(plugin_dir, "", "The directory of the backend plugins, empty for the directory of npubench.");
+
+// 预热和正式运行的次数
+DEFINE_int32(num_warmup, 10, "The number of warmup runs before actual benchmarking.");
+DEFINE_int32(num_run, 100, "The number of runs to measure the model's performance.");
+
+// 输入数据: random[:low,high], constant:value 或 replay:目录/逗号分隔的.npy/.raw文件，replay时每轮使用下一份样本
+DEFINE_string(input_data, "random", "The input data: random[:low,high], constant:value or replay:path.");
+
+// 随机输入的种子
+DEFINE_int32(input_seed, 0, "The seed of the random input data.");
+
+// 多模型共置场景文件(json)，设置后忽略--model；每个模型按backend字段或扩展名选择后端，整个json作为插件的选项
+DEFINE_string(scenario, "", "The json scenario file of co-located models, overrides --model.");
+
+// 测试配置文件(json)，设置后按配置中的模型、参数扫描、运行长度、采样器和输出执行，忽略其他测试参数；--plugin_dir不为空时覆盖配置中的plugin_dir
+DEFINE_string(config, "", "The json benchmark config with model sets, sweeps, run policy, samplers and outputs, overrides the other benchmark flags.");
+
+// 定义输出文件路径
+DEFINE_string(output_file, "output/npubench_result.json", "The file path to the output json file.");
+
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+
+// 功耗采样节点(例如INA226的hwmon power1_input)，为空时不采样；scale把读数换算为W，采样得到的平均功率和每次推理的能耗写在Summary中
+DEFINE_string(power_node, "", "The sysfs power node sampled during the timed rounds, empty to disable.");
+DEFINE_double(power_scale, 1e-6, "The scale converting the power node reading to watts, 1e-6 for microwatts.");
+DEFINE_int32(power_interval_ms, 10, "The sampling interval of the power node in milliseconds.");
+
+// 长时间稳定性测试(soak)的时长(s)，大于0时每个模型连续推理这么久(inputs_set + run + outputs_get)，按窗口统计延迟分位数、RSS、文件描述符和线程数，
+// 延迟或RSS的趋势、文件描述符或线程数的增长超过阈值时告警，有告警时npubench返回1
+DEFINE_double(soak_duration_s, 0, "The duration of the soak test in seconds, 0 to disable.");
+DEFINE_double(soak_window_s, 60, "The statistics window of the soak test in seconds.");
+DEFINE_double(soak_latency_drift, 10, "The alert threshold of the latency drift along the trend line over the run, in percent.");
+DEFINE_double(soak_rss_drift_mb, 10, "The alert threshold of the rss growth rate in MB per hour.");
+DEFINE_int32(soak_handle_drift, 16, "The alert threshold of the open fd and thread count growth over the first window.");
+DEFINE_string(soak_window_file, "output/soak_windows.jsonl", "The jsonl file the soak windows are appended to, empty to disable.");
+
+// 模型缓存回放: 访问序列为文件(每行一个模型路径)或zipf:s,n(在--model的模型中按Zipf分布生成n次访问)，设置后按每个策略和内存预算回放一次，
+// 报告命中率、驱逐次数、加载时间和取得模型带来的额外尾延迟；预算为MB，0为不限制；--cache_pin的模型(文件名)固定常驻
+DEFINE_string(cache_trace, "", "The model access trace replayed through the model cache: a file of model paths or zipf:s,n over --model. Empty to disable.");
+DEFINE_string(cache_budgets_mb, "0", "Comma separated memory budgets of the model cache in MB, 0 for unlimited.");
+DEFINE_string(cache_policy, "lru", "Comma separated eviction policies of the model cache: lru, lfu.");
+DEFINE_bool(cache_prefetch, false, "Prefetch the next model of the trace in the background after each access.");
+DEFINE_string(cache_pin, "", "Comma separated model file names pinned in the model cache.");
+
+int batch_benchmark(BackendRegistry &registry, const std::string &model, const std::string &backend, const nlohmann::json &options, std::vector<std::tuple<std::string, std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result);
+
+int soak_benchmark(BackendRegistry &registry, const std::string &model, const std::string &backend, const nlohmann::json &options, std::vector<std::tuple<std::string, std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result);
+
+int scenario_benchmark(BackendRegistry &registry, const std::string &path, nlohmann::json &report);
+
+int cache_benchmark(BackendRegistry &registry, const std::vector<std::string> &models, const nlohmann::json &options, nlohmann::json &report);
+
+// 模型文件的后端: --backend优先，否则按扩展名
+std::string model_backend(const std::string &model, const std::string &backend)
+{
+    return backend.empty() ? backend_for_model(model) : backend;
+}
+
+// 目录中只测试能选出后端的模型，指定--backend时只测试该后端的扩展名
+std::vector<std::string> bench_models(const std::string &model)
+{
+    if (!std::filesystem::is_directory(model))
+    {
+        return {model};
+    }
+    // OpenVINO的.bin是.xml的权重，与.xml配对后不再作为BPU模型
+    DiscoveryOptions discovery;
+    for (const auto &item : BACKEND_EXTENSIONS)
+    {
+        if (FLAGS_backend.empty() || item.second == FLAGS_backend)
+        {
+            discovery.patterns.push_back(item.first);
+        }
+    }
+    discovery.siblings = {{".xml", ".bin"}};
+    discovery.cacheFile = FLAGS_manifest_cache;
+    return discovered_paths(discover_models(model, discovery));
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;      // 设置日志消息是否转到标准输出而不是日志文件
+    FLAGS_alsologtostderr = true;  // 设置日志消息除了日志文件之外是否去标准输出
+    FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
+    FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
+    FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+    TRACE_THREAD_NAME("main");
+
+    if (!FLAGS_config.empty())
+    {
+        BenchPlan plan;
+        if (!load_bench_plan(FLAGS_config, plan))
+        {
+            return -1;
+        }
+        BackendRegistry registry(FLAGS_plugin_dir.empty() ? plan.pluginDir : FLAGS_plugin_dir);
+        return run_bench_plan(registry, plan) == 0 ? 0 : -1;
+    }
+
+    InputSpec input_spec;
+    if (!parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec))
+    {
+        LOG(ERROR) << "Unsupported input data: " << FLAGS_input_data;
+        return -1;
+    }
+    if (FLAGS_soak_window_s <= 0)
+    {
+        LOG(ERROR) << "Expected a positive soak window, got " << FLAGS_soak_window_s << " s";
+        return -1;
+    }
+    nlohmann::json options = nlohmann::json::parse(FLAGS_backend_options, nullptr, false);
+    if (!options.is_object())
+    {
+        LOG(ERROR) << "Invalid backend options, expected a json object: " << FLAGS_backend_options;
+        return -1;
+    }
+    BackendRegistry registry(FLAGS_plugin_dir);
+
+    nlohmann::json all_models_result;
+    int soak_alerts = 0;
+    if (!FLAGS_scenario.empty())
+    {
+        if (scenario_benchmark(registry, FLAGS_scenario, all_models_result) < 0)
+        {
+            return -1;
+        }
+    }
+    else if (!FLAGS_cache_trace.empty())
+    {
+        std::vector<std::string> models = FLAGS_model.empty() ? std::vector<std::string>() : bench_models(FLAGS_model);
+        if (cache_benchmark(registry, models, options, all_models_result) < 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        std::vector<std::string> models = bench_models(FLAGS_model);
+        std::vector<std::tuple<std::string, std::string, LatencyPerfData>> batch_perf_results;
+        for (const auto &model : models)
+        {
+            std::string backend = model_backend(model, FLAGS_backend);
+            if (backend.empty())
+            {
+                LOG(ERROR) << "Cannot pick a backend for " << model << ", use --backend";
+                continue;
+            }
+            if (FLAGS_soak_duration_s > 0)
+            {
+                soak_alerts += soak_benchmark(registry, model, backend, options, batch_perf_results, all_models_result);
+            }
+            else
+            {
+                batch_benchmark(registry, model, backend, options, batch_perf_results, all_models_result);
+            }
+        }
+        if (batch_perf_results.empty())
+        {
+            LOG(ERROR) << "No model was benchmarked: " << FLAGS_model;
+            return -1;
+        }
+
+        tabulate::Table profileTable;
+        profileTable.add_row({"index", "model", "backend", "avg", "std", "min", "max"});
+        for (size_t i = 0; i < batch_perf_results.size(); i++)
+        {
+            const auto &perf_result = batch_perf_results[i];
+            profileTable.add_row({std::to_string(i),
+                                  std::get<0>(perf_result),
+                                  std::get<1>(perf_result),
+                                  std::to_string(std::get<2>(perf_result).mean),
+                                  std::to_string(std::get<2>(perf_result).stdev),
+                                  std::to_string(std::get<2>(perf_result).min),
+                                  std::to_string(std::get<2>(perf_result).max)});
+        }
+        for (size_t i = 0; i < 7; ++i)
+        {
+            profileTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+        }
+        LOG(INFO) << "\n"
+                  << profileTable << "\n";
+    }
+    LOG(INFO) << "Loaded backend plugins: " << nlohmann::json(registry.loaded()).dump();
+
+    // 创建输出目录（如果不存在）并保存结果
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << all_models_result << std::endl;
+
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
+    }
+    google::ShutdownGoogleLogging();
+    return soak_alerts > 0 ? 1 : 0;
+}
+
+int batch_benchmark(BackendRegistry &registry, const std::string &model, const std::string &backend, const nlohmann::json &options, std::vector<std::tuple<std::string, std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result)
+{
+    LOG(INFO) << "Profiling model: " << model << " on " << backend;
+    std::shared_ptr<BackendLibrary> library = registry.get(backend);
+    if (!library)
+    {
+        return -1;
+    }
+    auto init_start = std::chrono::steady_clock::now();
+    TRACE_BEGIN("load");
+    std::unique_ptr<BackendModel> backend_model = BackendModel::load(library, model, options);
+    TRACE_END("load");
+    double init_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
+    if (!backend_model)
+    {
+        return -1;
+    }
+
+    // 输入由InputProvider一次性准备好，插件的inputs_set拷贝数据，缓冲区只需指向当前样本；输出拷贝到host缓冲区
+    InputSpec input_spec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec);
+    InputProvider input_provider(input_spec);
+    if (!input_provider.prepare(backend_model->inputs()))
+    {
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        return -1;
+    }
+    std::vector<const void *> inputs(backend_model->inputs().size());
+    auto bind_inputs = [&]()
+    {
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            inputs[i] = input_provider.data(i);
+        }
+    };
+    bind_inputs();
+    std::vector<std::vector<uint8_t>> output_buffers;
+    std::vector<void *> outputs;
+    for (const auto &output : backend_model->outputs())
+    {
+        output_buffers.emplace_back(output.bytes);
+        outputs.push_back(output_buffers.back().data());
+    }
+    if (!backend_model->inputs_set(inputs))
+    {
+        return -1;
+    }
+
+    // 与各驱动相同，主指标只计时推理本身，输入设置和输出获取另外计时
+    auto benchmark_function = [](BackendModel *backend_model)
+    {
+        backend_model->run();
+    };
+    Timer timer(FLAGS_num_warmup, FLAGS_num_run, benchmark_function, backend_model.get());
+    timer.set_trace_name(backend + " run");
+    // 回放多份样本时，每轮计时前切换到下一份样本并设置输入
+    if (input_provider.samples() > 1)
+    {
+        timer.set_setup([&]()
+                        {
+                            input_provider.next();
+                            bind_inputs();
+                            backend_model->inputs_set(inputs); });
+    }
+    PowerSampler power_sampler(FLAGS_power_node, FLAGS_power_scale, FLAGS_power_interval_ms);
+    power_sampler.start();
+    timer.run();
+    double power = power_sampler.stop();
+    auto data = timer.report();
+    if (!backend_model->outputs_get(outputs))
+    {
+        return -1;
+    }
+
+    auto input_function = [&]()
+    {
+        backend_model->inputs_set(inputs);
+    };
+    Timer input_timer(0, FLAGS_num_run, input_function);
+    input_timer.set_trace_name(backend + " inputs_set");
+    input_timer.run();
+    auto input_data = std::get<1>(input_timer.report());
+    auto output_function = [&]()
+    {
+        backend_model->outputs_get(outputs);
+    };
+    Timer output_timer(0, FLAGS_num_run, output_function);
+    output_timer.set_trace_name(backend + " outputs_get");
+    output_timer.run();
+    auto output_data = std::get<1>(output_timer.report());
+
+    std::string model_name = std::filesystem::path(model).filename().string();
+    nlohmann::json result;
+    result["MetaInfo"] = backend_model->meta_info();
+    result["MetaInfo"]["Plugin"] = library->path();
+    result["MetaInfo"]["ModelName"] = model_name;
+    result["MetaInfo"]["ModelHash"] = std::filesystem::exists(model) ? model_hash_string(model_file_hash(model)) : "";
+    result["RuntimeResult"]["Warmups"] = FLAGS_num_warmup;
+    result["RuntimeResult"]["Rounds"] = FLAGS_num_run;
+    result["RuntimeResult"]["TimerOverhead"] = calibrate_timer().mean;
+    result["RuntimeResult"]["AvgTotalRoundLatency"] = std::get<1>(data).mean;
+    result["RuntimeResult"]["StdTotalRoundLatency"] = std::get<1>(data).stdev;
+    result["RuntimeResult"]["MinTotalRoundLatency"] = std::get<1>(data).min;
+    result["RuntimeResult"]["MaxTotalRoundLatency"] = std::get<1>(data).max;
+    result["RuntimeResult"]["InitTime"] = init_time;
+    const auto &normal_times = timer.durations_normal_;
+    for (size_t i = 0; i < normal_times.size(); i++)
+    {
+        nlohmann::json round;
+        round["RoundIndex"] = i;
+        round["WarmupIndex"] = -1;
+        round["TotalRoundLatency"] = normal_times[i];
+        result["RuntimeResult"]["MultiRoundsProfileResult"].push_back(round);
+    }
+    uint64_t input_bytes = 0;
+    for (const auto &input : backend_model->inputs())
+    {
+        result["IOResult"]["Inputs"].push_back({{"Name", input.name}, {"Type", input_dtype_name(input.dtype)}, {"ByteSize", input.bytes}});
+        input_bytes += input.bytes;
+    }
+    uint64_t output_bytes = 0;
+    for (const auto &output : backend_model->outputs())
+    {
+        result["IOResult"]["Outputs"].push_back({{"Name", output.name}, {"Type", input_dtype_name(output.dtype)}, {"ByteSize", output.bytes}});
+        output_bytes += output.bytes;
+    }
+    result["IOResult"]["InputBytes"] = input_bytes;
+    result["IOResult"]["OutputBytes"] = output_bytes;
+    result["IOResult"]["AvgInputLatency"] = input_data.mean;
+    result["IOResult"]["AvgOutputLatency"] = output_data.mean;
+    result["IOResult"]["MinInputLatency"] = input_data.min;
+    result["IOResult"]["MinOutputLatency"] = output_data.min;
+    result["InputData"] = input_provider.describe();
+
+    // 各后端共同格式的Summary，与各驱动的结果可以一起汇总
+    const nlohmann::json &meta = result["MetaInfo"];
+    BenchmarkSummary summary = summarize_benchmark(logical_model_name(model), meta.value("BackendName", backend), meta.value("Device", device_model_name("NPU")), normal_times);
+    summary.modelFile = model_name;
+    summary.modelHash = meta.value("ModelHash", "");
+    summary.backendVersion = meta.value("BackendVersion", "");
+    summary.initTime = init_time;
+    if (meta.contains("MemoryBytes"))
+    {
+        summary.memory = meta["MemoryBytes"].get<double>() / 1024.0 / 1024.0;
+    }
+    set_summary_power(summary, power);
+    result["Summary"] = benchmark_summary_json(summary);
+
+    nlohmann::json model_result;
+    model_result[model_name] = result;
+    all_models_result.push_back(model_result);
+    batch_perf_results.push_back(std::make_tuple(model_name, backend, std::get<1>(data)));
+    return 0;
+}
+
+// 长时间稳定性测试: 延迟只保存在窗口直方图中，运行多久内存占用都不变；返回1表示有告警
+int soak_benchmark(BackendRegistry &registry, const std::string &model, const std::string &backend, const nlohmann::json &options, std::vector<std::tuple<std::string, std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result)
+{
+    LOG(INFO) << "Soak testing model: " << model << " on " << backend << " for " << FLAGS_soak_duration_s << " s";
+    std::shared_ptr<BackendLibrary> library = registry.get(backend);
+    if (!library)
+    {
+        return 0;
+    }
+    auto init_start = std::chrono::steady_clock::now();
+    std::unique_ptr<BackendModel> backend_model = BackendModel::load(library, model, options);
+    double init_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
+    if (!backend_model)
+    {
+        return 0;
+    }
+    InputSpec input_spec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec);
+    InputProvider input_provider(input_spec);
+    if (!input_provider.prepare(backend_model->inputs()))
+    {
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        return 0;
+    }
+    std::vector<const void *> inputs(backend_model->inputs().size());
+    std::vector<std::vector<uint8_t>> output_buffers;
+    std::vector<void *> outputs;
+    for (const auto &output : backend_model->outputs())
+    {
+        output_buffers.emplace_back(output.bytes);
+        outputs.push_back(output_buffers.back().data());
+    }
+    // 泄漏可能出现在输入输出的路径中，每次请求都包含inputs_set和outputs_get，回放多份样本时依次切换
+    auto request = [&]()
+    {
+        if (input_provider.samples() > 1)
+        {
+            input_provider.next();
+        }
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            inputs[i] = input_provider.data(i);
+        }
+        return backend_model->inputs_set(inputs) && backend_model->run() && backend_model->outputs_get(outputs);
+    };
+    for (int i = 0; i < FLAGS_num_warmup; i++)
+    {
+        request();
+    }
+
+    std::string model_name = std::filesystem::path(model).filename().string();
+    SoakConfig config;
+    config.durationS = FLAGS_soak_duration_s;
+    config.windowS = FLAGS_soak_window_s;
+    config.latencyDrift = FLAGS_soak_latency_drift;
+    config.rssDriftMb = FLAGS_soak_rss_drift_mb;
+    config.handleDrift = FLAGS_soak_handle_drift;
+    config.windowFile = FLAGS_soak_window_file;
+    config.label = model_name;
+    SoakMonitor monitor(config);
+    PowerSampler power_sampler(FLAGS_power_node, FLAGS_power_scale, FLAGS_power_interval_ms);
+    power_sampler.start();
+    nlohmann::json soak_result = monitor.run(request);
+    double power = power_sampler.stop();
+    const LatencyHistogram &latency = monitor.total();
+
+    nlohmann::json result;
+    result["MetaInfo"] = backend_model->meta_info();
+    result["MetaInfo"]["Plugin"] = library->path();
+    result["MetaInfo"]["ModelName"] = model_name;
+    result["MetaInfo"]["ModelHash"] = std::filesystem::exists(model) ? model_hash_string(model_file_hash(model)) : "";
+    result["RuntimeResult"]["Warmups"] = FLAGS_num_warmup;
+    result["RuntimeResult"]["Rounds"] = latency.count();
+    result["RuntimeResult"]["AvgTotalRoundLatency"] = latency.mean();
+    result["RuntimeResult"]["StdTotalRoundLatency"] = latency.stdev();
+    result["RuntimeResult"]["MinTotalRoundLatency"] = latency.min();
+    result["RuntimeResult"]["MaxTotalRoundLatency"] = latency.max();
+    result["RuntimeResult"]["InitTime"] = init_time;
+    result["SoakResult"] = soak_result;
+    result["InputData"] = input_provider.describe();
+
+    // 分位数来自直方图，相对误差约1%
+    const nlohmann::json &meta = result["MetaInfo"];
+    BenchmarkSummary summary = summarize_benchmark(logical_model_name(model), meta.value("BackendName", backend), meta.value("Device", device_model_name("NPU")), {});
+    summary.modelFile = model_name;
+    summary.modelHash = meta.value("ModelHash", "");
+    summary.backendVersion = meta.value("BackendVersion", "");
+    summary.rounds = (int)latency.count();
+    summary.meanLatency = latency.mean();
+    summary.stdLatency = latency.stdev();
+    summary.minLatency = latency.min();
+    summary.maxLatency = latency.max();
+    summary.p50Latency = latency.percentile(50);
+    summary.p90Latency = latency.percentile(90);
+    summary.p99Latency = latency.percentile(99);
+    summary.throughput = summary.meanLatency > 0 ? 1e6 / summary.meanLatency : -1;
+    summary.initTime = init_time;
+    if (meta.contains("MemoryBytes"))
+    {
+        summary.memory = meta["MemoryBytes"].get<double>() / 1024.0 / 1024.0;
+    }
+    set_summary_power(summary, power);
+    result["Summary"] = benchmark_summary_json(summary);
+
+    nlohmann::json model_result;
+    model_result[model_name] = result;
+    all_models_result.push_back(model_result);
+    LatencyPerfData data = {latency.mean(), latency.stdev(), latency.min(), latency.max()};
+    batch_perf_results.push_back(std::make_tuple(model_name, backend, data));
+    for (const auto &alert : soak_result["Alerts"])
+    {
+        LOG(WARNING) << model_name << " soak alert " << alert["Kind"].get<std::string>() << ": " << alert["Message"].get<std::string>();
+    }
+    return monitor.alerted() ? 1 : 0;
+}
+
+// 共置场景: 场景中的模型可以来自不同的后端，每个后端的插件只加载一次
+int scenario_benchmark(BackendRegistry &registry, const std::string &path, nlohmann::json &report)
+{
+    Scenario scenario;
+    if (!load_scenario(path, scenario))
+    {
+        return -1;
+    }
+    std::vector<std::unique_ptr<BackendModel>> backend_models;
+    std::vector<std::unique_ptr<InputProvider>> providers;
+    std::vector<std::vector<const void *>> inputs(scenario.models.size());
+    std::vector<std::vector<std::vector<uint8_t>>> output_buffers(scenario.models.size());
+    std::vector<std::vector<void *>> outputs(scenario.models.size());
+    std::vector<std::function<void()>> sessions;
+    nlohmann::json metaInfos;
+    InputSpec input_spec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec);
+    for (size_t index = 0; index < scenario.models.size(); index++)
+    {
+        const auto &model = scenario.models[index];
+        std::string backend = model_backend(model.model, model.config.value("backend", FLAGS_backend));
+        std::shared_ptr<BackendLibrary> library = backend.empty() ? nullptr : registry.get(backend);
+        if (!library)
+        {
+            LOG(ERROR) << "Cannot pick a backend for " << model.name << " (" << model.model << ")";
+            return -1;
+        }
+        backend_models.push_back(BackendModel::load(library, model.model, model.config));
+        BackendModel *backend_model = backend_models.back().get();
+        if (!backend_model)
+        {
+            return -1;
+        }
+        providers.emplace_back(new InputProvider(input_spec));
+        if (!providers.back()->prepare(backend_model->inputs()))
+        {
+            LOG(ERROR) << "Failed to prepare the input data of " << model.name;
+            return -1;
+        }
+        for (size_t i = 0; i < backend_model->inputs().size(); i++)
+        {
+            inputs[index].push_back(providers.back()->data(i));
+        }
+        for (const auto &output : backend_model->outputs())
+        {
+            output_buffers[index].emplace_back(output.bytes);
+            outputs[index].push_back(output_buffers[index].back().data());
+        }
+        nlohmann::json meta = backend_model->meta_info();
+        meta["Name"] = model.name;
+        metaInfos.push_back(meta);
+        const std::vector<const void *> &model_inputs = inputs[index];
+        const std::vector<void *> &model_outputs = outputs[index];
+        sessions.push_back([backend_model, &model_inputs, &model_outputs]()
+                           {
+            backend_model->inputs_set(model_inputs);
+            backend_model->run();
+            backend_model->outputs_get(model_outputs); });
+    }
+    report["MetaInfo"] = metaInfos;
+    report["Scenario"] = path;
+    report["ColocationResult"] = run_colocation(scenario, sessions);
+    return 0;
+}
+
+// 逗号分隔的列表，忽略空项
+std::vector<std::string> split_list(const std::string &text)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// 按每个策略和内存预算用新的缓存回放同一个访问序列，固定的模型在回放前加载
+int cache_benchmark(BackendRegistry &registry, const std::vector<std::string> &models, const nlohmann::json &options, nlohmann::json &report)
+{
+    std::vector<std::string> trace;
+    if (!load_cache_trace(FLAGS_cache_trace, models, (uint32_t)FLAGS_input_seed, trace))
+    {
+        LOG(ERROR) << "Invalid model access trace: " << FLAGS_cache_trace;
+        return -1;
+    }
+    std::vector<std::string> catalog(models);
+    for (const auto &model : trace)
+    {
+        if (std::find(catalog.begin(), catalog.end(), model) == catalog.end())
+        {
+            catalog.push_back(model);
+        }
+    }
+    std::vector<std::string> pins = split_list(FLAGS_cache_pin);
+    std::vector<std::string> policies = split_list(FLAGS_cache_policy);
+    std::vector<double> budgets;
+    for (const auto &budget : split_list(FLAGS_cache_budgets_mb))
+    {
+        char *end = nullptr;
+        double value = std::strtod(budget.c_str(), &end);
+        if (end == budget.c_str() || *end != '\0' || !std::isfinite(value) || value < 0)
+        {
+            LOG(ERROR) << "Invalid cache budget: " << budget << ", expected a non-negative size in MB";
+            return -1;
+        }
+        budgets.push_back(value);
+    }
+    for (const auto &policy : policies)
+    {
+        if (policy != "lru" && policy != "lfu")
+        {
+            LOG(ERROR) << "Unsupported cache policy: " << policy;
+            return -1;
+        }
+    }
+    LOG(INFO) << "Replaying " << trace.size() << " accesses over " << catalog.size() << " models through the model cache";
+
+    tabulate::Table cacheTable;
+    cacheTable.add_row({"policy", "budget(MB)", "hit rate", "prefetch hits", "evictions", "load(ms)", "peak(MB)", "acquire p50(us)", "acquire p99(us)", "added p99(us)"});
+    report["CacheReplay"]["Trace"] = FLAGS_cache_trace;
+    report["CacheReplay"]["Accesses"] = trace.size();
+    report["CacheReplay"]["Prefetch"] = FLAGS_cache_prefetch;
+    report["CacheReplay"]["Pinned"] = pins;
+    for (const auto &policy : policies)
+    {
+        for (double budget : budgets)
+        {
+            ModelCacheConfig config;
+            config.budgetBytes = (uint64_t)(budget * 1024 * 1024);
+            config.policy = policy;
+            ModelCache cache(registry, config);
+            for (const auto &model : catalog)
+            {
+                std::string backend = model_backend(model, FLAGS_backend);
+                cache.add(model, backend, options);
+                if (std::find(pins.begin(), pins.end(), std::filesystem::path(model).filename().string()) != pins.end())
+                {
+                    cache.pin(model);
+                    cache.acquire(model);
+                }
+            }
+            cache.reset_stats();
+            CacheReplayResult replay = replay_cache_trace(cache, trace, FLAGS_cache_prefetch);
+            const ModelCacheStats &stats = replay.stats;
+            std::vector<double> total(replay.acquireUs.size());
+            for (size_t i = 0; i < total.size(); i++)
+            {
+                total[i] = replay.acquireUs[i] + replay.computeUs[i];
+            }
+            double accesses = (double)(stats.hits + stats.misses);
+            double hit_rate = accesses > 0 ? stats.hits / accesses : 0;
+            double added_p99 = latency_percentile(total, 99) - latency_percentile(replay.computeUs, 99);
+            nlohmann::json run;
+            run["Policy"] = policy;
+            run["BudgetMB"] = budget;
+            run["Hits"] = stats.hits;
+            run["Misses"] = stats.misses;
+            run["HitRate"] = hit_rate;
+            run["PrefetchHits"] = stats.prefetchHits;
+            run["PrefetchWaits"] = stats.prefetchWaits;
+            run["PrefetchSkips"] = stats.prefetchSkips;
+            run["Loads"] = stats.loads;
+            run["LoadFailures"] = stats.loadFailures;
+            run["Evictions"] = stats.evictions;
+            run["LoadTime"] = stats.loadMs;
+            run["PeakResidentMB"] = stats.peakResidentBytes / 1024.0 / 1024.0;
+            run["AcquireP50"] = latency_percentile(replay.acquireUs, 50);
+            run["AcquireP99"] = latency_percentile(replay.acquireUs, 99);
+            run["AcquireMax"] = replay.acquireUs.empty() ? 0 : *std::max_element(replay.acquireUs.begin(), replay.acquireUs.end());
+            run["ComputeP99"] = latency_percentile(replay.computeUs, 99);
+            run["TotalP99"] = latency_percentile(total, 99);
+            run["AddedP99"] = added_p99;
+            run["Errors"] = replay.errors;
+            nlohmann::json footprints;
+            for (const auto &footprint : cache.footprints())
+            {
+                footprints[footprint.first] = footprint.second / 1024.0 / 1024.0;
+            }
+            run["FootprintMB"] = footprints;
+            report["CacheReplay"]["Runs"].push_back(run);
+            cacheTable.add_row({policy, budget > 0 ? std::to_string(budget) : "unlimited", std::to_string(hit_rate), std::to_string(stats.prefetchHits),
+                                std::to_string(stats.evictions), std::to_string(stats.loadMs), std::to_string(run["PeakResidentMB"].get<double>()),
+                                std::to_string(run["AcquireP50"].get<double>()), std::to_string(run["AcquireP99"].get<double>()), std::to_string(added_p99)});
+        }
+    }
+    for (size_t i = 0; i < 10; ++i)
+    {
+        cacheTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "\n"
+              << cacheTable << "\n";
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef PLUGIN_COMMON_HPP
+#define PLUGIN_COMMON_HPP
+#include <cstdio>
+#include <string>
+#include "nlohmann/json.hpp"
+#include "BackendPlugin.h"
+
+// 后端插件共用的部分。插件中不使用glog/gflags，错误写进模型的error字符串，由npubench通过last_error取出记录。
+
+// 每个插件的模型结构都继承它，meta_info和last_error直接返回这两个字符串
+struct PluginModel
+{
+    std::string meta;
+    std::string error;
+};
+
+// options为空或不是json对象时返回空对象
+nlohmann::json plugin_options(const char *options)
+{
+    nlohmann::json parsed = nlohmann::json::parse(options && *options ? options : "{}", nullptr, false);
+    return parsed.is_object() ? parsed : nlohmann::json::object();
+}
+
+void plugin_error(char *error, size_t error_size, const std::string &message)
+{
+    snprintf(error, error_size, "%s", message.c_str());
+}
+
+void plugin_tensor_desc(NpuTensorDesc *desc, const std::string &name, int32_t dtype, uint64_t bytes)
+{
+    snprintf(desc->name, sizeof(desc->name), "%s", name.c_str());
+    desc->dtype = dtype;
+    desc->bytes = bytes;
+}
+
+const char *plugin_meta_info(void *model)
+{
+    return static_cast<PluginModel *>(model)->meta.c_str();
+}
+
+const char *plugin_last_error(void *model)
+{
+    return static_cast<PluginModel *>(model)->error.c_str();
+}
+
+#endif
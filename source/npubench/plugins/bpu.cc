@@ -0,0 +1,261 @@
+#include <cstring>
+#include <string>
+#include <vector>
+#include "dnn/hb_dnn.h"
+#include "PluginCommon.hpp"
+
+// BPU后端插件(libnpubench_bpu.so)。选项: model_name为打包文件中的模型(默认第一个)，
+// core为绑定的BPU核心(0/1，-1为任意)，priority为任务优先级(0-255，默认90)
+struct BpuModel : PluginModel
+{
+    hbPackedDNNHandle_t packed = nullptr;
+    hbDNNHandle_t handle = nullptr;
+    std::vector<hbDNNTensor> inputs;
+    std::vector<hbDNNTensor> outputs;
+    std::vector<std::string> inputNames;
+    std::vector<std::string> outputNames;
+    hbDNNInferCtrlParam ctrl = {};
+};
+
+static int32_t to_npu_dtype(int32_t type)
+{
+    switch (type)
+    {
+    case HB_DNN_TENSOR_TYPE_S8:
+        return NPU_DTYPE_INT8;
+    case HB_DNN_TENSOR_TYPE_F16:
+        return NPU_DTYPE_FLOAT16;
+    case HB_DNN_TENSOR_TYPE_S16:
+        return NPU_DTYPE_INT16;
+    case HB_DNN_TENSOR_TYPE_U16:
+        return NPU_DTYPE_UINT16;
+    case HB_DNN_TENSOR_TYPE_F32:
+        return NPU_DTYPE_FLOAT32;
+    case HB_DNN_TENSOR_TYPE_S32:
+    case HB_DNN_TENSOR_TYPE_U32:
+        return NPU_DTYPE_INT32;
+    case HB_DNN_TENSOR_TYPE_S64:
+    case HB_DNN_TENSOR_TYPE_U64:
+        return NPU_DTYPE_INT64;
+    default:
+        return NPU_DTYPE_UINT8;
+    }
+}
+
+static const char *bpu_plugin_version()
+{
+    return hbDNNGetVersion();
+}
+
+static void bpu_plugin_unload(void *model)
+{
+    auto bpu = static_cast<BpuModel *>(model);
+    for (auto *tensors : {&bpu->inputs, &bpu->outputs})
+    {
+        for (auto &tensor : *tensors)
+        {
+            for (auto &mem : tensor.sysMem)
+            {
+                if (mem.virAddr)
+                {
+                    hbSysFreeMem(&mem);
+                }
+            }
+        }
+    }
+    if (bpu->packed)
+    {
+        hbDNNRelease(bpu->packed);
+    }
+    delete bpu;
+}
+
+static void *bpu_plugin_load(const char *model_path, const char *options, char *error, size_t error_size)
+{
+    nlohmann::json config = plugin_options(options);
+    // core为-1时任意核心，0和1绑定BPU0和BPU1；priority为BPU任务优先级0-255
+    int core = config.value("core", -1);
+    int priority = config.value("priority", 90);
+    if (core > 1)
+    {
+        plugin_error(error, error_size, "invalid core " + std::to_string(core) + ", BPU has cores 0 and 1");
+        return nullptr;
+    }
+    if (priority < 0 || priority > 255)
+    {
+        plugin_error(error, error_size, "invalid priority " + std::to_string(priority) + ", expected 0 to 255");
+        return nullptr;
+    }
+    auto model = new BpuModel();
+    auto fail = [&](const std::string &message, int32_t ret) -> void *
+    {
+        plugin_error(error, error_size, message + " ret=" + std::to_string(ret));
+        bpu_plugin_unload(model);
+        return nullptr;
+    };
+    const char *files[] = {model_path};
+    int32_t ret = hbDNNInitializeFromFiles(&model->packed, files, 1);
+    if (ret != HB_SYS_SUCCESS)
+    {
+        model->packed = nullptr;
+        return fail("hbDNNInitializeFromFiles fail!", ret);
+    }
+    const char **names = nullptr;
+    int32_t count = 0;
+    if ((ret = hbDNNGetModelNameList(&names, &count, model->packed)) != HB_SYS_SUCCESS || count == 0)
+    {
+        return fail("hbDNNGetModelNameList fail!", ret);
+    }
+    std::string model_name = config.value("model_name", std::string(names[0]));
+    if ((ret = hbDNNGetModelHandle(&model->handle, model->packed, model_name.c_str())) != HB_SYS_SUCCESS)
+    {
+        return fail("hbDNNGetModelHandle fail! model=" + model_name, ret);
+    }
+    int32_t input_count = 0, output_count = 0;
+    hbDNNGetInputCount(&input_count, model->handle);
+    hbDNNGetOutputCount(&output_count, model->handle);
+    model->inputs.resize(input_count);
+    model->outputs.resize(output_count);
+    for (int32_t i = 0; i < input_count; i++)
+    {
+        hbDNNTensor &tensor = model->inputs[i];
+        memset(&tensor, 0, sizeof(tensor));
+        hbDNNGetInputTensorProperties(&tensor.properties, model->handle, i);
+        if ((ret = hbSysAllocCachedMem(&tensor.sysMem[0], tensor.properties.alignedByteSize)) != HB_SYS_SUCCESS)
+        {
+            return fail("hbSysAllocCachedMem fail!", ret);
+        }
+        // NV12_SEPARATE的UV平面单独存放在sysMem[1]，填中性色度，npubench只提供Y平面
+        if (tensor.properties.tensorType == HB_DNN_IMG_TYPE_NV12_SEPARATE)
+        {
+            if ((ret = hbSysAllocCachedMem(&tensor.sysMem[1], tensor.properties.alignedByteSize / 2)) != HB_SYS_SUCCESS)
+            {
+                return fail("hbSysAllocCachedMem fail!", ret);
+            }
+            memset(tensor.sysMem[1].virAddr, 128, tensor.sysMem[1].memSize);
+            hbSysFlushMem(&tensor.sysMem[1], HB_SYS_MEM_CACHE_CLEAN);
+        }
+        const char *name = nullptr;
+        hbDNNGetInputName(&name, model->handle, i);
+        model->inputNames.push_back(name ? name : "input" + std::to_string(i));
+    }
+    for (int32_t i = 0; i < output_count; i++)
+    {
+        hbDNNTensor &tensor = model->outputs[i];
+        memset(&tensor, 0, sizeof(tensor));
+        hbDNNGetOutputTensorProperties(&tensor.properties, model->handle, i);
+        if ((ret = hbSysAllocCachedMem(&tensor.sysMem[0], tensor.properties.alignedByteSize)) != HB_SYS_SUCCESS)
+        {
+            return fail("hbSysAllocCachedMem fail!", ret);
+        }
+        const char *name = nullptr;
+        hbDNNGetOutputName(&name, model->handle, i);
+        model->outputNames.push_back(name ? name : "output" + std::to_string(i));
+    }
+    model->ctrl.bpuCoreId = core < 0 ? HB_BPU_CORE_ANY : (core == 0 ? HB_BPU_CORE_0 : HB_BPU_CORE_1);
+    model->ctrl.priority = priority;
+
+    nlohmann::json meta;
+    meta["BackendName"] = "BPU";
+    meta["BackendVersion"] = hbDNNGetVersion();
+    meta["PackedModelName"] = model_name;
+    meta["BpuCoreId"] = model->ctrl.bpuCoreId;
+    meta["Priority"] = model->ctrl.priority;
+    model->meta = meta.dump();
+    return model;
+}
+
+static int32_t bpu_plugin_input_count(void *model)
+{
+    return (int32_t)static_cast<BpuModel *>(model)->inputs.size();
+}
+
+static int32_t bpu_plugin_output_count(void *model)
+{
+    return (int32_t)static_cast<BpuModel *>(model)->outputs.size();
+}
+
+static int32_t bpu_plugin_input_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    auto bpu = static_cast<BpuModel *>(model);
+    const hbDNNTensorProperties &properties = bpu->inputs[index].properties;
+    plugin_tensor_desc(desc, bpu->inputNames[index], to_npu_dtype(properties.tensorType), properties.alignedByteSize);
+    return 0;
+}
+
+static int32_t bpu_plugin_output_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    auto bpu = static_cast<BpuModel *>(model);
+    const hbDNNTensorProperties &properties = bpu->outputs[index].properties;
+    plugin_tensor_desc(desc, bpu->outputNames[index], to_npu_dtype(properties.tensorType), properties.alignedByteSize);
+    return 0;
+}
+
+// 拷贝到BPU内存后clean cache，BPU通过DMA读取
+static int32_t bpu_plugin_inputs_set(void *model, const void *const *inputs)
+{
+    auto bpu = static_cast<BpuModel *>(model);
+    for (size_t i = 0; i < bpu->inputs.size(); i++)
+    {
+        hbSysMem &mem = bpu->inputs[i].sysMem[0];
+        memcpy(mem.virAddr, inputs[i], bpu->inputs[i].properties.alignedByteSize);
+        hbSysFlushMem(&mem, HB_SYS_MEM_CACHE_CLEAN);
+    }
+    return 0;
+}
+
+static int32_t bpu_plugin_run(void *model)
+{
+    auto bpu = static_cast<BpuModel *>(model);
+    hbDNNTaskHandle_t task = nullptr;
+    hbDNNTensor *outputs = bpu->outputs.data();
+    hbDNNInferCtrlParam ctrl = bpu->ctrl;
+    int32_t ret = hbDNNInfer(&task, &outputs, bpu->inputs.data(), bpu->handle, &ctrl);
+    if (ret == HB_SYS_SUCCESS)
+    {
+        ret = hbDNNWaitTaskDone(task, 0);
+    }
+    if (task)
+    {
+        hbDNNReleaseTask(task);
+    }
+    if (ret != HB_SYS_SUCCESS)
+    {
+        bpu->error = "hbDNNInfer fail! ret=" + std::to_string(ret);
+    }
+    return ret;
+}
+
+static int32_t bpu_plugin_outputs_get(void *model, void *const *outputs)
+{
+    auto bpu = static_cast<BpuModel *>(model);
+    for (size_t i = 0; i < bpu->outputs.size(); i++)
+    {
+        hbSysMem &mem = bpu->outputs[i].sysMem[0];
+        hbSysFlushMem(&mem, HB_SYS_MEM_CACHE_INVALIDATE);
+        memcpy(outputs[i], mem.virAddr, bpu->outputs[i].properties.alignedByteSize);
+    }
+    return 0;
+}
+
+extern "C" const NpuBackendPlugin *npubench_backend_plugin()
+{
+    static const NpuBackendPlugin plugin = {
+        NPUBENCH_PLUGIN_ABI,
+        "bpu",
+        ".bin,.hbm",
+        bpu_plugin_version,
+        bpu_plugin_load,
+        bpu_plugin_unload,
+        bpu_plugin_input_count,
+        bpu_plugin_output_count,
+        bpu_plugin_input_desc,
+        bpu_plugin_output_desc,
+        bpu_plugin_inputs_set,
+        bpu_plugin_run,
+        bpu_plugin_outputs_get,
+        plugin_meta_info,
+        plugin_last_error,
+    };
+    return &plugin;
+}
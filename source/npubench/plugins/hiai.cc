@@ -0,0 +1,187 @@
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "HiAiModelManagerService.h"
+#include "PluginCommon.hpp"
+
+// HiAI后端插件(libnpubench_hiai.so)，与hiai_test相同使用FP16精度和HIGH性能模式，没有后端特有的选项
+struct HiaiModel : PluginModel
+{
+    std::shared_ptr<hiai::IBuiltModel> builtModel;
+    std::shared_ptr<hiai::IModelManager> modelManager;
+    std::vector<hiai::NDTensorDesc> inputDescs;
+    std::vector<hiai::NDTensorDesc> outputDescs;
+    std::vector<std::shared_ptr<hiai::INDTensorBuffer>> inputs;
+    std::vector<std::shared_ptr<hiai::INDTensorBuffer>> outputs;
+};
+
+static int32_t to_npu_dtype(hiai::DataType type)
+{
+    switch (type)
+    {
+    case hiai::DataType::FLOAT32:
+        return NPU_DTYPE_FLOAT32;
+    case hiai::DataType::FLOAT16:
+        return NPU_DTYPE_FLOAT16;
+    case hiai::DataType::INT8:
+        return NPU_DTYPE_INT8;
+    case hiai::DataType::INT16:
+        return NPU_DTYPE_INT16;
+    case hiai::DataType::INT32:
+    case hiai::DataType::UINT32:
+        return NPU_DTYPE_INT32;
+    case hiai::DataType::INT64:
+        return NPU_DTYPE_INT64;
+    case hiai::DataType::BOOL:
+        return NPU_DTYPE_BOOL;
+    default:
+        return NPU_DTYPE_UINT8;
+    }
+}
+
+static const char *hiai_plugin_version()
+{
+    return "hiai-ddk";
+}
+
+static void hiai_plugin_unload(void *model)
+{
+    auto hiai_model = static_cast<HiaiModel *>(model);
+    if (hiai_model->modelManager)
+    {
+        hiai_model->modelManager->DeInit();
+    }
+    delete hiai_model;
+}
+
+static void *hiai_plugin_load(const char *model_path, const char *, char *error, size_t error_size)
+{
+    auto model = new HiaiModel();
+    hiai::ModelInitOptions initOptions;
+    initOptions.buildOptions.precisionMode = hiai::PrecisionMode::PRECISION_MODE_FP16;
+    initOptions.perfMode = hiai::PerfMode::HIGH;
+    model->builtModel = hiai::CreateBuiltModel();
+    hiai::Status ret = model->builtModel->RestoreFromFile(model_path);
+    if (ret != hiai::SUCCESS)
+    {
+        plugin_error(error, error_size, "RestoreFromFile fail! ret=" + std::to_string(ret));
+        delete model;
+        return nullptr;
+    }
+    model->modelManager = hiai::CreateModelManager();
+    ret = model->modelManager->Init(initOptions, model->builtModel, nullptr);
+    if (ret != hiai::SUCCESS)
+    {
+        plugin_error(error, error_size, "IModelManager::Init fail! ret=" + std::to_string(ret));
+        model->modelManager.reset();
+        delete model;
+        return nullptr;
+    }
+    model->inputDescs = model->builtModel->GetInputTensorDescs();
+    model->outputDescs = model->builtModel->GetOutputTensorDescs();
+    for (const auto &desc : model->inputDescs)
+    {
+        model->inputs.push_back(hiai::CreateNDTensorBuffer(desc));
+    }
+    for (const auto &desc : model->outputDescs)
+    {
+        model->outputs.push_back(hiai::CreateNDTensorBuffer(desc));
+    }
+    for (const auto *buffers : {&model->inputs, &model->outputs})
+    {
+        for (const auto &buffer : *buffers)
+        {
+            if (!buffer)
+            {
+                plugin_error(error, error_size, "CreateNDTensorBuffer fail!");
+                hiai_plugin_unload(model);
+                return nullptr;
+            }
+        }
+    }
+
+    nlohmann::json meta;
+    meta["BackendName"] = "HiAI";
+    meta["PrecisionMode"] = "FP16";
+    model->meta = meta.dump();
+    return model;
+}
+
+static int32_t hiai_plugin_input_count(void *model)
+{
+    return (int32_t)static_cast<HiaiModel *>(model)->inputs.size();
+}
+
+static int32_t hiai_plugin_output_count(void *model)
+{
+    return (int32_t)static_cast<HiaiModel *>(model)->outputs.size();
+}
+
+static int32_t hiai_plugin_input_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    auto hiai_model = static_cast<HiaiModel *>(model);
+    plugin_tensor_desc(desc, "input" + std::to_string(index), to_npu_dtype(hiai_model->inputDescs[index].dataType), hiai_model->inputs[index]->GetSize());
+    return 0;
+}
+
+static int32_t hiai_plugin_output_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    auto hiai_model = static_cast<HiaiModel *>(model);
+    plugin_tensor_desc(desc, "output" + std::to_string(index), to_npu_dtype(hiai_model->outputDescs[index].dataType), hiai_model->outputs[index]->GetSize());
+    return 0;
+}
+
+static int32_t hiai_plugin_inputs_set(void *model, const void *const *inputs)
+{
+    auto hiai_model = static_cast<HiaiModel *>(model);
+    for (size_t i = 0; i < hiai_model->inputs.size(); i++)
+    {
+        memcpy(hiai_model->inputs[i]->GetData(), inputs[i], hiai_model->inputs[i]->GetSize());
+    }
+    return 0;
+}
+
+static int32_t hiai_plugin_run(void *model)
+{
+    auto hiai_model = static_cast<HiaiModel *>(model);
+    hiai::Status ret = hiai_model->modelManager->Run(hiai_model->inputs, hiai_model->outputs);
+    if (ret != hiai::SUCCESS)
+    {
+        hiai_model->error = "IModelManager::Run fail! ret=" + std::to_string(ret);
+        return -1;
+    }
+    return 0;
+}
+
+static int32_t hiai_plugin_outputs_get(void *model, void *const *outputs)
+{
+    auto hiai_model = static_cast<HiaiModel *>(model);
+    for (size_t i = 0; i < hiai_model->outputs.size(); i++)
+    {
+        memcpy(outputs[i], hiai_model->outputs[i]->GetData(), hiai_model->outputs[i]->GetSize());
+    }
+    return 0;
+}
+
+extern "C" const NpuBackendPlugin *npubench_backend_plugin()
+{
+    static const NpuBackendPlugin plugin = {
+        NPUBENCH_PLUGIN_ABI,
+        "hiai",
+        ".om",
+        hiai_plugin_version,
+        hiai_plugin_load,
+        hiai_plugin_unload,
+        hiai_plugin_input_count,
+        hiai_plugin_output_count,
+        hiai_plugin_input_desc,
+        hiai_plugin_output_desc,
+        hiai_plugin_inputs_set,
+        hiai_plugin_run,
+        hiai_plugin_outputs_get,
+        plugin_meta_info,
+        plugin_last_error,
+    };
+    return &plugin;
+}
@@ -0,0 +1,194 @@
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "openvino/openvino.hpp"
+#include "PluginCommon.hpp"
+
+// OpenVINO后端插件(libnpubench_openvino.so)。选项: device为推理设备(默认CPU)，streams为ov::num_streams(0为默认)，
+// performance_mode为LATENCY或THROUGHPUT(为空时不设置)。.xml模型的权重为同名的.bin
+struct OpenvinoModel : PluginModel
+{
+    ov::Core core;
+    ov::CompiledModel compiledModel;
+    ov::InferRequest inferRequest;
+    std::vector<ov::Output<const ov::Node>> inputs;
+    std::vector<ov::Output<const ov::Node>> outputs;
+};
+
+static int32_t to_npu_dtype(const ov::element::Type &type)
+{
+    if (type == ov::element::f32)
+        return NPU_DTYPE_FLOAT32;
+    if (type == ov::element::f16)
+        return NPU_DTYPE_FLOAT16;
+    if (type == ov::element::i8)
+        return NPU_DTYPE_INT8;
+    if (type == ov::element::i16)
+        return NPU_DTYPE_INT16;
+    if (type == ov::element::u16)
+        return NPU_DTYPE_UINT16;
+    if (type == ov::element::i32)
+        return NPU_DTYPE_INT32;
+    if (type == ov::element::i64)
+        return NPU_DTYPE_INT64;
+    if (type == ov::element::boolean)
+        return NPU_DTYPE_BOOL;
+    return NPU_DTYPE_UINT8;
+}
+
+static const char *openvino_plugin_version()
+{
+    return ov::get_openvino_version().buildNumber;
+}
+
+static void *openvino_plugin_load(const char *model_path, const char *options, char *error, size_t error_size)
+{
+    nlohmann::json config = plugin_options(options);
+    auto model = new OpenvinoModel();
+    try
+    {
+        std::string device = config.value("device", "CPU");
+        std::string bin_path;
+        if (std::filesystem::path(model_path).extension() == ".xml")
+        {
+            bin_path = std::filesystem::path(model_path).replace_extension(".bin").string();
+        }
+        std::shared_ptr<ov::Model> network = model->core.read_model(model_path, bin_path);
+        ov::AnyMap properties;
+        int streams = config.value("streams", 0);
+        if (streams > 0)
+        {
+            properties.insert(ov::num_streams(streams));
+        }
+        std::string mode = config.value("performance_mode", "");
+        if (!mode.empty())
+        {
+            properties.insert(ov::hint::performance_mode(mode == "THROUGHPUT" ? ov::hint::PerformanceMode::THROUGHPUT : ov::hint::PerformanceMode::LATENCY));
+        }
+        model->compiledModel = model->core.compile_model(network, device, properties);
+        model->inferRequest = model->compiledModel.create_infer_request();
+        model->inputs = model->compiledModel.inputs();
+        model->outputs = model->compiledModel.outputs();
+
+        nlohmann::json meta;
+        meta["BackendName"] = "OpenVINO";
+        meta["BackendVersion"] = ov::get_openvino_version().buildNumber;
+        meta["Device"] = device;
+        meta["Streams"] = streams;
+        meta["PerformanceMode"] = mode;
+        model->meta = meta.dump();
+        return model;
+    }
+    catch (const std::exception &ex)
+    {
+        plugin_error(error, error_size, ex.what());
+        delete model;
+        return nullptr;
+    }
+}
+
+static void openvino_plugin_unload(void *model)
+{
+    delete static_cast<OpenvinoModel *>(model);
+}
+
+static int32_t openvino_plugin_input_count(void *model)
+{
+    return (int32_t)static_cast<OpenvinoModel *>(model)->inputs.size();
+}
+
+static int32_t openvino_plugin_output_count(void *model)
+{
+    return (int32_t)static_cast<OpenvinoModel *>(model)->outputs.size();
+}
+
+static int32_t openvino_plugin_input_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    const auto &input = static_cast<OpenvinoModel *>(model)->inputs[index];
+    plugin_tensor_desc(desc, input.get_any_name(), to_npu_dtype(input.get_element_type()), ov::shape_size(input.get_shape()) * input.get_element_type().size());
+    return 0;
+}
+
+static int32_t openvino_plugin_output_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    const auto &output = static_cast<OpenvinoModel *>(model)->outputs[index];
+    plugin_tensor_desc(desc, output.get_any_name(), to_npu_dtype(output.get_element_type()), ov::shape_size(output.get_shape()) * output.get_element_type().size());
+    return 0;
+}
+
+// 拷入请求的输入张量，与openvino_test的输入阶段相同
+static int32_t openvino_plugin_inputs_set(void *model, const void *const *inputs)
+{
+    auto openvino = static_cast<OpenvinoModel *>(model);
+    try
+    {
+        for (size_t i = 0; i < openvino->inputs.size(); i++)
+        {
+            ov::Tensor tensor = openvino->inferRequest.get_tensor(openvino->inputs[i]);
+            memcpy(tensor.data(), inputs[i], tensor.get_byte_size());
+        }
+        return 0;
+    }
+    catch (const std::exception &ex)
+    {
+        openvino->error = ex.what();
+        return -1;
+    }
+}
+
+static int32_t openvino_plugin_run(void *model)
+{
+    auto openvino = static_cast<OpenvinoModel *>(model);
+    try
+    {
+        openvino->inferRequest.infer();
+        return 0;
+    }
+    catch (const std::exception &ex)
+    {
+        openvino->error = ex.what();
+        return -1;
+    }
+}
+
+static int32_t openvino_plugin_outputs_get(void *model, void *const *outputs)
+{
+    auto openvino = static_cast<OpenvinoModel *>(model);
+    try
+    {
+        for (size_t i = 0; i < openvino->outputs.size(); i++)
+        {
+            ov::Tensor tensor = openvino->inferRequest.get_tensor(openvino->outputs[i]);
+            memcpy(outputs[i], tensor.data(), tensor.get_byte_size());
+        }
+        return 0;
+    }
+    catch (const std::exception &ex)
+    {
+        openvino->error = ex.what();
+        return -1;
+    }
+}
+
+extern "C" const NpuBackendPlugin *npubench_backend_plugin()
+{
+    static const NpuBackendPlugin plugin = {
+        NPUBENCH_PLUGIN_ABI,
+        "openvino",
+        ".xml,.onnx",
+        openvino_plugin_version,
+        openvino_plugin_load,
+        openvino_plugin_unload,
+        openvino_plugin_input_count,
+        openvino_plugin_output_count,
+        openvino_plugin_input_desc,
+        openvino_plugin_output_desc,
+        openvino_plugin_inputs_set,
+        openvino_plugin_run,
+        openvino_plugin_outputs_get,
+        plugin_meta_info,
+        plugin_last_error,
+    };
+    return &plugin;
+}
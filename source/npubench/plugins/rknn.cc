@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "rknn_api.h"
+#include "PluginCommon.hpp"
+
+// RKNN后端插件(libnpubench_rknn.so)。选项: core为绑定的NPU核心(0-2，-1为自动)，core_mask直接给出rknn_core_mask
+struct RknnModel : PluginModel
+{
+    rknn_context ctx = 0;
+    std::vector<rknn_tensor_attr> inputAttrs;
+    std::vector<rknn_tensor_attr> outputAttrs;
+    std::vector<rknn_input> inputs;
+    std::vector<rknn_output> outputs;
+};
+
+static int32_t to_npu_dtype(rknn_tensor_type type)
+{
+    switch (type)
+    {
+    case RKNN_TENSOR_FLOAT32:
+        return NPU_DTYPE_FLOAT32;
+    case RKNN_TENSOR_FLOAT16:
+        return NPU_DTYPE_FLOAT16;
+    case RKNN_TENSOR_INT8:
+        return NPU_DTYPE_INT8;
+    case RKNN_TENSOR_INT16:
+        return NPU_DTYPE_INT16;
+    case RKNN_TENSOR_UINT16:
+        return NPU_DTYPE_UINT16;
+    case RKNN_TENSOR_INT32:
+    case RKNN_TENSOR_UINT32:
+        return NPU_DTYPE_INT32;
+    case RKNN_TENSOR_INT64:
+        return NPU_DTYPE_INT64;
+    case RKNN_TENSOR_BOOL:
+        return NPU_DTYPE_BOOL;
+    default:
+        return NPU_DTYPE_UINT8;
+    }
+}
+
+static const char *rknn_plugin_version()
+{
+    return "rknn-toolkit2";
+}
+
+static void rknn_plugin_unload(void *model)
+{
+    auto rknn = static_cast<RknnModel *>(model);
+    if (rknn->ctx)
+    {
+        rknn_destroy(rknn->ctx);
+    }
+    delete rknn;
+}
+
+static void *rknn_plugin_load(const char *model_path, const char *options, char *error, size_t error_size)
+{
+    nlohmann::json config = plugin_options(options);
+    // core为-1时由驱动分配，0-2绑定对应的核心
+    int core = config.value("core", -1);
+    if (core > 2)
+    {
+        plugin_error(error, error_size, "invalid core " + std::to_string(core) + ", RKNN has cores 0 to 2");
+        return nullptr;
+    }
+    auto model = new RknnModel();
+    int ret = rknn_init(&model->ctx, (void *)model_path, 0, 0, nullptr);
+    if (ret < 0)
+    {
+        plugin_error(error, error_size, "rknn_init fail! ret=" + std::to_string(ret));
+        model->ctx = 0;
+        rknn_plugin_unload(model);
+        return nullptr;
+    }
+    int core_mask = config.value("core_mask", core < 0 ? (int)RKNN_NPU_CORE_AUTO : (int)RKNN_NPU_CORE_0 << core);
+    if (core_mask != RKNN_NPU_CORE_AUTO && (ret = rknn_set_core_mask(model->ctx, (rknn_core_mask)core_mask)) < 0)
+    {
+        plugin_error(error, error_size, "rknn_set_core_mask fail! core mask=" + std::to_string(core_mask) + ", ret=" + std::to_string(ret));
+        rknn_plugin_unload(model);
+        return nullptr;
+    }
+    rknn_input_output_num io_num;
+    if (rknn_query(model->ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num)) != RKNN_SUCC)
+    {
+        plugin_error(error, error_size, "rknn_query RKNN_QUERY_IN_OUT_NUM fail!");
+        rknn_plugin_unload(model);
+        return nullptr;
+    }
+    model->inputAttrs.resize(io_num.n_input);
+    model->inputs.resize(io_num.n_input);
+    for (uint32_t i = 0; i < io_num.n_input; i++)
+    {
+        rknn_tensor_attr &attr = model->inputAttrs[i];
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        rknn_query(model->ctx, RKNN_QUERY_INPUT_ATTR, &attr, sizeof(attr));
+        memset(&model->inputs[i], 0, sizeof(rknn_input));
+        model->inputs[i].index = i;
+        model->inputs[i].type = attr.type;
+        model->inputs[i].size = attr.size;
+        model->inputs[i].fmt = attr.fmt;
+    }
+    model->outputAttrs.resize(io_num.n_output);
+    model->outputs.resize(io_num.n_output);
+    for (uint32_t i = 0; i < io_num.n_output; i++)
+    {
+        rknn_tensor_attr &attr = model->outputAttrs[i];
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        rknn_query(model->ctx, RKNN_QUERY_OUTPUT_ATTR, &attr, sizeof(attr));
+        memset(&model->outputs[i], 0, sizeof(rknn_output));
+        model->outputs[i].index = i;
+        model->outputs[i].is_prealloc = true;
+        model->outputs[i].size = attr.size;
+    }
+
+    nlohmann::json meta;
+    meta["BackendName"] = "RKNN";
+    meta["CoreMask"] = core_mask;
+    rknn_sdk_version version;
+    if (rknn_query(model->ctx, RKNN_QUERY_SDK_VERSION, &version, sizeof(version)) == RKNN_SUCC)
+    {
+        meta["BackendVersion"] = std::string(version.api_version) + " (driver " + version.drv_version + ")";
+    }
+    rknn_mem_size mem_size;
+    if (rknn_query(model->ctx, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size)) == RKNN_SUCC)
+    {
+        meta["MemoryBytes"] = (uint64_t)mem_size.total_weight_size + mem_size.total_internal_size;
+        meta["WeightBytes"] = mem_size.total_weight_size;
+        meta["InternalBytes"] = mem_size.total_internal_size;
+    }
+    model->meta = meta.dump();
+    return model;
+}
+
+static int32_t rknn_plugin_input_count(void *model)
+{
+    return (int32_t)static_cast<RknnModel *>(model)->inputAttrs.size();
+}
+
+static int32_t rknn_plugin_output_count(void *model)
+{
+    return (int32_t)static_cast<RknnModel *>(model)->outputAttrs.size();
+}
+
+static int32_t rknn_plugin_input_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    const rknn_tensor_attr &attr = static_cast<RknnModel *>(model)->inputAttrs[index];
+    plugin_tensor_desc(desc, attr.name, to_npu_dtype(attr.type), attr.size);
+    return 0;
+}
+
+static int32_t rknn_plugin_output_desc(void *model, int32_t index, NpuTensorDesc *desc)
+{
+    const rknn_tensor_attr &attr = static_cast<RknnModel *>(model)->outputAttrs[index];
+    plugin_tensor_desc(desc, attr.name, to_npu_dtype(attr.type), attr.size);
+    return 0;
+}
+
+// rknn_inputs_set会拷贝数据，buf只需指向npubench的缓冲区
+static int32_t rknn_plugin_inputs_set(void *model, const void *const *inputs)
+{
+    auto rknn = static_cast<RknnModel *>(model);
+    for (size_t i = 0; i < rknn->inputs.size(); i++)
+    {
+        rknn->inputs[i].buf = (void *)inputs[i];
+    }
+    int ret = rknn_inputs_set(rknn->ctx, (uint32_t)rknn->inputs.size(), rknn->inputs.data());
+    if (ret < 0)
+    {
+        rknn->error = "rknn_inputs_set fail! ret=" + std::to_string(ret);
+    }
+    return ret < 0 ? ret : 0;
+}
+
+static int32_t rknn_plugin_run(void *model)
+{
+    auto rknn = static_cast<RknnModel *>(model);
+    int ret = rknn_run(rknn->ctx, nullptr);
+    if (ret < 0)
+    {
+        rknn->error = "rknn_run fail! ret=" + std::to_string(ret);
+    }
+    return ret < 0 ? ret : 0;
+}
+
+// 输出预分配在npubench的缓冲区中，rknn_outputs_release只释放内部状态
+static int32_t rknn_plugin_outputs_get(void *model, void *const *outputs)
+{
+    auto rknn = static_cast<RknnModel *>(model);
+    for (size_t i = 0; i < rknn->outputs.size(); i++)
+    {
+        rknn->outputs[i].buf = outputs[i];
+    }
+    int ret = rknn_outputs_get(rknn->ctx, (uint32_t)rknn->outputs.size(), rknn->outputs.data(), nullptr);
+    if (ret < 0)
+    {
+        rknn->error = "rknn_outputs_get fail! ret=" + std::to_string(ret);
+        return ret;
+    }
+    rknn_outputs_release(rknn->ctx, (uint32_t)rknn->outputs.size(), rknn->outputs.data());
+    return 0;
+}
+
+extern "C" const NpuBackendPlugin *npubench_backend_plugin()
+{
+    static const NpuBackendPlugin plugin = {
+        NPUBENCH_PLUGIN_ABI,
+        "rknn",
+        ".rknn",
+        rknn_plugin_version,
+        rknn_plugin_load,
+        rknn_plugin_unload,
+        rknn_plugin_input_count,
+        rknn_plugin_output_count,
+        rknn_plugin_input_desc,
+        rknn_plugin_output_desc,
+        rknn_plugin_inputs_set,
+        rknn_plugin_run,
+        rknn_plugin_outputs_get,
+        plugin_meta_info,
+        plugin_last_error,
+    };
+    return &plugin;
+}
@@ -0,0 +1,347 @@
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "BenchmarkSummary.hpp"
+#include "InputProvider.hpp"
+#include "LoadGenerator.hpp"
+#include "ServeProtocol.hpp"
+#include "Timer.hpp"
+
+// npuserve监听的UNIX域套接字路径
+DEFINE_string(socket, "/tmp/npuserve.sock", "The path of the UNIX domain socket npuserve listens on.");
+
+// 请求的常驻模型名(模型文件名)
+DEFINE_string(model, "", "The resident model to request, the model file name on the server.");
+
+// 请求到达率(请求/s)，泊松到达；0为闭环，收到回复后立即发出下一个请求
+DEFINE_double(rate, 0, "The Poisson arrival rate of the requests (requests/s), 0 for a closed loop.");
+
+// 正式请求的个数
+DEFINE_int32(num_requests, 2000, "The number of timed requests.");
+
+// 预热请求的个数，不计入结果
+DEFINE_int32(num_warmup, 20, "The number of warmup requests, not included in the result.");
+
+// 同时在途的请求数，也是共享内存中的slot数
+DEFINE_int32(inflight, 1, "The maximum number of requests in flight, also the number of slots in the shared memory.");
+
+// 输入数据: random[:low,high]、constant:value 或 replay:文件或目录
+DEFINE_string(input_data, "random", "The input data: random[:low,high], constant:value or replay:path.");
+
+// 随机输入数据的种子
+DEFINE_int32(input_seed, 0, "The seed of the random input data.");
+
+// 到达时间的随机种子
+DEFINE_int32(seed, 0, "The seed of the request arrivals.");
+
+// 输出的json文件路径
+DEFINE_string(output_file, "output/npuserve_client_result.json", "The file path to the output json file.");
+
+// 一个请求在客户端记录的时间点和服务端报告的时间
+struct ServeRecord
+{
+    std::chrono::steady_clock::time_point arrival;
+    std::chrono::steady_clock::time_point sent;
+    std::chrono::steady_clock::time_point received;
+    double serverUs = 0;
+    double computeUs = 0;
+    double socketQueueUs = 0;
+    bool replied = false;
+    bool ok = false;
+};
+
+// 发送一个请求并等待回复，用于DESCRIBE、ATTACH和预热
+bool serve_call(int sock, const ServeRequest &request, ServeReply &reply, int fd = -1)
+{
+    if (!serve_send(sock, &request, sizeof(request), fd) || !serve_recv(sock, &reply, sizeof(reply)))
+    {
+        LOG(ERROR) << "The connection to npuserve is closed";
+        return false;
+    }
+    if (reply.status != 0)
+    {
+        reply.error[NPUSERVE_NAME_SIZE - 1] = 0;
+        LOG(ERROR) << "npuserve error: " << reply.error;
+        return false;
+    }
+    return true;
+}
+
+nlohmann::json serve_latency_json(const std::vector<double> &values)
+{
+    nlohmann::json item;
+    item["Mean"] = values.empty() ? 0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    item["P50"] = latency_percentile(values, 50);
+    item["P90"] = latency_percentile(values, 90);
+    item["P99"] = latency_percentile(values, 99);
+    return item;
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;      // 设置日志消息是否转到标准输出而不是日志文件
+    FLAGS_alsologtostderr = true;  // 设置日志消息除了日志文件之外是否去标准输出
+    FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
+    FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
+    FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+
+    InputSpec input_spec;
+    if (!parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec))
+    {
+        LOG(ERROR) << "Unsupported input data: " << FLAGS_input_data;
+        return -1;
+    }
+    if (FLAGS_model.empty() || FLAGS_inflight < 1 || FLAGS_inflight > NPUSERVE_MAX_SLOTS || FLAGS_num_requests < 1)
+    {
+        LOG(ERROR) << "Expected a model, at least 1 request and 1 to " << NPUSERVE_MAX_SLOTS << " requests in flight";
+        return -1;
+    }
+    int sock = serve_connect(FLAGS_socket);
+    if (sock < 0)
+    {
+        LOG(ERROR) << "Cannot connect to npuserve on " << FLAGS_socket << ": " << strerror(errno);
+        return -1;
+    }
+
+    // 查询模型的输入输出，按slot数创建共享内存并交给服务端
+    ServeRequest request = {};
+    ServeReply describe = {};
+    request.op = SERVE_DESCRIBE;
+    serve_copy_name(request.model, FLAGS_model);
+    if (!serve_call(sock, request, describe))
+    {
+        return -1;
+    }
+    describe.backend[NPUSERVE_NAME_SIZE - 1] = 0;
+    std::string backend = describe.backend;
+    uint32_t slots = (uint32_t)FLAGS_inflight;
+    SharedArenaLayout layout(describe, slots);
+    uint8_t *arena = nullptr;
+    int arena_fd = create_shared_arena(layout.total_bytes(), &arena);
+    if (arena_fd < 0)
+    {
+        LOG(ERROR) << "Cannot create the shared memory of " << layout.total_bytes() << " bytes: " << strerror(errno);
+        return -1;
+    }
+    ServeReply reply = {};
+    request.op = SERVE_ATTACH;
+    request.slot = slots;
+    if (!serve_call(sock, request, reply, arena_fd))
+    {
+        return -1;
+    }
+    close(arena_fd);
+
+    std::vector<InputTensorInfo> inputs;
+    for (uint32_t i = 0; i < describe.inputCount; i++)
+    {
+        inputs.push_back({"input_" + std::to_string(i), (InputDataType)describe.inputTypes[i], describe.inputBytes[i]});
+    }
+    InputProvider provider(input_spec);
+    if (!provider.prepare(inputs))
+    {
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        return -1;
+    }
+    // 客户端把当前样本写入slot的输入区，服务端直接从共享内存读取
+    auto fill_slot = [&](uint32_t slot)
+    {
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            provider.copy_to(i, layout.input(arena, slot, i));
+        }
+        provider.next();
+    };
+    LOG(INFO) << "Attached to " << FLAGS_model << " on " << backend << " with " << slots << " slots of " << layout.slotBytes << " bytes";
+
+    request.op = SERVE_INFER;
+    for (int i = 0; i < FLAGS_num_warmup; i++)
+    {
+        request.slot = 0;
+        request.id = i;
+        fill_slot(0);
+        if (!serve_call(sock, request, reply))
+        {
+            return -1;
+        }
+    }
+
+    // 接收线程按回复中的slot释放slot，发送端在每个请求的到达时刻取一个空闲slot发出请求
+    std::vector<ServeRecord> records(FLAGS_num_requests);
+    std::mutex slot_mutex;
+    std::condition_variable slot_cv;
+    std::deque<uint32_t> free_slots;
+    // 连接关闭或发送失败后不再等待slot，发送端随即停止
+    bool closed = false;
+    for (uint32_t slot = 0; slot < slots; slot++)
+    {
+        free_slots.push_back(slot);
+    }
+    std::thread receiver([&]()
+                         {
+        ServeReply message;
+        for (int i = 0; i < FLAGS_num_requests; i++)
+        {
+            if (!serve_recv(sock, &message, sizeof(message)))
+            {
+                LOG(ERROR) << "The connection to npuserve is closed after " << i << " replies";
+                break;
+            }
+            if (message.id >= records.size())
+            {
+                continue;
+            }
+            ServeRecord &record = records[message.id];
+            record.received = std::chrono::steady_clock::now();
+            record.serverUs = message.serverUs;
+            record.computeUs = message.computeUs;
+            record.socketQueueUs = message.socketQueueUs;
+            record.replied = true;
+            record.ok = message.status == 0;
+            std::lock_guard<std::mutex> lock(slot_mutex);
+            free_slots.push_back(message.slot);
+            slot_cv.notify_one();
+        }
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        closed = true;
+        slot_cv.notify_all(); });
+
+    LoadConfig load;
+    load.requestRate = FLAGS_rate;
+    load.numRequests = FLAGS_num_requests;
+    load.seed = (uint32_t)FLAGS_seed;
+    bool send_failed = false;
+    auto start = std::chrono::steady_clock::now();
+    run_open_loop(load, [&](int index, std::chrono::steady_clock::time_point arrival)
+                  {
+        uint32_t slot;
+        {
+            std::unique_lock<std::mutex> lock(slot_mutex);
+            slot_cv.wait(lock, [&]()
+                         { return !free_slots.empty() || closed; });
+            if (closed)
+            {
+                return false;
+            }
+            slot = free_slots.front();
+            free_slots.pop_front();
+        }
+        // 闭环时请求在拿到slot时才到达，等待上一个回复的时间不计入延迟
+        if (FLAGS_rate <= 0)
+        {
+            arrival = std::chrono::steady_clock::now();
+        }
+        fill_slot(slot);
+        ServeRequest infer = {};
+        infer.op = SERVE_INFER;
+        infer.slot = slot;
+        infer.id = (uint64_t)index;
+        records[index].arrival = arrival;
+        records[index].sent = std::chrono::steady_clock::now();
+        infer.sentNs = serve_monotonic_ns();
+        if (!serve_send(sock, &infer, sizeof(infer)))
+        {
+            LOG(ERROR) << "Failed to send request " << index << ": " << strerror(errno);
+            send_failed = true;
+            shutdown(sock, SHUT_RD);
+            return false;
+        }
+        return true; });
+    receiver.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(sock);
+
+    // 延迟 = 计划到达 -> 收到回复，往返 = 发出 -> 收到回复；
+    // 套接字排队 = 请求在套接字中等待同一连接上前面的请求处理完的时间，IPC开销 = 往返 - 服务端时间 - 套接字排队，即两个方向的传递和唤醒；
+    // 服务端排队 = 服务端时间 - 推理时间，主要是等待同一模型上其他连接的推理
+    std::vector<double> latency, round_trip, server, compute, ipc, socket_queue, queue;
+    // 连接中途关闭时没有收到回复(包括没有发出)的请求单独计数
+    int errors = 0;
+    int unanswered = 0;
+    for (const auto &record : records)
+    {
+        if (!record.ok)
+        {
+            (record.replied ? errors : unanswered)++;
+            continue;
+        }
+        latency.push_back(std::chrono::duration<double, std::micro>(record.received - record.arrival).count());
+        round_trip.push_back(std::chrono::duration<double, std::micro>(record.received - record.sent).count());
+        server.push_back(record.serverUs);
+        compute.push_back(record.computeUs);
+        socket_queue.push_back(record.socketQueueUs);
+        ipc.push_back(round_trip.back() - record.serverUs - record.socketQueueUs);
+        queue.push_back(record.serverUs - record.computeUs);
+    }
+    double throughput = elapsed > 0 ? latency.size() / elapsed : 0;
+
+    tabulate::Table serveTable;
+    serveTable.add_row({"stage", "mean(us)", "p50(us)", "p90(us)", "p99(us)"});
+    std::vector<std::pair<std::string, const std::vector<double> *>> stages = {
+        {"latency", &latency}, {"round trip", &round_trip}, {"ipc overhead", &ipc}, {"socket queue", &socket_queue}, {"server", &server}, {"server queue", &queue}, {"compute", &compute}};
+    nlohmann::json serve_result;
+    for (const auto &stage : stages)
+    {
+        nlohmann::json item = serve_latency_json(*stage.second);
+        serveTable.add_row({stage.first, std::to_string(item["Mean"].get<double>()), std::to_string(item["P50"].get<double>()),
+                            std::to_string(item["P90"].get<double>()), std::to_string(item["P99"].get<double>())});
+    }
+    for (size_t i = 0; i < 5; ++i)
+    {
+        serveTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << FLAGS_model << " via npuserve: " << latency.size() << " requests, " << errors << " errors, " << unanswered << " unanswered, " << throughput << " requests/s\n"
+              << serveTable << "\n";
+
+    serve_result["Socket"] = FLAGS_socket;
+    serve_result["RequestRate"] = FLAGS_rate;
+    serve_result["Inflight"] = FLAGS_inflight;
+    serve_result["Requests"] = (int)latency.size();
+    serve_result["Errors"] = errors;
+    serve_result["Unanswered"] = unanswered;
+    serve_result["Throughput"] = throughput;
+    serve_result["Latency"] = serve_latency_json(latency);
+    serve_result["RoundTrip"] = serve_latency_json(round_trip);
+    serve_result["IpcOverhead"] = serve_latency_json(ipc);
+    serve_result["SocketQueue"] = serve_latency_json(socket_queue);
+    serve_result["Server"] = serve_latency_json(server);
+    serve_result["ServerQueue"] = serve_latency_json(queue);
+    serve_result["Compute"] = serve_latency_json(compute);
+
+    BenchmarkSummary summary = summarize_benchmark(logical_model_name(FLAGS_model), "npuserve/" + backend, device_model_name(""), latency);
+    summary.modelFile = FLAGS_model;
+    summary.maxThroughput = throughput;
+    nlohmann::json result;
+    result["MetaInfo"]["Backend"] = backend;
+    result["MetaInfo"]["Model"] = FLAGS_model;
+    result["ServeResult"] = serve_result;
+    result["InputData"] = provider.describe();
+    result["Summary"] = benchmark_summary_json(summary);
+    nlohmann::json all_models_result = nlohmann::json::array();
+    all_models_result.push_back({{FLAGS_model, result}});
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << all_models_result << std::endl;
+    munmap(arena, layout.total_bytes());
+    google::ShutdownGoogleLogging();
+    return errors > 0 || unanswered > 0 || send_failed ? 1 : 0;
+}
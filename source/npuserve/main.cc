@@ -0,0 +1,340 @@
+#include <poll.h>
+#include <signal.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "nlohmann/json.hpp"
+#include "tabulate.hpp"
+#include "BackendLoader.hpp"
+#include "ModelDiscovery.hpp"
+#include "ServeProtocol.hpp"
+
+// 常驻的模型文件或目录，逗号分隔；目录中所有能选出后端的模型都会加载
+DEFINE_string(models, "", "Comma separated model files or directories kept resident by the server.");
+
+// 模型的后端，为空时按扩展名选择
+DEFINE_string(backend, "", "The backend plugin to use, empty to pick it by the model file extension.");
+
+// 传给插件的后端选项(json对象)
+DEFINE_string(backend_options, "{}", "The json object of backend specific options passed to the plugin.");
+
+// 插件目录，为空时为npuserve所在的目录
+DEFINE_string(plugin_dir, "", "The directory of the backend plugins, empty for the directory of npuserve.");
+
+// 模型目录扫描的manifest缓存文件，为空时不缓存
+DEFINE_string(manifest_cache, "", "The manifest cache of the model directory scan, unchanged directories are not listed again. Empty to disable.");
+
+// 监听的UNIX域套接字路径
+DEFINE_string(socket, "/tmp/npuserve.sock", "The path of the UNIX domain socket the server listens on.");
+
+// 常驻模型，同一个模型的请求串行推理
+struct ResidentModel
+{
+    std::string name;
+    std::string backend;
+    std::unique_ptr<BackendModel> model;
+    ServeReply describe = {};
+    std::mutex mutex;
+    uint64_t requests = 0;
+    double computeUs = 0;
+};
+
+std::atomic<bool> stop_server(false);
+// 仍在服务的连接，连接线程分离运行，结束时从中移除；退出时关闭它们的读端并等待全部结束
+std::mutex clients_mutex;
+std::condition_variable clients_cv;
+std::set<int> live_clients;
+
+void handle_signal(int)
+{
+    stop_server = true;
+}
+
+bool load_resident_models(BackendRegistry &registry, const nlohmann::json &options, std::map<std::string, std::unique_ptr<ResidentModel>> &models)
+{
+    std::vector<std::string> paths;
+    std::stringstream stream(FLAGS_models);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+        if (std::filesystem::is_directory(item))
+        {
+            DiscoveryOptions discovery;
+            for (const auto &extension : BACKEND_EXTENSIONS)
+            {
+                if (FLAGS_backend.empty() || extension.second == FLAGS_backend)
+                {
+                    discovery.patterns.push_back(extension.first);
+                }
+            }
+            discovery.siblings = {{".xml", ".bin"}};
+            discovery.cacheFile = FLAGS_manifest_cache;
+            std::vector<std::string> found = discovered_paths(discover_models(item, discovery));
+            paths.insert(paths.end(), found.begin(), found.end());
+        }
+        else
+        {
+            paths.push_back(item);
+        }
+    }
+    for (const auto &path : paths)
+    {
+        std::string backend = FLAGS_backend.empty() ? backend_for_model(path) : FLAGS_backend;
+        std::string name = std::filesystem::path(path).filename().string();
+        if (backend.empty() || models.count(name))
+        {
+            LOG(WARNING) << "Skip " << path << (backend.empty() ? ", no backend for its extension" : ", a model with the same name is resident");
+            continue;
+        }
+        std::shared_ptr<BackendLibrary> library = registry.get(backend);
+        if (!library)
+        {
+            continue;
+        }
+        auto init_start = std::chrono::steady_clock::now();
+        std::unique_ptr<BackendModel> model = BackendModel::load(library, path, options);
+        if (!model)
+        {
+            continue;
+        }
+        if (model->inputs().size() > NPUSERVE_MAX_TENSORS || model->outputs().size() > NPUSERVE_MAX_TENSORS)
+        {
+            LOG(WARNING) << "Skip " << path << ", more than " << NPUSERVE_MAX_TENSORS << " tensors";
+            continue;
+        }
+        std::unique_ptr<ResidentModel> resident(new ResidentModel());
+        resident->name = name;
+        resident->backend = model->meta_info().value("BackendName", backend);
+        serve_copy_name(resident->describe.backend, resident->backend);
+        resident->describe.inputCount = (uint32_t)model->inputs().size();
+        resident->describe.outputCount = (uint32_t)model->outputs().size();
+        for (size_t i = 0; i < model->inputs().size(); i++)
+        {
+            resident->describe.inputTypes[i] = (int32_t)model->inputs()[i].dtype;
+            resident->describe.inputBytes[i] = model->inputs()[i].bytes;
+        }
+        for (size_t i = 0; i < model->outputs().size(); i++)
+        {
+            resident->describe.outputBytes[i] = model->outputs()[i].bytes;
+        }
+        resident->model = std::move(model);
+        LOG(INFO) << "Resident model " << name << " on " << backend << ", loaded in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count() << " ms";
+        models[name] = std::move(resident);
+    }
+    return !models.empty();
+}
+
+// 一个客户端连接: DESCRIBE查询模型，ATTACH传入共享内存，之后每个INFER只携带slot编号
+void serve_connection(int sock, std::map<std::string, std::unique_ptr<ResidentModel>> &models)
+{
+    ResidentModel *attached = nullptr;
+    SharedArenaLayout layout;
+    uint8_t *arena = nullptr;
+    std::vector<const void *> inputs;
+    std::vector<void *> outputs;
+    ServeRequest request;
+    int fd = -1;
+    // 同一连接上的请求按顺序处理，前一个回复发出之前已经发出的请求在套接字中排队
+    int64_t previous_done_ns = 0;
+    while (serve_recv(sock, &request, sizeof(request), &fd))
+    {
+        auto received = std::chrono::steady_clock::now();
+        ServeReply reply = {};
+        reply.id = request.id;
+        reply.slot = request.slot;
+        request.model[NPUSERVE_NAME_SIZE - 1] = 0;
+        if (request.op == SERVE_DESCRIBE || request.op == SERVE_ATTACH)
+        {
+            auto it = models.find(request.model);
+            if (it == models.end())
+            {
+                reply.status = -1;
+                serve_copy_name(reply.error, std::string("no resident model ") + request.model);
+            }
+            else if (request.op == SERVE_DESCRIBE)
+            {
+                reply = it->second->describe;
+                reply.id = request.id;
+            }
+            else
+            {
+                SharedArenaLayout requested(it->second->describe, request.slot);
+                uint8_t *mapped = fd >= 0 && requested.valid() ? map_shared_arena(fd, requested.total_bytes()) : nullptr;
+                if (!requested.valid())
+                {
+                    reply.status = -1;
+                    serve_copy_name(reply.error, "expected 1 to " + std::to_string(NPUSERVE_MAX_SLOTS) + " slots, got " + std::to_string(request.slot));
+                }
+                else if (!mapped)
+                {
+                    reply.status = -1;
+                    serve_copy_name(reply.error, "cannot map the shared memory, expected a memfd sealed with F_SEAL_SHRINK of " + std::to_string(requested.total_bytes()) + " bytes");
+                }
+                else
+                {
+                    if (arena)
+                    {
+                        munmap(arena, layout.total_bytes());
+                    }
+                    attached = it->second.get();
+                    layout = requested;
+                    arena = mapped;
+                    inputs.assign(layout.inputOffsets.size(), nullptr);
+                    outputs.assign(layout.outputOffsets.size(), nullptr);
+                }
+            }
+        }
+        else if (request.op == SERVE_INFER && attached && request.slot < layout.slots)
+        {
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                inputs[i] = layout.input(arena, request.slot, i);
+            }
+            for (size_t i = 0; i < outputs.size(); i++)
+            {
+                outputs[i] = layout.output(arena, request.slot, i);
+            }
+            std::lock_guard<std::mutex> lock(attached->mutex);
+            auto start = std::chrono::steady_clock::now();
+            bool ok = attached->model->inputs_set(inputs) && attached->model->run() && attached->model->outputs_get(outputs);
+            auto end = std::chrono::steady_clock::now();
+            reply.status = ok ? 0 : -1;
+            reply.socketQueueUs = std::max<int64_t>(previous_done_ns - request.sentNs, 0) / 1000.0;
+            reply.computeUs = std::chrono::duration<double, std::micro>(end - start).count();
+            attached->requests++;
+            attached->computeUs += reply.computeUs;
+        }
+        else
+        {
+            reply.status = -1;
+            serve_copy_name(reply.error, attached ? "invalid request" : "no model attached");
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        reply.serverUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - received).count();
+        previous_done_ns = serve_monotonic_ns();
+        if (!serve_send(sock, &reply, sizeof(reply)))
+        {
+            break;
+        }
+    }
+    if (arena)
+    {
+        munmap(arena, layout.total_bytes());
+    }
+    // 在锁内关闭，退出时shutdown的fd不会是已经被复用的fd
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    close(sock);
+    live_clients.erase(sock);
+    clients_cv.notify_all();
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;      // 设置日志消息是否转到标准输出而不是日志文件
+    FLAGS_alsologtostderr = true;  // 设置日志消息除了日志文件之外是否去标准输出
+    FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
+    FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
+    FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+
+    nlohmann::json options = nlohmann::json::parse(FLAGS_backend_options, nullptr, false);
+    if (!options.is_object())
+    {
+        LOG(ERROR) << "Invalid backend options, expected a json object: " << FLAGS_backend_options;
+        return -1;
+    }
+    BackendRegistry registry(FLAGS_plugin_dir);
+    std::map<std::string, std::unique_ptr<ResidentModel>> models;
+    if (!load_resident_models(registry, options, models))
+    {
+        LOG(ERROR) << "No model is resident: " << FLAGS_models;
+        return -1;
+    }
+
+    struct sockaddr_un address;
+    if (!serve_socket_address(FLAGS_socket, address))
+    {
+        LOG(ERROR) << "The socket path is too long: " << FLAGS_socket;
+        return -1;
+    }
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    unlink(FLAGS_socket.c_str());
+    if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 16) != 0)
+    {
+        LOG(ERROR) << "Cannot listen on " << FLAGS_socket << ": " << strerror(errno);
+        return -1;
+    }
+    struct sigaction action = {};
+    action.sa_handler = handle_signal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    LOG(INFO) << "npuserve listening on " << FLAGS_socket << " with " << models.size() << " resident models";
+
+    while (!stop_server)
+    {
+        struct pollfd poll_fd = {listener, POLLIN, 0};
+        if (poll(&poll_fd, 1, 200) <= 0)
+        {
+            continue;
+        }
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            live_clients.insert(client);
+        }
+        std::thread(serve_connection, client, std::ref(models)).detach();
+    }
+    // 关闭所有连接的读端，连接线程处理完当前请求后退出
+    {
+        std::unique_lock<std::mutex> lock(clients_mutex);
+        for (int client : live_clients)
+        {
+            shutdown(client, SHUT_RD);
+        }
+        clients_cv.wait(lock, []()
+                        { return live_clients.empty(); });
+    }
+    close(listener);
+    unlink(FLAGS_socket.c_str());
+
+    tabulate::Table serveTable;
+    serveTable.add_row({"model", "backend", "requests", "avg compute(us)"});
+    for (const auto &item : models)
+    {
+        const ResidentModel &model = *item.second;
+        serveTable.add_row({model.name, model.backend, std::to_string(model.requests), std::to_string(model.requests ? model.computeUs / model.requests : 0)});
+    }
+    for (size_t i = 0; i < 4; ++i)
+    {
+        serveTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "\n"
+              << serveTable << "\n";
+    google::ShutdownGoogleLogging();
+    return 0;
+}
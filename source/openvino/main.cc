@@ -3,20 +3,62 @@
 #include "glog/logging.h"
 #include "gflags/gflags.h"
 #include "Timer.hpp"
+#include "InputProvider.hpp"
+#include "TensorPool.hpp"
+#include "Colocation.hpp"
+#include "Placement.hpp"
+#include "OperatorProfile.hpp"
+#include "Trace.hpp"
+#include "Helper.h"
+#include "ModelDiscovery.hpp"
+#include "BenchmarkSummary.hpp"
+#include "PowerSampler.hpp"
+#include <sstream>
 #include <filesystem>
 #include "tabulate.hpp"
+#include "nlohmann/json.hpp"
+#include <fstream>
 // 定义模型文件的路径
 DEFINE_string(model, "model path", "The file path to the rknn model.");
+
+// 模型目录扫描的manifest缓存文件，目录没有变化时不再重新列出，为空时不缓存
+DEFINE_string(manifest_cache, "", "The manifest cache of the model directory scan, unchanged directories are not listed again. Empty to disable.");
 // DEFINE_string(bin, "bin path", "The file path to the rknn model.");
 DEFINE_string(device, "MYRIAD", "The device to run the model.");
 // 定义预热运行的次数，用于模型初始化或数据预加载
 DEFINE_int32(num_warmup, 1, "The number of warmup runs before actual benchmarking.");
 // 定义实际运行的次数，用于获取模型性能的平均值
 DEFINE_int32(num_run, 10, "The number of runs to measure the model's performance.");
+// 是否对算子进行性能分析，开启后编译时设置ov::enable_profiling(true)，计时结束后再运行num_run次收集每个节点的耗时
+DEFINE_bool(enable_profiling, false, "Flag to enable profiling of individual operations within the model.");
+// 算子级性能分析中输出耗时最多的前N个算子
+DEFINE_int32(profiling_topn, 10, "The number of the slowest operators reported by the operator profiling.");
+// 定义输出文件路径
+DEFINE_string(output_file, "output/openvino_profile_result.json", "The file path to the output json file.");
+// 输入数据: random[:low,high], constant:value 或 replay:目录/逗号分隔的.npy/.raw文件，replay时每轮使用下一份样本
+DEFINE_string(input_data, "random", "The input data: random[:low,high], constant:value or replay:path.");
+// 随机输入的种子
+DEFINE_int32(input_seed, 0, "The seed of the random input data.");
+// 多模型共置场景文件(json)，设置后忽略--model，场景中的priority映射为ov::hint::model_priority，
+// streams映射为ov::num_streams，每个stream一个推理请求，由各自的线程同时发出
+DEFINE_string(scenario, "", "The json scenario file of co-located models, overrides --model.");
+// 放置扫描: 每个模型分别以LATENCY/THROUGHPUT性能模式和逗号分隔的stream数编译运行，结果和推荐的配置写在PlacementResult中
+DEFINE_bool(enable_placement_sweep, false, "Flag to run each model under every performance mode and stream count.");
+DEFINE_string(placement_streams, "1,2,4", "Comma separated ov::num_streams values swept by the placement sweep.");
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译。开启profiling时附带每个节点的轨道
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+// 功耗采样节点(例如INA226的hwmon power1_input)，为空时不采样；scale把读数换算为W，采样得到的平均功率和每次推理的能耗写在Summary中
+DEFINE_string(power_node, "", "The sysfs power node sampled during the timed rounds, empty to disable.");
+DEFINE_double(power_scale, 1e-6, "The scale converting the power node reading to watts, 1e-6 for microwatts.");
+DEFINE_int32(power_interval_ms, 10, "The sampling interval of the power node in milliseconds.");
 
 void query_device();
 void copy_tensor_data(ov::Tensor &dst, const ov::Tensor &src);
-int batch_benchmark(const char *model_path, const char *bin_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results);
+InputDataType to_input_dtype(const ov::element::Type &type);
+int batch_benchmark(const char *model_path, const char *bin_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result);
+int scenario_benchmark(const std::string &path, nlohmann::json &all_models_result);
+int placement_sweep(ov::Core &core, const std::shared_ptr<ov::Model> &model, InputProvider &inputProvider, nlohmann::json &result);
+std::vector<OperatorRecord> collect_operator_profile(ov::InferRequest &inferRequest, int num_run);
 
 int main(int argc, char **argv)
 {
@@ -28,23 +70,42 @@ int main(int argc, char **argv)
     FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
     FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
     FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+    TRACE_THREAD_NAME("main");
     query_device();
     std::string model = FLAGS_model;
     int num_warmup = FLAGS_num_warmup;
     int num_run = FLAGS_num_run;
-    bool enable_profiling = false;
+    bool enable_profiling = FLAGS_enable_profiling;
     bool enable_batch_benchmark = true;
+    InputSpec input_spec;
+    if (!parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec))
+    {
+        LOG(ERROR) << "Unsupported input data: " << FLAGS_input_data;
+        return -1;
+    }
 
     std::vector<std::tuple<std::string, LatencyPerfData>> batch_perf_results;
+    nlohmann::json all_models_result;
 
-    if (std::filesystem::is_regular_file(model))
+    if (!FLAGS_scenario.empty())
+    {
+        if (scenario_benchmark(FLAGS_scenario, all_models_result) < 0)
+        {
+            return -1;
+        }
+        std::filesystem::path output_path(FLAGS_output_file);
+        std::filesystem::create_directories(output_path.parent_path());
+        std::ofstream json_file(FLAGS_output_file);
+        json_file << std::setw(4) << all_models_result << std::endl;
+    }
+    else if (std::filesystem::is_regular_file(model))
     {
         auto bin_path = std::filesystem::path(model);
         bin_path.replace_extension(".bin");
         if (std::filesystem::exists(bin_path))
         {
             batch_benchmark(model.c_str(), bin_path.string().c_str(),
-                            num_warmup, num_run, enable_profiling, batch_perf_results);
+                            num_warmup, num_run, enable_profiling, batch_perf_results, all_models_result);
         }
         else
         {
@@ -56,35 +117,19 @@ int main(int argc, char **argv)
     {
         std::string directoryPath = model;
 
-        // 存储找到的文件名
-        std::vector<std::filesystem::path> modelFiles;
-        std::vector<std::filesystem::path> binFiles;
-
-        // 遍历目录
-        for (const auto &entry : std::filesystem::recursive_directory_iterator(directoryPath))
-        {
-            // LOG(INFO) << "entry: " << entry.path().string();
-            if (entry.is_regular_file() && entry.path().extension() == ".xml")
-            {
-                // 查找对应的bin文件
-                auto binPath = entry.path();
-                binPath.replace_extension(".bin");
-                LOG(INFO) << "binPath: " << binPath.string();
-                if (std::filesystem::exists(binPath))
-                {
-                    binFiles.push_back(binPath);
-                    modelFiles.push_back(entry.path());
-                }
-            }
-        }
+        // 并行扫描目录，每个.xml与同名的.bin配对，没有.bin的.xml被跳过
+        DiscoveryOptions discovery;
+        discovery.patterns = {".xml"};
+        discovery.siblings = {{".xml", ".bin"}};
+        discovery.cacheFile = FLAGS_manifest_cache;
+        std::vector<DiscoveredModel> modelFiles = discover_models(directoryPath, discovery);
 
         // 打印所有找到的文件
-        for (size_t i = 0; i < modelFiles.size(); i++)
+        for (const auto &model_file : modelFiles)
         {
-            const auto &model_file = modelFiles[i];
-            const auto &bin_file = binFiles[i];
-            LOG(INFO) << "model_file: " << model_file.string() << ", bin_file: " << bin_file.string();
-            batch_benchmark(model_file.string().c_str(), bin_file.string().c_str(), num_warmup, num_run, enable_profiling, batch_perf_results);
+            const std::string &bin_file = model_file.siblings[0];
+            LOG(INFO) << "model_file: " << model_file.path << ", bin_file: " << bin_file;
+            batch_benchmark(model_file.path.c_str(), bin_file.c_str(), num_warmup, num_run, enable_profiling, batch_perf_results, all_models_result);
         }
     }
     if (batch_perf_results.size() > 0)
@@ -129,6 +174,17 @@ int main(int argc, char **argv)
         }
         LOG(INFO) << "\n"
                   << profileTable << "\n";
+
+        // 创建输出目录（如果不存在）并保存结果
+        std::filesystem::path output_path(FLAGS_output_file);
+        std::filesystem::create_directories(output_path.parent_path());
+        std::ofstream json_file(FLAGS_output_file);
+        json_file << std::setw(4) << all_models_result << std::endl;
+    }
+
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
     }
 
     google::ShutdownGoogleLogging();
@@ -187,10 +243,31 @@ void copy_tensor_data(ov::Tensor &dst, const ov::Tensor &src)
     memcpy(dst.data(), src.data(), src.get_byte_size());
 }
 
-int batch_benchmark(const char *model_path, const char *bin_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results)
+// 按输入的element type选择数据类型，不支持的类型按字节填充
+InputDataType to_input_dtype(const ov::element::Type &type)
+{
+    if (type == ov::element::f32)
+        return InputDataType::Float32;
+    if (type == ov::element::f16)
+        return InputDataType::Float16;
+    if (type == ov::element::i8)
+        return InputDataType::Int8;
+    if (type == ov::element::i16)
+        return InputDataType::Int16;
+    if (type == ov::element::u16)
+        return InputDataType::Uint16;
+    if (type == ov::element::i32)
+        return InputDataType::Int32;
+    if (type == ov::element::i64)
+        return InputDataType::Int64;
+    if (type == ov::element::boolean)
+        return InputDataType::Bool;
+    return InputDataType::Uint8;
+}
+
+int batch_benchmark(const char *model_path, const char *bin_path, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &all_models_result)
 {
     ov::shutdown();
-    // ov::enable_profiling();
     LOG(INFO) << "Profiling model:" << model_path;
     // -------- Get OpenVINO runtime version --------
     ov::Version version = ov::get_openvino_version();
@@ -200,43 +277,376 @@ int batch_benchmark(const char *model_path, const char *bin_path, int num_warmup
 
     // -------- Step 2. Read a model --------
     LOG(INFO) << "Loading model files: " << model_path;
+    auto init_start = std::chrono::steady_clock::now();
     std::shared_ptr<ov::Model> model = core.read_model(model_path, bin_path);
 
     LOG(INFO) << "Device: " << core.get_versions(FLAGS_device);
 
-    ov::CompiledModel compiledModel = core.compile_model(model, FLAGS_device);
+    // 开启profiling会给每个节点加上计时，计时结果包含这部分开销
+    TRACE_BEGIN("compile_model");
+    ov::CompiledModel compiledModel = core.compile_model(model, FLAGS_device, ov::enable_profiling(enable_profiling));
+    TRACE_END("compile_model");
+    double init_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - init_start).count();
     std::vector<ov::Output<const ov::Node>> modelInputs = compiledModel.inputs();
     std::vector<ov::Output<const ov::Node>> modelOutputs = compiledModel.outputs();
     ov::InferRequest inferRequest = compiledModel.create_infer_request();
+    std::vector<ov::Tensor> inputTensors;
+    nlohmann::json result;
+    uint64_t inputBytes = 0;
+    // 按输入的element type准备输入数据，样本一次性准备好
+    InputSpec inputSpec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, inputSpec);
+    InputProvider inputProvider(inputSpec);
+    std::vector<InputTensorInfo> inputInfos;
+    for (const auto &input : modelInputs)
+    {
+        inputInfos.push_back({input.get_any_name(), to_input_dtype(input.get_element_type()), ov::shape_size(input.get_shape()) * input.get_element_type().size()});
+    }
+    if (!inputProvider.prepare(inputInfos))
+    {
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        return -1;
+    }
+    // host侧输入张量直接包装当前样本，不拷贝
+    auto wrap_inputs = [&]()
+    {
+        for (size_t j = 0; j < modelInputs.size(); j++)
+        {
+            inputTensors[j] = ov::Tensor(modelInputs[j].get_element_type(), modelInputs[j].get_shape(), const_cast<void *>(inputProvider.data(j)));
+        }
+    };
+    inputTensors.resize(modelInputs.size());
+    wrap_inputs();
     for (size_t j = 0; j < modelInputs.size(); j++)
     {
         const auto &input = modelInputs[j];
-        const auto &shape = input.get_shape();
-
-        // 创建随机输入数据
-        size_t input_size = ov::shape_size(shape);
-        std::vector<float> input_data(input_size);
-        // 创建输入张量
-        ov::Tensor input_tensor(input.get_element_type(), shape, input_data.data());
-
         auto requestTensor = inferRequest.get_tensor(input.get_any_name());
-        copy_tensor_data(requestTensor, input_tensor);
+        copy_tensor_data(requestTensor, inputTensors[j]);
+        inputBytes += requestTensor.get_byte_size();
+        result["IOResult"]["Inputs"].push_back({{"Name", input.get_any_name()},
+                                                {"Type", input.get_element_type().get_type_name()},
+                                                {"ByteSize", requestTensor.get_byte_size()}});
+    }
+    // host侧的输出缓冲区来自共享的缓冲池，批量测试时相同大小的缓冲区会被复用
+    std::vector<HostTensor> outputDatas;
+    uint64_t outputBytes = 0;
+    for (size_t j = 0; j < modelOutputs.size(); j++)
+    {
+        auto requestTensor = inferRequest.get_tensor(modelOutputs[j].get_any_name());
+        outputDatas.emplace_back(requestTensor.get_byte_size());
+        outputBytes += requestTensor.get_byte_size();
+        result["IOResult"]["Outputs"].push_back({{"Name", modelOutputs[j].get_any_name()},
+                                                 {"Type", modelOutputs[j].get_element_type().get_type_name()},
+                                                 {"ByteSize", requestTensor.get_byte_size()}});
     }
-    auto benchmark_function = [](ov::InferRequest inferRequest)
+
+    // 单独统计host侧I/O阶段：把host输入拷入请求张量、把输出张量拷回host
+    auto input_function = [](ov::InferRequest *inferRequest, std::vector<ov::Output<const ov::Node>> *modelInputs, std::vector<ov::Tensor> *inputTensors)
+    {
+        for (size_t j = 0; j < modelInputs->size(); j++)
+        {
+            auto requestTensor = inferRequest->get_tensor((*modelInputs)[j].get_any_name());
+            copy_tensor_data(requestTensor, (*inputTensors)[j]);
+        }
+    };
+    auto output_function = [](ov::InferRequest *inferRequest, std::vector<ov::Output<const ov::Node>> *modelOutputs, std::vector<HostTensor> *outputDatas)
+    {
+        for (size_t j = 0; j < modelOutputs->size(); j++)
+        {
+            auto requestTensor = inferRequest->get_tensor((*modelOutputs)[j].get_any_name());
+            memcpy((*outputDatas)[j].data(), requestTensor.data(), requestTensor.get_byte_size());
+        }
+    };
+    Timer input_timer(0, num_run, input_function, &inferRequest, &modelInputs, &inputTensors);
+    input_timer.set_trace_name("set inputs");
+    if (inputProvider.samples() > 1)
+    {
+        input_timer.set_setup([&]()
+                              {
+                                  inputProvider.next();
+                                  wrap_inputs(); });
+    }
+    input_timer.run();
+    auto input_data = input_timer.report_statistics(input_timer.durations_normal_);
+    Timer output_timer(0, num_run, output_function, &inferRequest, &modelOutputs, &outputDatas);
+    output_timer.set_trace_name("get outputs");
+    output_timer.run();
+    auto output_data = output_timer.report_statistics(output_timer.durations_normal_);
+    auto benchmark_function = [](ov::InferRequest &inferRequest)
     {
         inferRequest.infer();
     };
+    Timer timer(num_warmup, num_run, benchmark_function, inferRequest);
+    timer.set_trace_name("infer");
+    // 回放多份样本时，每轮计时前把下一份样本拷入请求张量
+    if (inputProvider.samples() > 1)
+    {
+        timer.set_setup([&]()
+                        {
+                            inputProvider.next();
+                            wrap_inputs();
+                            input_function(&inferRequest, &modelInputs, &inputTensors); });
+    }
+    PowerSampler power_sampler(FLAGS_power_node, FLAGS_power_scale, FLAGS_power_interval_ms);
+    power_sampler.start();
+    timer.run();
+    double power = power_sampler.stop();
     // 释放资源
     modelInputs.clear();
     modelOutputs.clear();
 
     model.reset();
     // compiledModel.reset();
-
-    Timer timer(num_warmup, num_run, benchmark_function, inferRequest);
-    timer.run();
     auto data = timer.report();
     batch_perf_results.push_back(std::make_tuple(model_path, std::get<1>(data)));
+
+    std::string model_name = std::filesystem::path(model_path).filename().string();
+    result["IOResult"]["InputBytes"] = inputBytes;
+    result["InputData"] = inputProvider.describe();
+    result["TensorPool"] = host_tensor_pool().report();
+    result["IOResult"]["OutputBytes"] = outputBytes;
+    result["IOResult"]["AvgInputLatency"] = input_data.mean;
+    result["IOResult"]["AvgOutputLatency"] = output_data.mean;
+    result["IOResult"]["MinInputLatency"] = input_data.min;
+    result["IOResult"]["MinOutputLatency"] = output_data.min;
+    result["MetaInfo"]["BackendName"] = "OpenVINO";
+    result["MetaInfo"]["BackendVersion"] = std::string(version.buildNumber);
+    result["MetaInfo"]["Device"] = FLAGS_device;
+    result["MetaInfo"]["ModelName"] = model_name;
+    result["MetaInfo"]["ModelPath"] = model_path;
+    result["MetaInfo"]["ModelHash"] = model_hash_string(model_file_hash(bin_path, model_file_hash(model_path)));
+    result["RuntimeResult"]["Warmups"] = num_warmup;
+    result["RuntimeResult"]["Rounds"] = num_run;
+    // 计时器自身每轮的开销(空函数体)，需要时可以从各轮延迟中减去
+    result["RuntimeResult"]["TimerOverhead"] = calibrate_timer().mean;
+    result["RuntimeResult"]["AvgTotalRoundLatency"] = std::get<1>(data).mean;
+    result["RuntimeResult"]["StdTotalRoundLatency"] = std::get<1>(data).stdev;
+    result["RuntimeResult"]["MinTotalRoundLatency"] = std::get<1>(data).min;
+    result["RuntimeResult"]["MaxTotalRoundLatency"] = std::get<1>(data).max;
+    result["RuntimeResult"]["InitTime"] = init_time;
+    if (enable_profiling)
+    {
+        std::vector<OperatorRecord> operators = collect_operator_profile(inferRequest, num_run);
+        result["OperatorProfile"] = operator_profile_json(operators, FLAGS_profiling_topn);
+        log_operator_profile(model_name, operators, FLAGS_profiling_topn);
+        // 时间线上放在最后一次profiling推理的位置
+        TRACE_SPANS(model_name + " operators", "infer (profiling)", operator_trace_spans(operators));
+    }
+    if (FLAGS_enable_placement_sweep)
+    {
+        placement_sweep(core, model, inputProvider, result["PlacementResult"]);
+    }
+    // 各后端共同格式的Summary，设备为--device
+    BenchmarkSummary summary = summarize_benchmark(logical_model_name(model_path), "OpenVINO", FLAGS_device, timer.durations_normal_);
+    summary.modelFile = model_name;
+    summary.modelHash = result["MetaInfo"]["ModelHash"];
+    summary.backendVersion = result["MetaInfo"]["BackendVersion"];
+    summary.initTime = init_time;
+    if (result.contains("PlacementResult") && result["PlacementResult"].contains("RecommendedForThroughput"))
+    {
+        summary.maxThroughput = result["PlacementResult"]["RecommendedForThroughput"]["Throughput"];
+    }
+    set_summary_power(summary, power);
+    result["Summary"] = benchmark_summary_json(summary);
+    nlohmann::json model_result;
+    model_result[model_name] = result;
+    all_models_result.push_back(model_result);
     ov::shutdown();
     return 0;
-}
\ No newline at end of file
+}
+
+// 场景中的优先级(0-255)分为三档，对应ov::hint::Priority
+ov::hint::Priority scenario_model_priority(int priority)
+{
+    if (priority >= 170)
+        return ov::hint::Priority::HIGH;
+    if (priority >= 85)
+        return ov::hint::Priority::MEDIUM;
+    return ov::hint::Priority::LOW;
+}
+
+int scenario_benchmark(const std::string &path, nlohmann::json &all_models_result)
+{
+    Scenario scenario;
+    if (!load_scenario(path, scenario))
+    {
+        return -1;
+    }
+    // 所有模型编译到同一个Core和设备上，设备插件按model_priority调度不同模型的请求
+    ov::Core core;
+    std::vector<ov::CompiledModel> compiledModels;
+    // 每个模型max(1, streams)个推理请求，共置测试中每个请求一个线程，多个stream才会同时有请求在运行
+    std::vector<std::vector<ov::InferRequest>> inferRequests;
+    std::vector<std::vector<std::function<void()>>> infers;
+    for (const auto &item : scenario.models)
+    {
+        auto binPath = std::filesystem::path(item.model);
+        binPath.replace_extension(".bin");
+        std::shared_ptr<ov::Model> model = core.read_model(item.model, binPath.string());
+        ov::AnyMap config;
+        config.insert(ov::hint::model_priority(scenario_model_priority(item.priority)));
+        if (item.streams > 0)
+        {
+            config.insert(ov::num_streams(item.streams));
+        }
+        compiledModels.push_back(core.compile_model(model, FLAGS_device, config));
+        inferRequests.emplace_back();
+        for (int stream = 0; stream < std::max(item.streams, 1); stream++)
+        {
+            inferRequests.back().push_back(compiledModels.back().create_infer_request());
+        }
+        LOG(INFO) << "Scenario model " << item.name << ": " << item.model << ", priority " << item.priority << ", streams " << item.streams;
+
+        // 共置测试关注调度，每个模型只准备一份输入，拷入请求的输入张量后每次推理复用
+        std::vector<ov::Output<const ov::Node>> modelInputs = compiledModels.back().inputs();
+        InputSpec inputSpec;
+        parse_input_spec(FLAGS_input_data, FLAGS_input_seed, inputSpec);
+        InputProvider inputProvider(inputSpec);
+        std::vector<InputTensorInfo> inputInfos;
+        for (const auto &input : modelInputs)
+        {
+            inputInfos.push_back({input.get_any_name(), to_input_dtype(input.get_element_type()), ov::shape_size(input.get_shape()) * input.get_element_type().size()});
+        }
+        if (!inputProvider.prepare(inputInfos))
+        {
+            LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+            return -1;
+        }
+        for (auto &inferRequest : inferRequests.back())
+        {
+            for (size_t j = 0; j < modelInputs.size(); j++)
+            {
+                ov::Tensor inputTensor(modelInputs[j].get_element_type(), modelInputs[j].get_shape(), const_cast<void *>(inputProvider.data(j)));
+                auto requestTensor = inferRequest.get_tensor(modelInputs[j].get_any_name());
+                copy_tensor_data(requestTensor, inputTensor);
+            }
+        }
+    }
+    for (auto &requests : inferRequests)
+    {
+        infers.emplace_back();
+        for (auto &inferRequest : requests)
+        {
+            ov::InferRequest *request = &inferRequest;
+            infers.back().push_back([request]()
+                                    { request->infer(); });
+        }
+    }
+
+    nlohmann::json result;
+    result["ColocationResult"] = run_colocation(scenario, infers);
+    for (size_t i = 0; i < scenario.models.size(); i++)
+    {
+        result["ColocationResult"]["Models"][i]["Streams"] = scenario.models[i].streams;
+        result["ColocationResult"]["Models"][i]["InferRequests"] = inferRequests[i].size();
+    }
+    ov::Version version = ov::get_openvino_version();
+    result["MetaInfo"]["BackendName"] = "OpenVINO";
+    result["MetaInfo"]["BackendVersion"] = std::string(version.buildNumber);
+    result["MetaInfo"]["Device"] = FLAGS_device;
+    result["MetaInfo"]["Scenario"] = path;
+    all_models_result.push_back(result);
+    return 0;
+}
+
+// 放置方式: LATENCY模式(单个请求)、THROUGHPUT模式(按设备建议的请求数)、固定stream数(每个stream一个请求)
+std::vector<PlacementConfig> openvino_placements()
+{
+    std::vector<PlacementConfig> configs;
+    configs.push_back({"latency", 1, {{"PerformanceMode", "LATENCY"}}});
+    configs.push_back({"throughput", 1, {{"PerformanceMode", "THROUGHPUT"}}});
+    std::stringstream ss(FLAGS_placement_streams);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        int streams = std::atoi(item.c_str());
+        if (streams > 0)
+        {
+            configs.push_back({"streams" + std::to_string(streams), streams, {{"NumStreams", streams}}});
+        }
+    }
+    return configs;
+}
+
+int placement_sweep(ov::Core &core, const std::shared_ptr<ov::Model> &model, InputProvider &inputProvider, nlohmann::json &result)
+{
+    PlacementSetup setup = [&](const PlacementConfig &config, std::vector<std::function<void()>> &infers)
+    {
+        ov::AnyMap properties;
+        if (config.settings.contains("PerformanceMode"))
+        {
+            bool latency = config.settings["PerformanceMode"] == "LATENCY";
+            properties.insert(ov::hint::performance_mode(latency ? ov::hint::PerformanceMode::LATENCY : ov::hint::PerformanceMode::THROUGHPUT));
+        }
+        if (config.settings.contains("NumStreams"))
+        {
+            properties.insert(ov::num_streams(config.settings["NumStreams"].get<int32_t>()));
+        }
+        std::shared_ptr<ov::CompiledModel> compiledModel;
+        try
+        {
+            compiledModel = std::make_shared<ov::CompiledModel>(core.compile_model(model, FLAGS_device, properties));
+        }
+        catch (const std::exception &ex)
+        {
+            LOG(WARNING) << "Failed to compile with " << config.settings.dump() << ": " << ex.what();
+            return false;
+        }
+        // THROUGHPUT模式的请求数由设备决定
+        int instances = config.instances;
+        if (config.settings.contains("PerformanceMode") && config.settings["PerformanceMode"] == "THROUGHPUT")
+        {
+            instances = std::max<int>(1, compiledModel->get_property(ov::optimal_number_of_infer_requests));
+        }
+        std::vector<ov::Output<const ov::Node>> modelInputs = compiledModel->inputs();
+        for (int instance = 0; instance < instances; instance++)
+        {
+            auto inferRequest = std::make_shared<ov::InferRequest>(compiledModel->create_infer_request());
+            for (size_t j = 0; j < modelInputs.size(); j++)
+            {
+                ov::Tensor inputTensor(modelInputs[j].get_element_type(), modelInputs[j].get_shape(), const_cast<void *>(inputProvider.data(j)));
+                auto requestTensor = inferRequest->get_tensor(modelInputs[j].get_any_name());
+                copy_tensor_data(requestTensor, inputTensor);
+            }
+            // 请求持有编译后的模型，最后一个请求释放时模型随之释放
+            infers.push_back([compiledModel, inferRequest]()
+                             { inferRequest->infer(); });
+        }
+        return true;
+    };
+    std::vector<PlacementResult> results = run_placement_sweep(openvino_placements(), setup, FLAGS_num_warmup, FLAGS_num_run);
+    log_placement_sweep(FLAGS_device, results);
+    result = placement_sweep_json(results);
+    return 0;
+}
+
+// 运行num_run次，每次取get_profiling_info()，按节点名称累积real_time和cpu_time；没有执行或被优化掉的节点不计入
+std::vector<OperatorRecord> collect_operator_profile(ov::InferRequest &inferRequest, int num_run)
+{
+    OperatorSampler sampler;
+    for (int i = 0; i < num_run; i++)
+    {
+        TRACE_BEGIN("infer (profiling)");
+        inferRequest.infer();
+        TRACE_END("infer (profiling)");
+        int id = 0;
+        for (const auto &info : inferRequest.get_profiling_info())
+        {
+            id++;
+            if (info.status != ov::ProfilingInfo::Status::EXECUTED)
+            {
+                continue;
+            }
+            OperatorRecord record;
+            record.id = id;
+            record.name = info.node_name;
+            record.opType = info.node_type;
+            record.execType = info.exec_type;
+            record.target = FLAGS_device;
+            record.timeUs = (double)info.real_time.count();
+            record.cpuTimeUs = (double)info.cpu_time.count();
+            sampler.add(record);
+        }
+    }
+    return sampler.records();
+}
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "nlohmann/json.hpp"
+#include "Placement.hpp"
+#include "SimulatedBackend.hpp"
+#include "Trace.hpp"
+
+// 模拟加速器的核心数
+DEFINE_int32(sim_cores, 3, "The number of cores of the simulated accelerator.");
+
+// 模拟模型的参数，一个请求跨多个核心时每个核心计算sim_compute_us / 核心数，再加上sim_split_overhead比例的同步开销
+DEFINE_int64(sim_input_bytes, 1 * 3 * 224 * 224, "The input size of the simulated model in bytes.");
+DEFINE_int64(sim_output_bytes, 1000 * 4, "The output size of the simulated model in bytes.");
+DEFINE_int32(sim_weight_mb, 8, "The weights read from DDR per simulated inference in MB.");
+DEFINE_double(sim_compute_us, 4000, "The single core compute time of a simulated inference in us.");
+DEFINE_double(sim_split_overhead, 0.2, "The synchronization overhead of splitting one request across cores, as a fraction of the split compute time.");
+
+// 定义预热运行的次数和实际运行的次数(每个上下文)
+DEFINE_int32(num_warmup, 5, "The number of warmup runs per context before actual benchmarking.");
+DEFINE_int32(num_run, 200, "The number of runs per context.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/placement_benchmark.json", "The file path to the output json file.");
+
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+
+// 与rknn2_test相同的分配方式: 每个核心单独运行、一个请求跨多个核心、每个核心一个上下文的数据并行、驱动自动分配
+std::vector<PlacementConfig> simulated_placements(int cores)
+{
+    std::vector<PlacementConfig> configs;
+    for (int core = 0; core < cores; core++)
+    {
+        configs.push_back({"core" + std::to_string(core), 1, {{"Cores", {core}}}});
+    }
+    if (cores > 1)
+    {
+        std::vector<int> all(cores);
+        std::iota(all.begin(), all.end(), 0);
+        configs.push_back({"split" + std::to_string(cores), 1, {{"Cores", all}, {"Split", true}}});
+        nlohmann::json pinned = nlohmann::json::array();
+        for (int core : all)
+        {
+            pinned.push_back({core});
+        }
+        configs.push_back({"dp" + std::to_string(cores), cores, {{"Cores", pinned}}});
+    }
+    configs.push_back({"auto", 1, {{"Cores", nlohmann::json::array()}}});
+    return configs;
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+    FLAGS_alsologtostderr = true;
+    FLAGS_colorlogtostderr = true;
+    FLAGS_log_prefix = true;
+    FLAGS_logbufsecs = 0;
+    TRACE_THREAD_NAME("main");
+
+    SimulatedDevice device(FLAGS_sim_cores);
+    PlacementSetup setup = [&](const PlacementConfig &config, std::vector<std::function<void()>> &infers)
+    {
+        bool split = config.settings.value("Split", false);
+        for (int instance = 0; instance < config.instances; instance++)
+        {
+            // Cores: 单个上下文时为核心列表，数据并行时为每个上下文的核心列表，空列表表示任意核心
+            std::vector<int> cores = config.instances > 1 ? config.settings["Cores"][instance].get<std::vector<int>>() : config.settings["Cores"].get<std::vector<int>>();
+            SimulatedModelConfig model;
+            model.name = "simulated_" + config.name;
+            model.inputBytes = FLAGS_sim_input_bytes;
+            model.outputBytes = FLAGS_sim_output_bytes;
+            model.weightBytes = (size_t)FLAGS_sim_weight_mb * 1024 * 1024;
+            model.computeUs = split ? FLAGS_sim_compute_us / cores.size() * (1 + FLAGS_sim_split_overhead) : FLAGS_sim_compute_us;
+            model.idleCompute = true;
+            std::shared_ptr<SimulatedBackend> backend(new SimulatedBackend(model));
+            if (cores.empty())
+            {
+                cores.push_back(-1);
+            }
+            infers.push_back([backend, cores, &device]()
+                             {
+                backend->inputs_set();
+                std::vector<int> granted;
+                for (int core : cores)
+                {
+                    granted.push_back(device.acquire(0, core));
+                }
+                backend->run();
+                for (int core : granted)
+                {
+                    device.release(core);
+                }
+                backend->outputs_get(); });
+        }
+        return true;
+    };
+
+    std::vector<PlacementResult> results = run_placement_sweep(simulated_placements(FLAGS_sim_cores), setup, FLAGS_num_warmup, FLAGS_num_run);
+    log_placement_sweep("simulated", results);
+
+    SimulatedModelConfig model;
+    model.weightBytes = (size_t)FLAGS_sim_weight_mb * 1024 * 1024;
+    model.computeUs = FLAGS_sim_compute_us;
+    nlohmann::json report;
+    report["MetaInfo"] = SimulatedBackend(model).meta_info();
+    report["Cores"] = FLAGS_sim_cores;
+    report["PlacementResult"] = placement_sweep_json(results);
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << report << std::endl;
+
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
+    }
+
+    google::ShutdownGoogleLogging();
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <random>
+#include <array>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "tabulate.hpp"
+#include "nlohmann/json.hpp"
+#include "Timer.hpp"
+#include "Postprocess.hpp"
+
+// 分类模型的类别数和top-k
+DEFINE_int32(num_classes, 1000, "The number of classes of the classification output.");
+DEFINE_int32(topk, 5, "The k of top-k.");
+
+// 检测模型的输出[4 + det_classes, det_boxes]，YOLOv8的640x640输入对应8400个框
+DEFINE_int32(det_boxes, 8400, "The number of boxes of the detection output.");
+DEFINE_int32(det_classes, 80, "The number of classes of the detection output.");
+// 生成的数据中真实目标的个数，每个目标周围有若干重叠的候选框
+DEFINE_int32(det_objects, 40, "The number of synthetic objects in the detection output.");
+
+// 检测后处理参数
+DEFINE_double(score_threshold, 0.25, "The detection score threshold.");
+DEFINE_double(iou_threshold, 0.45, "The NMS IoU threshold.");
+DEFINE_int32(max_detections, 100, "The maximum number of detections kept by NMS.");
+
+// 预热和测试轮数
+DEFINE_int32(num_warmup, 5, "The number of warmup rounds per kernel.");
+DEFINE_int32(num_run, 50, "The number of measured rounds per kernel.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/postprocess_benchmark.json", "The file path to the output json file.");
+
+struct KernelResult
+{
+    std::string shape;
+    std::string kernel;
+    double refLatency;
+    double simdLatency;
+    size_t mismatches;
+};
+
+double measure(std::function<void()> func)
+{
+    Timer timer(FLAGS_num_warmup, FLAGS_num_run, func);
+    timer.run();
+    return timer.report_statistics(timer.durations_normal_).mean;
+}
+
+// 分别运行标量参考实现和分派后的实现，最后由mismatches比较两者的输出
+KernelResult compare_kernel(const std::string &shapeName, const std::string &kernelName, std::function<void()> ref,
+                            std::function<void()> simd, std::function<size_t()> mismatches)
+{
+    LOG(INFO) << shapeName << " " << kernelName << " (scalar):";
+    double refLatency = measure(ref);
+    LOG(INFO) << shapeName << " " << kernelName << " (" << preprocess_isa() << "):";
+    double simdLatency = measure(simd);
+    return {shapeName, kernelName, refLatency, simdLatency, mismatches()};
+}
+
+size_t count_mismatches(const std::vector<float> &a, const std::vector<float> &b, float tolerance)
+{
+    size_t mismatches = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        mismatches += tolerance == 0 ? memcmp(&a[i], &b[i], sizeof(float)) != 0 : std::fabs(a[i] - b[i]) > tolerance;
+    }
+    return mismatches;
+}
+
+size_t count_mismatches(const std::vector<ScoredIndex> &a, const std::vector<ScoredIndex> &b)
+{
+    size_t mismatches = a.size() > b.size() ? a.size() - b.size() : b.size() - a.size();
+    for (size_t i = 0; i < std::min(a.size(), b.size()); i++)
+    {
+        mismatches += a[i].index != b[i].index || a[i].score != b[i].score;
+    }
+    return mismatches;
+}
+
+size_t count_mismatches(const DetectionBoxes &a, const DetectionBoxes &b)
+{
+    if (a.size() != b.size())
+    {
+        return std::max(a.size(), b.size());
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        mismatches += a.x1[i] != b.x1[i] || a.y1[i] != b.y1[i] || a.x2[i] != b.x2[i] || a.y2[i] != b.y2[i] ||
+                      a.score[i] != b.score[i] || a.classId[i] != b.classId[i];
+    }
+    return mismatches;
+}
+
+// 生成YOLOv8风格的输出[4 + classes, boxes]: 少量框聚集在真实目标周围并带有较高的类别logit，其余为背景
+std::vector<float> generate_detection_output(std::mt19937 &rng, int numBoxes, int numClasses, int numObjects)
+{
+    std::vector<float> data((size_t)(4 + numClasses) * numBoxes);
+    std::uniform_real_distribution<float> position(0.0f, 640.0f);
+    std::uniform_real_distribution<float> size(16.0f, 200.0f);
+    std::uniform_real_distribution<float> background(-9.0f, -3.0f);
+    std::uniform_real_distribution<float> foreground(-1.0f, 5.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> jitter(0.0f, 6.0f);
+    std::uniform_int_distribution<int> classDist(0, numClasses - 1);
+    std::vector<std::array<float, 4>> objects(numObjects);
+    std::vector<int> objectClasses(numObjects);
+    for (int o = 0; o < numObjects; o++)
+    {
+        objects[o] = {position(rng), position(rng), size(rng), size(rng)};
+        objectClasses[o] = classDist(rng);
+    }
+    for (int box = 0; box < numBoxes; box++)
+    {
+        int object = numObjects > 0 && unit(rng) < 0.05f ? (int)(unit(rng) * numObjects) % numObjects : -1;
+        for (int row = 0; row < 4; row++)
+        {
+            data[(size_t)row * numBoxes + box] = object >= 0 ? objects[object][row] + jitter(rng) : (row < 2 ? position(rng) : size(rng));
+        }
+        for (int c = 0; c < numClasses; c++)
+        {
+            data[(size_t)(4 + c) * numBoxes + box] = background(rng);
+        }
+        if (object >= 0)
+        {
+            data[(size_t)(4 + objectClasses[object]) * numBoxes + box] = foreground(rng);
+        }
+    }
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;      // 设置日志消息是否转到标准输出而不是日志文件
+    FLAGS_alsologtostderr = true;  // 设置日志消息除了日志文件之外是否去标准输出
+    FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
+    FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
+    FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+
+    LOG(INFO) << "Post-processing kernels dispatched to: " << preprocess_isa();
+    std::vector<KernelResult> results;
+    std::mt19937 rng(0);
+
+    // 反量化: 按检测输出的元素个数
+    size_t detCount = (size_t)(4 + FLAGS_det_classes) * FLAGS_det_boxes;
+    std::string detShape = std::to_string(4 + FLAGS_det_classes) + "x" + std::to_string(FLAGS_det_boxes);
+    QuantParams quant{0.0173f, -11};
+    std::uniform_int_distribution<int> byteDist(-128, 127);
+    std::vector<int8_t> s8(detCount);
+    std::vector<uint8_t> u8(detCount);
+    std::vector<int16_t> s16(detCount);
+    std::vector<int32_t> s32(detCount);
+    for (size_t i = 0; i < detCount; i++)
+    {
+        s8[i] = (int8_t)byteDist(rng);
+        u8[i] = (uint8_t)(s8[i] + 128);
+        s16[i] = (int16_t)(s8[i] * 211);
+        s32[i] = s8[i] * 70001;
+    }
+    std::vector<float> refOut(detCount), simdOut(detCount);
+    auto compare_dequantize = [&](const std::string &name, auto *src)
+    {
+        results.push_back(compare_kernel(detShape, name, [&]()
+                                         { dequantize_ref(src, refOut.data(), detCount, quant); }, [&]()
+                                         { dequantize(src, simdOut.data(), detCount, quant); }, [&]()
+                                         { return count_mismatches(refOut, simdOut, 0); }));
+    };
+    compare_dequantize("dequantize_int8", s8.data());
+    compare_dequantize("dequantize_uint8", u8.data());
+    compare_dequantize("dequantize_int16", s16.data());
+    compare_dequantize("dequantize_int32", s32.data());
+
+    // 分类: softmax与top-k
+    std::string clsShape = std::to_string(FLAGS_num_classes);
+    std::vector<float> logits(FLAGS_num_classes);
+    std::normal_distribution<float> logitDist(0.0f, 3.0f);
+    for (auto &value : logits)
+    {
+        value = logitDist(rng);
+    }
+    std::vector<float> refProb(logits.size()), simdProb(logits.size());
+    results.push_back(compare_kernel(clsShape, "softmax", [&]()
+                                     { softmax_ref(logits.data(), refProb.data(), logits.size()); }, [&]()
+                                     { softmax(logits.data(), simdProb.data(), logits.size()); }, [&]()
+                                     { return count_mismatches(refProb, simdProb, 1e-6f); }));
+    std::vector<ScoredIndex> refTopk, simdTopk;
+    results.push_back(compare_kernel(clsShape, "top" + std::to_string(FLAGS_topk), [&]()
+                                     { refTopk = topk_ref(logits.data(), logits.size(), FLAGS_topk); }, [&]()
+                                     { simdTopk = topk(logits.data(), logits.size(), FLAGS_topk); }, [&]()
+                                     { return count_mismatches(refTopk, simdTopk); }));
+
+    // 检测: 候选框解码与NMS，分别测试概率输出和logit输出
+    std::vector<float> detection = generate_detection_output(rng, FLAGS_det_boxes, FLAGS_det_classes, FLAGS_det_objects);
+    nlohmann::json detectionSummary;
+    for (bool sigmoid : {true, false})
+    {
+        DetectParams params;
+        params.scoreThreshold = (float)FLAGS_score_threshold;
+        params.iouThreshold = (float)FLAGS_iou_threshold;
+        params.maxDetections = FLAGS_max_detections;
+        params.sigmoid = sigmoid;
+        std::vector<float> scores = detection;
+        if (!sigmoid)
+        {
+            for (size_t i = 4 * (size_t)FLAGS_det_boxes; i < scores.size(); i++)
+            {
+                scores[i] = 1.0f / (1.0f + std::exp(-scores[i]));
+            }
+        }
+        std::string suffix = sigmoid ? "_logit" : "";
+        DetectionBoxes refBoxes, simdBoxes;
+        results.push_back(compare_kernel(detShape, "decode" + suffix, [&]()
+                                         { decode_detections_ref(scores.data(), FLAGS_det_boxes, FLAGS_det_classes, params, refBoxes); }, [&]()
+                                         { decode_detections(scores.data(), FLAGS_det_boxes, FLAGS_det_classes, params, simdBoxes); }, [&]()
+                                         { return count_mismatches(refBoxes, simdBoxes); }));
+        std::vector<ScoredIndex> refKept, simdKept;
+        results.push_back(compare_kernel(detShape, "nms" + suffix, [&]()
+                                         { refKept = nms_ref(refBoxes, params); }, [&]()
+                                         { simdKept = nms(refBoxes, params); }, [&]()
+                                         { return count_mismatches(refKept, simdKept); }));
+        detectionSummary["Candidates" + suffix] = refBoxes.size();
+        detectionSummary["Detections" + suffix] = refKept.size();
+        LOG(INFO) << "decode" << suffix << ": " << refBoxes.size() << " candidates, " << refKept.size() << " detections after NMS";
+    }
+
+    nlohmann::json report;
+    report["Isa"] = preprocess_isa();
+    report["Detection"] = detectionSummary;
+    tabulate::Table kernelTable;
+    kernelTable.add_row({"shape", "kernel", "scalar(us)", preprocess_isa() + "(us)", "speedup", "mismatches"});
+    bool allMatched = true;
+    for (const auto &result : results)
+    {
+        double speedup = result.simdLatency > 0 ? result.refLatency / result.simdLatency : 0;
+        allMatched = allMatched && result.mismatches == 0;
+
+        nlohmann::json item;
+        item["Shape"] = result.shape;
+        item["Kernel"] = result.kernel;
+        item["AvgScalarLatency"] = result.refLatency;
+        item["AvgSimdLatency"] = result.simdLatency;
+        item["Speedup"] = speedup;
+        item["Mismatches"] = result.mismatches;
+        report["Kernels"].push_back(item);
+
+        kernelTable.add_row({result.shape,
+                             result.kernel,
+                             std::to_string(result.refLatency),
+                             std::to_string(result.simdLatency),
+                             std::to_string(speedup),
+                             std::to_string(result.mismatches)});
+    }
+    for (size_t i = 0; i < 6; ++i)
+    {
+        kernelTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "\n"
+              << kernelTable << "\n";
+    if (!allMatched)
+    {
+        LOG(ERROR) << "SIMD kernels do not match the scalar reference.";
+    }
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << report << std::endl;
+
+    google::ShutdownGoogleLogging();
+    return allMatched ? 0 : 1;
+}
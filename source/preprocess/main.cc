@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <string>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "tabulate.hpp"
+#include "nlohmann/json.hpp"
+#include "Timer.hpp"
+#include "Preprocess.hpp"
+#include "ImageProcess.hpp"
+
+// 测试的张量形状(NCHW)，逗号分隔
+DEFINE_string(shapes, "1x3x224x224,1x3x640x640,1x3x1080x1920,1x64x56x56", "Comma separated NCHW tensor shapes, e.g. 1x3x224x224.");
+
+// 图像kernel的测试尺寸，源宽x高:目标宽x高，逗号分隔；为空时跳过图像kernel
+DEFINE_string(image_sizes, "1920x1080:640x640,1280x720:224x224", "Comma separated image sizes, source WxH:destination WxH.");
+
+// 归一化参数，按通道循环使用
+DEFINE_string(mean, "123.675,116.28,103.53", "Comma separated per channel mean.");
+DEFINE_string(std, "58.395,57.12,57.375", "Comma separated per channel std.");
+
+// 量化参数，对应rknn_tensor_attr.scale/zp
+DEFINE_double(quant_scale, 0.0186584, "The int8 quantization scale.");
+DEFINE_int32(quant_zp, -14, "The int8 quantization zero point.");
+
+// 预热和测试轮数
+DEFINE_int32(num_warmup, 5, "The number of warmup rounds per kernel.");
+DEFINE_int32(num_run, 50, "The number of measured rounds per kernel.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/preprocess_benchmark.json", "The file path to the output json file.");
+
+struct KernelResult
+{
+    std::string shape;
+    std::string kernel;
+    double refLatency;
+    double simdLatency;
+    double bytes;
+    size_t mismatches;
+};
+
+std::vector<float> parse_float_list(const std::string &text)
+{
+    std::vector<float> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(std::stof(item));
+        }
+    }
+    return items;
+}
+
+bool parse_shape(const std::string &text, TensorShape4D &shape)
+{
+    std::vector<size_t> dims;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, 'x'))
+    {
+        dims.push_back(std::stoul(item));
+    }
+    if (dims.size() != 4 || std::find(dims.begin(), dims.end(), 0) != dims.end())
+    {
+        return false;
+    }
+    shape.n = dims[0];
+    shape.c = dims[1];
+    shape.h = dims[2];
+    shape.w = dims[3];
+    return true;
+}
+
+bool parse_image_size(const std::string &text, int &width, int &height)
+{
+    size_t pos = text.find('x');
+    if (pos == std::string::npos)
+    {
+        return false;
+    }
+    width = std::stoi(text.substr(0, pos));
+    height = std::stoi(text.substr(pos + 1));
+    return width > 0 && height > 0 && width % 2 == 0 && height % 2 == 0;
+}
+
+double measure(std::function<void()> func)
+{
+    Timer timer(FLAGS_num_warmup, FLAGS_num_run, func);
+    timer.run();
+    return timer.report_statistics(timer.durations_normal_).mean;
+}
+
+template <typename T>
+size_t count_mismatches(const std::vector<T> &a, const std::vector<T> &b)
+{
+    size_t mismatches = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        mismatches += memcmp(&a[i], &b[i], sizeof(T)) != 0;
+    }
+    return mismatches;
+}
+
+// 对同一输入分别运行标量参考实现和分派后的实现，比较耗时并逐元素校验结果
+template <typename SrcT, typename DstT, typename RefFunc, typename SimdFunc>
+KernelResult compare_kernel(const std::string &shapeName, const std::string &kernelName, const std::vector<SrcT> &src, size_t dstCount,
+                            RefFunc &&ref, SimdFunc &&simd)
+{
+    std::vector<DstT> refDst(dstCount), simdDst(dstCount);
+    LOG(INFO) << shapeName << " " << kernelName << " (scalar):";
+    double refLatency = measure([&]()
+                                { ref(src.data(), refDst.data()); });
+    LOG(INFO) << shapeName << " " << kernelName << " (" << preprocess_isa() << "):";
+    double simdLatency = measure([&]()
+                                 { simd(src.data(), simdDst.data()); });
+    return {shapeName, kernelName, refLatency, simdLatency,
+            (double)(src.size() * sizeof(SrcT) + dstCount * sizeof(DstT)), count_mismatches(refDst, simdDst)};
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;      // 设置日志消息是否转到标准输出而不是日志文件
+    FLAGS_alsologtostderr = true;  // 设置日志消息除了日志文件之外是否去标准输出
+    FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
+    FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
+    FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+
+    NormalizeParams params{parse_float_list(FLAGS_mean), parse_float_list(FLAGS_std)};
+    QuantParams quant{(float)FLAGS_quant_scale, FLAGS_quant_zp};
+    LOG(INFO) << "Pre-processing kernels dispatched to: " << preprocess_isa();
+
+    std::vector<KernelResult> results;
+    std::mt19937 rng(0);
+    std::stringstream shapes(FLAGS_shapes);
+    std::string shapeName;
+    while (std::getline(shapes, shapeName, ','))
+    {
+        TensorShape4D shape;
+        if (!parse_shape(shapeName, shape))
+        {
+            LOG(ERROR) << "Invalid shape: " << shapeName;
+            continue;
+        }
+        size_t count = shape.count();
+        std::vector<uint8_t> image(count);
+        std::uniform_int_distribution<int> byteDist(0, 255);
+        for (auto &value : image)
+        {
+            value = byteDist(rng);
+        }
+        std::vector<float> feature(count);
+        std::uniform_real_distribution<float> floatDist(-3.0f, 3.0f);
+        for (auto &value : feature)
+        {
+            value = floatDist(rng);
+        }
+
+        results.push_back(compare_kernel<uint8_t, uint8_t>(shapeName, "nchw_to_nhwc_u8", image, count, [&](const uint8_t *s, uint8_t *d)
+                                                          { nchw_to_nhwc_ref(s, d, shape); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { nchw_to_nhwc(s, d, shape); }));
+        results.push_back(compare_kernel<uint8_t, uint8_t>(shapeName, "nhwc_to_nchw_u8", image, count, [&](const uint8_t *s, uint8_t *d)
+                                                          { nhwc_to_nchw_ref(s, d, shape); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { nhwc_to_nchw(s, d, shape); }));
+        results.push_back(compare_kernel<float, float>(shapeName, "nchw_to_nhwc_fp32", feature, count, [&](const float *s, float *d)
+                                                      { nchw_to_nhwc_ref(s, d, shape); }, [&](const float *s, float *d)
+                                                      { nchw_to_nhwc(s, d, shape); }));
+        results.push_back(compare_kernel<float, float>(shapeName, "nhwc_to_nchw_fp32", feature, count, [&](const float *s, float *d)
+                                                      { nhwc_to_nchw_ref(s, d, shape); }, [&](const float *s, float *d)
+                                                      { nhwc_to_nchw(s, d, shape); }));
+        results.push_back(compare_kernel<uint8_t, float>(shapeName, "normalize_fp32_nhwc", image, count, [&](const uint8_t *s, float *d)
+                                                        { normalize_to_fp32_ref(s, d, shape, PreprocessLayout::NHWC, params); }, [&](const uint8_t *s, float *d)
+                                                        { normalize_to_fp32(s, d, shape, PreprocessLayout::NHWC, params); }));
+        results.push_back(compare_kernel<uint8_t, float>(shapeName, "normalize_fp32_nchw", image, count, [&](const uint8_t *s, float *d)
+                                                        { normalize_to_fp32_ref(s, d, shape, PreprocessLayout::NCHW, params); }, [&](const uint8_t *s, float *d)
+                                                        { normalize_to_fp32(s, d, shape, PreprocessLayout::NCHW, params); }));
+        results.push_back(compare_kernel<uint8_t, uint16_t>(shapeName, "normalize_fp16_nhwc", image, count, [&](const uint8_t *s, uint16_t *d)
+                                                           { normalize_to_fp16_ref(s, d, shape, PreprocessLayout::NHWC, params); }, [&](const uint8_t *s, uint16_t *d)
+                                                           { normalize_to_fp16(s, d, shape, PreprocessLayout::NHWC, params); }));
+        results.push_back(compare_kernel<float, int8_t>(shapeName, "quantize_int8", feature, count, [&](const float *s, int8_t *d)
+                                                       { quantize_to_int8_ref(s, d, count, quant); }, [&](const float *s, int8_t *d)
+                                                       { quantize_to_int8(s, d, count, quant); }));
+        results.push_back(compare_kernel<uint8_t, int8_t>(shapeName, "normalize_quantize_int8", image, count, [&](const uint8_t *s, int8_t *d)
+                                                         { normalize_quantize_to_int8_ref(s, d, shape, PreprocessLayout::NHWC, params, quant); }, [&](const uint8_t *s, int8_t *d)
+                                                         { normalize_quantize_to_int8(s, d, shape, PreprocessLayout::NHWC, params, quant); }));
+    }
+
+    std::stringstream imageSizes(FLAGS_image_sizes);
+    std::string sizeName;
+    while (std::getline(imageSizes, sizeName, ','))
+    {
+        int srcW, srcH, dstW, dstH;
+        size_t colon = sizeName.find(':');
+        if (colon == std::string::npos || !parse_image_size(sizeName.substr(0, colon), srcW, srcH) ||
+            !parse_image_size(sizeName.substr(colon + 1), dstW, dstH))
+        {
+            LOG(ERROR) << "Invalid image size: " << sizeName;
+            continue;
+        }
+        size_t srcPixels = (size_t)srcW * srcH;
+        size_t dstPixels = (size_t)dstW * dstH;
+        std::uniform_int_distribution<int> byteDist(0, 255);
+        std::vector<uint8_t> nv12(srcPixels * 3 / 2);
+        for (auto &value : nv12)
+        {
+            value = byteDist(rng);
+        }
+        std::vector<uint8_t> rgb(srcPixels * 3);
+        for (auto &value : rgb)
+        {
+            value = byteDist(rng);
+        }
+        // 以短边为边长的居中正方形裁剪，坐标取偶数以兼容NV12
+        int side = std::min(srcW, srcH) & ~1;
+        ImageRect crop{((srcW - side) / 2) & ~1, ((srcH - side) / 2) & ~1, side, side};
+
+        results.push_back(compare_kernel<uint8_t, uint8_t>(sizeName, "nv12_to_rgb", nv12, srcPixels * 3, [&](const uint8_t *s, uint8_t *d)
+                                                          { nv12_to_rgb_ref(s, srcW, s + srcPixels, srcW, srcW, srcH, d, srcW * 3, false); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { nv12_to_rgb(s, srcW, s + srcPixels, srcW, srcW, srcH, d, srcW * 3, false); }));
+        results.push_back(compare_kernel<uint8_t, uint8_t>(sizeName, "nv12_to_bgr", nv12, srcPixels * 3, [&](const uint8_t *s, uint8_t *d)
+                                                          { nv12_to_rgb_ref(s, srcW, s + srcPixels, srcW, srcW, srcH, d, srcW * 3, true); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { nv12_to_rgb(s, srcW, s + srcPixels, srcW, srcW, srcH, d, srcW * 3, true); }));
+        results.push_back(compare_kernel<uint8_t, uint8_t>(sizeName, "rgb_to_nv12", rgb, srcPixels * 3 / 2, [&](const uint8_t *s, uint8_t *d)
+                                                          { rgb_to_nv12_ref(s, srcW * 3, srcW, srcH, d, srcW, d + srcPixels, srcW, false); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { rgb_to_nv12(s, srcW * 3, srcW, srcH, d, srcW, d + srcPixels, srcW, false); }));
+        results.push_back(compare_kernel<uint8_t, uint8_t>(sizeName, "resize_rgb", rgb, dstPixels * 3, [&](const uint8_t *s, uint8_t *d)
+                                                          { resize_bilinear_ref(s, srcW, srcH, srcW * 3, 3, {}, d, dstW, dstH, dstW * 3); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { resize_bilinear(s, srcW, srcH, srcW * 3, 3, {}, d, dstW, dstH, dstW * 3); }));
+        results.push_back(compare_kernel<uint8_t, uint8_t>(sizeName, "crop_resize_rgb", rgb, dstPixels * 3, [&](const uint8_t *s, uint8_t *d)
+                                                          { resize_bilinear_ref(s, srcW, srcH, srcW * 3, 3, crop, d, dstW, dstH, dstW * 3); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { resize_bilinear(s, srcW, srcH, srcW * 3, 3, crop, d, dstW, dstH, dstW * 3); }));
+        results.push_back(compare_kernel<uint8_t, uint8_t>(sizeName, "resize_nv12", nv12, dstPixels * 3 / 2, [&](const uint8_t *s, uint8_t *d)
+                                                          { resize_nv12(s, srcW, s + srcPixels, srcW, srcW, srcH, {}, d, dstW, d + dstPixels, dstW, dstW, dstH, true); }, [&](const uint8_t *s, uint8_t *d)
+                                                          { resize_nv12(s, srcW, s + srcPixels, srcW, srcW, srcH, {}, d, dstW, d + dstPixels, dstW, dstW, dstH); }));
+    }
+
+    nlohmann::json report;
+    report["Isa"] = preprocess_isa();
+    tabulate::Table kernelTable;
+    kernelTable.add_row({"shape", "kernel", "scalar(us)", preprocess_isa() + "(us)", "speedup", "MB/s", "mismatches"});
+    bool allMatched = true;
+    for (const auto &result : results)
+    {
+        double speedup = result.simdLatency > 0 ? result.refLatency / result.simdLatency : 0;
+        // bytes / us == MB/s
+        double bandwidth = result.simdLatency > 0 ? result.bytes / result.simdLatency : 0;
+        allMatched = allMatched && result.mismatches == 0;
+
+        nlohmann::json item;
+        item["Shape"] = result.shape;
+        item["Kernel"] = result.kernel;
+        item["AvgScalarLatency"] = result.refLatency;
+        item["AvgSimdLatency"] = result.simdLatency;
+        item["Speedup"] = speedup;
+        item["SimdMBps"] = bandwidth;
+        item["Mismatches"] = result.mismatches;
+        report["Kernels"].push_back(item);
+
+        kernelTable.add_row({result.shape,
+                             result.kernel,
+                             std::to_string(result.refLatency),
+                             std::to_string(result.simdLatency),
+                             std::to_string(speedup),
+                             std::to_string(bandwidth),
+                             std::to_string(result.mismatches)});
+    }
+    for (size_t i = 0; i < 7; ++i)
+    {
+        kernelTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "\n"
+              << kernelTable << "\n";
+    if (!allMatched)
+    {
+        LOG(ERROR) << "SIMD kernels do not match the scalar reference.";
+    }
+
+    std::filesystem::path output_path(FLAGS_output_file);
+    if (output_path.has_parent_path())
+    {
+        std::filesystem::create_directories(output_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << report << std::endl;
+
+    google::ShutdownGoogleLogging();
+    return allMatched ? 0 : 1;
+}
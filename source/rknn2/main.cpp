@@ -7,6 +7,18 @@
 #include "gflags/gflags.h"
 #include "rknn_api.h"
 #include "Timer.hpp"
+#include "Postprocess.hpp"
+#include "InputProvider.hpp"
+#include "TensorPool.hpp"
+#include "DynamicBatcher.hpp"
+#include "Colocation.hpp"
+#include "Placement.hpp"
+#include "RknnPerfDetail.hpp"
+#include "Trace.hpp"
+#include "Helper.h"
+#include "ModelDiscovery.hpp"
+#include "BenchmarkSummary.hpp"
+#include "PowerSampler.hpp"
 #include <tuple>
 #include <vector>
 #include "tabulate.hpp"
@@ -17,6 +29,9 @@
 // 定义模型文件的路径
 DEFINE_string(model, "path", "The file path to the rknn model.");
 
+// 模型目录扫描的manifest缓存文件，目录没有变化时不再重新列出，为空时不缓存
+DEFINE_string(manifest_cache, "", "The manifest cache of the model directory scan, unchanged directories are not listed again. Empty to disable.");
+
 // 定义预热运行的次数，用于模型初始化或数据预加载
 DEFINE_int32(num_warmup, 10, "The number of warmup runs before actual benchmarking.");
 
@@ -29,6 +44,50 @@ DEFINE_string(output_file, "output/rknn_profile_result.json", "The file path to
 // 是否对操作进行性能分析，如果设置为true，将输出操作级别的性能数据
 DEFINE_bool(enable_profiling, false, "Flag to enable profiling of individual operations within the model.");
 
+// 算子级性能分析中输出耗时最多的前N个算子
+DEFINE_int32(profiling_topn, 10, "The number of the slowest operators reported by the operator profiling.");
+
+// 后处理阶段: none, classify(softmax + top-k), detect(YOLOv8风格[4 + classes, boxes]输出的解码 + NMS)
+DEFINE_string(postprocess, "none", "The post-processing phase timed after rknn_outputs_get: none, classify or detect.");
+
+// 分类后处理的top-k
+DEFINE_int32(postprocess_topk, 5, "The k of the classify post-processing.");
+
+// 检测后处理参数，score_sigmoid表示类别分数是logit
+DEFINE_double(score_threshold, 0.25, "The detection score threshold.");
+DEFINE_double(iou_threshold, 0.45, "The NMS IoU threshold.");
+DEFINE_int32(max_detections, 100, "The maximum number of detections kept by NMS.");
+DEFINE_bool(score_sigmoid, false, "Flag to apply sigmoid to the detection class scores.");
+
+// 输入数据: random[:low,high], constant:value 或 replay:目录/逗号分隔的.npy/.raw文件，replay时每轮使用下一份样本
+DEFINE_string(input_data, "random", "The input data: random[:low,high], constant:value or replay:path.");
+
+// 随机输入的种子
+DEFINE_int32(input_seed, 0, "The seed of the random input data.");
+
+// 输出缓冲区使用2MB大页
+DEFINE_bool(enable_hugepage, false, "Flag to back the output buffers with huge pages.");
+
+// 动态批处理: 模型的batch维(dims[0])大于1时，按逗号分隔的max_delay_us逐个测量开环负载下的延迟/吞吐，为空时不测
+DEFINE_string(batch_delays, "", "Comma separated max queue delays in us for the dynamic batching curve, empty to disable.");
+DEFINE_double(batch_request_rate, 100, "The Poisson arrival rate of the batching load in requests per second.");
+DEFINE_int32(batch_requests, 500, "The number of requests per batching curve point.");
+
+// 多模型共置场景文件(json)，设置后忽略--model，按场景中的速率同时运行多个模型，对比单独运行和共置运行的延迟分位数
+DEFINE_string(scenario, "", "The json scenario file of co-located models, overrides --model.");
+
+// 放置扫描: 每个模型在每种核心分配方式下运行，结果和推荐的配置写在PlacementResult中；placement_cores为NPU核心数(RK3588为3)
+DEFINE_bool(enable_placement_sweep, false, "Flag to run each model under every NPU core assignment.");
+DEFINE_int32(placement_cores, 3, "The number of NPU cores swept by the placement sweep.");
+
+// 时间线跟踪文件(Chrome trace-event json)，为空时不导出；需要用-DENABLE_TRACE=ON编译。开启profiling时附带每个算子的轨道
+DEFINE_string(trace_file, "", "The file path to the Chrome trace json of the run, empty to disable. Requires ENABLE_TRACE.");
+
+// 功耗采样节点(例如INA226的hwmon power1_input)，为空时不采样；scale把读数换算为W，采样得到的平均功率和每次推理的能耗写在Summary中
+DEFINE_string(power_node, "", "The sysfs power node sampled during the timed rounds, empty to disable.");
+DEFINE_double(power_scale, 1e-6, "The scale converting the power node reading to watts, 1e-6 for microwatts.");
+DEFINE_int32(power_interval_ms, 10, "The sampling interval of the power node in milliseconds.");
+
 static void dump_tensor_attr(rknn_tensor_attr *attr, bool is_input = true)
 {
     std::string tensor_type = is_input ? "input tensor" : "output tensor";
@@ -36,8 +95,78 @@ static void dump_tensor_attr(rknn_tensor_attr *attr, bool is_input = true)
               << ", dims=[" << attr->dims[0] << ", " << attr->dims[1] << ", " << attr->dims[2] << ", " << attr->dims[3] << "], fmt=" << get_format_string(attr->fmt) << ", n_elems=" << attr->n_elems << ", size=" << attr->size << ", type=" << get_type_string(attr->type) << ", qnt_type=" << get_qnt_type_string(attr->qnt_type) << ", zp=" << attr->zp << ", scale=" << attr->scale;
 }
 
+// 按输出的类型和量化方式反量化为fp32，不支持的类型返回false
+static bool dequantize_output(const rknn_tensor_attr &attr, const void *buf, float *dst)
+{
+    QuantParams quant;
+    if (attr.qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC)
+    {
+        quant = QuantParams{attr.scale, attr.zp};
+    }
+    else if (attr.qnt_type == RKNN_TENSOR_QNT_DFP)
+    {
+        quant = QuantParams{std::ldexp(1.0f, -attr.fl), 0};
+    }
+    switch (attr.type)
+    {
+    case RKNN_TENSOR_INT8:
+        dequantize((const int8_t *)buf, dst, attr.n_elems, quant);
+        return true;
+    case RKNN_TENSOR_UINT8:
+        dequantize((const uint8_t *)buf, dst, attr.n_elems, quant);
+        return true;
+    case RKNN_TENSOR_INT16:
+        dequantize((const int16_t *)buf, dst, attr.n_elems, quant);
+        return true;
+    case RKNN_TENSOR_INT32:
+        dequantize((const int32_t *)buf, dst, attr.n_elems, quant);
+        return true;
+    case RKNN_TENSOR_FLOAT32:
+        memcpy(dst, buf, attr.n_elems * sizeof(float));
+        return true;
+    case RKNN_TENSOR_FLOAT16:
+        for (uint32_t i = 0; i < attr.n_elems; i++)
+        {
+            dst[i] = half_to_float(((const uint16_t *)buf)[i]);
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+static InputDataType to_input_dtype(rknn_tensor_type type)
+{
+    switch (type)
+    {
+    case RKNN_TENSOR_FLOAT32:
+        return InputDataType::Float32;
+    case RKNN_TENSOR_FLOAT16:
+        return InputDataType::Float16;
+    case RKNN_TENSOR_INT8:
+        return InputDataType::Int8;
+    case RKNN_TENSOR_INT16:
+        return InputDataType::Int16;
+    case RKNN_TENSOR_UINT16:
+        return InputDataType::Uint16;
+    case RKNN_TENSOR_INT32:
+    case RKNN_TENSOR_UINT32:
+        return InputDataType::Int32;
+    case RKNN_TENSOR_INT64:
+        return InputDataType::Int64;
+    case RKNN_TENSOR_BOOL:
+        return InputDataType::Bool;
+    default:
+        return InputDataType::Uint8;
+    }
+}
+
 int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_profiling, std::vector<std::tuple<std::string, LatencyPerfData>> &batch_perf_results, nlohmann::json &result);
 
+int scenario_benchmark(const std::string &path, nlohmann::json &result);
+
+int placement_sweep(const char *model, nlohmann::json &result);
+
 int main(int argc, char *argv[])
 {
     gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
@@ -47,35 +176,54 @@ int main(int argc, char *argv[])
     FLAGS_colorlogtostderr = true;
     FLAGS_log_prefix = true;
     FLAGS_logbufsecs = 0;
+    TRACE_THREAD_NAME("main");
 
     std::string model_path = FLAGS_model;
     int num_warmup = FLAGS_num_warmup;
     int num_run = FLAGS_num_run;
     bool enable_profiling = FLAGS_enable_profiling;
+    PostprocessMode postprocess_mode;
+    if (!parse_postprocess_mode(FLAGS_postprocess, postprocess_mode))
+    {
+        LOG(ERROR) << "Unsupported post-processing mode: " << FLAGS_postprocess;
+        return -1;
+    }
+    InputSpec input_spec;
+    if (!parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec))
+    {
+        LOG(ERROR) << "Unsupported input data: " << FLAGS_input_data;
+        return -1;
+    }
+    if (FLAGS_placement_cores < 1 || FLAGS_placement_cores > 3)
+    {
+        LOG(ERROR) << "Expected 1 to 3 placement cores, got " << FLAGS_placement_cores;
+        return -1;
+    }
 
     std::vector<std::tuple<std::string, LatencyPerfData>> batch_perf_results;
     nlohmann::json all_models_result;  // 创建总的JSON对象
 
-    // 检查输入路径是否为目录
-    if (std::filesystem::is_directory(model_path))
+    if (!FLAGS_scenario.empty())
     {
-        // 存储找到的文件名
-        std::vector<std::filesystem::path> rknn_files;
-
-        // 遍历目录查找.rknn文件
-        for (const auto &entry : std::filesystem::recursive_directory_iterator(model_path))
+        if (scenario_benchmark(FLAGS_scenario, all_models_result) < 0)
         {
-            if (entry.is_regular_file() && entry.path().extension() == ".rknn")
-            {
-                rknn_files.push_back(entry.path());
-            }
+            return -1;
         }
+    }
+    // 检查输入路径是否为目录
+    else if (std::filesystem::is_directory(model_path))
+    {
+        // 并行扫描目录查找.rknn文件
+        DiscoveryOptions discovery;
+        discovery.patterns = {".rknn"};
+        discovery.cacheFile = FLAGS_manifest_cache;
+        std::vector<std::string> rknn_files = discovered_paths(discover_models(model_path, discovery));
 
         // 对每个找到的模型文件进行测试
         for (const auto &file : rknn_files)
         {
             nlohmann::json model_result;  // 单个模型的结果
-            batch_benchmark(file.string().c_str(), num_warmup, num_run, enable_profiling, batch_perf_results, model_result);
+            batch_benchmark(file.c_str(), num_warmup, num_run, enable_profiling, batch_perf_results, model_result);
             all_models_result.push_back(model_result);  // 添加到总结果中
         }
     }
@@ -95,6 +243,11 @@ int main(int argc, char *argv[])
     std::ofstream json_file(FLAGS_output_file);
     json_file << std::setw(4) << all_models_result << std::endl;
 
+    if (!FLAGS_trace_file.empty())
+    {
+        write_chrome_trace(FLAGS_trace_file);
+    }
+
     google::ShutdownGoogleLogging();
     return 0;
 }
@@ -109,7 +262,9 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
     
     // 添加初始化时间统计
     auto init_start = std::chrono::high_resolution_clock::now();
+    TRACE_BEGIN("rknn_init");
     int ret = rknn_init(&ctx, (void *)model, 0, flag, nullptr);
+    TRACE_END("rknn_init");
     auto init_end = std::chrono::high_resolution_clock::now();
     double init_time = std::chrono::duration<double, std::milli>(init_end - init_start).count();
 
@@ -139,6 +294,7 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
     if (ret != RKNN_SUCC)
     {
         LOG(ERROR) << "rknn_query fail! ret=" << ret << "\n";
+        rknn_destroy(ctx);
         return -1;
     }
     LOG(INFO) << "model input num: " << io_num.n_input << ", output num: " << io_num.n_output;
@@ -154,6 +310,7 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
         {
             LOG(ERROR) << "rknn_query fail! ret="
                        << ret << "\n";
+            rknn_destroy(ctx);
             return -1;
         }
         dump_tensor_attr(&(input_attrs[i]), true);
@@ -161,13 +318,47 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
         inputs[i].type = input_attrs[i].type;
         inputs[i].size = input_attrs[i].size;
         inputs[i].fmt = input_attrs[i].fmt;
-        inputs[i].buf = malloc(inputs[i].size);
     }
+    // 输入数据由InputProvider提供，样本在这里一次性准备好，rknn_inputs_set会拷贝数据，buf只需指向当前样本
+    InputSpec input_spec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec);
+    InputProvider input_provider(input_spec);
+    std::vector<InputTensorInfo> input_infos;
+    for (int i = 0; i < io_num.n_input; i++)
+    {
+        input_infos.push_back({input_attrs[i].name, to_input_dtype(input_attrs[i].type), input_attrs[i].size});
+    }
+    if (!input_provider.prepare(input_infos))
+    {
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        rknn_destroy(ctx);
+        return -1;
+    }
+    auto bind_inputs = [&]()
+    {
+        for (int i = 0; i < io_num.n_input; i++)
+        {
+            inputs[i].buf = const_cast<void *>(input_provider.data(i));
+        }
+    };
+    bind_inputs();
     // Get Model Output Info
     rknn_tensor_attr output_attrs[io_num.n_output];
     memset(output_attrs, 0, sizeof(output_attrs));
     rknn_output outputs[io_num.n_output];
     memset(outputs, 0, sizeof(outputs));
+    // 输出缓冲区从共享的host缓冲池中取，批量测试多个模型时相同大小的缓冲区会被复用
+    std::vector<PoolKey> output_keys(io_num.n_output);
+    MemoryKind output_kind = FLAGS_enable_hugepage ? MemoryKind::HostHugePage : MemoryKind::Host;
+    // 出错返回时归还前count个输出缓冲区并释放上下文
+    auto release_context = [&](int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            host_tensor_pool().release(output_keys[i], outputs[i].buf);
+        }
+        rknn_destroy(ctx);
+    };
     for (int i = 0; i < io_num.n_output; i++)
     {
         output_attrs[i].index = i;
@@ -176,11 +367,16 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
         {
             LOG(ERROR) << "rknn_query fail! ret="
                        << ret << "\n";
+            release_context(i);
             return -1;
         }
         outputs[i].index = output_attrs[i].index;
         outputs[i].size = output_attrs[i].size;
-        outputs[i].buf = malloc(output_attrs[i].size);
+        if (!host_tensor_pool().acquire(output_attrs[i].size, CACHE_LINE_SIZE, output_kind, outputs[i].buf, output_keys[i]))
+        {
+            release_context(i);
+            return -1;
+        }
         outputs[i].is_prealloc = true;
         dump_tensor_attr(&(output_attrs[i]), false);
     }
@@ -190,6 +386,7 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
     {
         LOG(ERROR) << "rknn_input_set fail! ret=" << ret << "\n";
         // printf("rknn_input_set fail! ret=%d\n", ret);
+        release_context(io_num.n_output);
         return -1;
     }
     auto benchmark_function = [](rknn_context ctx)
@@ -203,8 +400,21 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
         }
     };
     Timer timer(num_warmup, num_run, benchmark_function, ctx);
+    timer.set_trace_name("rknn_run");
+    // 回放多份样本时，每轮计时前切换到下一份样本并设置输入
+    if (input_provider.samples() > 1)
+    {
+        timer.set_setup([&]()
+                        {
+                            input_provider.next();
+                            bind_inputs();
+                            rknn_inputs_set(ctx, io_num.n_input, inputs); });
+    }
 
+    PowerSampler power_sampler(FLAGS_power_node, FLAGS_power_scale, FLAGS_power_interval_ms);
+    power_sampler.start();
     timer.run();
+    double power = power_sampler.stop();
     auto data = timer.report();
     batch_perf_results.push_back(std::make_tuple(model, std::get<1>(data)));
 
@@ -214,6 +424,207 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
         LOG(ERROR) << "rknn_outputs_get fail! ret=" << ret << "\n";
         // printf("rknn_outputs_get fail! ret=%d\n", ret);
     }
+
+    // 单独统计host侧I/O阶段：rknn_inputs_set把输入拷贝/转换到NPU内存，rknn_outputs_get把输出拷回host
+    auto input_set_function = [](rknn_context ctx, uint32_t n_input, rknn_input *inputs)
+    {
+        int ret = rknn_inputs_set(ctx, n_input, inputs);
+        if (ret < 0)
+        {
+            LOG(ERROR) << "rknn_inputs_set fail! ret=" << ret << "\n";
+        }
+    };
+    auto output_get_function = [](rknn_context ctx, uint32_t n_output, rknn_output *outputs)
+    {
+        int ret = rknn_outputs_get(ctx, n_output, outputs, nullptr);
+        if (ret < 0)
+        {
+            LOG(ERROR) << "rknn_outputs_get fail! ret=" << ret << "\n";
+        }
+        rknn_outputs_release(ctx, n_output, outputs);
+    };
+    Timer input_timer(0, num_run, input_set_function, ctx, io_num.n_input, &inputs[0]);
+    input_timer.set_trace_name("rknn_inputs_set");
+    if (input_provider.samples() > 1)
+    {
+        input_timer.set_setup([&]()
+                              {
+                                  input_provider.next();
+                                  bind_inputs(); });
+    }
+    input_timer.run();
+    auto input_data = input_timer.report_statistics(input_timer.durations_normal_);
+    Timer output_timer(0, num_run, output_get_function, ctx, io_num.n_output, &outputs[0]);
+    output_timer.set_trace_name("rknn_outputs_get");
+    // 每轮先rknn_run产生新的输出(不计时)，否则连续的rknn_outputs_get只拷贝同一份已经取回的结果
+    output_timer.set_setup([&]()
+                           { benchmark_function(ctx); });
+    output_timer.run();
+    auto output_data = output_timer.report_statistics(output_timer.durations_normal_);
+
+    // 可选的后处理阶段: 输出反量化为fp32后做分类或检测后处理，与rknn_outputs_get一起计时，得到应用实际看到的输出延迟
+    PostprocessMode postprocess_mode = PostprocessMode::None;
+    parse_postprocess_mode(FLAGS_postprocess, postprocess_mode);
+    if (postprocess_mode != PostprocessMode::None)
+    {
+        std::vector<std::vector<float>> float_outputs(io_num.n_output);
+        for (int i = 0; i < io_num.n_output; i++)
+        {
+            float_outputs[i].resize(output_attrs[i].n_elems);
+        }
+        std::vector<size_t> dims(output_attrs[0].dims, output_attrs[0].dims + output_attrs[0].n_dims);
+        DetectParams params;
+        params.scoreThreshold = (float)FLAGS_score_threshold;
+        params.iouThreshold = (float)FLAGS_iou_threshold;
+        params.maxDetections = FLAGS_max_detections;
+        params.sigmoid = FLAGS_score_sigmoid;
+        PostprocessResult post_result;
+        bool supported = true;
+        auto postprocess_function = [&]()
+        {
+            for (int i = 0; i < io_num.n_output; i++)
+            {
+                supported = dequantize_output(output_attrs[i], outputs[i].buf, float_outputs[i].data()) && supported;
+            }
+            supported = run_postprocess(postprocess_mode, float_outputs[0].data(), dims, FLAGS_postprocess_topk, params, post_result) && supported;
+        };
+        auto output_postprocess_function = [&]()
+        {
+            int ret = rknn_outputs_get(ctx, io_num.n_output, outputs, nullptr);
+            if (ret < 0)
+            {
+                LOG(ERROR) << "rknn_outputs_get fail! ret=" << ret << "\n";
+            }
+            postprocess_function();
+            rknn_outputs_release(ctx, io_num.n_output, outputs);
+        };
+        auto end_to_end_function = [&]()
+        {
+            benchmark_function(ctx);
+            output_postprocess_function();
+        };
+        Timer postprocess_timer(num_warmup, num_run, postprocess_function);
+        postprocess_timer.set_trace_name("postprocess");
+        postprocess_timer.run();
+        auto postprocess_data = postprocess_timer.report_statistics(postprocess_timer.durations_normal_);
+        Timer output_postprocess_timer(num_warmup, num_run, output_postprocess_function);
+        output_postprocess_timer.set_trace_name("rknn_outputs_get + postprocess");
+        output_postprocess_timer.set_setup([&]()
+                                           { benchmark_function(ctx); });
+        output_postprocess_timer.run();
+        auto output_postprocess_data = output_postprocess_timer.report_statistics(output_postprocess_timer.durations_normal_);
+        Timer end_to_end_timer(num_warmup, num_run, end_to_end_function);
+        end_to_end_timer.set_trace_name("end to end");
+        end_to_end_timer.run();
+        auto end_to_end_data = end_to_end_timer.report_statistics(end_to_end_timer.durations_normal_);
+        if (!supported)
+        {
+            LOG(WARNING) << "Outputs do not fit the " << FLAGS_postprocess << " post-processing, only part of it was timed.";
+        }
+
+        nlohmann::json post_json;
+        post_json["Mode"] = FLAGS_postprocess;
+        post_json["Supported"] = supported;
+        post_json["AvgPostprocessLatency"] = postprocess_data.mean;
+        post_json["MinPostprocessLatency"] = postprocess_data.min;
+        post_json["AvgOutputWithPostprocessLatency"] = output_postprocess_data.mean;
+        post_json["AvgEndToEndLatency"] = end_to_end_data.mean;
+        post_json["StdEndToEndLatency"] = end_to_end_data.stdev;
+        post_json["MinEndToEndLatency"] = end_to_end_data.min;
+        post_json["MaxEndToEndLatency"] = end_to_end_data.max;
+        for (const auto &item : post_result.topk)
+        {
+            post_json["TopK"].push_back({{"Index", item.index}, {"Score", item.score}});
+        }
+        if (postprocess_mode == PostprocessMode::Detect)
+        {
+            post_json["Candidates"] = post_result.candidates.size();
+            post_json["Detections"] = post_result.detections.size();
+        }
+        result[model_name]["PostprocessResult"] = post_json;
+        LOG(INFO) << "Post-processing avg " << postprocess_data.mean << " us, run + outputs_get + post-processing avg " << end_to_end_data.mean << " us";
+    }
+
+    // 动态批处理曲线: 请求的输入直接写进批次输入，rknn_inputs_set直接使用批次缓冲区，输出按batch维拆回各请求
+    int model_batch = input_attrs[0].n_dims > 0 ? input_attrs[0].dims[0] : 1;
+    std::vector<double> batch_delays;
+    if (!FLAGS_batch_delays.empty() && model_batch > 1 && parse_delay_list(FLAGS_batch_delays, batch_delays))
+    {
+        BatcherConfig batch_config;
+        batch_config.maxBatch = model_batch;
+        std::vector<const void *> samples;
+        for (int i = 0; i < io_num.n_input; i++)
+        {
+            batch_config.inputSampleBytes.push_back(input_attrs[i].size / model_batch);
+            samples.push_back(input_provider.data(i));
+        }
+        for (int i = 0; i < io_num.n_output; i++)
+        {
+            batch_config.outputSampleBytes.push_back(output_attrs[i].size / model_batch);
+        }
+        std::vector<rknn_input> batch_inputs(inputs, inputs + io_num.n_input);
+        std::vector<rknn_output> batch_outputs(outputs, outputs + io_num.n_output);
+        // 模型按编译的批大小整批运行，输出直接写入批缓冲区，与实际请求数无关
+        BatchRunner runner = [&](const std::vector<uint8_t *> &batch_input_buffers, int, const std::vector<uint8_t *> &batch_output_buffers)
+        {
+            for (int i = 0; i < io_num.n_input; i++)
+            {
+                batch_inputs[i].buf = batch_input_buffers[i];
+            }
+            for (int i = 0; i < io_num.n_output; i++)
+            {
+                batch_outputs[i].buf = batch_output_buffers[i];
+            }
+            rknn_inputs_set(ctx, io_num.n_input, batch_inputs.data());
+            benchmark_function(ctx);
+            rknn_outputs_get(ctx, io_num.n_output, batch_outputs.data(), nullptr);
+            rknn_outputs_release(ctx, io_num.n_output, batch_outputs.data());
+        };
+        LoadConfig load;
+        load.requestRate = FLAGS_batch_request_rate;
+        load.numRequests = FLAGS_batch_requests;
+        std::vector<BatchingPoint> curve;
+        for (double delay : batch_delays)
+        {
+            batch_config.maxDelayUs = delay;
+            curve.push_back(run_batching_load(batch_config, runner, load, samples));
+            result[model_name]["BatchingResult"]["Curve"].push_back(batching_point_json(curve.back()));
+        }
+        result[model_name]["BatchingResult"]["RequestRate"] = FLAGS_batch_request_rate;
+        log_batching_curve(curve);
+        // 恢复单个请求的输入
+        rknn_inputs_set(ctx, io_num.n_input, inputs);
+    }
+
+    uint64_t input_bytes = 0;
+    for (int i = 0; i < io_num.n_input; i++)
+    {
+        nlohmann::json tensor;
+        tensor["Name"] = input_attrs[i].name;
+        tensor["Type"] = get_type_string(input_attrs[i].type);
+        tensor["Elements"] = input_attrs[i].n_elems;
+        tensor["ByteSize"] = input_attrs[i].size;
+        result[model_name]["IOResult"]["Inputs"].push_back(tensor);
+        input_bytes += input_attrs[i].size;
+    }
+    uint64_t output_bytes = 0;
+    for (int i = 0; i < io_num.n_output; i++)
+    {
+        nlohmann::json tensor;
+        tensor["Name"] = output_attrs[i].name;
+        tensor["Type"] = get_type_string(output_attrs[i].type);
+        tensor["Elements"] = output_attrs[i].n_elems;
+        tensor["ByteSize"] = output_attrs[i].size;
+        result[model_name]["IOResult"]["Outputs"].push_back(tensor);
+        output_bytes += output_attrs[i].size;
+    }
+    result[model_name]["IOResult"]["InputBytes"] = input_bytes;
+    result[model_name]["InputData"] = input_provider.describe();
+    result[model_name]["IOResult"]["OutputBytes"] = output_bytes;
+    result[model_name]["IOResult"]["AvgInputLatency"] = input_data.mean;
+    result[model_name]["IOResult"]["AvgOutputLatency"] = output_data.mean;
+    result[model_name]["IOResult"]["MinInputLatency"] = input_data.min;
+    result[model_name]["IOResult"]["MinOutputLatency"] = output_data.min;
     rknn_perf_detail perf_detail;
 
     // 在模型运行完成后，查询性能详情
@@ -226,23 +637,37 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
         
         // 使用模型名称作为键
         result[model_name]["RKNN_API_PerformanceDetail"] = perf_detail.perf_data;
-    }
 
-
-    for (int i = 0; i < io_num.n_input; i++)
-    {
-        if (inputs[i].buf != nullptr)
+        // 解析为结构化的算子记录，按类型汇总并给出热点算子和回退到CPU的算子
+        RknnPerfDetail parsed_detail;
+        if (parse_rknn_perf_detail(perf_detail.perf_data, parsed_detail))
         {
-            free(inputs[i].buf);
+            nlohmann::json operator_profile = operator_profile_json(parsed_detail.operators, FLAGS_profiling_topn);
+            if (parsed_detail.totalTimeUs >= 0)
+            {
+                operator_profile["ReportedTotalTime"] = parsed_detail.totalTimeUs;
+            }
+            if (parsed_detail.totalRwKB >= 0)
+            {
+                operator_profile["ReportedTotalRW"] = parsed_detail.totalRwKB;
+            }
+            result[model_name]["OperatorProfile"] = operator_profile;
+            log_operator_profile(model_name, parsed_detail.operators, FLAGS_profiling_topn);
+            // 时间线上放在最后一轮rknn_run的位置
+            TRACE_SPANS(model_name + " operators", "rknn_run", operator_trace_spans(parsed_detail.operators));
+        }
+        else
+        {
+            LOG(WARNING) << "Cannot parse the performance detail of " << model_name;
         }
     }
+
+
     for (int i = 0; i < io_num.n_output; i++)
     {
-        if (outputs[i].buf != nullptr)
-        {
-            free(outputs[i].buf);
-        }
+        host_tensor_pool().release(output_keys[i], outputs[i].buf);
     }
+    result[model_name]["TensorPool"] = host_tensor_pool().report();
 
  // // 获取RKNN版本信息
     rknn_sdk_version version;
@@ -256,9 +681,17 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
 
     rknn_destroy(ctx);
 
+    // 放置扫描为每种方式创建自己的上下文，在主上下文释放后进行
+    if (FLAGS_enable_placement_sweep)
+    {
+        placement_sweep(model, result[model_name]["PlacementResult"]);
+    }
+
     // 设置模型分析结果
     result[model_name]["RuntimeResult"]["Warmups"] = num_warmup;
     result[model_name]["RuntimeResult"]["Rounds"] = num_run;
+    // 计时器自身每轮的开销(空函数体)，需要时可以从各轮延迟中减去
+    result[model_name]["RuntimeResult"]["TimerOverhead"] = calibrate_timer().mean;
     result[model_name]["RuntimeResult"]["InitTime"] = init_time;
     result[model_name]["RuntimeResult"]["InitMemory"] = mem_size.total_weight_size / 1024.0 / 1024.0;  // 转换为 MB
     
@@ -266,7 +699,7 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
     result[model_name]["RuntimeResult"]["AvgTotalRoundLatency"] = std::get<1>(data).mean;
     result[model_name]["RuntimeResult"]["AvgPeakMemory"] = 
         (mem_size.total_weight_size + mem_size.total_internal_size) / 1024.0 / 1024.0;  // 总内存使用（MB）
-    result[model_name]["RuntimeResult"]["AvgPeakPower"] = 0.0;  // 如果有功耗数据，在这里设置
+    result[model_name]["RuntimeResult"]["AvgPeakPower"] = std::max(power, 0.0);  // 没有功耗数据时为0
     result[model_name]["RuntimeResult"]["StdTotalRoundLatency"] = std::get<1>(data).stdev;
     result[model_name]["RuntimeResult"]["MinTotalRoundLatency"] = std::get<1>(data).min;
     result[model_name]["RuntimeResult"]["MaxTotalRoundLatency"] = std::get<1>(data).max;
@@ -299,6 +732,21 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
     // 添加元数据信息
     result[model_name]["MetaInfo"]["ModelName"] = std::filesystem::path(model).filename().string();
     result[model_name]["MetaInfo"]["ModelPath"] = model;
+    result[model_name]["MetaInfo"]["ModelHash"] = model_hash_string(model_file_hash(model));
+
+    // 各后端共同格式的Summary
+    BenchmarkSummary summary = summarize_benchmark(logical_model_name(model), "RKNN", device_model_name("NPU"), timer.durations_normal_);
+    summary.modelFile = model_name;
+    summary.modelHash = result[model_name]["MetaInfo"]["ModelHash"];
+    summary.backendVersion = result[model_name]["MetaInfo"].value("BackendVersion", "");
+    summary.initTime = init_time;
+    summary.memory = (mem_size.total_weight_size + mem_size.total_internal_size) / 1024.0 / 1024.0;
+    if (result[model_name].contains("PlacementResult") && result[model_name]["PlacementResult"].contains("RecommendedForThroughput"))
+    {
+        summary.maxThroughput = result[model_name]["PlacementResult"]["RecommendedForThroughput"]["Throughput"];
+    }
+    set_summary_power(summary, power);
+    result[model_name]["Summary"] = benchmark_summary_json(summary);
     
     // 获取系统信息
     struct utsname system_info;
@@ -323,4 +771,260 @@ int batch_benchmark(const char *model, int num_warmup, int num_run, bool enable_
 
     LOG(INFO) << "Profiling model:" << model << " done!";
     return 0;
-}
\ No newline at end of file
+}
+
+// 共置场景和放置扫描中一个模型的上下文
+struct ScenarioSession
+{
+    rknn_context ctx = 0;
+    std::vector<rknn_input> inputs;
+    std::vector<rknn_output> outputs;
+    std::vector<PoolKey> outputKeys;
+    std::unique_ptr<InputProvider> inputProvider;
+};
+
+// 场景中没有指定核心时按优先级分配: 优先级最高的两个模型各独占一个核心，其余模型共享最后一个核心；
+// 指定的核心超出0-2时返回false
+static bool scenario_core_mask(const Scenario &scenario, size_t index, rknn_core_mask &core_mask)
+{
+    const ScenarioModel &model = scenario.models[index];
+    if (model.core > 2)
+    {
+        LOG(ERROR) << "Scenario model " << model.name << " asks for NPU core " << model.core << ", RKNN has cores 0 to 2";
+        return false;
+    }
+    if (model.core >= 0)
+    {
+        core_mask = (rknn_core_mask)(RKNN_NPU_CORE_0 << model.core);
+        return true;
+    }
+    int rank = 0;
+    for (size_t i = 0; i < scenario.models.size(); i++)
+    {
+        const ScenarioModel &other = scenario.models[i];
+        if (other.priority > model.priority || (other.priority == model.priority && i < index))
+        {
+            rank++;
+        }
+    }
+    core_mask = (rknn_core_mask)(RKNN_NPU_CORE_0 << std::min(rank, 2));
+    return true;
+}
+
+// fallback_to_auto为true时指定的核心不可用则退回RKNN_NPU_CORE_AUTO并修改core_mask，否则打开失败(放置扫描据此跳过该配置)
+static bool open_scenario_session(const ScenarioModel &model, rknn_core_mask &core_mask, ScenarioSession &session, bool fallback_to_auto)
+{
+    int ret = rknn_init(&session.ctx, (void *)model.model.c_str(), 0, 0, nullptr);
+    if (ret < 0)
+    {
+        LOG(ERROR) << "rknn_init fail! model=" << model.model << ", ret=" << ret;
+        return false;
+    }
+    ret = rknn_set_core_mask(session.ctx, core_mask);
+    if (ret < 0)
+    {
+        // 单核的芯片上只支持RKNN_NPU_CORE_AUTO
+        if (!fallback_to_auto)
+        {
+            LOG(ERROR) << "rknn_set_core_mask fail! model=" << model.model << ", core mask=" << core_mask << ", ret=" << ret;
+            return false;
+        }
+        LOG(WARNING) << "rknn_set_core_mask fail! model=" << model.model << ", core mask=" << core_mask << ", ret=" << ret << ", fall back to RKNN_NPU_CORE_AUTO";
+        core_mask = RKNN_NPU_CORE_AUTO;
+    }
+    rknn_input_output_num io_num;
+    ret = rknn_query(session.ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
+    if (ret != RKNN_SUCC)
+    {
+        LOG(ERROR) << "rknn_query fail! ret=" << ret;
+        return false;
+    }
+    std::vector<InputTensorInfo> input_infos;
+    session.inputs.resize(io_num.n_input);
+    for (uint32_t i = 0; i < io_num.n_input; i++)
+    {
+        rknn_tensor_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        if (rknn_query(session.ctx, RKNN_QUERY_INPUT_ATTR, &attr, sizeof(attr)) != RKNN_SUCC)
+        {
+            return false;
+        }
+        memset(&session.inputs[i], 0, sizeof(rknn_input));
+        session.inputs[i].index = i;
+        session.inputs[i].type = attr.type;
+        session.inputs[i].size = attr.size;
+        session.inputs[i].fmt = attr.fmt;
+        input_infos.push_back({attr.name, to_input_dtype(attr.type), attr.size});
+    }
+    InputSpec input_spec;
+    parse_input_spec(FLAGS_input_data, FLAGS_input_seed, input_spec);
+    session.inputProvider.reset(new InputProvider(input_spec));
+    if (!session.inputProvider->prepare(input_infos))
+    {
+        LOG(ERROR) << "Failed to prepare the input data: " << FLAGS_input_data;
+        return false;
+    }
+    for (uint32_t i = 0; i < io_num.n_input; i++)
+    {
+        session.inputs[i].buf = const_cast<void *>(session.inputProvider->data(i));
+    }
+    session.outputs.resize(io_num.n_output);
+    session.outputKeys.resize(io_num.n_output);
+    for (uint32_t i = 0; i < io_num.n_output; i++)
+    {
+        rknn_tensor_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        if (rknn_query(session.ctx, RKNN_QUERY_OUTPUT_ATTR, &attr, sizeof(attr)) != RKNN_SUCC)
+        {
+            return false;
+        }
+        memset(&session.outputs[i], 0, sizeof(rknn_output));
+        session.outputs[i].index = i;
+        session.outputs[i].size = attr.size;
+        session.outputs[i].is_prealloc = true;
+        if (!host_tensor_pool().acquire(attr.size, CACHE_LINE_SIZE, MemoryKind::Host, session.outputs[i].buf, session.outputKeys[i]))
+        {
+            return false;
+        }
+    }
+    LOG(INFO) << "Scenario model " << model.name << ": " << model.model << ", core mask " << core_mask;
+    return true;
+}
+
+static void run_scenario_session(ScenarioSession &session)
+{
+    TRACE_BEGIN("rknn_inputs_set");
+    rknn_inputs_set(session.ctx, session.inputs.size(), session.inputs.data());
+    TRACE_END("rknn_inputs_set");
+    TRACE_BEGIN("rknn_run");
+    int ret = rknn_run(session.ctx, nullptr);
+    TRACE_END("rknn_run");
+    if (ret < 0)
+    {
+        LOG(ERROR) << "rknn_run fail! ret=" << ret;
+    }
+    TRACE_BEGIN("rknn_outputs_get");
+    rknn_outputs_get(session.ctx, session.outputs.size(), session.outputs.data(), nullptr);
+    rknn_outputs_release(session.ctx, session.outputs.size(), session.outputs.data());
+    TRACE_END("rknn_outputs_get");
+}
+
+static void close_scenario_session(ScenarioSession &session)
+{
+    for (size_t i = 0; i < session.outputs.size(); i++)
+    {
+        if (session.outputs[i].buf)
+        {
+            host_tensor_pool().release(session.outputKeys[i], session.outputs[i].buf);
+            session.outputs[i].buf = nullptr;
+        }
+    }
+    if (session.ctx)
+    {
+        rknn_destroy(session.ctx);
+        session.ctx = 0;
+    }
+}
+
+int scenario_benchmark(const std::string &path, nlohmann::json &result)
+{
+    Scenario scenario;
+    if (!load_scenario(path, scenario))
+    {
+        return -1;
+    }
+    // 每个模型一个rknn上下文，RKNN没有任务优先级，优先级通过核心分配体现
+    std::vector<ScenarioSession> sessions(scenario.models.size());
+    std::vector<std::function<void()>> infers;
+    std::vector<rknn_core_mask> core_masks;
+    int ret = 0;
+    for (size_t i = 0; i < scenario.models.size(); i++)
+    {
+        core_masks.push_back(RKNN_NPU_CORE_AUTO);
+        if (!scenario_core_mask(scenario, i, core_masks[i]) || !open_scenario_session(scenario.models[i], core_masks[i], sessions[i], true))
+        {
+            ret = -1;
+            break;
+        }
+        ScenarioSession *session = &sessions[i];
+        infers.push_back([session]()
+                         { run_scenario_session(*session); });
+    }
+    if (ret == 0)
+    {
+        nlohmann::json colocation = run_colocation(scenario, infers);
+        for (size_t i = 0; i < scenario.models.size(); i++)
+        {
+            colocation["Models"][i]["CoreMask"] = (int)core_masks[i];
+        }
+        result["ColocationResult"] = colocation;
+        result["MetaInfo"]["BackendName"] = "RKNN";
+        result["MetaInfo"]["Scenario"] = path;
+    }
+    for (auto &session : sessions)
+    {
+        close_scenario_session(session);
+    }
+    return ret;
+}
+
+// 放置方式: 每个核心单独运行、一个请求跨前两个/全部核心(驱动在核心之间切分算子)、每个核心一个上下文的数据并行、驱动自动分配
+static std::vector<PlacementConfig> rknn_placements(int cores)
+{
+    std::vector<PlacementConfig> configs;
+    for (int core = 0; core < cores; core++)
+    {
+        configs.push_back({"core" + std::to_string(core), 1, {{"CoreMasks", {RKNN_NPU_CORE_0 << core}}}});
+    }
+    if (cores >= 2)
+    {
+        configs.push_back({"core0_1", 1, {{"CoreMasks", {RKNN_NPU_CORE_0_1}}}});
+    }
+    if (cores >= 3)
+    {
+        configs.push_back({"core0_1_2", 1, {{"CoreMasks", {RKNN_NPU_CORE_0_1_2}}}});
+    }
+    if (cores >= 2)
+    {
+        nlohmann::json masks = nlohmann::json::array();
+        for (int core = 0; core < cores; core++)
+        {
+            masks.push_back(RKNN_NPU_CORE_0 << core);
+        }
+        configs.push_back({"dp" + std::to_string(cores), cores, {{"CoreMasks", masks}}});
+    }
+    configs.push_back({"auto", 1, {{"CoreMasks", {RKNN_NPU_CORE_AUTO}}}});
+    return configs;
+}
+
+int placement_sweep(const char *model, nlohmann::json &result)
+{
+    ScenarioModel placement_model;
+    placement_model.name = std::filesystem::path(model).filename().string();
+    placement_model.model = model;
+    // 每种放置方式重新创建上下文，上下文由推理函数共享持有，扫描完一种方式后释放
+    PlacementSetup setup = [&](const PlacementConfig &config, std::vector<std::function<void()>> &infers)
+    {
+        for (int instance = 0; instance < config.instances; instance++)
+        {
+            std::shared_ptr<ScenarioSession> session(new ScenarioSession(), [](ScenarioSession *session)
+                                                     {
+                close_scenario_session(*session);
+                delete session; });
+            rknn_core_mask core_mask = (rknn_core_mask)config.settings["CoreMasks"][instance].get<int>();
+            if (!open_scenario_session(placement_model, core_mask, *session, false))
+            {
+                return false;
+            }
+            infers.push_back([session]()
+                             { run_scenario_session(*session); });
+        }
+        return true;
+    };
+    std::vector<PlacementResult> results = run_placement_sweep(rknn_placements(FLAGS_placement_cores), setup, FLAGS_num_warmup, FLAGS_num_run);
+    log_placement_sweep(placement_model.name, results);
+    result = placement_sweep_json(results);
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "RknnPerfDetail.hpp"
+
+// 保存下来的RKNN_QUERY_PERF_DETAIL文本，包含CPU算子(MacUsage为空)、\表示的空形状、超出列宽的形状和末尾的汇总
+DEFINE_string(perf_detail, "source/rknn2/testdata/perf_detail.txt", "The perf_detail text captured from rknn_query.");
+
+// 不需要rknn_api.h和板子，检查parse_rknn_perf_detail对保存的文本的解析结果；返回值: 0通过，1有检查失败，2文件错误
+int failures = 0;
+
+template <typename T>
+void check_equal(const std::string &what, const T &actual, const T &expected)
+{
+    if (!(actual == expected))
+    {
+        LOG(ERROR) << what << ": expected " << expected << ", got " << actual;
+        failures++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;
+    FLAGS_colorlogtostderr = true;
+    FLAGS_log_prefix = true;
+    FLAGS_logbufsecs = 0;
+
+    std::ifstream file(FLAGS_perf_detail);
+    if (!file)
+    {
+        LOG(ERROR) << "Failed to open " << FLAGS_perf_detail;
+        return 2;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    RknnPerfDetail detail;
+    if (!parse_rknn_perf_detail(text.str(), detail))
+    {
+        LOG(ERROR) << "No operator is parsed from " << FLAGS_perf_detail;
+        return 1;
+    }
+
+    // 只有Network Layer Information Table中的行是算子，Operator Time Consuming Ranking Table被跳过
+    check_equal("operators", detail.operators.size(), (size_t)8);
+    check_equal("TotalTime", detail.totalTimeUs, 4175.0);
+    check_equal("TotalRW", detail.totalRwKB, 3806.0);
+    double sum = 0;
+    for (const auto &record : detail.operators)
+    {
+        sum += record.timeUs;
+    }
+    check_equal("sum of Time", sum, detail.totalTimeUs);
+    if (detail.operators.size() == 8)
+    {
+        const OperatorRecord &input = detail.operators[0];
+        check_equal("input InputShape", input.inputShape, std::string());
+        check_equal("input OutputShape", input.outputShape, std::string("(1,3,224,224)"));
+        check_equal("input MacUsage", input.macUsage, -1.0);
+        check_equal("input WorkLoad is not taken as RW", input.rwKB, 0.0);
+        check_equal("input fallback", input.fallback, false);
+
+        const OperatorRecord &conv = detail.operators[1];
+        check_equal("conv id", conv.id, 2);
+        check_equal("conv OpType", conv.opType, std::string("ConvRelu"));
+        check_equal("conv DataType", conv.execType, std::string("UINT8"));
+        check_equal("conv Target", conv.target, std::string("NPU"));
+        check_equal("conv Cycles", conv.cycles, (int64_t)28224);
+        check_equal("conv Time", conv.timeUs, 348.0);
+        check_equal("conv MacUsage", conv.macUsage, 0.34);
+        check_equal("conv RW", conv.rwKB, 150.0);
+        check_equal("conv FullName", conv.name, std::string("Conv:Conv_0"));
+
+        // 输入形状比列宽，后面的单元格整体右移
+        const OperatorRecord &wide = detail.operators[3];
+        check_equal("wide InputShape", wide.inputShape, std::string("(1,32,112,112),(64,32,1,1),(64),(1,64,112,112)"));
+        check_equal("wide OutputShape", wide.outputShape, std::string("(1,64,112,112)"));
+        check_equal("wide Cycles", wide.cycles, (int64_t)37632);
+        check_equal("wide Time", wide.timeUs, 274.0);
+        check_equal("wide MacUsage", wide.macUsage, 1.46);
+        check_equal("wide RW", wide.rwKB, 784.0);
+        check_equal("wide FullName", wide.name, std::string("Conv:Conv_4"));
+
+        // CPU上的算子MacUsage为空，后面的WorkLoad不能错位成MacUsage
+        const OperatorRecord &softmax = detail.operators[5];
+        check_equal("softmax Target", softmax.target, std::string("CPU"));
+        check_equal("softmax Time", softmax.timeUs, 2036.0);
+        check_equal("softmax MacUsage", softmax.macUsage, -1.0);
+        check_equal("softmax RW", softmax.rwKB, 1568.0);
+        check_equal("softmax FullName", softmax.name, std::string("Softmax:Softmax_7"));
+        check_equal("softmax fallback", softmax.fallback, true);
+
+        // FullName含空格
+        check_equal("fc FullName", detail.operators[6].name, std::string("Conv:Conv_9 fc"));
+
+        const OperatorRecord &output = detail.operators[7];
+        check_equal("output OutputShape", output.outputShape, std::string());
+        check_equal("output fallback", output.fallback, false);
+    }
+
+    int fallbacks = 0;
+    for (const auto &record : detail.operators)
+    {
+        fallbacks += record.fallback;
+    }
+    check_equal("fallbacks", fallbacks, 2);
+
+    if (failures > 0)
+    {
+        LOG(ERROR) << failures << " check(s) failed on " << FLAGS_perf_detail;
+        return 1;
+    }
+    LOG(INFO) << "All checks passed on " << FLAGS_perf_detail;
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "glog/logging.h"
+#include "gflags/gflags.h"
+#include "tabulate.hpp"
+#include "nlohmann/json.hpp"
+#include "BenchmarkSummary.hpp"
+
+// arch_test生成的硬件画像
+DEFINE_string(hardware_profile, "output/arch_profile.json", "The file path to the hardware profile json generated by arch_test.");
+
+// 各后端生成的结果文件，逗号分隔
+DEFINE_string(results, "output/rknn_profile_result.json", "Comma separated result json files generated by the backend drivers.");
+
+// 输出文件路径
+DEFINE_string(output_file, "output/roofline_report.json", "The file path to the output json file.");
+DEFINE_string(output_csv, "output/roofline_report.csv", "The file path to the output csv file.");
+
+// host I/O时间占端到端时间的比例超过该阈值时，认为模型受host拷贝限制
+DEFINE_double(host_bound_fraction, 0.5, "Models whose host I/O share of the end-to-end latency exceeds this fraction are reported as host copy bound.");
+
+struct HostCeilings {
+    double copyMBps = 0;
+    double readMBps = 0;
+    double writeMBps = 0;
+    // 各数据类型全部核心的峰值算力(GFLOPS/GOPS)
+    std::vector<std::pair<std::string, double>> computePeaks;
+};
+
+struct RooflineEntry {
+    std::string modelName;
+    std::string backend;
+    uint64_t inputBytes = 0;
+    uint64_t outputBytes = 0;
+    double inputLatency = 0;   // us
+    double outputLatency = 0;  // us
+    double acceleratorLatency = 0; // us，计时循环中只包含推理本身
+    double effectiveMBps = 0;
+    double bandwidthUtilization = 0;
+    double hostCopyFloor = 0;  // us，以host峰值拷贝带宽搬运全部I/O所需的最短时间
+    double hostIOFraction = 0;
+    std::string bound;
+};
+
+std::vector<std::string> split(const std::string &text, char delimiter)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, delimiter))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+HostCeilings load_host_ceilings(const std::string &path)
+{
+    HostCeilings ceilings;
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Cannot open hardware profile: " << path;
+        return ceilings;
+    }
+    nlohmann::json profile = nlohmann::json::parse(file, nullptr, false);
+    if (profile.is_discarded() || !profile.is_object())
+    {
+        LOG(ERROR) << "Invalid hardware profile: " << path;
+        return ceilings;
+    }
+    if (profile.contains("MemoryBandwidth"))
+    {
+        ceilings.copyMBps = profile["MemoryBandwidth"].value("CopyMBps", 0.0);
+        ceilings.readMBps = profile["MemoryBandwidth"].value("ReadMBps", 0.0);
+        ceilings.writeMBps = profile["MemoryBandwidth"].value("WriteMBps", 0.0);
+    }
+    else
+    {
+        LOG(WARNING) << "Hardware profile has no MemoryBandwidth, run arch_test with --enable_memory_bandwidth.";
+    }
+    if (profile.contains("ComputePeak"))
+    {
+        for (const auto &kernel : profile["ComputePeak"]["Kernels"])
+        {
+            ceilings.computePeaks.push_back({kernel["Name"].get<std::string>() + " (" + kernel["Unit"].get<std::string>() + ")",
+                                             kernel["AllCores"].value("ThroughputBound", 0.0)});
+        }
+    }
+    return ceilings;
+}
+
+// 结果文件是 [{model_name: {MetaInfo, RuntimeResult, IOResult}}, ...]
+std::vector<RooflineEntry> load_entries(const std::string &path, const HostCeilings &ceilings)
+{
+    std::vector<RooflineEntry> entries;
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOG(ERROR) << "Cannot open result file: " << path;
+        return entries;
+    }
+    nlohmann::json results = nlohmann::json::parse(file, nullptr, false);
+    if (results.is_discarded() || !results.is_array())
+    {
+        LOG(ERROR) << "Invalid result file: " << path;
+        return entries;
+    }
+    for (const auto &model_result : results)
+    {
+        for (const auto &item : model_result.items())
+        {
+            const auto &result = item.value();
+            if (!result.contains("IOResult") || !result.contains("RuntimeResult"))
+            {
+                LOG(WARNING) << "Skip " << item.key() << " in " << path << ": no IOResult/RuntimeResult";
+                continue;
+            }
+            RooflineEntry entry;
+            entry.modelName = item.key();
+            entry.backend = result.contains("MetaInfo") ? result["MetaInfo"].value("BackendName", "") : "";
+            entry.inputBytes = result["IOResult"].value("InputBytes", (uint64_t)0);
+            entry.outputBytes = result["IOResult"].value("OutputBytes", (uint64_t)0);
+            entry.inputLatency = result["IOResult"].value("AvgInputLatency", 0.0);
+            entry.outputLatency = result["IOResult"].value("AvgOutputLatency", 0.0);
+            entry.acceleratorLatency = result["RuntimeResult"].value("AvgTotalRoundLatency", 0.0);
+
+            double ioBytes = (double)(entry.inputBytes + entry.outputBytes);
+            double ioLatency = entry.inputLatency + entry.outputLatency;
+            // bytes / us == MB/s
+            entry.effectiveMBps = ioLatency > 0 ? ioBytes / ioLatency : 0;
+            entry.bandwidthUtilization = ceilings.copyMBps > 0 ? entry.effectiveMBps / ceilings.copyMBps : 0;
+            entry.hostCopyFloor = ceilings.copyMBps > 0 ? ioBytes / ceilings.copyMBps : 0;
+            double endToEnd = ioLatency + entry.acceleratorLatency;
+            entry.hostIOFraction = endToEnd > 0 ? ioLatency / endToEnd : 0;
+            entry.bound = entry.hostIOFraction >= FLAGS_host_bound_fraction ? "HostCopy" : "Accelerator";
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+int main(int argc, char **argv)
+{
+    gflags::ParseCommandLineNonHelpFlags(&argc, &argv, true);
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = true;      // 设置日志消息是否转到标准输出而不是日志文件
+    FLAGS_alsologtostderr = true;  // 设置日志消息除了日志文件之外是否去标准输出
+    FLAGS_colorlogtostderr = true; // 设置记录到标准输出的颜色消息（如果终端支持）
+    FLAGS_log_prefix = true;       // 设置日志前缀是否应该添加到每行输出
+    FLAGS_logbufsecs = 0;          // 设置可以缓冲日志的最大秒数，0指实时输出
+
+    HostCeilings ceilings = load_host_ceilings(FLAGS_hardware_profile);
+    std::vector<RooflineEntry> entries;
+    for (const auto &path : split(FLAGS_results, ','))
+    {
+        auto fileEntries = load_entries(path, ceilings);
+        entries.insert(entries.end(), fileEntries.begin(), fileEntries.end());
+    }
+    // host I/O占比高的排在前面
+    std::sort(entries.begin(), entries.end(), [](const RooflineEntry &a, const RooflineEntry &b)
+              { return a.hostIOFraction > b.hostIOFraction; });
+
+    nlohmann::json report;
+    report["HostCeilings"]["CopyMBps"] = ceilings.copyMBps;
+    report["HostCeilings"]["ReadMBps"] = ceilings.readMBps;
+    report["HostCeilings"]["WriteMBps"] = ceilings.writeMBps;
+    for (const auto &peak : ceilings.computePeaks)
+    {
+        report["HostCeilings"]["ComputePeak"][peak.first] = peak.second;
+    }
+    report["HostBoundFraction"] = FLAGS_host_bound_fraction;
+
+    std::filesystem::path csv_path(FLAGS_output_csv);
+    if (csv_path.has_parent_path())
+    {
+        std::filesystem::create_directories(csv_path.parent_path());
+    }
+    std::ofstream csv_file(FLAGS_output_csv);
+    csv_file << "model,backend,input_bytes,output_bytes,input_us,output_us,accelerator_us,effective_mbps,bandwidth_utilization,host_copy_floor_us,host_io_fraction,bound\n";
+
+    tabulate::Table rooflineTable;
+    rooflineTable.add_row({"model", "backend", "io(KB)", "io(us)", "npu(us)", "eff(MB/s)", "util", "floor(us)", "io share", "bound"});
+    for (const auto &entry : entries)
+    {
+        nlohmann::json item;
+        item["ModelName"] = entry.modelName;
+        item["BackendName"] = entry.backend;
+        item["InputBytes"] = entry.inputBytes;
+        item["OutputBytes"] = entry.outputBytes;
+        item["AvgInputLatency"] = entry.inputLatency;
+        item["AvgOutputLatency"] = entry.outputLatency;
+        item["AvgAcceleratorLatency"] = entry.acceleratorLatency;
+        item["EffectiveHostBandwidthMBps"] = entry.effectiveMBps;
+        item["HostBandwidthUtilization"] = entry.bandwidthUtilization;
+        item["HostCopyFloorLatency"] = entry.hostCopyFloor;
+        item["HostIOFraction"] = entry.hostIOFraction;
+        item["Bound"] = entry.bound;
+        report["Models"].push_back(item);
+
+        csv_file << summary_csv_string(entry.modelName) << "," << summary_csv_string(entry.backend) << "," << entry.inputBytes << "," << entry.outputBytes << ","
+                 << entry.inputLatency << "," << entry.outputLatency << "," << entry.acceleratorLatency << ","
+                 << entry.effectiveMBps << "," << entry.bandwidthUtilization << "," << entry.hostCopyFloor << ","
+                 << entry.hostIOFraction << "," << summary_csv_string(entry.bound) << "\n";
+
+        rooflineTable.add_row({entry.modelName,
+                               entry.backend,
+                               std::to_string((entry.inputBytes + entry.outputBytes) / 1024.0),
+                               std::to_string(entry.inputLatency + entry.outputLatency),
+                               std::to_string(entry.acceleratorLatency),
+                               std::to_string(entry.effectiveMBps),
+                               std::to_string(entry.bandwidthUtilization),
+                               std::to_string(entry.hostCopyFloor),
+                               std::to_string(entry.hostIOFraction),
+                               entry.bound});
+    }
+    for (size_t i = 0; i < 10; ++i)
+    {
+        rooflineTable[0][i].format().font_color(tabulate::Color::yellow).font_align(tabulate::FontAlign::center).font_style({tabulate::FontStyle::bold});
+    }
+    LOG(INFO) << "Host copy ceiling: " << ceilings.copyMBps << " MB/s, read: " << ceilings.readMBps << " MB/s, write: " << ceilings.writeMBps << " MB/s";
+    for (const auto &peak : ceilings.computePeaks)
+    {
+        LOG(INFO) << "Host compute ceiling " << peak.first << ": " << peak.second;
+    }
+    LOG(INFO) << "\n"
+              << rooflineTable << "\n";
+
+    std::filesystem::path json_path(FLAGS_output_file);
+    if (json_path.has_parent_path())
+    {
+        std::filesystem::create_directories(json_path.parent_path());
+    }
+    std::ofstream json_file(FLAGS_output_file);
+    json_file << std::setw(4) << report << std::endl;
+
+    google::ShutdownGoogleLogging();
+    return 0;
+}